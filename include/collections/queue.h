@@ -91,6 +91,14 @@ const int es_validate_queue(struct es_queue *queue);
  */
 const int es_check_queue_is_empty(struct es_queue *queue);
 
+/**
+ * Gets the number of elements stored in the specified queue.
+ *
+ * @param queue The queue to be checked.
+ * @return The number of elements in the given queue, 0 if the queue is invalid.
+ */
+const int es_get_queue_length(struct es_queue *queue);
+
 /**
  * Pushes the given element in the queue.
  *
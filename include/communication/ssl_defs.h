@@ -34,6 +34,8 @@
 
 #define ES_DEFAULT_BACKLOG_SIZE 10
 #define ES_DEFAULT_CONNECTION_BUFFER_SIZE 128
+#define ES_DEFAULT_CONNECTION_TIMEOUT 5
+#define ES_DEFAULT_LISTENER_TIMEOUT 1
 
 typedef const int (*es_process_ssl_server_request_function)(
 	const void *in_buff,
@@ -41,4 +43,12 @@ typedef const int (*es_process_ssl_server_request_function)(
 	void *out_buff,
 	int *out_buff_size);
 
+struct es_ssl_descriptor;
+
+typedef const int (*es_stream_ssl_server_request_function)(
+	const void *in_buff,
+	const int in_buff_size,
+	struct es_ssl_descriptor *descriptor,
+	int *handled);
+
 #endif /* ENTROPY_SOURCE_COMMUNICATION_SSL_DEFS_H_ */
@@ -74,6 +74,12 @@ const int es_read_ssl_descriptor(
 	void *buffer,
 	const int size);
 
+const int es_receive_ssl_descriptor(
+	struct es_ssl_descriptor *descriptor,
+	void *buffer,
+	const int size,
+	int *length);
+
 const int es_write_ssl_descriptor(
 	struct es_ssl_descriptor *descriptor,
 	const void *buffer,
@@ -54,4 +54,10 @@ const int es_run_ssl_server(
 	const int port,
 	es_process_ssl_server_request_function process_request);
 
+const int es_run_ssl_stream_server(
+	struct es_ssl_context *context,
+	const int port,
+	es_process_ssl_server_request_function process_request,
+	es_stream_ssl_server_request_function stream_request);
+
 #endif /* ENTROPY_SOURCE_COMMUNICATION_SSL_SERVER_H_ */
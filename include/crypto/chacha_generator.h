@@ -0,0 +1,156 @@
+/**
+ * Copyright (c) 2016, Codrin-Victor Poienaru <cvpoienaru@gmail.com>.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * This software is provided by the copyright holders and contributors "as is"
+ * and any express or implied warranties, including, but not limited to, the
+ * implied warranties of merchantability and fitness for a particular purpose
+ * are disclaimed. In no event shall the copyright holder or contributors be
+ * liable for any direct, indirect, incidental, special, exemplary, or
+ * consequential damages (including, but not limited to, procurement of
+ * substitute goods or services; loss of use, data, or profits; or business
+ * interruption) however caused and on any theory of liability, whether in
+ * contract, strict liability, or tort (including negligence or otherwise)
+ * arising in any way out of the use of this software, even if advised of the
+ * possibility of such damage.
+ */
+
+#ifndef ENTROPY_SOURCE_CRYPTO_CHACHA_GENERATOR_H_
+#define ENTROPY_SOURCE_CRYPTO_CHACHA_GENERATOR_H_
+
+#include <stdlib.h>
+
+#include <openssl/evp.h>
+
+#include <global/defs.h>
+
+/** The size in bytes of the ChaCha20 key. */
+#define ES_CHACHA_KEY_SIZE 32
+
+/** The size in bytes of the ChaCha20 nonce. */
+#define ES_CHACHA_NONCE_SIZE 12
+
+/** The size in bytes of the ChaCha20 initialization vector (counter + nonce). */
+#define ES_CHACHA_IV_SIZE 16
+
+/**
+ * The minimum size in bytes of the seed material used to key or rekey the
+ * generator.
+ */
+#define ES_CHACHA_MINIMUM_SEED_SIZE 32
+
+/**
+ * The number of output bytes produced under a single key. After each chunk
+ * the generator draws a fresh key from its own keystream and erases the
+ * previous one (fast key erasure).
+ */
+#define ES_CHACHA_CHUNK_SIZE (64 * 1024)
+
+/**
+ * Structure defining a ChaCha20 keystream generator with fast key erasure.
+ * The keystream is produced by the OpenSSL ChaCha20 implementation, which
+ * selects its AVX2/AVX-512 kernels at runtime.
+ */
+struct es_chacha_generator {
+	/** The current key followed by the current nonce. */
+	unsigned char key[ES_CHACHA_KEY_SIZE + ES_CHACHA_NONCE_SIZE];
+
+	/** The number of bytes generated since the generator was last seeded. */
+	long generated_bytes;
+
+	/** Indicates whether the generator was seeded. */
+	int seeded;
+
+	/** The ChaCha20 cipher context. */
+	EVP_CIPHER_CTX *context;
+};
+
+/**
+ * Allocates memory for a ChaCha20 generator.
+ *
+ * @return The address of a newly allocated ChaCha20 generator if the operation
+ * was successfull, NULL otherwise.
+ */
+struct es_chacha_generator* es_alloc_chacha_generator(void);
+
+/**
+ * Frees the memory used by a ChaCha20 generator. The generator key is wiped.
+ *
+ * @param generator The ChaCha20 generator to be freed.
+ */
+void es_free_chacha_generator(struct es_chacha_generator **generator);
+
+/**
+ * Initializes a ChaCha20 generator with the default values. The generator
+ * must still be seeded before use.
+ *
+ * @param generator The ChaCha20 generator to be initialized.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_init_chacha_generator(struct es_chacha_generator *generator);
+
+/**
+ * Creates a ChaCha20 generator.
+ *
+ * @return The address of a newly allocated ChaCha20 generator if the operation
+ * was successfull, NULL otherwise.
+ */
+struct es_chacha_generator* es_create_chacha_generator(void);
+
+/**
+ * Destroys a ChaCha20 generator.
+ *
+ * @param generator The ChaCha20 generator to be destroyed.
+ */
+void es_destroy_chacha_generator(struct es_chacha_generator **generator);
+
+/**
+ * Validates a ChaCha20 generator.
+ *
+ * @param generator The ChaCha20 generator to be validated.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_validate_chacha_generator(struct es_chacha_generator *generator);
+
+/**
+ * Seeds a ChaCha20 generator. The new key and nonce are derived with SHA-512
+ * from the current generator output and the seed material, so reseeding never
+ * discards entropy already held by the generator.
+ *
+ * @param generator The ChaCha20 generator to be seeded.
+ * @param seed The seed material (e.g. a clean entropy block).
+ * @param seed_length The number of bytes of seed material, at least
+ * ES_CHACHA_MINIMUM_SEED_SIZE.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_seed_chacha_generator(
+	struct es_chacha_generator *generator,
+	const char *seed,
+	const int seed_length);
+
+/**
+ * Generates keystream bytes from a ChaCha20 generator. The key is replaced
+ * with fresh keystream after every ES_CHACHA_CHUNK_SIZE bytes and at the end
+ * of the request, so earlier output cannot be recovered from the state.
+ *
+ * @param generator The ChaCha20 generator used to generate the bytes.
+ * @param output The buffer where to write the generated bytes.
+ * @param output_length The number of bytes to be generated.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_generate_chacha_generator(
+	struct es_chacha_generator *generator,
+	char *output,
+	const long output_length);
+
+#endif /* ENTROPY_SOURCE_CRYPTO_CHACHA_GENERATOR_H_ */
@@ -0,0 +1,96 @@
+/**
+ * Copyright (c) 2016, Codrin-Victor Poienaru <cvpoienaru@gmail.com>.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * This software is provided by the copyright holders and contributors "as is"
+ * and any express or implied warranties, including, but not limited to, the
+ * implied warranties of merchantability and fitness for a particular purpose
+ * are disclaimed. In no event shall the copyright holder or contributors be
+ * liable for any direct, indirect, incidental, special, exemplary, or
+ * consequential damages (including, but not limited to, procurement of
+ * substitute goods or services; loss of use, data, or profits; or business
+ * interruption) however caused and on any theory of liability, whether in
+ * contract, strict liability, or tort (including negligence or otherwise)
+ * arising in any way out of the use of this software, even if advised of the
+ * possibility of such damage.
+ */
+
+#ifndef ENTROPY_SOURCE_CRYPTO_CPU_DISPATCH_H_
+#define ENTROPY_SOURCE_CRYPTO_CPU_DISPATCH_H_
+
+#include <stdlib.h>
+
+#include <global/defs.h>
+
+/** Represents the portable scalar kernel variant. */
+#define ES_CPU_SCALAR 0
+
+/** Represents the SSE2 kernel variant. */
+#define ES_CPU_SSE2 1
+
+/** Represents the AVX2 kernel variant. */
+#define ES_CPU_AVX2 2
+
+/** Represents the AVX-512 kernel variant. */
+#define ES_CPU_AVX512 3
+
+/** Represents the number of kernel variants. */
+#define ES_CPU_LEVEL_COUNT 4
+
+/**
+ * Represents the environment variable used to force a kernel variant, e.g.
+ * ES_CPU_DISPATCH=scalar, for benchmarking. Variants the running CPU does not
+ * support are lowered to the best supported one.
+ */
+#define ES_CPU_DISPATCH_ENV "ES_CPU_DISPATCH"
+
+/**
+ * Gets the kernel variant selected for the running CPU. CPUID is probed once,
+ * at the first call, and the environment override is applied. Outside x86 the
+ * scalar variant is always selected.
+ *
+ * @return The selected kernel variant, one of the ES_CPU_* codes above.
+ */
+const int es_get_cpu_level(void);
+
+/**
+ * Checks whether the running CPU implements the SHA extensions. The digest
+ * backends delegate to OpenSSL, which uses SHA-NI on its own when present.
+ *
+ * @return TRUE if the SHA extensions are available, FALSE otherwise.
+ */
+const int es_cpu_supports_sha(void);
+
+/**
+ * Gets the name of the specified kernel variant.
+ *
+ * @param level The kernel variant.
+ * @return The name of the kernel variant, or NULL if the variant is invalid.
+ */
+const char* es_get_cpu_level_name(const int level);
+
+/**
+ * Selects a kernel among its variants, according to the kernel variant
+ * selected for the running CPU. The widest available variant not above the
+ * selected one is returned.
+ *
+ * @param name The kernel name, used when logging the choice.
+ * @param kernels The kernel variants, indexed by the ES_CPU_* codes. Missing
+ * variants are NULL; the scalar variant must be present unless the caller keeps
+ * its own fallback.
+ * @return The selected kernel variant, or NULL if only the missing scalar
+ * variant is left.
+ */
+void* es_select_cpu_kernel(const char *name, void * const *kernels);
+
+#endif /* ENTROPY_SOURCE_CRYPTO_CPU_DISPATCH_H_ */
@@ -32,18 +32,42 @@
 #include <string.h>
 
 #include <global/defs.h>
+#include <crypto/digest_backend.h>
 
 /** The MD5 digest algorithm code. */
-#define ES_MD5_DIGEST G_CHECKSUM_MD5
+#define ES_MD5_DIGEST 0
 
 /** The SHA-1 digest algorithm code. */
-#define ES_SHA1_DIGEST G_CHECKSUM_SHA1
+#define ES_SHA1_DIGEST 1
 
 /** The SHA-2 256-bit digest algorithm code. */
-#define ES_SHA256_DIGEST G_CHECKSUM_SHA256
+#define ES_SHA256_DIGEST 2
 
 /** The SHA-2 512-bit digest algorithm code. */
-#define ES_SHA512_DIGEST G_CHECKSUM_SHA512
+#define ES_SHA512_DIGEST 3
+
+/** The BLAKE2b 512-bit digest algorithm code. */
+#define ES_BLAKE2B_DIGEST 4
+
+/**
+ * The HKDF-SHA-512 keyed extractor code. As a plain digest it behaves like
+ * SHA-2 512-bit. As an entropy block digest type, blocks are conditioned with
+ * HKDF extract/expand instead of XOR and hash.
+ */
+#define ES_HKDF_SHA512_DIGEST 5
+
+/**
+ * The SHA-512 Merkle tree hash code. As a plain digest it behaves like SHA-2
+ * 512-bit. As an entropy block digest type, the combined block is hashed in
+ * tree mode, with the leaves hashed in parallel for large blocks.
+ */
+#define ES_TREE_SHA512_DIGEST 6
+
+/** The number of supported digest algorithms. */
+#define ES_DIGEST_TYPE_COUNT 7
+
+/** The size in bytes of the largest supported raw digest (512-bit). */
+#define ES_MAXIMUM_DIGEST_SIZE 64
 
 /** Represents the definition of a basic digest abstraction. */
 struct es_digest {
@@ -53,8 +77,17 @@ struct es_digest {
 	 */
 	int type;
 
-	/** The underlying digest algorithm from GLib. */
-	GChecksum *algorithm;
+	/**
+	 * The digest backend code representing the library implementing the
+	 * chosen digest algorithm.
+	 */
+	int backend;
+
+	/** The operations of the digest backend. */
+	const struct es_digest_backend *operations;
+
+	/** The underlying digest algorithm context of the backend. */
+	void *algorithm;
 };
 
 /**
@@ -62,10 +95,14 @@ struct es_digest {
  *
  * @param digest_type The digest type is one of the above digest algorithm
  * codes representing the chosen digest algorithm.
+ * @param digest_backend The digest backend code representing the library
+ * implementing the digest algorithm.
  * @return The address of a newly allocated digest if the operation was
  * successfull, NULL otherwise.
  */
-struct es_digest* es_alloc_digest(const int digest_type);
+struct es_digest* es_alloc_digest(
+	const int digest_type,
+	const int digest_backend);
 
 /**
  * Frees the memory used by a digest.
@@ -80,19 +117,28 @@ void es_free_digest(struct es_digest **digest);
  * @param digest The digest to be initialized.
  * @param digest_type The digest type is one of the above digest algorithm
  * codes representing the chosen digest algorithm.
+ * @param digest_backend The digest backend code representing the library
+ * implementing the digest algorithm.
  * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
  */
-const int es_init_digest(struct es_digest *digest, const int digest_type);
+const int es_init_digest(
+	struct es_digest *digest,
+	const int digest_type,
+	const int digest_backend);
 
 /**
  * Creates a digest.
  *
  * @param digest_type The digest type is one of the above digest algorithm
  * codes representing the chosen digest algorithm.
+ * @param digest_backend The digest backend code representing the library
+ * implementing the digest algorithm.
  * @return The address of a newly allocated digest if the operation was
  * successfull, NULL otherwise.
  */
-struct es_digest* es_create_digest(const int digest_type);
+struct es_digest* es_create_digest(
+	const int digest_type,
+	const int digest_backend);
 
 /**
  * Destroys a digest.
@@ -101,6 +147,33 @@ struct es_digest* es_create_digest(const int digest_type);
  */
 void es_destroy_digest(struct es_digest **digest);
 
+/**
+ * Acquires the digest of the specified type cached for the calling thread. The
+ * digest is created on first use, reset before being handed out and released
+ * automatically when the thread exits, so it must not be destroyed by the
+ * caller. It stays valid until the next acquire of the same type on the same
+ * thread.
+ *
+ * @param digest_type The digest type is one of the above digest algorithm
+ * codes representing the chosen digest algorithm.
+ * @param digest_backend The digest backend code representing the library
+ * implementing the digest algorithm.
+ * @return The address of the cached digest if the operation was successfull,
+ * NULL otherwise.
+ */
+struct es_digest* es_acquire_digest(
+	const int digest_type,
+	const int digest_backend);
+
+/**
+ * Resets a digest to its initial state, discarding any data it was updated
+ * with.
+ *
+ * @param digest The digest to be reset.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_reset_digest(struct es_digest *digest);
+
 /**
  * Validates the specified digest type.
  *
@@ -110,6 +183,20 @@ void es_destroy_digest(struct es_digest **digest);
  */
 const int es_validate_digest_type(const int digest_type);
 
+/**
+ * Validates the specified digest type against the specified digest backend.
+ *
+ * @param digest_type The digest type is one of the above digest algorithm
+ * codes representing the chosen digest algorithm.
+ * @param digest_backend The digest backend code representing the library
+ * implementing the digest algorithm.
+ * @return ES_SUCCESS if the backend implements the digest type, ES_FAILURE
+ * otherwise.
+ */
+const int es_validate_digest_pair(
+	const int digest_type,
+	const int digest_backend);
+
 /**
  * Validates a digest.
  *
@@ -127,6 +214,19 @@ const int es_validate_digest(struct es_digest *digest);
  */
 const int es_update_digest(struct es_digest *digest, const char *data);
 
+/**
+ * Updates the digest internal buffer using the specified binary data.
+ *
+ * @param digest The digest to be updated.
+ * @param data The data used to update the digest.
+ * @param length The number of bytes of data used to update the digest.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_update_digest_bytes(
+	struct es_digest *digest,
+	const char *data,
+	const int length);
+
 /**
  * Gets the string representation of the digest internal buffer.
  *
@@ -136,6 +236,24 @@ const int es_update_digest(struct es_digest *digest, const char *data);
  */
 char* es_get_digest_string(struct es_digest *digest);
 
+/**
+ * Gets the raw bytes of the digest internal buffer. Unlike the string
+ * representation, which is hex encoded, every output byte carries a full byte
+ * of the digest. If the output buffer is shorter than the digest, the digest is
+ * truncated. Once the bytes are read, the digest must be reset before being
+ * updated again.
+ *
+ * @param digest The digest used to get the raw bytes.
+ * @param out The buffer where to write the raw digest bytes.
+ * @param length Input/output parameter representing the size of the output
+ * buffer on input and the number of bytes written to it on output.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_get_digest_bytes(
+	struct es_digest *digest,
+	char *out,
+	int *length);
+
 /**
  * Computes the digest size based on the digest type.
  *
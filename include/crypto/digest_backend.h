@@ -0,0 +1,130 @@
+/**
+ * Copyright (c) 2016, Codrin-Victor Poienaru <cvpoienaru@gmail.com>.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * This software is provided by the copyright holders and contributors "as is"
+ * and any express or implied warranties, including, but not limited to, the
+ * implied warranties of merchantability and fitness for a particular purpose
+ * are disclaimed. In no event shall the copyright holder or contributors be
+ * liable for any direct, indirect, incidental, special, exemplary, or
+ * consequential damages (including, but not limited to, procurement of
+ * substitute goods or services; loss of use, data, or profits; or business
+ * interruption) however caused and on any theory of liability, whether in
+ * contract, strict liability, or tort (including negligence or otherwise)
+ * arising in any way out of the use of this software, even if advised of the
+ * possibility of such damage.
+ */
+
+#ifndef ENTROPY_SOURCE_CRYPTO_DIGEST_BACKEND_H_
+#define ENTROPY_SOURCE_CRYPTO_DIGEST_BACKEND_H_
+
+#include <stdlib.h>
+
+#include <global/defs.h>
+
+/** The GLib (GChecksum) digest backend code. */
+#define ES_GLIB_DIGEST_BACKEND 0
+
+/**
+ * The OpenSSL (EVP) digest backend code. EVP dispatches to the assembly
+ * implementations selected for the running CPU (e.g. SHA-NI, AVX2).
+ */
+#define ES_OPENSSL_DIGEST_BACKEND 1
+
+/** The number of supported digest backends. */
+#define ES_DIGEST_BACKEND_COUNT 2
+
+/** The digest backend used when none is explicitly selected. */
+#define ES_DEFAULT_DIGEST_BACKEND ES_OPENSSL_DIGEST_BACKEND
+
+/**
+ * Represents the definition of a digest backend. A backend is a table of
+ * operations working on an opaque backend context.
+ */
+struct es_digest_backend {
+	/** The human readable name of the backend. */
+	const char *name;
+
+	/**
+	 * Checks whether the backend implements the specified digest type.
+	 *
+	 * @param digest_type The digest algorithm code.
+	 * @return ES_SUCCESS if the digest type is supported, ES_FAILURE otherwise.
+	 */
+	const int (*supports)(const int digest_type);
+
+	/**
+	 * Creates a backend context for the specified digest type.
+	 *
+	 * @param digest_type The digest algorithm code.
+	 * @return The address of a new backend context if the operation was
+	 * successfull, NULL otherwise.
+	 */
+	void* (*create)(const int digest_type);
+
+	/**
+	 * Destroys a backend context.
+	 *
+	 * @param context The backend context to be destroyed.
+	 */
+	void (*destroy)(void *context);
+
+	/**
+	 * Resets a backend context to its initial state.
+	 *
+	 * @param context The backend context to be reset.
+	 * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+	 */
+	const int (*reset)(void *context);
+
+	/**
+	 * Updates a backend context using the specified data.
+	 *
+	 * @param context The backend context to be updated.
+	 * @param data The data used to update the context.
+	 * @param length The number of bytes of data.
+	 * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+	 */
+	const int (*update)(void *context, const char *data, const int length);
+
+	/**
+	 * Finalizes a backend context and writes the raw digest bytes.
+	 *
+	 * @param context The backend context to be finalized.
+	 * @param out The buffer where to write the digest, large enough for the
+	 * whole digest.
+	 * @param length Output parameter representing the number of digest bytes.
+	 * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+	 */
+	const int (*finish)(void *context, unsigned char *out, int *length);
+};
+
+/**
+ * Gets the digest backend associated with the specified backend code.
+ *
+ * @param digest_backend The digest backend code.
+ * @return The address of the digest backend if the backend code is valid,
+ * NULL otherwise.
+ */
+const struct es_digest_backend* es_get_digest_backend(
+	const int digest_backend);
+
+/**
+ * Validates the specified digest backend code.
+ *
+ * @param digest_backend The digest backend code.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_validate_digest_backend(const int digest_backend);
+
+#endif /* ENTROPY_SOURCE_CRYPTO_DIGEST_BACKEND_H_ */
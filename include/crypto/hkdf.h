@@ -0,0 +1,83 @@
+/**
+ * Copyright (c) 2016, Codrin-Victor Poienaru <cvpoienaru@gmail.com>.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * This software is provided by the copyright holders and contributors "as is"
+ * and any express or implied warranties, including, but not limited to, the
+ * implied warranties of merchantability and fitness for a particular purpose
+ * are disclaimed. In no event shall the copyright holder or contributors be
+ * liable for any direct, indirect, incidental, special, exemplary, or
+ * consequential damages (including, but not limited to, procurement of
+ * substitute goods or services; loss of use, data, or profits; or business
+ * interruption) however caused and on any theory of liability, whether in
+ * contract, strict liability, or tort (including negligence or otherwise)
+ * arising in any way out of the use of this software, even if advised of the
+ * possibility of such damage.
+ */
+
+#ifndef ENTROPY_SOURCE_CRYPTO_HKDF_H_
+#define ENTROPY_SOURCE_CRYPTO_HKDF_H_
+
+#include <stdlib.h>
+
+#include <global/defs.h>
+
+/** The size in bytes of an HKDF-SHA-512 pseudorandom key. */
+#define ES_HKDF_PRK_SIZE 64
+
+/** The maximum size in bytes of the HKDF expand context information. */
+#define ES_HKDF_MAXIMUM_INFO_SIZE 64
+
+/** The maximum number of bytes a single HKDF-SHA-512 expand can produce. */
+#define ES_HKDF_MAXIMUM_OUTPUT_SIZE (255 * ES_HKDF_PRK_SIZE)
+
+/**
+ * Extracts a pseudorandom key from the given input keying material, as
+ * HMAC-SHA-512(salt, input) (RFC 5869).
+ *
+ * @param salt The salt, used as the HMAC key. May be empty.
+ * @param salt_length The number of bytes of salt.
+ * @param input The input keying material (e.g. raw device data).
+ * @param input_length The number of bytes of input keying material.
+ * @param prk The buffer where to write the pseudorandom key, of
+ * ES_HKDF_PRK_SIZE bytes.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_hkdf_extract(
+	const char *salt,
+	const int salt_length,
+	const char *input,
+	const int input_length,
+	unsigned char *prk);
+
+/**
+ * Expands a pseudorandom key into the requested number of output bytes, using
+ * HMAC-SHA-512 (RFC 5869).
+ *
+ * @param prk The pseudorandom key, of ES_HKDF_PRK_SIZE bytes.
+ * @param info The context information binding the output to its use.
+ * @param info_length The number of bytes of context information, at most
+ * ES_HKDF_MAXIMUM_INFO_SIZE.
+ * @param output The buffer where to write the output bytes.
+ * @param output_length The number of output bytes, at most
+ * ES_HKDF_MAXIMUM_OUTPUT_SIZE.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_hkdf_expand(
+	const unsigned char *prk,
+	const char *info,
+	const int info_length,
+	char *output,
+	const int output_length);
+
+#endif /* ENTROPY_SOURCE_CRYPTO_HKDF_H_ */
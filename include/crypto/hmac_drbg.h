@@ -0,0 +1,170 @@
+/**
+ * Copyright (c) 2016, Codrin-Victor Poienaru <cvpoienaru@gmail.com>.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * This software is provided by the copyright holders and contributors "as is"
+ * and any express or implied warranties, including, but not limited to, the
+ * implied warranties of merchantability and fitness for a particular purpose
+ * are disclaimed. In no event shall the copyright holder or contributors be
+ * liable for any direct, indirect, incidental, special, exemplary, or
+ * consequential damages (including, but not limited to, procurement of
+ * substitute goods or services; loss of use, data, or profits; or business
+ * interruption) however caused and on any theory of liability, whether in
+ * contract, strict liability, or tort (including negligence or otherwise)
+ * arising in any way out of the use of this software, even if advised of the
+ * possibility of such damage.
+ */
+
+#ifndef ENTROPY_SOURCE_CRYPTO_HMAC_DRBG_H_
+#define ENTROPY_SOURCE_CRYPTO_HMAC_DRBG_H_
+
+#include <stdlib.h>
+
+#include <openssl/evp.h>
+
+#include <global/defs.h>
+
+/** The size in bytes of the HMAC-SHA-512 DRBG key and value. */
+#define ES_HMAC_DRBG_OUTPUT_SIZE 64
+
+/**
+ * The minimum size in bytes of the entropy input used to instantiate or reseed
+ * the DRBG (256 bits of security strength).
+ */
+#define ES_HMAC_DRBG_MINIMUM_ENTROPY_SIZE 32
+
+/** The maximum number of bytes produced by a single generate request. */
+#define ES_HMAC_DRBG_MAXIMUM_REQUEST_SIZE 65536
+
+/**
+ * The maximum number of generate requests between two reseeds, as specified
+ * for HMAC_DRBG.
+ */
+#define ES_HMAC_DRBG_RESEED_INTERVAL (1UL << 48)
+
+/**
+ * Structure defining an HMAC_DRBG deterministic random bit generator, as
+ * specified in NIST SP 800-90A, instantiated with HMAC-SHA-512.
+ */
+struct es_hmac_drbg {
+	/** The DRBG key (K). */
+	unsigned char key[ES_HMAC_DRBG_OUTPUT_SIZE];
+
+	/** The DRBG value (V). */
+	unsigned char value[ES_HMAC_DRBG_OUTPUT_SIZE];
+
+	/** The number of generate requests since the last (re)seed. */
+	unsigned long reseed_counter;
+
+	/** Indicates whether the DRBG was instantiated. */
+	int instantiated;
+
+	/** The HMAC-SHA-512 algorithm. */
+	EVP_MAC *mac;
+
+	/** The HMAC-SHA-512 context, reused across every HMAC computation. */
+	EVP_MAC_CTX *context;
+};
+
+/**
+ * Allocates memory for an HMAC_DRBG.
+ *
+ * @return The address of a newly allocated HMAC_DRBG if the operation was
+ * successfull, NULL otherwise.
+ */
+struct es_hmac_drbg* es_alloc_hmac_drbg(void);
+
+/**
+ * Frees the memory used by an HMAC_DRBG. The DRBG state is wiped.
+ *
+ * @param drbg The HMAC_DRBG to be freed.
+ */
+void es_free_hmac_drbg(struct es_hmac_drbg **drbg);
+
+/**
+ * Initializes an HMAC_DRBG with the default values. The DRBG must still be
+ * instantiated before use.
+ *
+ * @param drbg The HMAC_DRBG to be initialized.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_init_hmac_drbg(struct es_hmac_drbg *drbg);
+
+/**
+ * Creates an HMAC_DRBG.
+ *
+ * @return The address of a newly allocated HMAC_DRBG if the operation was
+ * successfull, NULL otherwise.
+ */
+struct es_hmac_drbg* es_create_hmac_drbg(void);
+
+/**
+ * Destroys an HMAC_DRBG.
+ *
+ * @param drbg The HMAC_DRBG to be destroyed.
+ */
+void es_destroy_hmac_drbg(struct es_hmac_drbg **drbg);
+
+/**
+ * Validates an HMAC_DRBG.
+ *
+ * @param drbg The HMAC_DRBG to be validated.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_validate_hmac_drbg(struct es_hmac_drbg *drbg);
+
+/**
+ * Instantiates an HMAC_DRBG from the specified seed material (entropy input,
+ * nonce and personalization string, concatenated).
+ *
+ * @param drbg The HMAC_DRBG to be instantiated.
+ * @param seed The seed material.
+ * @param seed_length The number of bytes of seed material, at least
+ * ES_HMAC_DRBG_MINIMUM_ENTROPY_SIZE.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_instantiate_hmac_drbg(
+	struct es_hmac_drbg *drbg,
+	const char *seed,
+	const int seed_length);
+
+/**
+ * Reseeds an HMAC_DRBG with fresh entropy input.
+ *
+ * @param drbg The HMAC_DRBG to be reseeded.
+ * @param entropy The fresh entropy input.
+ * @param entropy_length The number of bytes of entropy input, at least
+ * ES_HMAC_DRBG_MINIMUM_ENTROPY_SIZE.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_reseed_hmac_drbg(
+	struct es_hmac_drbg *drbg,
+	const char *entropy,
+	const int entropy_length);
+
+/**
+ * Generates pseudorandom bytes from an HMAC_DRBG. Requests larger than
+ * ES_HMAC_DRBG_MAXIMUM_REQUEST_SIZE are split into several generate requests.
+ *
+ * @param drbg The HMAC_DRBG used to generate the bytes.
+ * @param output The buffer where to write the generated bytes.
+ * @param output_length The number of bytes to be generated.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise
+ * (including the case when the DRBG must be reseeded first).
+ */
+const int es_generate_hmac_drbg(
+	struct es_hmac_drbg *drbg,
+	char *output,
+	const int output_length);
+
+#endif /* ENTROPY_SOURCE_CRYPTO_HMAC_DRBG_H_ */
@@ -0,0 +1,72 @@
+/**
+ * Copyright (c) 2016, Codrin-Victor Poienaru <cvpoienaru@gmail.com>.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * This software is provided by the copyright holders and contributors "as is"
+ * and any express or implied warranties, including, but not limited to, the
+ * implied warranties of merchantability and fitness for a particular purpose
+ * are disclaimed. In no event shall the copyright holder or contributors be
+ * liable for any direct, indirect, incidental, special, exemplary, or
+ * consequential damages (including, but not limited to, procurement of
+ * substitute goods or services; loss of use, data, or profits; or business
+ * interruption) however caused and on any theory of liability, whether in
+ * contract, strict liability, or tort (including negligence or otherwise)
+ * arising in any way out of the use of this software, even if advised of the
+ * possibility of such damage.
+ */
+
+
+#ifndef ENTROPY_SOURCE_CRYPTO_SHA_LANES_H_
+#define ENTROPY_SOURCE_CRYPTO_SHA_LANES_H_
+
+#include <stdlib.h>
+
+#include <global/defs.h>
+
+/** The maximum number of lanes of a multi-lane SHA kernel. */
+#define ES_SHA_MAXIMUM_LANES 16
+
+/**
+ * Represents a function pointer definition for a multi-lane SHA kernel. The
+ * kernel digests as many equally long messages as it has lanes, one per lane,
+ * each message word of every lane being packed in a single vector register.
+ */
+typedef void (*es_sha_lanes_kernel)(
+	const unsigned char * const *data,
+	const int length,
+	unsigned char * const *digests);
+
+/**
+ * Gets the multi-lane kernel bound for the specified digest type. SHA-256 and
+ * SHA-512 have AVX2 and AVX-512 kernels (on x86 only), bound once, at the first
+ * call, by the CPU dispatch layer. There is no scalar kernel: callers keep
+ * their own single-stream path when no kernel is bound, or when fewer messages
+ * than the minimum count are at hand. The minimum count is half of the lanes,
+ * or all of them for SHA-256 on CPUs implementing the SHA extensions, whose
+ * single stream outruns a half empty kernel; the AVX2 kernel, which is never
+ * faster there, is not bound at all.
+ *
+ * @param digest_type The digest type represents the digest algorithm code.
+ * @param kernel Output parameter representing the bound kernel, or NULL if no
+ * kernel is bound. It may be NULL.
+ * @param minimum_count Output parameter representing the minimum number of
+ * messages for which the kernel outruns the single-stream path. It may be NULL.
+ * @return The number of lanes of the bound kernel, or zero if no kernel is
+ * bound for the digest type and the running CPU.
+ */
+const int es_get_sha_lanes_kernel(
+	const int digest_type,
+	es_sha_lanes_kernel *kernel,
+	int *minimum_count);
+
+#endif /* ENTROPY_SOURCE_CRYPTO_SHA_LANES_H_ */
@@ -0,0 +1,96 @@
+/**
+ * Copyright (c) 2016, Codrin-Victor Poienaru <cvpoienaru@gmail.com>.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * This software is provided by the copyright holders and contributors "as is"
+ * and any express or implied warranties, including, but not limited to, the
+ * implied warranties of merchantability and fitness for a particular purpose
+ * are disclaimed. In no event shall the copyright holder or contributors be
+ * liable for any direct, indirect, incidental, special, exemplary, or
+ * consequential damages (including, but not limited to, procurement of
+ * substitute goods or services; loss of use, data, or profits; or business
+ * interruption) however caused and on any theory of liability, whether in
+ * contract, strict liability, or tort (including negligence or otherwise)
+ * arising in any way out of the use of this software, even if advised of the
+ * possibility of such damage.
+ */
+
+#ifndef ENTROPY_SOURCE_CRYPTO_TREE_HASH_H_
+#define ENTROPY_SOURCE_CRYPTO_TREE_HASH_H_
+
+#include <stdlib.h>
+
+#include <global/defs.h>
+
+/** The size in bytes of a tree hash node (a SHA-512 digest). */
+#define ES_TREE_HASH_NODE_SIZE 64
+
+/** The size in bytes of a tree hash leaf chunk. */
+#define ES_TREE_HASH_CHUNK_SIZE 1024
+
+/**
+ * The minimum total input size in bytes of a batch for which the leaves are
+ * hashed by the worker pool. Smaller batches are hashed on the calling thread,
+ * since waking the workers would cost more than hashing the leaves. A batch of
+ * eight 4 KiB blocks reaches the workers.
+ */
+#define ES_TREE_HASH_PARALLEL_THRESHOLD (32 * 1024)
+
+/** The maximum number of tree hash worker threads. */
+#define ES_TREE_HASH_MAXIMUM_WORKERS 16
+
+/** The maximum number of data sets in a tree hash batch. */
+#define ES_TREE_HASH_MAXIMUM_BATCH_SIZE 16
+
+/**
+ * Computes the Merkle tree hash of the specified data over SHA-512. The data
+ * is split into ES_TREE_HASH_CHUNK_SIZE chunks; each leaf is
+ * SHA-512(0x00 | chunk index | chunk) and each parent is
+ * SHA-512(0x01 | left | right), an unpaired node being promoted to the next
+ * level as is. See es_compute_tree_hashes.
+ *
+ * @param data The data to be hashed.
+ * @param length The number of bytes of data.
+ * @param digest The buffer where to write the root hash, of
+ * ES_TREE_HASH_NODE_SIZE bytes.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_compute_tree_hash(
+	const char *data,
+	const long length,
+	char *digest);
+
+/**
+ * Computes the Merkle tree hashes of a batch of data sets, each one the same
+ * as es_compute_tree_hash would. The leaves of the whole batch form a single
+ * job: they are hashed side by side by the SHA-512 multi-lane kernel, when the
+ * CPU dispatch layer bound one, and batches of at least
+ * ES_TREE_HASH_PARALLEL_THRESHOLD bytes are shared with a pool of worker
+ * threads, created on first use with one worker per additional online CPU.
+ * The parents of every level of the batch are hashed side by side as well.
+ *
+ * @param data The data sets to be hashed.
+ * @param lengths The number of bytes of every data set.
+ * @param digests The buffers where to write the root hashes, of
+ * ES_TREE_HASH_NODE_SIZE bytes each.
+ * @param count The number of data sets, at most
+ * ES_TREE_HASH_MAXIMUM_BATCH_SIZE.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_compute_tree_hashes(
+	const char * const *data,
+	const long *lengths,
+	char * const *digests,
+	const int count);
+
+#endif /* ENTROPY_SOURCE_CRYPTO_TREE_HASH_H_ */
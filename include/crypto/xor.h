@@ -0,0 +1,52 @@
+/**
+ * Copyright (c) 2016, Codrin-Victor Poienaru <cvpoienaru@gmail.com>.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * This software is provided by the copyright holders and contributors "as is"
+ * and any express or implied warranties, including, but not limited to, the
+ * implied warranties of merchantability and fitness for a particular purpose
+ * are disclaimed. In no event shall the copyright holder or contributors be
+ * liable for any direct, indirect, incidental, special, exemplary, or
+ * consequential damages (including, but not limited to, procurement of
+ * substitute goods or services; loss of use, data, or profits; or business
+ * interruption) however caused and on any theory of liability, whether in
+ * contract, strict liability, or tort (including negligence or otherwise)
+ * arising in any way out of the use of this software, even if advised of the
+ * possibility of such damage.
+ */
+
+#ifndef ENTROPY_SOURCE_CRYPTO_XOR_H_
+#define ENTROPY_SOURCE_CRYPTO_XOR_H_
+
+#include <stdlib.h>
+
+#include <global/defs.h>
+
+/**
+ * Combines two byte arrays with XOR. The kernel is bound once, at the first
+ * call, by the CPU dispatch layer among AVX-512, AVX2, SSE2 (on x86 only) and
+ * a portable word-sized implementation.
+ *
+ * @param destination The array where to write the combined bytes. It may be
+ * the same array as any of the sources, but must not partially overlap them.
+ * @param source_1 The first array to be combined.
+ * @param source_2 The second array to be combined.
+ * @param length The number of bytes to be combined.
+ */
+void es_xor_bytes(
+	char *destination,
+	const char *source_1,
+	const char *source_2,
+	const int length);
+
+#endif /* ENTROPY_SOURCE_CRYPTO_XOR_H_ */
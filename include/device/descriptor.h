@@ -34,6 +34,19 @@
 #include <global/defs.h>
 #include <device/serial_bundle.h>
 
+/**
+ * Represents an entropy board connected to a serial port, read with the
+ * start/stop transfer protocol.
+ */
+#define ES_SERIAL_SOURCE_TYPE 0
+
+/**
+ * Represents a raw character device (for example a hardware random number
+ * generator) read as a plain byte stream, without terminal configuration or
+ * transfer codes.
+ */
+#define ES_RAW_SOURCE_TYPE 1
+
 /** Represents the definition of a basic device descriptor. */
 struct es_device_descriptor {
 	/** The file descriptor associated with the connected device. */
@@ -44,6 +57,15 @@ struct es_device_descriptor {
 	 */
 	int runnable;
 
+	/** The source type of the connected device. */
+	int source_type;
+
+	/**
+	 * TRUE if the device was asked to stream data continuously, FALSE if every
+	 * read is wrapped in its own start/stop transfer codes.
+	 */
+	int streaming;
+
 	/** The serial bundle associated with the connected device. */
 	struct es_serial_bundle *serial_bundle;
 };
@@ -107,4 +129,16 @@ void es_destroy_device_descriptor(struct es_device_descriptor **descriptor);
 const int es_validate_device_descriptor(
 	struct es_device_descriptor *descriptor);
 
+/**
+ * Sets the source type of a device descriptor. Must be called before the
+ * device is initialized.
+ *
+ * @param descriptor The device descriptor to be updated.
+ * @param source_type The source type of the connected device.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_set_device_source_type(
+	struct es_device_descriptor *descriptor,
+	const int source_type);
+
 #endif /* ENTROPY_SOURCE_DEVICE_DESCRIPTOR_H_ */
@@ -0,0 +1,99 @@
+/**
+ * Copyright (c) 2016, Codrin-Victor Poienaru <cvpoienaru@gmail.com>.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * This software is provided by the copyright holders and contributors "as is"
+ * and any express or implied warranties, including, but not limited to, the
+ * implied warranties of merchantability and fitness for a particular purpose
+ * are disclaimed. In no event shall the copyright holder or contributors be
+ * liable for any direct, indirect, incidental, special, exemplary, or
+ * consequential damages (including, but not limited to, procurement of
+ * substitute goods or services; loss of use, data, or profits; or business
+ * interruption) however caused and on any theory of liability, whether in
+ * contract, strict liability, or tort (including negligence or otherwise)
+ * arising in any way out of the use of this software, even if advised of the
+ * possibility of such damage.
+ */
+
+#ifndef ENTROPY_SOURCE_DEVICE_DEVICE_SPEC_H_
+#define ENTROPY_SOURCE_DEVICE_DEVICE_SPEC_H_
+
+#include <stdlib.h>
+#include <termios.h>
+
+#include <global/defs.h>
+#include <device/descriptor.h>
+
+/** Represents the separator between the fields of a device specification. */
+#define ES_DEVICE_SPEC_SEPARATOR ':'
+
+/** Represents the maximum size in bytes of a device port name. */
+#define ES_MAXIMUM_PORT_NAME_SIZE 256
+
+/** Represents the baud rate used when a device specification omits it. */
+#define ES_DEFAULT_DEVICE_BAUD_RATE B9600
+
+/** Represents the name of the serial source type. */
+#define ES_SERIAL_SOURCE_TYPE_NAME "serial"
+
+/** Represents the name of the raw source type. */
+#define ES_RAW_SOURCE_TYPE_NAME "raw"
+
+/**
+ * Structure defining a device specification, given as
+ * <port_name>[:<baud_rate>[:<source_type>]].
+ */
+struct es_device_spec {
+	/** The name of the port to which the device is connected. */
+	char port_name[ES_MAXIMUM_PORT_NAME_SIZE];
+
+	/** The baud rate code of the serial port. */
+	speed_t baud_rate;
+
+	/** The source type of the device. */
+	int source_type;
+};
+
+/**
+ * Parses a device specification of the form
+ * <port_name>[:<baud_rate>[:<source_type>]], where the baud rate is given in
+ * bits per second and the source type is either "serial" or "raw".
+ *
+ * @param spec The device specification to be parsed.
+ * @param device_spec Output parameter holding the parsed specification.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_parse_device_spec(
+	const char *spec,
+	struct es_device_spec *device_spec);
+
+/**
+ * Creates and initializes the device descriptor of a device specification.
+ * The device is opened and ready to be read.
+ *
+ * @param device_spec The device specification.
+ * @return The address of a newly allocated device descriptor if the operation
+ * was successfull, NULL otherwise.
+ */
+struct es_device_descriptor* es_open_device_spec(
+	const struct es_device_spec *device_spec);
+
+/**
+ * Gets the name of a device source type.
+ *
+ * @param source_type The device source type.
+ * @return The name of the source type, or NULL if the source type is invalid.
+ */
+const char* es_get_device_source_type_name(const int source_type);
+
+#endif /* ENTROPY_SOURCE_DEVICE_DEVICE_SPEC_H_ */
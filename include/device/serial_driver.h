@@ -55,7 +55,9 @@
 const int es_init_device(struct es_device_descriptor *descriptor);
 
 /**
- * Reads data from the device.
+ * Reads data from the device. Unless the device is streaming, the read is
+ * wrapped in start/stop transfer codes. The buffer is terminated with a NULL
+ * character, so at most size - 1 bytes are read.
  *
  * @param descriptor The device descriptor associated with the connected device.
  * @param size The number of bytes to read from the device.
@@ -67,4 +69,40 @@ const int es_read_device_data(
 	const int size,
 	char *buffer);
 
+/**
+ * Reads raw binary data from the device. Unlike es_read_device_data, the
+ * buffer is filled completely and is not terminated with a NULL character, so
+ * NUL bytes coming from the device are kept.
+ *
+ * @param descriptor The device descriptor associated with the connected device.
+ * @param size The number of bytes to read from the device.
+ * @param buffer The buffer where to store the data read from the device.
+ * @param length Output parameter representing the number of bytes read.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_read_device_bytes(
+	struct es_device_descriptor *descriptor,
+	const int size,
+	char *buffer,
+	int *length);
+
+/**
+ * Asks the device to stream data continuously, so that following reads do not
+ * pay the start/stop transfer round trip. Does nothing if the device is
+ * already streaming.
+ *
+ * @param descriptor The device descriptor associated with the connected device.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_start_device_stream(struct es_device_descriptor *descriptor);
+
+/**
+ * Asks the device to stop streaming data. Does nothing if the device is not
+ * streaming.
+ *
+ * @param descriptor The device descriptor associated with the connected device.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_stop_device_stream(struct es_device_descriptor *descriptor);
+
 #endif /* ENTROPY_SOURCE_DEVICE_SERIAL_DRIVER_H_ */
@@ -34,14 +34,64 @@
 #include <device/descriptor.h>
 #include <device/serial_driver.h>
 #include <pool/entropy_pool.h>
+#include <generator/entropy_ring.h>
+#include <generator/entropy_health.h>
+#include <generator/entropy_score.h>
+
+/**
+ * Represents the maximum number of ring buffers a mixing entropy bundle draws
+ * from at once.
+ */
+#define ES_MAXIMUM_MIXING_SOURCE_COUNT 8
 
 /** Structure defining a basic entropy bundle. */
 struct es_entropy_bundle {
 	/** The entropy pool associated with the entropy bundle. */
 	struct es_entropy_pool *pool;
 
-	/** The device descriptor associated with the entropy bundle. */
+	/**
+	 * The device descriptor associated with the entropy bundle. NULL for a
+	 * mixing entropy bundle, which draws its readings from the ring buffers of
+	 * several devices.
+	 */
 	struct es_device_descriptor *descriptor;
+
+	/**
+	 * The optional ring buffer carrying raw device bytes from the device reader
+	 * thread to the conditioning workers. NULL if the device thread conditions
+	 * its own readings. The ring is not owned by the entropy bundle.
+	 */
+	struct es_entropy_ring *ring;
+
+	/**
+	 * The optional staging ring keeping raw device bytes read ahead while every
+	 * block in the pool is clean, so that they are drained at memory speed into
+	 * the next dirty blocks. Only used when the device thread conditions its own
+	 * readings. The staging ring is not owned by the entropy bundle.
+	 */
+	struct es_entropy_ring *staging;
+
+	/**
+	 * The health test state of the raw device stream. Owned by the entropy
+	 * bundle.
+	 */
+	struct es_entropy_health *health;
+
+	/**
+	 * The score of the device, weighing its throughput, error rate and health
+	 * test results for scheduling. Owned by the entropy bundle.
+	 */
+	struct es_entropy_score *score;
+
+	/**
+	 * The ring buffers a mixing entropy bundle currently draws from. Every read
+	 * takes a slice from each of them. The ring buffers are not owned by the
+	 * entropy bundle.
+	 */
+	struct es_entropy_ring *sources[ES_MAXIMUM_MIXING_SOURCE_COUNT];
+
+	/** The number of ring buffers a mixing entropy bundle draws from. */
+	int source_count;
 };
 
 /**
@@ -53,7 +103,8 @@ struct es_entropy_bundle {
 struct es_entropy_bundle* es_alloc_entropy_bundle(void);
 
 /**
- * Frees the memory used by an entropy bundle.
+ * Frees the memory used by an entropy bundle. The health test state and the
+ * score of the entropy bundle are freed as well.
  *
  * @param bundle The entropy bundle to be freed.
  */
@@ -84,6 +135,17 @@ struct es_entropy_bundle* es_create_entropy_bundle(
 	struct es_entropy_pool *pool,
 	struct es_device_descriptor *descriptor);
 
+/**
+ * Creates a mixing entropy bundle. A mixing entropy bundle has no device of its
+ * own and draws its readings from the ring buffers of several devices.
+ *
+ * @param pool The entropy pool associated with the entropy bundle.
+ * @return The address of a newly allocated entropy bundle if the operation was
+ * successfull, NULL otherwise.
+ */
+struct es_entropy_bundle* es_create_entropy_mixing_bundle(
+	struct es_entropy_pool *pool);
+
 /**
  * Destroys an entropy bundle.
  *
@@ -99,4 +161,31 @@ void es_destroy_entropy_bundle(struct es_entropy_bundle **bundle);
  */
 const int es_validate_entropy_bundle(struct es_entropy_bundle *bundle);
 
+/**
+ * Attaches a ring buffer to an entropy bundle. Once attached, device readings
+ * are taken from the ring instead of the device.
+ *
+ * @param bundle The entropy bundle to which the ring buffer will be attached.
+ * @param ring The ring buffer to be attached, or NULL to detach the current
+ * one.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_set_entropy_bundle_ring(
+	struct es_entropy_bundle *bundle,
+	struct es_entropy_ring *ring);
+
+/**
+ * Sets the ring buffers a mixing entropy bundle draws from.
+ *
+ * @param bundle The mixing entropy bundle.
+ * @param sources The ring buffers to draw from.
+ * @param count The number of ring buffers, at most
+ * ES_MAXIMUM_MIXING_SOURCE_COUNT, or zero to detach the current ones.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_set_entropy_bundle_sources(
+	struct es_entropy_bundle *bundle,
+	struct es_entropy_ring **sources,
+	const int count);
+
 #endif /* ENTROPY_SOURCE_GENERATOR_ENTROPY_BUNDLE_H_ */
@@ -0,0 +1,281 @@
+/**
+ * Copyright (c) 2016, Codrin-Victor Poienaru <cvpoienaru@gmail.com>.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * This software is provided by the copyright holders and contributors "as is"
+ * and any express or implied warranties, including, but not limited to, the
+ * implied warranties of merchantability and fitness for a particular purpose
+ * are disclaimed. In no event shall the copyright holder or contributors be
+ * liable for any direct, indirect, incidental, special, exemplary, or
+ * consequential damages (including, but not limited to, procurement of
+ * substitute goods or services; loss of use, data, or profits; or business
+ * interruption) however caused and on any theory of liability, whether in
+ * contract, strict liability, or tort (including negligence or otherwise)
+ * arising in any way out of the use of this software, even if advised of the
+ * possibility of such damage.
+ */
+
+#ifndef ENTROPY_SOURCE_GENERATOR_ENTROPY_CONDITIONER_H_
+#define ENTROPY_SOURCE_GENERATOR_ENTROPY_CONDITIONER_H_
+
+#include <stdlib.h>
+#include <pthread.h>
+
+#include <global/defs.h>
+#include <global/thread_policy.h>
+#include <generator/entropy_bundle.h>
+#include <generator/entropy_ring.h>
+#include <pool/entropy_pool.h>
+
+/** Represents the maximum number of conditioning workers. */
+#define ES_MAXIMUM_CONDITIONING_WORKER_COUNT 64
+
+/** Represents the maximum number of entropy bundles feeding a conditioner. */
+#define ES_MAXIMUM_CONDITIONING_SOURCE_COUNT 64
+
+/** Represents the conditioning worker sleep time in microseconds. */
+#define ES_CONDITIONING_WORKER_SLEEP 10000
+
+/** Structure defining an entropy bundle feeding a conditioner. */
+struct es_conditioning_source {
+	/** The entropy bundle. */
+	struct es_entropy_bundle *bundle;
+
+	/** The ring buffer owned by the conditioner and attached to the bundle. */
+	struct es_entropy_ring *ring;
+
+	/** The number of conditioning workers currently consuming the ring. */
+	int users;
+
+	/** TRUE if the source is being removed, FALSE otherwise. */
+	int removing;
+};
+
+/**
+ * Structure defining the conditioning stage of the generator pipeline. Device
+ * reader threads only move raw bytes from their device into the ring buffer of
+ * their entropy bundle, while a pool of conditioning workers consumes the rings,
+ * mixes the bytes into dirty blocks and publishes them as clean. Entropy
+ * bundles can be added and removed while the workers are running.
+ */
+struct es_entropy_conditioner {
+	/** The entropy pool fed by every entropy bundle. */
+	struct es_entropy_pool *pool;
+
+	/**
+	 * The entropy bundles feeding the conditioner. Every source is allocated
+	 * on its own, so that the workers holding a source are not affected when
+	 * the array is compacted.
+	 */
+	struct es_conditioning_source **sources;
+
+	/** The number of entropy bundles feeding the conditioner. */
+	int source_count;
+
+	/** The size in bytes of every ring buffer. */
+	int ring_size;
+
+	/** The number of conditioning workers. */
+	int worker_count;
+
+	/**
+	 * The number of distinct entropy bundles every block draws input from,
+	 * between 1 and ES_MAXIMUM_MIXING_SOURCE_COUNT. With a single one, every
+	 * batch of blocks is filled from the ring of a single bundle.
+	 */
+	int mix_count;
+
+	/**
+	 * The placement and scheduling applied to the conditioning workers, or NULL
+	 * to leave them untouched. Not owned by the conditioner.
+	 */
+	struct es_thread_policy *policy;
+
+	/** The conditioning worker threads. */
+	pthread_t *workers;
+
+	/** The number of conditioning workers started. */
+	int started_count;
+
+	/** The source the next source search starts from. */
+	unsigned int next_source;
+
+	/**
+	 * TRUE if the conditioning workers are still runnable, FALSE otherwise.
+	 */
+	int runnable;
+
+	/** The mutex guarding the sources. */
+	pthread_mutex_t mutex;
+
+	/** The condition signaled when a worker stops consuming a source. */
+	pthread_cond_t released;
+};
+
+/**
+ * Allocates memory for a conditioner.
+ *
+ * @param worker_count The number of conditioning workers.
+ * @return The address of a newly allocated conditioner if the operation was
+ * successfull, NULL otherwise.
+ */
+struct es_entropy_conditioner* es_alloc_entropy_conditioner(
+	const int worker_count);
+
+/**
+ * Frees the memory used by a conditioner. The ring buffers are detached from
+ * their entropy bundles and destroyed.
+ *
+ * @param conditioner The conditioner to be freed.
+ */
+void es_free_entropy_conditioner(struct es_entropy_conditioner **conditioner);
+
+/**
+ * Initializes a conditioner with no entropy bundles.
+ *
+ * @param conditioner The conditioner to be initialized.
+ * @param pool The entropy pool fed by the conditioner.
+ * @param ring_size The size in bytes of every ring buffer.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_init_entropy_conditioner(
+	struct es_entropy_conditioner *conditioner,
+	struct es_entropy_pool *pool,
+	const int ring_size);
+
+/**
+ * Creates a conditioner.
+ *
+ * @param pool The entropy pool fed by the conditioner.
+ * @param worker_count The number of conditioning workers, between 1 and
+ * ES_MAXIMUM_CONDITIONING_WORKER_COUNT.
+ * @param ring_size The size in bytes of every ring buffer.
+ * @return The address of a newly allocated conditioner if the operation was
+ * successfull, NULL otherwise.
+ */
+struct es_entropy_conditioner* es_create_entropy_conditioner(
+	struct es_entropy_pool *pool,
+	const int worker_count,
+	const int ring_size);
+
+/**
+ * Destroys a conditioner. The conditioning workers must be stopped first.
+ *
+ * @param conditioner The conditioner to be destroyed.
+ */
+void es_destroy_entropy_conditioner(
+	struct es_entropy_conditioner **conditioner);
+
+/**
+ * Validates a conditioner.
+ *
+ * @param conditioner The conditioner to be validated.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_validate_entropy_conditioner(
+	struct es_entropy_conditioner *conditioner);
+
+/**
+ * Adds an entropy bundle to a conditioner. A ring buffer is created and
+ * attached to the bundle, so the device reader thread of the bundle must be
+ * started afterwards.
+ *
+ * @param conditioner The conditioner to be fed by the entropy bundle.
+ * @param bundle The entropy bundle to be added.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_add_entropy_conditioner_bundle(
+	struct es_entropy_conditioner *conditioner,
+	struct es_entropy_bundle *bundle);
+
+/**
+ * Removes an entropy bundle from a conditioner. The device reader thread of the
+ * bundle must be stopped first. Waits until no worker consumes the ring of the
+ * bundle, then detaches and destroys the ring.
+ *
+ * @param conditioner The conditioner fed by the entropy bundle.
+ * @param bundle The entropy bundle to be removed.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_remove_entropy_conditioner_bundle(
+	struct es_entropy_conditioner *conditioner,
+	struct es_entropy_bundle *bundle);
+
+/**
+ * Sets the number of distinct entropy bundles every block draws input from.
+ * While fewer bundles feed the conditioner, blocks draw input from all of them.
+ * Must be called before the conditioning workers are started.
+ *
+ * @param conditioner The conditioner to be updated.
+ * @param mix_count The number of entropy bundles, between 1 and
+ * ES_MAXIMUM_MIXING_SOURCE_COUNT.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_set_entropy_conditioner_mix_count(
+	struct es_entropy_conditioner *conditioner,
+	const int mix_count);
+
+/**
+ * Sets the placement and scheduling applied to the conditioning workers. Must
+ * be called before the conditioning workers are started.
+ *
+ * @param conditioner The conditioner to be updated.
+ * @param policy The thread policy to be applied, or NULL to leave the workers
+ * untouched. The policy must outlive the conditioner.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_set_entropy_conditioner_thread_policy(
+	struct es_entropy_conditioner *conditioner,
+	struct es_thread_policy *policy);
+
+/**
+ * Gets the CPU time consumed by a conditioning worker.
+ *
+ * @param conditioner The conditioner owning the worker.
+ * @param index The index of the worker, lower than the number of started
+ * workers.
+ * @param cpu_time Output parameter holding the CPU time in nanoseconds.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_get_entropy_conditioner_worker_cpu_time(
+	struct es_entropy_conditioner *conditioner,
+	const int index,
+	unsigned long *cpu_time);
+
+/**
+ * Starts the conditioning workers.
+ *
+ * @param conditioner The conditioner whose workers will be started.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_start_entropy_conditioner(
+	struct es_entropy_conditioner *conditioner);
+
+/**
+ * Asks the conditioning workers to stop. Only sets a flag, so it can be called
+ * from a signal handler.
+ *
+ * @param conditioner The conditioner whose workers will be stopped.
+ */
+void es_stop_entropy_conditioner(struct es_entropy_conditioner *conditioner);
+
+/**
+ * Waits for the conditioning workers to stop.
+ *
+ * @param conditioner The conditioner whose workers will be joined.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_join_entropy_conditioner(
+	struct es_entropy_conditioner *conditioner);
+
+#endif /* ENTROPY_SOURCE_GENERATOR_ENTROPY_CONDITIONER_H_ */
@@ -0,0 +1,162 @@
+/**
+ * Copyright (c) 2016, Codrin-Victor Poienaru <cvpoienaru@gmail.com>.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * This software is provided by the copyright holders and contributors "as is"
+ * and any express or implied warranties, including, but not limited to, the
+ * implied warranties of merchantability and fitness for a particular purpose
+ * are disclaimed. In no event shall the copyright holder or contributors be
+ * liable for any direct, indirect, incidental, special, exemplary, or
+ * consequential damages (including, but not limited to, procurement of
+ * substitute goods or services; loss of use, data, or profits; or business
+ * interruption) however caused and on any theory of liability, whether in
+ * contract, strict liability, or tort (including negligence or otherwise)
+ * arising in any way out of the use of this software, even if advised of the
+ * possibility of such damage.
+ */
+
+#ifndef ENTROPY_SOURCE_GENERATOR_ENTROPY_DRBG_H_
+#define ENTROPY_SOURCE_GENERATOR_ENTROPY_DRBG_H_
+
+#include <stdlib.h>
+#include <pthread.h>
+
+#include <global/defs.h>
+#include <crypto/hmac_drbg.h>
+#include <pool/entropy_pool.h>
+
+/**
+ * Represents the number of fresh pool bytes used to instantiate or reseed the
+ * DRBG tier.
+ */
+#define ES_ENTROPY_DRBG_SEED_SIZE 64
+
+/**
+ * Represents the default number of bytes the DRBG tier serves before it is
+ * reseeded from the entropy pool.
+ */
+#define ES_DEFAULT_DRBG_RESEED_BYTES (1024L * 1024L)
+
+/**
+ * Represents the default number of seconds after which the DRBG tier is
+ * reseeded from the entropy pool.
+ */
+#define ES_DEFAULT_DRBG_RESEED_INTERVAL 60L
+
+/**
+ * Structure defining the DRBG expansion tier. The tier sits between the
+ * entropy pool and the consumers, stretching fresh pool output through an
+ * HMAC_DRBG so that high-volume requests do not drain the pool block by block.
+ */
+struct es_entropy_drbg {
+	/** The entropy pool used to seed the DRBG. */
+	struct es_entropy_pool *pool;
+
+	/** The deterministic random bit generator. */
+	struct es_hmac_drbg *drbg;
+
+	/** The number of bytes served between two reseeds. */
+	long reseed_bytes;
+
+	/** The number of seconds between two reseeds. */
+	long reseed_interval;
+
+	/** The number of bytes served since the last reseed. */
+	long generated_bytes;
+
+	/** The monotonic time in seconds of the last reseed. */
+	long last_reseed;
+
+	/**
+	 * The current DRBG mutex used for mutual exclusion between the consumers
+	 * sharing the DRBG tier.
+	 */
+	pthread_mutex_t mutex;
+};
+
+/**
+ * Allocates memory for a DRBG tier.
+ *
+ * @return The address of a newly allocated DRBG tier if the operation was
+ * successfull, NULL otherwise.
+ */
+struct es_entropy_drbg* es_alloc_entropy_drbg(void);
+
+/**
+ * Frees the memory used by a DRBG tier.
+ *
+ * @param tier The DRBG tier to be freed.
+ */
+void es_free_entropy_drbg(struct es_entropy_drbg **tier);
+
+/**
+ * Initializes a DRBG tier with the default values. The DRBG is seeded lazily,
+ * on the first generate request, so that the device threads have time to fill
+ * the entropy pool.
+ *
+ * @param tier The DRBG tier to be initialized.
+ * @param pool The entropy pool used to seed the DRBG.
+ * @param reseed_bytes The number of bytes served between two reseeds.
+ * @param reseed_interval The number of seconds between two reseeds.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_init_entropy_drbg(
+	struct es_entropy_drbg *tier,
+	struct es_entropy_pool *pool,
+	const long reseed_bytes,
+	const long reseed_interval);
+
+/**
+ * Creates a DRBG tier.
+ *
+ * @param pool The entropy pool used to seed the DRBG.
+ * @param reseed_bytes The number of bytes served between two reseeds.
+ * @param reseed_interval The number of seconds between two reseeds.
+ * @return The address of a newly allocated DRBG tier if the operation was
+ * successfull, NULL otherwise.
+ */
+struct es_entropy_drbg* es_create_entropy_drbg(
+	struct es_entropy_pool *pool,
+	const long reseed_bytes,
+	const long reseed_interval);
+
+/**
+ * Destroys a DRBG tier.
+ *
+ * @param tier The DRBG tier to be destroyed.
+ */
+void es_destroy_entropy_drbg(struct es_entropy_drbg **tier);
+
+/**
+ * Validates a DRBG tier.
+ *
+ * @param tier The DRBG tier to be validated.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_validate_entropy_drbg(struct es_entropy_drbg *tier);
+
+/**
+ * Generates bytes from the DRBG tier. The DRBG is reseeded from fresh entropy
+ * pool blocks first if the byte or time reseed interval has elapsed.
+ *
+ * @param tier The DRBG tier used to generate the bytes.
+ * @param buffer The buffer where to write the generated bytes.
+ * @param size The number of bytes to be generated.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_generate_entropy_drbg(
+	struct es_entropy_drbg *tier,
+	char *buffer,
+	const int size);
+
+#endif /* ENTROPY_SOURCE_GENERATOR_ENTROPY_DRBG_H_ */
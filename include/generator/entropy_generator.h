@@ -43,12 +43,55 @@
 #include <device/descriptor.h>
 #include <device/serial_driver.h>
 
-/** Represents the read buffer size in bytes. */
+/**
+ * Represents the minimum size in bytes of a device read. Used until the
+ * throughput of the device is measured.
+ */
 #define ES_READ_BUFFER_SIZE 8
 
+/** Represents the maximum size in bytes of a device read. */
+#define ES_MAXIMUM_READ_SIZE 512
+
+/**
+ * Represents the time in microseconds a device read should take at the
+ * measured device throughput. The read size grows until the per-call overhead
+ * is a small fraction of this time, and is kept small enough for the device
+ * thread to stay responsive.
+ */
+#define ES_READ_TARGET_TIME 20000
+
+/**
+ * Represents the maximum number of staged bytes drained from a ring buffer
+ * into an entropy block with a single copy.
+ */
+#define ES_STAGING_READ_SIZE 512
+
+/**
+ * Represents the maximum number of dirty entropy blocks a device thread
+ * conditions and mixes as a single batch.
+ */
+#define ES_CONDITIONING_BATCH_SIZE 8
+
 /** Represents the device thread sleep time in seconds. */
 #define ES_DEVICE_THREAD_SLEEP 1
 
+/**
+ * Represents the maximum time in microseconds a device thread backs off after a
+ * batch did no work while its stream is kept running. The wait starts at
+ * ES_DEVICE_READER_SLEEP and doubles after every idle batch.
+ */
+#define ES_DEVICE_THREAD_MAXIMUM_BACKOFF 500000
+
+/**
+ * Represents the percentage of clean blocks at or above which the pool counts
+ * as full. A device stream is stopped only while the pool is full and the ring
+ * buffers of the device cannot take more readings.
+ */
+#define ES_DEVICE_STREAM_HIGH_WATERMARK 75
+
+/** Represents the time in microseconds a device reader waits for ring space. */
+#define ES_DEVICE_READER_SLEEP 10000
+
 /** Represents the request thread sleep time in seconds. */
 #define ES_REQUEST_THREAD_SLEEP 1
 
@@ -82,7 +125,46 @@ const int es_consume_entropy_block(
 	char **content);
 
 /**
- * Cleans the entropy block specified by the given index.
+ * Consumes a clean entropy block directly into the specified buffer. The block
+ * content is read in place from the published half of the block double buffer,
+ * so no intermediate copy is allocated.
+ *
+ * @param pool The pool from where to extract the clean block to be consumed.
+ * @param buffer The buffer where to write the content of the clean entropy
+ * block extracted.
+ * @param size The size of the specified buffer.
+ * @param length The number of entropy bytes written to the buffer.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_consume_entropy_block_into(
+	struct es_entropy_pool *pool,
+	char *buffer,
+	const int size,
+	int *length);
+
+/**
+ * Cleans the entropy blocks specified by the given indexes. If the pool has a
+ * spill tier holding surplus entropy, blocks are refilled from the spill at
+ * memory speed. The remaining blocks are filled with device data and mixed as a
+ * single batch.
+ *
+ * @param bundle The entropy bundle associated with the current device thread.
+ * @param indexes The indexes of the entropy blocks to be cleaned.
+ * @param count The number of indexes, at most ES_CONDITIONING_BATCH_SIZE.
+ * @param statuses Output parameter holding, for each index, ES_SUCCESS if the
+ * block was cleaned, ES_FAILURE otherwise.
+ * @return ES_SUCCESS if every block was cleaned, ES_FAILURE otherwise.
+ */
+const int es_clean_entropy_blocks(
+	struct es_entropy_bundle *bundle,
+	int **indexes,
+	const int count,
+	int *statuses);
+
+/**
+ * Cleans the entropy block specified by the given index. If the pool has a
+ * spill tier holding surplus entropy, the block is refilled from the spill at
+ * memory speed, otherwise it is filled with device data.
  *
  * @param bundle The entropy bundle associated with the current device thread.
  * @param index The index of the entropy block to be cleaned.
@@ -92,12 +174,53 @@ const int es_clean_entropy_block(
 	struct es_entropy_bundle *bundle,
 	const int index);
 
+/**
+ * Creates the scratch entropy block used to condition device data into the
+ * spill tier of a pool while every block in the pool is clean.
+ *
+ * @param pool The entropy pool owning the spill tier.
+ * @return The address of a newly allocated scratch entropy block if the pool
+ * has a spill tier and the operation was successfull, NULL otherwise.
+ */
+struct es_entropy_block* es_create_entropy_spill_block(
+	struct es_entropy_pool *pool);
+
+/**
+ * Cleans a single batch of dirty entropy blocks and publishes them in the clean
+ * queue. If no dirty block exists, a block worth of device data is conditioned
+ * into the spill tier instead, when a scratch block is given.
+ *
+ * @param bundle The entropy bundle providing the device data.
+ * @param spill_block The scratch entropy block used to feed the spill tier, or
+ * NULL.
+ * @return ES_SUCCESS if some work was done, ES_FAILURE if there was nothing to
+ * do or no block of the batch could be cleaned.
+ */
+const int es_clean_entropy_pool_batch(
+	struct es_entropy_bundle *bundle,
+	struct es_entropy_block *spill_block);
+
 /**
  * Cleans the entire entropy pool specified in the entropy bundle parameter.
+ * While every block is clean, device readings are kept in a staging ring of
+ * the bundle and drained into the next dirty blocks. The device stream is only
+ * stopped while the pool and the staging ring are both full; when a batch does
+ * no work for any other reason, the thread backs off with the stream running.
  *
  * @param bundle The entropy bundle associated with the current device thread.
  * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
  */
 const int es_clean_entropy_pool(struct es_entropy_bundle *bundle);
 
+/**
+ * Reads raw device data into the ring buffer of the specified entropy bundle
+ * until the device is stopped. This is the only work of a device reader thread,
+ * so serial I/O overlaps with the conditioning done by the workers. The ring is
+ * closed on exit.
+ *
+ * @param bundle The entropy bundle associated with the current device thread.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_read_entropy_device(struct es_entropy_bundle *bundle);
+
 #endif /* ENTROPY_SOURCE_GENERATOR_ENTROPY_GENERATOR_H_ */
\ No newline at end of file
@@ -0,0 +1,174 @@
+/**
+ * Copyright (c) 2016, Codrin-Victor Poienaru <cvpoienaru@gmail.com>.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * This software is provided by the copyright holders and contributors "as is"
+ * and any express or implied warranties, including, but not limited to, the
+ * implied warranties of merchantability and fitness for a particular purpose
+ * are disclaimed. In no event shall the copyright holder or contributors be
+ * liable for any direct, indirect, incidental, special, exemplary, or
+ * consequential damages (including, but not limited to, procurement of
+ * substitute goods or services; loss of use, data, or profits; or business
+ * interruption) however caused and on any theory of liability, whether in
+ * contract, strict liability, or tort (including negligence or otherwise)
+ * arising in any way out of the use of this software, even if advised of the
+ * possibility of such damage.
+ */
+
+#ifndef ENTROPY_SOURCE_GENERATOR_ENTROPY_HEALTH_H_
+#define ENTROPY_SOURCE_GENERATOR_ENTROPY_HEALTH_H_
+
+#include <stdlib.h>
+
+#include <global/defs.h>
+
+/**
+ * Represents the minimum entropy in bits per byte assumed for a device when
+ * choosing the health test cutoffs.
+ */
+#define ES_DEFAULT_HEALTH_MIN_ENTROPY 1
+
+/** Represents the maximum supported entropy in bits per byte. */
+#define ES_MAXIMUM_HEALTH_MIN_ENTROPY 8
+
+/** Represents the size in bytes of an adaptive proportion test window. */
+#define ES_HEALTH_APT_WINDOW_SIZE 512
+
+/** Represents the health test status of a device stream that passed so far. */
+#define ES_HEALTH_NO_FAILURE 0
+
+/** Represents a failure of the repetition count test. */
+#define ES_HEALTH_RCT_FAILURE 1
+
+/** Represents a failure of the adaptive proportion test. */
+#define ES_HEALTH_APT_FAILURE 2
+
+/**
+ * Structure defining the continuous health tests run on the raw bytes of a
+ * device stream. Both the repetition count test and the adaptive proportion
+ * test of NIST SP 800-90B are run incrementally, with constant work per byte.
+ * Once a test fails, the failure is sticky.
+ */
+struct es_entropy_health {
+	/** The byte most recently seen by the repetition count test. */
+	unsigned char rct_value;
+
+	/** The number of consecutive occurrences of the most recent byte. */
+	int rct_count;
+
+	/** The repetition count at which the repetition count test fails. */
+	int rct_cutoff;
+
+	/** The reference byte of the current adaptive proportion test window. */
+	unsigned char apt_value;
+
+	/** The number of occurrences of the reference byte in the window. */
+	int apt_count;
+
+	/** The number of bytes seen in the current window. */
+	int apt_length;
+
+	/** The occurrence count at which the adaptive proportion test fails. */
+	int apt_cutoff;
+
+	/** The total number of bytes which passed the health tests. */
+	long byte_count;
+
+	/** The failure status of the health tests. */
+	int failure;
+};
+
+/**
+ * Allocates memory for an entropy health test state.
+ *
+ * @return The address of a newly allocated entropy health test state if the
+ * operation was successfull, NULL otherwise.
+ */
+struct es_entropy_health* es_alloc_entropy_health(void);
+
+/**
+ * Frees the memory used by an entropy health test state.
+ *
+ * @param health The entropy health test state to be freed.
+ */
+void es_free_entropy_health(struct es_entropy_health **health);
+
+/**
+ * Initializes an entropy health test state with the default values. The test
+ * cutoffs are looked up for the assumed minimum entropy, with a false positive
+ * probability of 2^-20 per test.
+ *
+ * @param health The entropy health test state to be initialized.
+ * @param min_entropy The assumed minimum entropy in bits per byte.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_init_entropy_health(
+	struct es_entropy_health *health,
+	const int min_entropy);
+
+/**
+ * Creates an entropy health test state.
+ *
+ * @param min_entropy The assumed minimum entropy in bits per byte.
+ * @return The address of a newly allocated entropy health test state if the
+ * operation was successfull, NULL otherwise.
+ */
+struct es_entropy_health* es_create_entropy_health(const int min_entropy);
+
+/**
+ * Destroys an entropy health test state.
+ *
+ * @param health The entropy health test state to be destroyed.
+ */
+void es_destroy_entropy_health(struct es_entropy_health **health);
+
+/**
+ * Validates an entropy health test state.
+ *
+ * @param health The entropy health test state to be validated.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_validate_entropy_health(struct es_entropy_health *health);
+
+/**
+ * Runs the health tests on the next raw bytes of a device stream.
+ *
+ * @param health The entropy health test state of the device stream.
+ * @param buffer The raw bytes read from the device.
+ * @param length The number of raw bytes read from the device.
+ * @return ES_SUCCESS if the bytes passed the health tests, ES_FAILURE otherwise
+ * (including the case when a previous test already failed).
+ */
+const int es_test_entropy_health(
+	struct es_entropy_health *health,
+	const char *buffer,
+	const int length);
+
+/**
+ * Gets the failure status of an entropy health test state. Safe to call from
+ * a thread other than the one running the tests.
+ *
+ * @param health The entropy health test state to be checked.
+ * @return The failure status of the health tests.
+ */
+const int es_get_entropy_health_failure(struct es_entropy_health *health);
+
+/**
+ * Gets the name of a health test failure status.
+ *
+ * @param failure The failure status.
+ * @return The name of the failure status.
+ */
+const char* es_get_entropy_health_failure_name(const int failure);
+
+#endif /* ENTROPY_SOURCE_GENERATOR_ENTROPY_HEALTH_H_ */
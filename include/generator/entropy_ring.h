@@ -0,0 +1,201 @@
+/**
+ * Copyright (c) 2016, Codrin-Victor Poienaru <cvpoienaru@gmail.com>.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * This software is provided by the copyright holders and contributors "as is"
+ * and any express or implied warranties, including, but not limited to, the
+ * implied warranties of merchantability and fitness for a particular purpose
+ * are disclaimed. In no event shall the copyright holder or contributors be
+ * liable for any direct, indirect, incidental, special, exemplary, or
+ * consequential damages (including, but not limited to, procurement of
+ * substitute goods or services; loss of use, data, or profits; or business
+ * interruption) however caused and on any theory of liability, whether in
+ * contract, strict liability, or tort (including negligence or otherwise)
+ * arising in any way out of the use of this software, even if advised of the
+ * possibility of such damage.
+ */
+
+#ifndef ENTROPY_SOURCE_GENERATOR_ENTROPY_RING_H_
+#define ENTROPY_SOURCE_GENERATOR_ENTROPY_RING_H_
+
+#include <stdlib.h>
+#include <pthread.h>
+
+#include <global/defs.h>
+
+/** Represents the default size in bytes of a device ring buffer. */
+#define ES_DEFAULT_ENTROPY_RING_SIZE 4096
+
+/**
+ * Represents the maximum time in seconds a ring operation waits for data or
+ * free space before giving up, so that the calling thread can check whether it
+ * should stop.
+ */
+#define ES_ENTROPY_RING_TIMEOUT 1
+
+/**
+ * Structure defining the ring buffer staging raw device bytes until they are
+ * mixed into entropy blocks. Bytes are wiped from the ring storage as soon as
+ * they are read.
+ */
+struct es_entropy_ring {
+	/** The ring storage. */
+	char *buffer;
+
+	/** The size in bytes of the ring storage. */
+	int size;
+
+	/** The offset of the oldest byte stored in the ring. */
+	int head;
+
+	/** The number of bytes stored in the ring. */
+	int length;
+
+	/** TRUE if the producer closed the ring, FALSE otherwise. */
+	int closed;
+
+	/** The mutex guarding the ring fields. */
+	pthread_mutex_t mutex;
+
+	/** The condition signaled when bytes are written to the ring. */
+	pthread_cond_t readable;
+
+	/** The condition signaled when bytes are read from the ring. */
+	pthread_cond_t writable;
+};
+
+/**
+ * Allocates memory for a ring buffer.
+ *
+ * @param size The size in bytes of the ring storage.
+ * @return The address of a newly allocated ring buffer if the operation was
+ * successfull, NULL otherwise.
+ */
+struct es_entropy_ring* es_alloc_entropy_ring(const int size);
+
+/**
+ * Frees the memory used by a ring buffer. The ring storage is cleared.
+ *
+ * @param ring The ring buffer to be freed.
+ */
+void es_free_entropy_ring(struct es_entropy_ring **ring);
+
+/**
+ * Initializes a ring buffer with the default values.
+ *
+ * @param ring The ring buffer to be initialized.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_init_entropy_ring(struct es_entropy_ring *ring);
+
+/**
+ * Creates a ring buffer.
+ *
+ * @param size The size in bytes of the ring storage.
+ * @return The address of a newly allocated ring buffer if the operation was
+ * successfull, NULL otherwise.
+ */
+struct es_entropy_ring* es_create_entropy_ring(const int size);
+
+/**
+ * Destroys a ring buffer.
+ *
+ * @param ring The ring buffer to be destroyed.
+ */
+void es_destroy_entropy_ring(struct es_entropy_ring **ring);
+
+/**
+ * Validates a ring buffer.
+ *
+ * @param ring The ring buffer to be validated.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_validate_entropy_ring(struct es_entropy_ring *ring);
+
+/**
+ * Writes the specified bytes to a ring buffer, waiting while the ring is full.
+ *
+ * @param ring The ring buffer where to write the bytes.
+ * @param data The bytes to be written.
+ * @param length The number of bytes to be written.
+ * @return ES_SUCCESS if every byte was written, ES_FAILURE otherwise (including
+ * the case when the ring stayed full for ES_ENTROPY_RING_TIMEOUT seconds or was
+ * closed).
+ */
+const int es_write_entropy_ring(
+	struct es_entropy_ring *ring,
+	const char *data,
+	const int length);
+
+/**
+ * Reads up to the specified number of bytes from a ring buffer, waiting while
+ * the ring is empty. The bytes read are wiped from the ring storage.
+ *
+ * @param ring The ring buffer from where to read the bytes.
+ * @param buffer The buffer where to store the bytes read.
+ * @param size The maximum number of bytes to be read.
+ * @param length Output parameter representing the number of bytes read.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise
+ * (including the case when the ring stayed empty for ES_ENTROPY_RING_TIMEOUT
+ * seconds or was closed and drained).
+ */
+const int es_read_entropy_ring(
+	struct es_entropy_ring *ring,
+	char *buffer,
+	const int size,
+	int *length);
+
+/**
+ * Reads up to the specified number of bytes from a ring buffer, without
+ * waiting for more bytes to be written. The bytes read are wiped from the ring
+ * storage.
+ *
+ * @param ring The ring buffer from where to read the bytes.
+ * @param buffer The buffer where to store the bytes read.
+ * @param size The maximum number of bytes to be read.
+ * @param length Output parameter representing the number of bytes read.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise
+ * (including the case when the ring is empty).
+ */
+const int es_drain_entropy_ring(
+	struct es_entropy_ring *ring,
+	char *buffer,
+	const int size,
+	int *length);
+
+/**
+ * Closes a ring buffer. Waiting readers and writers are woken up, and the bytes
+ * still stored in the ring can be read until it is drained.
+ *
+ * @param ring The ring buffer to be closed.
+ */
+void es_close_entropy_ring(struct es_entropy_ring *ring);
+
+/**
+ * Gets the number of bytes stored in a ring buffer.
+ *
+ * @param ring The ring buffer to be checked.
+ * @return The number of bytes stored in the ring.
+ */
+const int es_get_entropy_ring_length(struct es_entropy_ring *ring);
+
+/**
+ * Gets the number of bytes that can be written to a ring buffer without
+ * waiting.
+ *
+ * @param ring The ring buffer to be checked.
+ * @return The number of free bytes in the ring.
+ */
+const int es_get_entropy_ring_space(struct es_entropy_ring *ring);
+
+#endif /* ENTROPY_SOURCE_GENERATOR_ENTROPY_RING_H_ */
@@ -0,0 +1,155 @@
+/**
+ * Copyright (c) 2016, Codrin-Victor Poienaru <cvpoienaru@gmail.com>.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * This software is provided by the copyright holders and contributors "as is"
+ * and any express or implied warranties, including, but not limited to, the
+ * implied warranties of merchantability and fitness for a particular purpose
+ * are disclaimed. In no event shall the copyright holder or contributors be
+ * liable for any direct, indirect, incidental, special, exemplary, or
+ * consequential damages (including, but not limited to, procurement of
+ * substitute goods or services; loss of use, data, or profits; or business
+ * interruption) however caused and on any theory of liability, whether in
+ * contract, strict liability, or tort (including negligence or otherwise)
+ * arising in any way out of the use of this software, even if advised of the
+ * possibility of such damage.
+ */
+
+#ifndef ENTROPY_SOURCE_GENERATOR_ENTROPY_SCORE_H_
+#define ENTROPY_SOURCE_GENERATOR_ENTROPY_SCORE_H_
+
+#include <stdlib.h>
+
+#include <global/defs.h>
+
+/**
+ * Represents the smoothing shift of the score averages. Each new sample moves
+ * an average by 1 / 2^shift of the difference.
+ */
+#define ES_SCORE_SMOOTHING_SHIFT 3
+
+/** Represents the scale of the error rate, in errors per this many reads. */
+#define ES_SCORE_ERROR_RATE_SCALE 1000
+
+/**
+ * Structure defining the score of a device stream. The score tracks the
+ * measured throughput and error rate of the device and combines them with the
+ * health test results into a scheduling weight.
+ */
+struct es_entropy_score {
+	/** The moving average of the device throughput, in bytes per second. */
+	long throughput;
+
+	/**
+	 * The moving average of the read error rate, in errors per
+	 * ES_SCORE_ERROR_RATE_SCALE reads.
+	 */
+	long error_rate;
+
+	/** The number of successfull device reads. */
+	long read_count;
+
+	/** The number of failed device reads. */
+	long error_count;
+
+	/**
+	 * The scheduling weight of the device, in bytes per second of usable
+	 * throughput. Zero until the first read is measured or once the device
+	 * failed its health tests.
+	 */
+	long weight;
+};
+
+/**
+ * Allocates memory for an entropy score.
+ *
+ * @return The address of a newly allocated entropy score if the operation was
+ * successfull, NULL otherwise.
+ */
+struct es_entropy_score* es_alloc_entropy_score(void);
+
+/**
+ * Frees the memory used by an entropy score.
+ *
+ * @param score The entropy score to be freed.
+ */
+void es_free_entropy_score(struct es_entropy_score **score);
+
+/**
+ * Initializes an entropy score with the default values.
+ *
+ * @param score The entropy score to be initialized.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_init_entropy_score(struct es_entropy_score *score);
+
+/**
+ * Creates an entropy score.
+ *
+ * @return The address of a newly allocated entropy score if the operation was
+ * successfull, NULL otherwise.
+ */
+struct es_entropy_score* es_create_entropy_score(void);
+
+/**
+ * Destroys an entropy score.
+ *
+ * @param score The entropy score to be destroyed.
+ */
+void es_destroy_entropy_score(struct es_entropy_score **score);
+
+/**
+ * Validates an entropy score.
+ *
+ * @param score The entropy score to be validated.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_validate_entropy_score(struct es_entropy_score *score);
+
+/**
+ * Records the outcome of a device read and recomputes the scheduling weight.
+ *
+ * @param score The entropy score of the device stream.
+ * @param status ES_SUCCESS if the read succeeded, ES_FAILURE otherwise.
+ * @param length The number of bytes read.
+ * @param elapsed_time The duration of the read in nanoseconds.
+ * @param healthy TRUE if the device stream passed its health tests, FALSE
+ * otherwise.
+ * @return The change of the scheduling weight.
+ */
+const long es_record_entropy_score_read(
+	struct es_entropy_score *score,
+	const int status,
+	const int length,
+	const unsigned long elapsed_time,
+	const int healthy);
+
+/**
+ * Gets the scheduling weight of an entropy score. Safe to call from a thread
+ * other than the one recording the reads.
+ *
+ * @param score The entropy score to be checked.
+ * @return The scheduling weight of the device stream.
+ */
+const long es_get_entropy_score_weight(struct es_entropy_score *score);
+
+/**
+ * Clears the scheduling weight of an entropy score, once the device stream
+ * stopped.
+ *
+ * @param score The entropy score to be cleared.
+ * @return The change of the scheduling weight.
+ */
+const long es_clear_entropy_score_weight(struct es_entropy_score *score);
+
+#endif /* ENTROPY_SOURCE_GENERATOR_ENTROPY_SCORE_H_ */
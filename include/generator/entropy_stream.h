@@ -0,0 +1,66 @@
+/**
+ * Copyright (c) 2016, Codrin-Victor Poienaru <cvpoienaru@gmail.com>.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * This software is provided by the copyright holders and contributors "as is"
+ * and any express or implied warranties, including, but not limited to, the
+ * implied warranties of merchantability and fitness for a particular purpose
+ * are disclaimed. In no event shall the copyright holder or contributors be
+ * liable for any direct, indirect, incidental, special, exemplary, or
+ * consequential damages (including, but not limited to, procurement of
+ * substitute goods or services; loss of use, data, or profits; or business
+ * interruption) however caused and on any theory of liability, whether in
+ * contract, strict liability, or tort (including negligence or otherwise)
+ * arising in any way out of the use of this software, even if advised of the
+ * possibility of such damage.
+ */
+
+#ifndef ENTROPY_SOURCE_GENERATOR_ENTROPY_STREAM_H_
+#define ENTROPY_SOURCE_GENERATOR_ENTROPY_STREAM_H_
+
+#include <stdlib.h>
+#include <pthread.h>
+
+#include <global/defs.h>
+#include <crypto/chacha_generator.h>
+#include <pool/entropy_pool.h>
+
+/**
+ * Represents the number of fresh pool bytes used to seed or reseed a stream
+ * generator.
+ */
+#define ES_STREAM_SEED_SIZE 64
+
+/**
+ * Represents the number of bytes a stream generator produces before it is
+ * reseeded from the entropy pool.
+ */
+#define ES_DEFAULT_STREAM_RESEED_BYTES (256L * 1024L * 1024L)
+
+/**
+ * Generates bulk bytes from the ChaCha20 stream generator of the calling
+ * thread. Each thread owns its generator, so concurrent bulk requests never
+ * contend on a lock. The generator is seeded from a clean entropy block on
+ * first use and reseeded after ES_DEFAULT_STREAM_RESEED_BYTES bytes.
+ *
+ * @param pool The entropy pool used to seed the stream generator.
+ * @param buffer The buffer where to write the generated bytes.
+ * @param size The number of bytes to be generated.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_generate_entropy_stream(
+	struct es_entropy_pool *pool,
+	char *buffer,
+	const long size);
+
+#endif /* ENTROPY_SOURCE_GENERATOR_ENTROPY_STREAM_H_ */
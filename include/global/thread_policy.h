@@ -0,0 +1,196 @@
+/**
+ * Copyright (c) 2016, Codrin-Victor Poienaru <cvpoienaru@gmail.com>.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * This software is provided by the copyright holders and contributors "as is"
+ * and any express or implied warranties, including, but not limited to, the
+ * implied warranties of merchantability and fitness for a particular purpose
+ * are disclaimed. In no event shall the copyright holder or contributors be
+ * liable for any direct, indirect, incidental, special, exemplary, or
+ * consequential damages (including, but not limited to, procurement of
+ * substitute goods or services; loss of use, data, or profits; or business
+ * interruption) however caused and on any theory of liability, whether in
+ * contract, strict liability, or tort (including negligence or otherwise)
+ * arising in any way out of the use of this software, even if advised of the
+ * possibility of such damage.
+ */
+
+#ifndef ENTROPY_SOURCE_GLOBAL_THREAD_POLICY_H_
+#define ENTROPY_SOURCE_GLOBAL_THREAD_POLICY_H_
+
+#include <stdlib.h>
+#include <pthread.h>
+
+#include <global/defs.h>
+
+/** Represents the maximum number of CPUs a thread policy can pin threads to. */
+#define ES_MAXIMUM_THREAD_POLICY_CPU_COUNT 256
+
+/** Represents the default real-time priority of SCHED_FIFO threads. */
+#define ES_DEFAULT_REALTIME_PRIORITY 10
+
+/**
+ * Structure defining the placement and scheduling applied to a group of
+ * threads (e.g. the device readers or the conditioning workers).
+ */
+struct es_thread_policy {
+	/** The CPUs the threads are pinned to. */
+	int cpus[ES_MAXIMUM_THREAD_POLICY_CPU_COUNT];
+
+	/**
+	 * The number of CPUs the threads are pinned to, or zero if the threads may
+	 * run on any CPU.
+	 */
+	int cpu_count;
+
+	/**
+	 * TRUE if the threads are scheduled with SCHED_FIFO, FALSE if they keep
+	 * the default scheduling policy.
+	 */
+	int realtime;
+
+	/** The SCHED_FIFO priority of the threads. */
+	int priority;
+};
+
+/**
+ * Allocates memory for a thread policy.
+ *
+ * @return The address of a newly allocated thread policy if the operation was
+ * successfull, NULL otherwise.
+ */
+struct es_thread_policy* es_alloc_thread_policy(void);
+
+/**
+ * Frees the memory used by a thread policy.
+ *
+ * @param policy The thread policy to be freed.
+ */
+void es_free_thread_policy(struct es_thread_policy **policy);
+
+/**
+ * Initializes a thread policy with the default values, i.e. no pinning and the
+ * default scheduling policy.
+ *
+ * @param policy The thread policy to be initialized.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_init_thread_policy(struct es_thread_policy *policy);
+
+/**
+ * Creates a thread policy.
+ *
+ * @return The address of a newly allocated thread policy if the operation was
+ * successfull, NULL otherwise.
+ */
+struct es_thread_policy* es_create_thread_policy(void);
+
+/**
+ * Destroys a thread policy.
+ *
+ * @param policy The thread policy to be destroyed.
+ */
+void es_destroy_thread_policy(struct es_thread_policy **policy);
+
+/**
+ * Validates a thread policy.
+ *
+ * @param policy The thread policy to be validated.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_validate_thread_policy(struct es_thread_policy *policy);
+
+/**
+ * Sets the CPUs a thread policy pins threads to.
+ *
+ * @param policy The thread policy to be updated.
+ * @param cpu_list The comma separated list of CPUs or CPU ranges, e.g.
+ * "0,2-3".
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_set_thread_policy_cpus(
+	struct es_thread_policy *policy,
+	const char *cpu_list);
+
+/**
+ * Makes a thread policy schedule threads with SCHED_FIFO.
+ *
+ * @param policy The thread policy to be updated.
+ * @param priority The SCHED_FIFO priority of the threads.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_set_thread_policy_realtime(
+	struct es_thread_policy *policy,
+	const int priority);
+
+/**
+ * Applies a thread policy to a running thread. Scheduling threads with
+ * SCHED_FIFO requires the CAP_SYS_NICE capability.
+ *
+ * @param policy The thread policy to be applied, or NULL to leave the thread
+ * untouched.
+ * @param thread The thread to which the policy will be applied.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_apply_thread_policy(
+	struct es_thread_policy *policy,
+	pthread_t thread);
+
+/**
+ * Initializes thread attributes holding a thread policy, so that a thread is
+ * created pinned and with its scheduling policy in place. Scheduling threads
+ * with SCHED_FIFO requires the CAP_SYS_NICE capability when the thread is
+ * created. The attributes must be destroyed with pthread_attr_destroy.
+ *
+ * @param policy The thread policy to be held, or NULL for the default
+ * attributes.
+ * @param attributes The thread attributes to be initialized.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_init_thread_policy_attributes(
+	struct es_thread_policy *policy,
+	pthread_attr_t *attributes);
+
+/**
+ * Creates a thread placed and scheduled according to a thread policy. The
+ * policy is set on the thread attributes before the thread starts. If the
+ * thread cannot be created with them, e.g. because SCHED_FIFO is not
+ * permitted, it is created with the default attributes and the policy is
+ * applied to the running thread instead.
+ *
+ * @param policy The thread policy to be applied, or NULL to leave the thread
+ * untouched.
+ * @param thread Output parameter holding the created thread.
+ * @param routine The routine run by the thread.
+ * @param argument The argument passed to the routine.
+ * @param applied Output parameter set to TRUE if the whole policy is in effect,
+ * FALSE otherwise.
+ * @return ES_SUCCESS if the thread was created, ES_FAILURE otherwise.
+ */
+const int es_create_policy_thread(
+	struct es_thread_policy *policy,
+	pthread_t *thread,
+	void *(*routine)(void*),
+	void *argument,
+	int *applied);
+
+/**
+ * Gets the CPU time consumed by a running thread.
+ *
+ * @param thread The thread to be checked.
+ * @param cpu_time Output parameter holding the CPU time in nanoseconds.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_get_thread_cpu_time(pthread_t thread, unsigned long *cpu_time);
+
+#endif /* ENTROPY_SOURCE_GLOBAL_THREAD_POLICY_H_ */
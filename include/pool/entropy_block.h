@@ -29,7 +29,6 @@
 #define ENTROPY_SOURCE_POOL_ENTROPY_BLOCK_H_
 
 #include <stdlib.h>
-#include <pthread.h>
 
 #include <global/defs.h>
 #include <crypto/digest.h>
@@ -49,6 +48,40 @@
  */
 #define ES_DIRTY_BLOCK_STATE 1
 
+/**
+ * Indicates that the entropy block was claimed by a device thread and is being
+ * filled. No other thread may fill or consume the block until it is published.
+ */
+#define ES_FILLING_BLOCK_STATE 2
+
+/**
+ * Indicates that the entropy block was claimed by a consumer and its published
+ * content is being read. The block becomes dirty once the read is over.
+ */
+#define ES_READING_BLOCK_STATE 3
+
+/**
+ * The number of low bits of the packed block state word which hold the block
+ * state. The remaining high bits hold the block generation.
+ */
+#define ES_BLOCK_STATE_BITS 8
+
+/** The mask used to extract the block state from the packed state word. */
+#define ES_BLOCK_STATE_MASK ((1UL << ES_BLOCK_STATE_BITS) - 1)
+
+/**
+ * Packs the specified block state and generation into a single state word.
+ */
+#define ES_PACK_BLOCK_STATE(STATE, GENERATION) \
+	((((unsigned long)(GENERATION)) << ES_BLOCK_STATE_BITS) \
+		| (((unsigned long)(STATE)) & ES_BLOCK_STATE_MASK))
+
+/** Extracts the block state from the specified packed state word. */
+#define ES_UNPACK_BLOCK_STATE(WORD) ((int)((WORD) & ES_BLOCK_STATE_MASK))
+
+/** Extracts the block generation from the specified packed state word. */
+#define ES_UNPACK_BLOCK_GENERATION(WORD) ((WORD) >> ES_BLOCK_STATE_BITS)
+
 /**
  * Minimum block threshold expressed in percentage points relative to the total
  * block size.
@@ -61,27 +94,53 @@
  */
 #define ES_MAXIMUM_BLOCK_THRESHOLD 100.0
 
+/** The maximum number of entropy blocks expanded from a single extract. */
+#define ES_MAXIMUM_EXPANSION_FACTOR 8
+
+/** The label of the HKDF context information used to expand entropy blocks. */
+#define ES_HKDF_BLOCK_INFO "EntropySource block"
+
+/**
+ * The label of the HKDF context information used to stretch digests shorter
+ * than their entropy block over the whole block.
+ */
+#define ES_HKDF_STRETCH_INFO "EntropySource stretch"
+
 /** Structure defining the basic entropy block. */
 struct es_entropy_block {
 	/** The number of entropy bytes to be stored in an entropy block. */
 	int size;
 
-	/** The entropy block internal array for storing actual entropy bytes. */
+	/**
+	 * The entropy block internal array for storing actual entropy bytes. The
+	 * array holds raw binary digest bytes (not a string) over the whole block
+	 * size. This is the published half of the block double buffer and is only
+	 * replaced through an atomic pointer swap.
+	 */
 	char *content;
 
 	/**
 	 * The entropy block buffer for storing temporary entropy bytes until the
 	 * threshold is reached. After exceeding the threshold, the bytes will be
-	 * mixed with those already in store in the main array and the buffer
-	 * will be cleared.
+	 * mixed with those already in store in the main array, the result will be
+	 * written back to the buffer and the buffer will be swapped with the main
+	 * array, becoming the inactive half of the block double buffer.
 	 */
 	char *buffer;
 
+	/** The number of bytes appended to the buffer since the last mix. */
+	int buffer_length;
+
 	/**
-	 * Indicates the state of the current entropy block. The state is either
-	 * clean (ES_CLEAN_BLOCK_STATE) or dirty (ES_DIRTY_BLOCK_STATE).
+	 * The packed state word of the current entropy block. The low bits hold
+	 * the block state, which is one of clean (ES_CLEAN_BLOCK_STATE), dirty
+	 * (ES_DIRTY_BLOCK_STATE), filling (ES_FILLING_BLOCK_STATE) or reading
+	 * (ES_READING_BLOCK_STATE). The high bits hold the block generation, which
+	 * is incremented on every transition so that a stale compare-and-swap can
+	 * never succeed after the block went through a full cycle (ABA).
+	 * The word must only be accessed through the atomic state functions.
 	 */
-	int state;
+	unsigned long state;
 
 	/**
 	 * The threshold of the current entropy block expressed in percentage
@@ -101,10 +160,17 @@ struct es_entropy_block {
 	int digest_type;
 
 	/**
-	 * The current block mutex used for mutual exclusion between read and write
-	 * operations applied to the same block.
+	 * Indicates the digest backend for the current entropy block, i.e. the
+	 * library implementing the digest algorithm used when mixing.
+	 */
+	int digest_backend;
+
+	/**
+	 * The block mixer specialized for the digest type, digest backend and size
+	 * of the current entropy block, bound whenever the digest is set, or NULL
+	 * if the generic mixing path must be used.
 	 */
-	pthread_mutex_t mutex;
+	es_block_mixer_func mixer;
 };
 
 /**
@@ -162,6 +228,20 @@ void es_destroy_entropy_block(struct es_entropy_block **block);
  */
 const int es_validate_entropy_block(struct es_entropy_block *block);
 
+/**
+ * Sets the digest used to mix the specified entropy block and binds the block
+ * mixer specialized for the digest and the block size, if any.
+ *
+ * @param block The entropy block to be updated.
+ * @param digest_type The digest algorithm code.
+ * @param digest_backend The digest backend code.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_set_entropy_block_digest(
+	struct es_entropy_block *block,
+	const int digest_type,
+	const int digest_backend);
+
 /**
  * Updates the contents of the specified entropy block with the new content
  * array. Depending on the value of the block threshold, the content may be
@@ -169,9 +249,79 @@ const int es_validate_entropy_block(struct es_entropy_block *block);
  *
  * @param block The entropy block to be updated.
  * @param content The contents to be written to the specified entropy block.
+ * @param length The number of bytes of content.
  * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
  */
 const int es_update_entropy_block_content(
+	struct es_entropy_block *block,
+	const char *content,
+	const int length);
+
+/**
+ * Appends the new content array to the buffer of the specified entropy block,
+ * without mixing it into the main array. The content is binary and may include
+ * NUL characters.
+ *
+ * @param block The entropy block to be updated.
+ * @param content The contents to be appended to the entropy block buffer.
+ * @param length The number of bytes of content.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_append_entropy_block_content(
+	struct es_entropy_block *block,
+	const char *content,
+	const int length);
+
+/**
+ * Checks whether the buffer of the specified entropy block reached the block
+ * threshold, i.e. whether the block is ready to be mixed.
+ *
+ * @param block The entropy block to be checked.
+ * @return ES_SUCCESS if the block is ready to be mixed, ES_FAILURE otherwise.
+ */
+const int es_check_entropy_block_ready(struct es_entropy_block *block);
+
+/**
+ * Mixes the buffers of the specified entropy blocks with their main arrays and
+ * publishes the blocks. The digests of all the blocks are computed as a single
+ * batch, so the blocks must share the same digest type and digest backend.
+ *
+ * @param blocks The entropy blocks to be mixed.
+ * @param count The number of entropy blocks, at most
+ * ES_MAXIMUM_DIGEST_BATCH_SIZE.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_mix_entropy_blocks(
+	struct es_entropy_block **blocks,
+	const int count);
+
+/**
+ * Conditions the specified entropy blocks with the HKDF-SHA-512 keyed
+ * extractor and publishes them. A single extract is performed over the buffer
+ * of the first block, keyed with its current content, and the resulting
+ * pseudorandom key is expanded into the content of every block. Only the first
+ * block needs to be filled; the other blocks are only claimed.
+ *
+ * @param blocks The entropy blocks to be conditioned.
+ * @param count The number of entropy blocks, at most
+ * ES_MAXIMUM_EXPANSION_FACTOR.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_expand_entropy_blocks(
+	struct es_entropy_block **blocks,
+	const int count);
+
+/**
+ * Sets the content of the specified entropy block to already conditioned
+ * entropy bytes, bypassing the mixing step, and publishes the block. Used to
+ * refill blocks from conditioned entropy stored elsewhere (e.g. the spill
+ * tier).
+ *
+ * @param block The entropy block to be updated.
+ * @param content The conditioned content, of the block size.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_set_entropy_block_content(
 	struct es_entropy_block *block,
 	const char *content);
 
@@ -181,13 +331,75 @@ const int es_update_entropy_block_content(
  * function.
  *
  * @param block The entropy block for which we request the content.
- * @param content A copy of the contents of the specified entropy block.
+ * @param content A copy of the raw contents of the specified entropy block,
+ * of the block size.
  * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
  */
 const int es_request_entropy_block_content(
 	struct es_entropy_block *block,
 	char **content);
 
+/**
+ * Gets the published content of the specified entropy block without copying
+ * it. The returned array belongs to the block and stays valid until the block
+ * is consumed and mixed again, so the caller must hold the block while reading
+ * it.
+ *
+ * @param block The entropy block for which we request the content.
+ * @return The address of the published entropy array if the operation was
+ * successfull, NULL otherwise.
+ */
+const char* es_get_entropy_block_content(struct es_entropy_block *block);
+
+/**
+ * Atomically loads the packed state word of the specified entropy block.
+ *
+ * @param block The entropy block for which we request the state word.
+ * @return The packed state word of the specified entropy block.
+ */
+const unsigned long es_load_entropy_block_state(struct es_entropy_block *block);
+
+/**
+ * Atomically loads the state of the specified entropy block.
+ *
+ * @param block The entropy block for which we request the state.
+ * @return The state of the specified entropy block.
+ */
+const int es_get_entropy_block_state(struct es_entropy_block *block);
+
+/**
+ * Claims the specified entropy block by moving it from one state to another
+ * with a single compare-and-swap operation. The claim fails if the block is
+ * not found in the expected state.
+ *
+ * @param block The entropy block to be claimed.
+ * @param from_state The state in which the block is expected to be.
+ * @param to_state The state in which the block will be after the claim.
+ * @param ticket Output parameter representing the packed state word written by
+ * the claim. The ticket must be handed back when releasing the block.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_claim_entropy_block(
+	struct es_entropy_block *block,
+	const int from_state,
+	const int to_state,
+	unsigned long *ticket);
+
+/**
+ * Releases a previously claimed entropy block by moving it to the specified
+ * state. The release only succeeds if the block still holds the state word
+ * written by the matching claim.
+ *
+ * @param block The entropy block to be released.
+ * @param ticket The packed state word written by the matching claim.
+ * @param to_state The state in which the block will be after the release.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_release_entropy_block(
+	struct es_entropy_block *block,
+	const unsigned long ticket,
+	const int to_state);
+
 /**
  * Validates the specified entropy block state.
  *
@@ -33,13 +33,65 @@
 #include <global/defs.h>
 #include <crypto/digest.h>
 
+/** The maximum number of jobs in a digest batch. */
+#define ES_MAXIMUM_DIGEST_BATCH_SIZE 16
+
+/**
+ * Lists the block size classes for which specialized block mixers are
+ * generated, as an X-macro applying the given macro to every size.
+ */
+#define ES_BLOCK_MIXER_SIZE_CLASSES(X) \
+	X(64) \
+	X(128) \
+	X(256) \
+	X(512) \
+	X(1024) \
+	X(2048) \
+	X(4096)
+
+/**
+ * Represents a digest job in a batch: two data sets to be combined and digested,
+ * and the buffer receiving the raw digest.
+ */
+struct es_digest_job {
+	/** The first data set. */
+	const char *data_1;
+
+	/** The number of bytes in the first data set. */
+	int data_1_length;
+
+	/** The second data set. */
+	const char *data_2;
+
+	/** The number of bytes in the second data set. */
+	int data_2_length;
+
+	/**
+	 * The buffer where to combine the two data sets in place, or NULL. See
+	 * es_compute_digest_2.
+	 */
+	char *scratch_data;
+
+	/** The buffer where to write the raw digest bytes. */
+	char *digest_data;
+
+	/**
+	 * The size of the digest buffer on input and the number of digest bytes
+	 * written on output.
+	 */
+	int digest_length;
+};
+
 /**
  * Represents a function pointer definition for computing simple digests.
  */
 typedef const int (*es_digest_func_1)(
 	const int digest_type,
+	const int digest_backend,
 	const char *data,
-	char **digest_data);
+	const int data_length,
+	char *digest_data,
+	int *digest_length);
 
 /**
  * Represents a function pointer definition for computing complex digests
@@ -47,38 +99,149 @@ typedef const int (*es_digest_func_1)(
  */
 typedef const int (*es_digest_func_2)(
 	const int digest_type,
+	const int digest_backend,
 	const char *data_1,
+	const int data_1_length,
 	const char *data_2,
-	char **digest_data);
+	const int data_2_length,
+	char *scratch_data,
+	char *digest_data,
+	int *digest_length);
 
 /**
- * Computes the digest for the given data set.
+ * Computes the raw digest for the given data set. No memory is allocated: the
+ * digest context is cached per thread and the output is written to the caller
+ * buffer.
  *
  * @param digest_type The digest type represents the digest algorithm code which
  * identifies a particular digest algorithm used to compute the digest.
+ * @param digest_backend The digest backend code representing the library
+ * implementing the digest algorithm.
  * @param data The data set for which the digest must be computed.
- * @param digest_data The output digest data.
+ * @param data_length The number of bytes in the data set.
+ * @param digest_data The buffer where to write the raw digest bytes.
+ * @param digest_length Input/output parameter representing the size of the
+ * digest buffer on input and the number of digest bytes written on output.
  * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
  */
 const int es_compute_digest_1(
 	const int digest_type,
+	const int digest_backend,
 	const char *data,
-	char **digest_data);
+	const int data_length,
+	char *digest_data,
+	int *digest_length);
 
 /**
- * Computes the digest for the two given data sets.
+ * Computes the raw digest for the two given data sets. The data sets are
+ * combined with XOR over their common length and the remainder of the longer
+ * one is kept as is. No memory is allocated: the combination is written into
+ * the caller scratch buffer, or streamed through a small chunk on the stack.
  *
  * @param digest_type The digest type represents the digest algorithm code which
  * identifies a particular digest algorithm used to compute the digest.
+ * @param digest_backend The digest backend code representing the library
+ * implementing the digest algorithm.
  * @param data_1 The first data set for which the digest must be computed.
+ * @param data_1_length The number of bytes in the first data set.
  * @param data_2 The second data set for which the digest must be computed.
- * @param digest_data The output digest data.
+ * @param data_2_length The number of bytes in the second data set.
+ * @param scratch_data The buffer where to combine the two data sets in place,
+ * at least as long as the longer data set, or NULL to stream the combination
+ * through a small chunk on the stack. It may be one of the two data sets. It is
+ * wiped once digested.
+ * @param digest_data The buffer where to write the raw digest bytes. It may
+ * overlap any of the data sets and the scratch buffer, since it is only written
+ * once both are fully digested.
+ * @param digest_length Input/output parameter representing the size of the
+ * digest buffer on input and the number of digest bytes written on output.
  * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
  */
 const int es_compute_digest_2(
 	const int digest_type,
+	const int digest_backend,
 	const char *data_1,
+	const int data_1_length,
 	const char *data_2,
-	char **digest_data);
+	const int data_2_length,
+	char *scratch_data,
+	char *digest_data,
+	int *digest_length);
+
+/**
+ * Checks whether a digest batch is computed by a multi-lane kernel, which is
+ * the case when the CPU dispatch layer bound one for the digest type and the
+ * batch holds at least its minimum number of messages.
+ *
+ * @param digest_type The digest type represents the digest algorithm code.
+ * @param count The number of digest jobs in the batch.
+ * @return ES_SUCCESS if the batch is computed by a multi-lane kernel,
+ * ES_FAILURE otherwise.
+ */
+const int es_check_digest_batch_lanes(const int digest_type, const int count);
+
+/**
+ * Computes the raw digests of a batch of independent jobs in one call. Each job
+ * combines two data sets the same way es_compute_digest_2 does. If the CPU
+ * dispatch layer bound a multi-lane kernel for the digest type, equally long
+ * jobs combined in their scratch buffers are digested side by side, one per
+ * vector lane. Otherwise, the digest context is acquired once for the whole
+ * batch and reset between jobs.
+ *
+ * @param digest_type The digest type represents the digest algorithm code which
+ * identifies a particular digest algorithm used to compute the digests.
+ * @param digest_backend The digest backend code representing the library
+ * implementing the digest algorithm.
+ * @param jobs The digest jobs to be computed. On output, the digest length of
+ * each job holds the number of digest bytes written, or zero if the job failed.
+ * @param count The number of digest jobs, at most ES_MAXIMUM_DIGEST_BATCH_SIZE.
+ * @return ES_SUCCESS if every job was successfull, ES_FAILURE otherwise.
+ */
+const int es_compute_digest_batch(
+	const int digest_type,
+	const int digest_backend,
+	struct es_digest_job *jobs,
+	const int count);
+
+/**
+ * Represents a function pointer definition for a block mixer specialized for a
+ * single digest type and block size. The mixer combines the block content and
+ * buffer and writes their raw digest back into the buffer.
+ *
+ * @param content The main entropy array of the block, of the specialized
+ * block size.
+ * @param buffer The entropy buffer of the block, of the specialized block size.
+ * It is used as the scratch buffer and receives the raw digest bytes.
+ * @param buffer_length The number of bytes stored in the buffer.
+ * @param digest_backend The digest backend code representing the library
+ * implementing the digest algorithm.
+ * @param digest_length Output parameter representing the number of digest
+ * bytes written to the buffer.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+typedef const int (*es_block_mixer_func)(
+	const char *content,
+	char *buffer,
+	const int buffer_length,
+	const int digest_backend,
+	int *digest_length);
+
+/**
+ * Gets the block mixer specialized for the specified digest type and block
+ * size. Specialized mixers are generated at compile time for the digest
+ * algorithms and for the block size classes ES_BLOCK_MIXER_SIZE_CLASSES, so
+ * the combination and digest sizes are compile-time constants.
+ *
+ * @param digest_type The digest type represents the digest algorithm code.
+ * @param digest_backend The digest backend code representing the library
+ * implementing the digest algorithm.
+ * @param block_size The block size in bytes.
+ * @return The specialized block mixer, or NULL if the combination has no
+ * specialization and the generic mixing path must be used.
+ */
+es_block_mixer_func es_get_block_mixer(
+	const int digest_type,
+	const int digest_backend,
+	const int block_size);
 
 #endif /* ENTROPY_SOURCE_POOL_ENTROPY_BLOCK_DIGEST_H_ */
\ No newline at end of file
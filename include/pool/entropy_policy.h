@@ -0,0 +1,259 @@
+/**
+ * Copyright (c) 2016, Codrin-Victor Poienaru <cvpoienaru@gmail.com>.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * This software is provided by the copyright holders and contributors "as is"
+ * and any express or implied warranties, including, but not limited to, the
+ * implied warranties of merchantability and fitness for a particular purpose
+ * are disclaimed. In no event shall the copyright holder or contributors be
+ * liable for any direct, indirect, incidental, special, exemplary, or
+ * consequential damages (including, but not limited to, procurement of
+ * substitute goods or services; loss of use, data, or profits; or business
+ * interruption) however caused and on any theory of liability, whether in
+ * contract, strict liability, or tort (including negligence or otherwise)
+ * arising in any way out of the use of this software, even if advised of the
+ * possibility of such damage.
+ */
+
+#ifndef ENTROPY_SOURCE_POOL_ENTROPY_POLICY_H_
+#define ENTROPY_SOURCE_POOL_ENTROPY_POLICY_H_
+
+#include <stdlib.h>
+#include <pthread.h>
+
+#include <global/defs.h>
+#include <crypto/digest.h>
+
+/** Gets the allowed digest types bit of the specified digest type. */
+#define ES_DIGEST_TYPE_BIT(DIGEST_TYPE) (1U << (DIGEST_TYPE))
+
+/**
+ * Represents the weight, in 1/ES_POLICY_AVERAGE_SCALE units, given to the
+ * latest sample of the mixing time moving average.
+ */
+#define ES_POLICY_AVERAGE_WEIGHT 1
+
+/** Represents the scale of the mixing time moving average weight. */
+#define ES_POLICY_AVERAGE_SCALE 8
+
+/** Structure defining the metrics recorded by a digest policy. */
+struct es_entropy_policy_metrics {
+	/** The digest type currently used for new mixes. */
+	int digest_type;
+
+	/** The number of digest switches. */
+	unsigned long switch_count;
+
+	/** The number of switches to the burst digest. */
+	unsigned long burst_switch_count;
+
+	/** The number of switches back to the idle digest. */
+	unsigned long idle_switch_count;
+
+	/** The number of mixed blocks observed by the policy. */
+	unsigned long mix_count;
+
+	/** The total CPU time in nanoseconds spent mixing the observed blocks. */
+	unsigned long mix_time;
+
+	/** The moving average of the mixing CPU time per block, in nanoseconds. */
+	unsigned long average_mix_time;
+
+	/** The clean queue depth observed at the last evaluation. */
+	int clean_depth;
+};
+
+/**
+ * Structure defining a load-adaptive digest policy. The policy watches the
+ * clean queue depth and the mixing CPU time of a pool and switches the digest
+ * used for new mixes between an idle digest and a cheaper burst digest, both
+ * restricted to a configured set of allowed digests.
+ */
+struct es_entropy_policy {
+	/** The bit set of the allowed digest types (see ES_DIGEST_TYPE_BIT). */
+	unsigned int allowed_digest_types;
+
+	/** The digest type used while the pool keeps up with the demand. */
+	int idle_digest_type;
+
+	/** The digest type used during bursts. */
+	int burst_digest_type;
+
+	/** The digest backend used with both digest types. */
+	int digest_backend;
+
+	/**
+	 * The clean queue depth at or below which the policy switches to the
+	 * burst digest.
+	 */
+	int low_watermark;
+
+	/**
+	 * The clean queue depth at or above which the policy switches back to the
+	 * idle digest.
+	 */
+	int high_watermark;
+
+	/**
+	 * The mixing CPU time per block, in nanoseconds, at or below which the
+	 * moving average lets the policy switch back to the idle digest.
+	 */
+	unsigned long low_time_budget;
+
+	/**
+	 * The mixing CPU time per block, in nanoseconds, above which the moving
+	 * average switches the policy to the burst digest. Zero disables the CPU
+	 * time criterion.
+	 */
+	unsigned long high_time_budget;
+
+	/** The digest type currently used for new mixes. */
+	int digest_type;
+
+	/** The metrics recorded by the policy. */
+	struct es_entropy_policy_metrics metrics;
+
+	/**
+	 * The current policy mutex used for mutual exclusion between the device
+	 * threads reporting their mixes.
+	 */
+	pthread_mutex_t mutex;
+};
+
+/**
+ * Allocates memory for a digest policy.
+ *
+ * @return The address of a newly allocated digest policy if the operation was
+ * successfull, NULL otherwise.
+ */
+struct es_entropy_policy* es_alloc_entropy_policy(void);
+
+/**
+ * Frees the memory used by a digest policy.
+ *
+ * @param policy The digest policy to be freed.
+ */
+void es_free_entropy_policy(struct es_entropy_policy **policy);
+
+/**
+ * Initializes a digest policy. The policy starts on the idle digest.
+ *
+ * @param policy The digest policy to be initialized.
+ * @param allowed_digest_types The bit set of the allowed digest types. The
+ * HKDF-SHA-512 keyed extractor cannot be switched to or from.
+ * @param idle_digest_type The digest type used while the pool keeps up.
+ * @param burst_digest_type The digest type used during bursts.
+ * @param digest_backend The digest backend used with both digest types.
+ * @param low_watermark The clean queue depth at or below which the policy
+ * switches to the burst digest.
+ * @param high_watermark The clean queue depth at or above which the policy
+ * switches back to the idle digest.
+ * @param low_time_budget The mixing CPU time per block in nanoseconds at or
+ * below which the policy may switch back to the idle digest, or zero.
+ * @param high_time_budget The mixing CPU time per block in nanoseconds above
+ * which the policy switches to the burst digest, or zero.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_init_entropy_policy(
+	struct es_entropy_policy *policy,
+	const unsigned int allowed_digest_types,
+	const int idle_digest_type,
+	const int burst_digest_type,
+	const int digest_backend,
+	const int low_watermark,
+	const int high_watermark,
+	const unsigned long low_time_budget,
+	const unsigned long high_time_budget);
+
+/**
+ * Creates a digest policy.
+ *
+ * @param allowed_digest_types The bit set of the allowed digest types.
+ * @param idle_digest_type The digest type used while the pool keeps up.
+ * @param burst_digest_type The digest type used during bursts.
+ * @param digest_backend The digest backend used with both digest types.
+ * @param low_watermark The clean queue depth at or below which the policy
+ * switches to the burst digest.
+ * @param high_watermark The clean queue depth at or above which the policy
+ * switches back to the idle digest.
+ * @param low_time_budget The mixing CPU time per block in nanoseconds at or
+ * below which the policy may switch back to the idle digest, or zero.
+ * @param high_time_budget The mixing CPU time per block in nanoseconds above
+ * which the policy switches to the burst digest, or zero.
+ * @return The address of a newly allocated digest policy if the operation was
+ * successfull, NULL otherwise.
+ */
+struct es_entropy_policy* es_create_entropy_policy(
+	const unsigned int allowed_digest_types,
+	const int idle_digest_type,
+	const int burst_digest_type,
+	const int digest_backend,
+	const int low_watermark,
+	const int high_watermark,
+	const unsigned long low_time_budget,
+	const unsigned long high_time_budget);
+
+/**
+ * Destroys a digest policy.
+ *
+ * @param policy The digest policy to be destroyed.
+ */
+void es_destroy_entropy_policy(struct es_entropy_policy **policy);
+
+/**
+ * Validates a digest policy.
+ *
+ * @param policy The digest policy to be validated.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_validate_entropy_policy(struct es_entropy_policy *policy);
+
+/**
+ * Gets the digest type to be used for new mixes.
+ *
+ * @param policy The digest policy.
+ * @return The digest type to be used for new mixes.
+ */
+const int es_get_entropy_policy_digest(struct es_entropy_policy *policy);
+
+/**
+ * Records a mix and re-evaluates the policy. The policy switches to the burst
+ * digest when the clean queue depth drops to the low watermark or the mixing
+ * time exceeds its high budget, and back to the idle digest once the clean
+ * queue depth reaches the high watermark and the mixing time is back within
+ * its low budget.
+ *
+ * @param policy The digest policy.
+ * @param clean_depth The current clean queue depth of the pool.
+ * @param block_count The number of blocks mixed.
+ * @param mix_time The CPU time in nanoseconds spent mixing the blocks.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_record_entropy_policy_mix(
+	struct es_entropy_policy *policy,
+	const int clean_depth,
+	const int block_count,
+	const unsigned long mix_time);
+
+/**
+ * Gets a snapshot of the metrics recorded by a digest policy.
+ *
+ * @param policy The digest policy.
+ * @param metrics The structure where to copy the metrics.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_get_entropy_policy_metrics(
+	struct es_entropy_policy *policy,
+	struct es_entropy_policy_metrics *metrics);
+
+#endif /* ENTROPY_SOURCE_POOL_ENTROPY_POLICY_H_ */
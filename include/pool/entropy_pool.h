@@ -37,6 +37,8 @@
 #include <crypto/digest.h>
 #include <pool/entropy_block_digest.h>
 #include <pool/entropy_block.h>
+#include <pool/entropy_spill.h>
+#include <pool/entropy_policy.h>
 
 /** Structure defining the basic entropy pool. */
 struct es_entropy_pool {
@@ -52,6 +54,34 @@ struct es_entropy_pool {
 	/** The queue used to keep references to clean blocks. */
 	struct es_queue *clean_queue;
 
+	/**
+	 * The optional spill tier keeping surplus conditioned entropy on disk while
+	 * every block is clean. NULL if the pool has no spill tier. The spill is
+	 * not owned by the pool.
+	 */
+	struct es_entropy_spill *spill;
+
+	/**
+	 * The optional digest policy switching the block digest with the load of
+	 * the pool. NULL if every block keeps the pool digest. The policy is not
+	 * owned by the pool.
+	 */
+	struct es_entropy_policy *policy;
+
+	/**
+	 * The number of entropy blocks expanded from a single extract over device
+	 * input, between 1 and ES_MAXIMUM_EXPANSION_FACTOR. Only used when the
+	 * blocks are conditioned with the HKDF-SHA-512 keyed extractor.
+	 */
+	int expansion_factor;
+
+	/**
+	 * The sum of the scheduling weights of the device threads filling the
+	 * pool. Used to split the dirty blocks between the devices in proportion
+	 * to their weights.
+	 */
+	long device_weight;
+
 	/**
 	 * The current pool mutex used for mutual exclusion between read and write
 	 * operations applied to the pool.
@@ -123,4 +153,64 @@ void es_destroy_entropy_pool(struct es_entropy_pool **pool);
  */
 const int es_validate_entropy_pool(struct es_entropy_pool *pool);
 
+/**
+ * Attaches a spill tier to an entropy pool. The spill record size must match
+ * the entropy block size. The spill is not owned by the pool and must be
+ * destroyed by the caller after the pool is no longer in use.
+ *
+ * @param pool The entropy pool to which the spill tier will be attached.
+ * @param spill The spill tier to be attached, or NULL to detach the current
+ * one.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_set_entropy_pool_spill(
+	struct es_entropy_pool *pool,
+	struct es_entropy_spill *spill);
+
+/**
+ * Attaches a load-adaptive digest policy to an entropy pool. Blocks refilled
+ * after the policy is attached are mixed with the digest selected by the
+ * policy. The policy is not owned by the pool and must be destroyed by the
+ * caller after the pool is no longer in use.
+ *
+ * @param pool The entropy pool to which the digest policy will be attached.
+ * @param policy The digest policy to be attached, or NULL to detach the current
+ * one. Both digests of the policy must be at least as long as the pool blocks,
+ * so that every block byte is digest output.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_set_entropy_pool_policy(
+	struct es_entropy_pool *pool,
+	struct es_entropy_policy *policy);
+
+/**
+ * Selects the digest algorithm and the digest backend used to mix every entropy
+ * block of an entropy pool. Must be called before entropy is collected into the
+ * pool.
+ *
+ * @param pool The entropy pool to be updated.
+ * @param digest_type The digest algorithm code.
+ * @param digest_backend The digest backend code representing the library
+ * implementing the digest algorithm.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_set_entropy_pool_digest(
+	struct es_entropy_pool *pool,
+	const int digest_type,
+	const int digest_backend);
+
+/**
+ * Sets the number of entropy blocks expanded from a single extract over device
+ * input, when the pool blocks are conditioned with the HKDF-SHA-512 keyed
+ * extractor. Must be called before entropy is collected into the pool.
+ *
+ * @param pool The entropy pool to be updated.
+ * @param expansion_factor The number of blocks per extract, between 1 and
+ * ES_MAXIMUM_EXPANSION_FACTOR.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_set_entropy_pool_expansion(
+	struct es_entropy_pool *pool,
+	const int expansion_factor);
+
 #endif /* ENTROPY_SOURCE_POOL_ENTROPY_POOL_H_ */
@@ -0,0 +1,204 @@
+/**
+ * Copyright (c) 2016, Codrin-Victor Poienaru <cvpoienaru@gmail.com>.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * This software is provided by the copyright holders and contributors "as is"
+ * and any express or implied warranties, including, but not limited to, the
+ * implied warranties of merchantability and fitness for a particular purpose
+ * are disclaimed. In no event shall the copyright holder or contributors be
+ * liable for any direct, indirect, incidental, special, exemplary, or
+ * consequential damages (including, but not limited to, procurement of
+ * substitute goods or services; loss of use, data, or profits; or business
+ * interruption) however caused and on any theory of liability, whether in
+ * contract, strict liability, or tort (including negligence or otherwise)
+ * arising in any way out of the use of this software, even if advised of the
+ * possibility of such damage.
+ */
+
+#ifndef ENTROPY_SOURCE_POOL_ENTROPY_SPILL_H_
+#define ENTROPY_SOURCE_POOL_ENTROPY_SPILL_H_
+
+#include <stdlib.h>
+#include <pthread.h>
+
+#include <global/defs.h>
+
+/**
+ * Represents the size in bytes of the spill write buffer. Records are gathered
+ * in this buffer and appended to the spill file with a single sequential write.
+ * The same size is used for the memory-mapped read window.
+ */
+#define ES_SPILL_WRITE_BUFFER_SIZE (64 * 1024)
+
+/** Represents the default maximum size in bytes of the spill file. */
+#define ES_DEFAULT_SPILL_FILE_SIZE (64L * 1024L * 1024L)
+
+/** Represents the size in bytes of the ephemeral spill encryption key. */
+#define ES_SPILL_KEY_SIZE 32
+
+/** Represents the size in bytes of the spill record initialization vector. */
+#define ES_SPILL_IV_SIZE 16
+
+/**
+ * Structure defining the entropy spill tier. The spill keeps surplus
+ * conditioned entropy records on disk, encrypted with an ephemeral key that
+ * never leaves the process memory, so that they can be streamed back into the
+ * entropy pool when the pool runs low.
+ */
+struct es_entropy_spill {
+	/** The path of the spill file. */
+	char *path;
+
+	/** The file descriptor associated with the spill file. */
+	int fd;
+
+	/** The size in bytes of a single spill record. */
+	int record_size;
+
+	/** The maximum size in bytes of the spill file. */
+	long max_size;
+
+	/**
+	 * The number of records written before the current spill file generation.
+	 * Used together with the record offset to derive the record counter, so
+	 * that a counter value is never reused with the same key.
+	 */
+	long base_record;
+
+	/** The offset of the next record to be read back. */
+	long read_offset;
+
+	/** The number of bytes already flushed to the spill file. */
+	long write_offset;
+
+	/** The buffer gathering encrypted records before they are flushed. */
+	char *write_buffer;
+
+	/** The number of bytes stored in the write buffer. */
+	int write_buffer_length;
+
+	/** The currently mapped read window of the spill file. */
+	char *map;
+
+	/** The spill file offset at which the read window starts. */
+	long map_offset;
+
+	/** The size in bytes of the read window. */
+	long map_length;
+
+	/** The ephemeral key used to encrypt the spill records. */
+	unsigned char key[ES_SPILL_KEY_SIZE];
+
+	/**
+	 * The current spill mutex used for mutual exclusion between read and write
+	 * operations applied to the spill.
+	 */
+	pthread_mutex_t mutex;
+};
+
+/**
+ * Allocates memory for an entropy spill.
+ *
+ * @param path The path of the spill file.
+ * @return The address of a newly allocated entropy spill if the operation was
+ * successfull, NULL otherwise.
+ */
+struct es_entropy_spill* es_alloc_entropy_spill(const char *path);
+
+/**
+ * Frees the memory used by an entropy spill. The spill file is truncated and
+ * removed, and the ephemeral key is cleared.
+ *
+ * @param spill The entropy spill to be freed.
+ */
+void es_free_entropy_spill(struct es_entropy_spill **spill);
+
+/**
+ * Initializes an entropy spill with the default values. A fresh ephemeral key
+ * is generated and a new spill file is created, replacing any file found at
+ * the spill path.
+ *
+ * @param spill The entropy spill to be initialized.
+ * @param record_size The size in bytes of a single spill record.
+ * @param max_size The maximum size in bytes of the spill file.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_init_entropy_spill(
+	struct es_entropy_spill *spill,
+	const int record_size,
+	const long max_size);
+
+/**
+ * Creates an entropy spill.
+ *
+ * @param path The path of the spill file.
+ * @param record_size The size in bytes of a single spill record.
+ * @param max_size The maximum size in bytes of the spill file.
+ * @return The address of a newly allocated entropy spill if the operation was
+ * successfull, NULL otherwise.
+ */
+struct es_entropy_spill* es_create_entropy_spill(
+	const char *path,
+	const int record_size,
+	const long max_size);
+
+/**
+ * Destroys an entropy spill.
+ *
+ * @param spill The entropy spill to be destroyed.
+ */
+void es_destroy_entropy_spill(struct es_entropy_spill **spill);
+
+/**
+ * Validates an entropy spill.
+ *
+ * @param spill The entropy spill to be validated.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_validate_entropy_spill(struct es_entropy_spill *spill);
+
+/**
+ * Encrypts the specified record and appends it to the spill. Records are
+ * gathered in memory and flushed to the spill file in large sequential writes.
+ *
+ * @param spill The entropy spill where to append the record.
+ * @param record The record to be appended, of the spill record size.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise
+ * (including the case when the spill is full).
+ */
+const int es_write_entropy_spill(
+	struct es_entropy_spill *spill,
+	const char *record);
+
+/**
+ * Reads back and decrypts the oldest record stored in the spill. Flushed
+ * records are read through a memory-mapped window of the spill file. Each
+ * record is handed out only once.
+ *
+ * @param spill The entropy spill from where to read the record.
+ * @param record The buffer where to store the record, of the spill record
+ * size.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise
+ * (including the case when the spill is empty).
+ */
+const int es_read_entropy_spill(struct es_entropy_spill *spill, char *record);
+
+/**
+ * Gets the number of records stored in the spill which were not read back yet.
+ *
+ * @param spill The entropy spill to be checked.
+ * @return The number of records available in the spill.
+ */
+const long es_get_entropy_spill_record_count(struct es_entropy_spill *spill);
+
+#endif /* ENTROPY_SOURCE_POOL_ENTROPY_SPILL_H_ */
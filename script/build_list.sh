@@ -38,4 +38,8 @@ declare -a primary_build_list=( \
 
 declare -a test_build_list=( \
 	"test/device" \
-	"test/communication")
+	"test/communication" \
+	"test/hkdf" \
+	"test/hmac_drbg" \
+	"test/entropy_health" \
+	"test/sha_lanes")
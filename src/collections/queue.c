@@ -166,6 +166,25 @@ const int es_check_queue_is_empty(struct es_queue *queue)
 	return g_queue_is_empty(queue->queue);
 }
 
+/**
+ * Gets the number of elements stored in the specified queue.
+ *
+ * @param queue The queue to be checked.
+ * @return The number of elements in the given queue, 0 if the queue is invalid.
+ */
+const int es_get_queue_length(struct es_queue *queue)
+{
+	/* Perform sanity checks. */
+	if(!queue)
+		return 0;
+
+	if(es_validate_queue(queue) != ES_SUCCESS)
+		return 0;
+
+	/* Get the number of elements in the specified queue. */
+	return g_queue_get_length(queue->queue);
+}
+
 /**
  * Pushes the given element in the queue.
  *
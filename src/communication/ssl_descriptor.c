@@ -233,6 +233,40 @@ const int es_read_ssl_descriptor(
 	return ES_SUCCESS;
 }
 
+const int es_receive_ssl_descriptor(
+	struct es_ssl_descriptor *descriptor,
+	void *buffer,
+	const int size,
+	int *length)
+{
+	int r_bytes;
+
+	if(!length)
+		return ES_FAILURE;
+
+	*length = 0;
+
+	if(!descriptor)
+		return ES_FAILURE;
+
+	if(es_validate_ssl_descriptor(descriptor) != ES_SUCCESS)
+		return ES_FAILURE;
+
+	if(!buffer)
+		return ES_FAILURE;
+
+	if(size < 0)
+		return ES_FAILURE;
+
+	r_bytes = SSL_read(descriptor->ssl, buffer, size);
+	if(r_bytes <= 0)
+		return ES_FAILURE;
+
+	*length = r_bytes;
+
+	return ES_SUCCESS;
+}
+
 const int es_write_ssl_descriptor(
 	struct es_ssl_descriptor *descriptor,
 	const void *buffer,
@@ -35,6 +35,7 @@
 #include <arpa/inet.h>
 #include <sys/socket.h>
 #include <sys/types.h>
+#include <sys/time.h>
 #include <netinet/in.h>
 #include <resolv.h>
 #include <pthread.h>
@@ -52,6 +53,7 @@ static const int es_create_ssl_server_listener(const int port, int *listener_d)
 {
 	int ret = ES_FAILURE;
 	struct sockaddr_in addr;
+	struct timeval timeout;
 
 	*listener_d = ES_DEFAULT_DESCRIPTOR;
 
@@ -74,6 +76,18 @@ static const int es_create_ssl_server_listener(const int port, int *listener_d)
 	if(listen(*listener_d, ES_DEFAULT_BACKLOG_SIZE) != 0)
 		goto exit;
 
+	/* Wake up accept periodically so that a stop request is noticed. */
+	memset(&timeout, 0, sizeof(struct timeval));
+	timeout.tv_sec = ES_DEFAULT_LISTENER_TIMEOUT;
+
+	if(setsockopt(
+			*listener_d,
+			SOL_SOCKET,
+			SO_RCVTIMEO,
+			&timeout,
+			sizeof(struct timeval)))
+		goto exit;
+
 	ret = ES_SUCCESS;
 
 exit:
@@ -92,6 +106,7 @@ static const int es_accept_ssl_server_connection(
 	int client_d = ES_DEFAULT_DESCRIPTOR;
 	socklen_t addr_len;
 	struct sockaddr_in addr;
+	struct timeval timeout;
 
 	if(!context)
 		goto exit;
@@ -109,6 +124,24 @@ static const int es_accept_ssl_server_connection(
 	if(client_d < 0)
 		goto exit;
 
+	/* Bound the time a stalled client can hold the server. */
+	memset(&timeout, 0, sizeof(struct timeval));
+	timeout.tv_sec = ES_DEFAULT_CONNECTION_TIMEOUT;
+
+	if(setsockopt(
+			client_d,
+			SOL_SOCKET,
+			SO_RCVTIMEO,
+			&timeout,
+			sizeof(struct timeval))
+			|| setsockopt(
+				client_d,
+				SOL_SOCKET,
+				SO_SNDTIMEO,
+				&timeout,
+				sizeof(struct timeval)))
+		goto exit;
+
 	*descriptor = es_create_ssl_descriptor(context);
 	if(!*descriptor)
 		goto exit;
@@ -132,9 +165,11 @@ exit:
 
 static const int es_handle_ssl_request(
 	struct es_ssl_descriptor *descriptor,
-	es_process_ssl_server_request_function process_request)
+	es_process_ssl_server_request_function process_request,
+	es_stream_ssl_server_request_function stream_request)
 {
 	int ret = ES_FAILURE;
+	int handled = FALSE;
 	char in_buffer[ES_DEFAULT_CONNECTION_BUFFER_SIZE];
 	char out_buffer[ES_DEFAULT_CONNECTION_BUFFER_SIZE];
 	int out_buffer_size = 0;
@@ -160,6 +195,20 @@ static const int es_handle_ssl_request(
 			ES_DEFAULT_CONNECTION_BUFFER_SIZE) != ES_SUCCESS)
 		goto exit;
 
+	if(stream_request) {
+		if(stream_request(
+				in_buffer,
+				strlen(in_buffer),
+				descriptor,
+				&handled) != ES_SUCCESS)
+			goto exit;
+
+		if(handled) {
+			ret = ES_SUCCESS;
+			goto exit;
+		}
+	}
+
 	if(process_request(
 			in_buffer,
 			strlen(in_buffer),
@@ -186,6 +235,15 @@ const int es_run_ssl_server(
 	struct es_ssl_context *context,
 	const int port,
 	es_process_ssl_server_request_function process_request)
+{
+	return es_run_ssl_stream_server(context, port, process_request, NULL);
+}
+
+const int es_run_ssl_stream_server(
+	struct es_ssl_context *context,
+	const int port,
+	es_process_ssl_server_request_function process_request,
+	es_stream_ssl_server_request_function stream_request)
 {
 	int listener_d;
 	struct es_ssl_descriptor *descriptor = NULL;
@@ -200,21 +258,23 @@ const int es_run_ssl_server(
 		goto exit;
 
 	while(TRUE) {
-		if(!context->runnable)
+		if(!__atomic_load_n(&context->runnable, __ATOMIC_RELAXED))
 			break;
 
 		if(es_accept_ssl_server_connection(
 				context,
 				listener_d,
 				&descriptor) != ES_SUCCESS)
-			goto exit;
+			continue;
 
-		if(es_handle_ssl_request(descriptor, process_request) != ES_SUCCESS)
-			goto exit;
+		/* A failed request only drops its own connection. */
+		es_handle_ssl_request(descriptor, process_request, stream_request);
 
 		es_destroy_ssl_descriptor(&descriptor);
 	}
 
+	close(listener_d);
+
 exit:
 	return ES_SUCCESS;
 }
@@ -216,18 +216,18 @@ int main(int argc, char **argv)
 
 	memset(buffer, 0, ES_CLIENT_BUFFER_SIZE);
 
-	if(es_read_ssl_descriptor(
+	if(es_receive_ssl_descriptor(
 			descriptor,
 			buffer,
-			ES_CLIENT_BUFFER_SIZE) != ES_SUCCESS) {
+			ES_CLIENT_BUFFER_SIZE,
+			&buffer_size) != ES_SUCCESS) {
 		perror("Cannot read from SSL socket.");
 		goto exit;
 	}
 
-	buffer_size = strlen(buffer);
 	printf("Connected to entropy server ... \n");
-	printf("Received: %s\n", buffer);
-	printf("Updating entropy pool with: %s ...\n", buffer);
+	printf("Received: %d entropy bytes\n", buffer_size);
+	printf("Updating entropy pool with %d bytes ...\n", buffer_size);
 	if(es_update_kernel_entropy_pool(buffer, buffer_size) != ES_SUCCESS)
 		goto exit;
 
@@ -31,41 +31,93 @@
 #include <unistd.h>
 #include <signal.h>
 #include <pthread.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
 
 #include <global/defs.h>
 #include <global/alloc_type.h>
+#include <global/math_defs.h>
+#include <global/memory.h>
+#include <global/thread_policy.h>
 #include <generator/entropy_bundle.h>
 #include <generator/entropy_generator.h>
+#include <generator/entropy_drbg.h>
+#include <generator/entropy_stream.h>
+#include <generator/entropy_ring.h>
+#include <generator/entropy_conditioner.h>
+#include <generator/entropy_health.h>
+#include <generator/entropy_score.h>
 #include <pool/entropy_block.h>
 #include <pool/entropy_pool.h>
+#include <pool/entropy_spill.h>
+#include <pool/entropy_policy.h>
 #include <device/descriptor.h>
 #include <device/serial_driver.h>
+#include <device/device_spec.h>
 #include <communication/ssl_init.h>
 #include <communication/ssl_context.h>
 #include <communication/ssl_descriptor.h>
 #include <communication/ssl_server.h>
 
-#define ES_BLOCK_SIZE 65
+#define ES_BLOCK_SIZE 64
 #define ES_POOL_SIZE 32
-#define ES_DEVICE_COUNT 1
+#define ES_MAXIMUM_DEVICE_COUNT 16
+#define ES_BULK_REQUEST_PREFIX "BULK "
+#define ES_BULK_WRITE_SIZE (64 * 1024)
+#define ES_MAXIMUM_BULK_REQUEST_SIZE (16L * 1024L * 1024L)
+#define ES_POLICY_DIGEST_TYPES (ES_DIGEST_TYPE_BIT(ES_SHA512_DIGEST) \
+	| ES_DIGEST_TYPE_BIT(ES_BLAKE2B_DIGEST))
+#define ES_POLICY_LOW_WATERMARK (ES_POOL_SIZE / 8)
+#define ES_POLICY_HIGH_WATERMARK (ES_POOL_SIZE / 2)
+#define ES_POLICY_LOW_TIME_BUDGET 0
+#define ES_POLICY_HIGH_TIME_BUDGET 0
+#define ES_CONDITIONING_WORKERS_OPTION "--conditioning-workers="
+#define ES_MIX_SOURCES_OPTION "--mix-sources="
+#define ES_DEVICE_OPTION "--device="
+#define ES_CONTROL_OPTION "--control="
+#define ES_READER_CPUS_OPTION "--reader-cpus="
+#define ES_WORKER_CPUS_OPTION "--worker-cpus="
+#define ES_SERVER_CPUS_OPTION "--server-cpus="
+#define ES_READER_FIFO_OPTION "--reader-fifo"
+#define ES_CONTROL_BUFFER_SIZE 1024
+#define ES_CONTROL_BACKLOG 4
+#define ES_CONTROL_ADD_COMMAND "ADD "
+#define ES_CONTROL_REMOVE_COMMAND "REMOVE "
+#define ES_CONTROL_LIST_COMMAND "LIST"
+#define ES_CONTROL_STATS_COMMAND "STATS"
+#define ES_SERVER_SLEEP 1
+
+struct es_entropy_server_device {
+	struct es_entropy_bundle *bundle;
+	pthread_t thread;
+	int active;
+};
 
 struct es_entropy_server_ssl_bundle {
 	struct es_ssl_context *context;
 	int port;
 	es_process_ssl_server_request_function process_request;
+	es_stream_ssl_server_request_function stream_request;
 };
 
 static struct es_entropy_pool *pool = NULL;
-static struct es_entropy_bundle **bundles = NULL;
+static struct es_entropy_server_device devices[ES_MAXIMUM_DEVICE_COUNT];
+static pthread_mutex_t devices_mutex = PTHREAD_MUTEX_INITIALIZER;
+static volatile sig_atomic_t runnable = TRUE;
+static struct es_entropy_drbg *drbg = NULL;
+static struct es_entropy_conditioner *conditioner = NULL;
 static struct es_entropy_server_ssl_bundle ssl_bundle;
+static pthread_t ssl_thread;
+static int ssl_active = FALSE;
+static struct es_thread_policy *reader_policy = NULL;
+static struct es_thread_policy *worker_policy = NULL;
+static struct es_thread_policy *server_policy = NULL;
 
 static void es_signal_handler(int signum)
 {
-	int i;
-
-	for(i = 0; i < ES_DEVICE_COUNT; ++i) {
-		bundles[i]->descriptor->runnable = FALSE;
-	}
+	/* The main thread stops the devices, under the devices lock. */
+	runnable = FALSE;
 }
 
 static void es_init_signal_handler(void)
@@ -79,6 +131,10 @@ static void es_init_signal_handler(void)
 	sigaction(SIGTERM, &action, NULL);
 	sigaction(SIGQUIT, &action, NULL);
 	sigaction(SIGTSTP, &action, NULL);
+
+	/* A client hanging up mid-stream only fails its own write. */
+	action.sa_handler = SIG_IGN;
+	sigaction(SIGPIPE, &action, NULL);
 }
 
 static void* es_fill_entropy_blocks(void *arg)
@@ -91,6 +147,16 @@ static void* es_fill_entropy_blocks(void *arg)
 	return (es_clean_entropy_pool(bundle) != ES_SUCCESS) ? arg : NULL;
 }
 
+static void* es_read_device_entropy(void *arg)
+{
+	struct es_entropy_bundle *bundle = (struct es_entropy_bundle*)arg;
+
+	if(!bundle)
+		pthread_exit(NULL);
+
+	return (es_read_entropy_device(bundle) != ES_SUCCESS) ? arg : NULL;
+}
+
 static void* es_run_ssl_server_thread(void *arg)
 {
 	struct es_entropy_server_ssl_bundle *bundle =
@@ -99,48 +165,424 @@ static void* es_run_ssl_server_thread(void *arg)
 	if(!bundle)
 		pthread_exit(NULL);
 
-	return (es_run_ssl_server(
+	return (es_run_ssl_stream_server(
 			bundle->context,
 			bundle->port,
-			bundle->process_request) != ES_SUCCESS)
+			bundle->process_request,
+			bundle->stream_request) != ES_SUCCESS)
 		? arg
 		: NULL;
 }
 
-static const int es_collect_entropy(
-	struct es_entropy_bundle **bundles,
-	int bundle_count)
+static void es_stop_device(struct es_entropy_server_device *device)
+{
+	struct es_device_descriptor *descriptor = device->bundle->descriptor;
+
+	descriptor->runnable = FALSE;
+	pthread_join(device->thread, NULL);
+
+	if(conditioner)
+		es_remove_entropy_conditioner_bundle(conditioner, device->bundle);
+
+	es_destroy_device_descriptor(&descriptor);
+	es_destroy_entropy_bundle(&device->bundle);
+	device->active = FALSE;
+}
+
+static const int es_add_device(const char *spec)
 {
 	int i;
 	int ret = ES_FAILURE;
+	int applied;
+	struct es_device_spec device_spec;
+	struct es_device_descriptor *descriptor = NULL;
+	struct es_entropy_bundle *bundle = NULL;
+
+	if(es_parse_device_spec(spec, &device_spec) != ES_SUCCESS)
+		return ES_FAILURE;
+
+	pthread_mutex_lock(&devices_mutex);
+
+	for(i = 0; i < ES_MAXIMUM_DEVICE_COUNT; ++i) {
+		if(devices[i].active && !strcmp(
+				devices[i].bundle->descriptor->serial_bundle->port_name,
+				device_spec.port_name))
+			goto exit;
+	}
+
+	for(i = 0; i < ES_MAXIMUM_DEVICE_COUNT; ++i) {
+		if(!devices[i].active)
+			break;
+	}
+
+	if(i == ES_MAXIMUM_DEVICE_COUNT || !runnable)
+		goto exit;
+
+	descriptor = es_open_device_spec(&device_spec);
+	if(!descriptor)
+		goto exit;
+
+	bundle = es_create_entropy_bundle(pool, descriptor);
+	if(!bundle)
+		goto exit;
+
+	if(conditioner
+			&& es_add_entropy_conditioner_bundle(
+				conditioner,
+				bundle) != ES_SUCCESS)
+		goto exit;
+
+	if(es_create_policy_thread(
+			reader_policy,
+			&devices[i].thread,
+			conditioner ? es_read_device_entropy : es_fill_entropy_blocks,
+			bundle,
+			&applied) != ES_SUCCESS) {
+		if(conditioner)
+			es_remove_entropy_conditioner_bundle(conditioner, bundle);
+
+		goto exit;
+	}
+
+	if(!applied)
+		printf("Cannot apply reader policy to device %s.\n", spec);
+
+	devices[i].bundle = bundle;
+	devices[i].active = TRUE;
+
+	printf(
+		"Device %s (%s) added\n",
+		device_spec.port_name,
+		es_get_device_source_type_name(device_spec.source_type));
+
+	ret = ES_SUCCESS;
+
+exit:
+	pthread_mutex_unlock(&devices_mutex);
+
+	if(ret != ES_SUCCESS) {
+		if(bundle)
+			es_destroy_entropy_bundle(&bundle);
+
+		if(descriptor)
+			es_destroy_device_descriptor(&descriptor);
+	}
+
+	return ret;
+}
+
+static const int es_remove_device(const char *port_name)
+{
+	int i;
+	int ret = ES_FAILURE;
+
+	pthread_mutex_lock(&devices_mutex);
+
+	for(i = 0; i < ES_MAXIMUM_DEVICE_COUNT; ++i) {
+		if(devices[i].active && !strcmp(
+				devices[i].bundle->descriptor->serial_bundle->port_name,
+				port_name)) {
+			es_stop_device(&devices[i]);
+			printf("Device %s removed\n", port_name);
+
+			ret = ES_SUCCESS;
+			break;
+		}
+	}
+
+	pthread_mutex_unlock(&devices_mutex);
+
+	return ret;
+}
+
+static void es_remove_devices(void)
+{
+	int i;
+
+	pthread_mutex_lock(&devices_mutex);
+
+	for(i = 0; i < ES_MAXIMUM_DEVICE_COUNT; ++i) {
+		if(devices[i].active)
+			es_stop_device(&devices[i]);
+	}
+
+	pthread_mutex_unlock(&devices_mutex);
+}
+
+static void es_reap_devices(void)
+{
+	int i;
+	int failure;
+	char port_name[ES_MAXIMUM_PORT_NAME_SIZE];
+
+	pthread_mutex_lock(&devices_mutex);
+
+	for(i = 0; i < ES_MAXIMUM_DEVICE_COUNT; ++i) {
+		if(!devices[i].active)
+			continue;
+
+		failure = es_get_entropy_health_failure(devices[i].bundle->health);
+		if(failure == ES_HEALTH_NO_FAILURE)
+			continue;
+
+		snprintf(
+			port_name,
+			ES_MAXIMUM_PORT_NAME_SIZE,
+			"%s",
+			devices[i].bundle->descriptor->serial_bundle->port_name);
+
+		es_stop_device(&devices[i]);
+		printf(
+			"Device %s removed: %s\n",
+			port_name,
+			es_get_entropy_health_failure_name(failure));
+	}
+
+	pthread_mutex_unlock(&devices_mutex);
+}
+
+static const int es_list_devices(char *buffer, const int size)
+{
+	int i;
+	int length = 0;
+	struct es_device_descriptor *descriptor = NULL;
+
+	buffer[0] = '\0';
+
+	pthread_mutex_lock(&devices_mutex);
+
+	for(i = 0; i < ES_MAXIMUM_DEVICE_COUNT && length < size; ++i) {
+		if(!devices[i].active)
+			continue;
+
+		descriptor = devices[i].bundle->descriptor;
+		length += snprintf(
+			buffer + length,
+			size - length,
+			"%s %s %ld B/s %ld/%ld errors\n",
+			descriptor->serial_bundle->port_name,
+			es_get_device_source_type_name(descriptor->source_type),
+			devices[i].bundle->score->throughput,
+			devices[i].bundle->score->error_count,
+			devices[i].bundle->score->read_count
+				+ devices[i].bundle->score->error_count);
+	}
+
+	pthread_mutex_unlock(&devices_mutex);
+
+	return es_min(length, size - 1);
+}
+
+static const int es_list_thread_stats(char *buffer, const int size)
+{
+	int i;
+	int length = 0;
+	unsigned long cpu_time;
+
+	buffer[0] = '\0';
+
+	pthread_mutex_lock(&devices_mutex);
+
+	for(i = 0; i < ES_MAXIMUM_DEVICE_COUNT && length < size; ++i) {
+		if(!devices[i].active
+				|| es_get_thread_cpu_time(
+					devices[i].thread,
+					&cpu_time) != ES_SUCCESS)
+			continue;
+
+		length += snprintf(
+			buffer + length,
+			size - length,
+			"reader %s %lu ms\n",
+			devices[i].bundle->descriptor->serial_bundle->port_name,
+			cpu_time / 1000000UL);
+	}
+
+	pthread_mutex_unlock(&devices_mutex);
+
+	for(i = 0; conditioner && i < conditioner->started_count
+			&& length < size; ++i) {
+		if(es_get_entropy_conditioner_worker_cpu_time(
+				conditioner,
+				i,
+				&cpu_time) != ES_SUCCESS)
+			continue;
+
+		length += snprintf(
+			buffer + length,
+			size - length,
+			"worker %d %lu ms\n",
+			i,
+			cpu_time / 1000000UL);
+	}
+
+	if(ssl_active && length < size
+			&& es_get_thread_cpu_time(ssl_thread, &cpu_time) == ES_SUCCESS)
+		length += snprintf(
+			buffer + length,
+			size - length,
+			"server %lu ms\n",
+			cpu_time / 1000000UL);
+
+	if(length < size
+			&& es_get_thread_cpu_time(pthread_self(), &cpu_time) == ES_SUCCESS)
+		length += snprintf(
+			buffer + length,
+			size - length,
+			"control %lu ms\n",
+			cpu_time / 1000000UL);
+
+	return es_min(length, size - 1);
+}
+
+static void es_process_control_command(
+	char *command,
+	char *reply,
+	const int reply_size)
+{
+	int status = ES_FAILURE;
+	int length;
+
+	length = strcspn(command, "\r\n");
+	command[length] = '\0';
+
+	if(!strncmp(
+			command,
+			ES_CONTROL_ADD_COMMAND,
+			strlen(ES_CONTROL_ADD_COMMAND)))
+		status = es_add_device(command + strlen(ES_CONTROL_ADD_COMMAND));
+	else if(!strncmp(
+			command,
+			ES_CONTROL_REMOVE_COMMAND,
+			strlen(ES_CONTROL_REMOVE_COMMAND)))
+		status = es_remove_device(command + strlen(ES_CONTROL_REMOVE_COMMAND));
+	else if(!strcmp(command, ES_CONTROL_LIST_COMMAND)) {
+		length = es_list_devices(reply, reply_size - strlen("OK\n"));
+		strcpy(reply + length, "OK\n");
+		return;
+	} else if(!strcmp(command, ES_CONTROL_STATS_COMMAND)) {
+		length = es_list_thread_stats(reply, reply_size - strlen("OK\n"));
+		strcpy(reply + length, "OK\n");
+		return;
+	}
+
+	strcpy(reply, (status == ES_SUCCESS) ? "OK\n" : "ERROR\n");
+}
+
+static void* es_run_control_thread(void *arg)
+{
+	const char *path = (const char*)arg;
+	int fd;
+	int client;
+	int length;
+	struct sockaddr_un address;
+	char command[ES_CONTROL_BUFFER_SIZE];
+	char reply[ES_CONTROL_BUFFER_SIZE];
+
+	if(strlen(path) >= sizeof(address.sun_path))
+		return arg;
+
+	fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if(fd < 0)
+		return arg;
+
+	memset(&address, 0, sizeof(struct sockaddr_un));
+	address.sun_family = AF_UNIX;
+	strcpy(address.sun_path, path);
+
+	unlink(path);
+	if(bind(fd, (struct sockaddr*)&address, sizeof(struct sockaddr_un))
+			|| chmod(path, S_IRUSR | S_IWUSR)
+			|| listen(fd, ES_CONTROL_BACKLOG)) {
+		close(fd);
+		return arg;
+	}
+
+	while(runnable) {
+		client = accept(fd, NULL, NULL);
+		if(client < 0)
+			continue;
+
+		length = read(client, command, ES_CONTROL_BUFFER_SIZE - 1);
+		if(length > 0) {
+			command[length] = '\0';
+			es_process_control_command(command, reply, ES_CONTROL_BUFFER_SIZE);
+
+			if(write(client, reply, strlen(reply)) < 0)
+				perror("Cannot reply to control command.");
+		}
+
+		close(client);
+	}
+
+	close(fd);
+	return NULL;
+}
+
+static const int es_collect_entropy(const char *control_path)
+{
+	int ret = ES_FAILURE;
+	int applied;
 	pthread_t thread;
-	pthread_t *threads = NULL;
 
-	threads = (pthread_t*)malloc((bundle_count + 1) * sizeof(pthread_t));
-	if(!threads)
+	if(conditioner && es_start_entropy_conditioner(conditioner) != ES_SUCCESS)
 		goto exit;
 
-	for(i = 0; i < bundle_count; ++i) {
-		if(pthread_create(&thread, NULL, es_fill_entropy_blocks, bundles[i]))
+	if(es_create_policy_thread(
+			server_policy,
+			&ssl_thread,
+			es_run_ssl_server_thread,
+			&ssl_bundle,
+			&applied) != ES_SUCCESS)
+		goto exit;
+
+	ssl_active = TRUE;
+
+	if(!applied)
+		printf("Cannot apply server policy to the SSL server.\n");
+
+	if(control_path) {
+		if(es_create_policy_thread(
+				server_policy,
+				&thread,
+				es_run_control_thread,
+				(void*)control_path,
+				&applied) != ES_SUCCESS)
 			goto exit;
 
-		threads[i] = thread;
+		if(!applied)
+			printf("Cannot apply server policy to the control server.\n");
+
+		pthread_detach(thread);
+	}
+
+	while(runnable) {
+		sleep(ES_SERVER_SLEEP);
+		es_reap_devices();
 	}
 
-	if(pthread_create(&thread, NULL, es_run_ssl_server_thread, &ssl_bundle))
+	/*
+	 * Stop the SSL server first, while the devices still serve its pending
+	 * request. Its accept loop wakes up periodically to notice.
+	 */
+	__atomic_store_n(&ssl_bundle.context->runnable, FALSE, __ATOMIC_RELAXED);
+
+	if(pthread_join(ssl_thread, NULL))
 		goto exit;
 
-	threads[bundle_count] = thread;
-	for(i = 0; i < bundle_count + 1; ++i) {
-		if(pthread_join(threads[i], NULL))
+	ssl_active = FALSE;
+
+	es_remove_devices();
+
+	if(conditioner) {
+		es_stop_entropy_conditioner(conditioner);
+		if(es_join_entropy_conditioner(conditioner) != ES_SUCCESS)
 			goto exit;
 	}
 
 	ret = ES_SUCCESS;
 
 exit:
-	if(threads)
-		free(threads);
 	return ret;
 }
 
@@ -150,74 +592,327 @@ static const int process_request(
 	void *out_buff,
 	int *out_buff_size)
 {
-	char *temp = NULL;
-	temp = malloc(ES_DEFAULT_CONNECTION_BUFFER_SIZE * sizeof(char));
-	if(!temp)
-		return ES_FAILURE;
 	/*printf("Received: %s\n", (const char*)in_buff);
 	strcpy((char*)out_buff, "Hello back.");
 	*out_buff_size = strlen((char*)out_buff);*/
 
-	if(es_consume_entropy_block(pool, &temp) != ES_SUCCESS)
+	if(drbg) {
+		if(es_generate_entropy_drbg(
+				drbg,
+				(char*)out_buff,
+				ES_DEFAULT_CONNECTION_BUFFER_SIZE) != ES_SUCCESS)
+			return ES_FAILURE;
+
+		*out_buff_size = ES_DEFAULT_CONNECTION_BUFFER_SIZE;
+	} else if(es_consume_entropy_block_into(
+			pool,
+			(char*)out_buff,
+			ES_DEFAULT_CONNECTION_BUFFER_SIZE,
+			out_buff_size) != ES_SUCCESS)
 		return ES_FAILURE;
 
-	strcpy((char*)out_buff, temp);
-	*out_buff_size = strlen((char*)out_buff);
-	((char*)out_buff)[*out_buff_size - 1] = '\0';
+	printf("Sending: %d entropy bytes\n", *out_buff_size);
 
-	printf("Sending: %s\nString Length: %d\n", (char*)out_buff, *out_buff_size);
-
-	free(temp);
 	return ES_SUCCESS;
 }
 
+static const int stream_request(
+	const void *in_buff,
+	const int in_buff_size,
+	struct es_ssl_descriptor *descriptor,
+	int *handled)
+{
+	int ret = ES_FAILURE;
+	int chunk;
+	long size;
+	long offset = 0;
+	char *buffer = NULL;
+
+	*handled = FALSE;
+
+	/* Requests without the bulk prefix are served block by block. */
+	if(in_buff_size < strlen(ES_BULK_REQUEST_PREFIX)
+			|| strncmp(
+				(const char*)in_buff,
+				ES_BULK_REQUEST_PREFIX,
+				strlen(ES_BULK_REQUEST_PREFIX)))
+		return ES_SUCCESS;
+
+	*handled = TRUE;
+
+	size = atol((const char*)in_buff + strlen(ES_BULK_REQUEST_PREFIX));
+	if(size <= 0 || size > ES_MAXIMUM_BULK_REQUEST_SIZE) {
+		printf("Rejected bulk request for %ld entropy bytes\n", size);
+		ret = ES_SUCCESS;
+		goto exit;
+	}
+
+	buffer = (char*)malloc(ES_BULK_WRITE_SIZE);
+	if(!buffer)
+		goto exit;
+
+	while(offset < size) {
+		chunk = (int)es_min(ES_BULK_WRITE_SIZE, size - offset);
+
+		if(es_generate_entropy_stream(pool, buffer, chunk) != ES_SUCCESS)
+			goto exit;
+
+		if(es_write_ssl_descriptor(descriptor, buffer, chunk) != ES_SUCCESS)
+			goto exit;
+
+		offset += chunk;
+	}
+
+	printf("Streamed: %ld entropy bytes\n", size);
+
+	ret = ES_SUCCESS;
+
+exit:
+	if(buffer) {
+		es_wipe_memory(buffer, ES_BULK_WRITE_SIZE);
+		free(buffer);
+	}
+
+	return ret;
+}
+
 int main(int argc, char **argv)
 {
 	int ret = ES_FAILURE;
 	int i;
-	struct es_device_descriptor *descriptor = NULL;
-	struct es_entropy_bundle *bundle = NULL;
 	struct es_ssl_context *context = NULL;
+	struct es_entropy_spill *spill = NULL;
+	struct es_entropy_policy *policy = NULL;
+	int use_drbg = FALSE;
+	int use_policy = FALSE;
+	int worker_count = 0;
+	int mix_count = 1;
+	int device_count = 0;
+	const char *device_specs[ES_MAXIMUM_DEVICE_COUNT];
+	const char *control_path = NULL;
+	const char *reader_cpus = NULL;
+	const char *worker_cpus = NULL;
+	const char *server_cpus = NULL;
+	int reader_priority = 0;
+
+	while(argc > 5 && !strncmp(argv[argc - 1], "--", 2)) {
+		if(!strcmp(argv[argc - 1], "--drbg"))
+			use_drbg = TRUE;
+		else if(!strcmp(argv[argc - 1], "--adaptive-digest"))
+			use_policy = TRUE;
+		else if(!strncmp(
+				argv[argc - 1],
+				ES_CONDITIONING_WORKERS_OPTION,
+				strlen(ES_CONDITIONING_WORKERS_OPTION)))
+			worker_count = atoi(
+				argv[argc - 1] + strlen(ES_CONDITIONING_WORKERS_OPTION));
+		else if(!strncmp(
+				argv[argc - 1],
+				ES_MIX_SOURCES_OPTION,
+				strlen(ES_MIX_SOURCES_OPTION)))
+			mix_count = atoi(argv[argc - 1] + strlen(ES_MIX_SOURCES_OPTION));
+		else if(!strncmp(
+				argv[argc - 1],
+				ES_DEVICE_OPTION,
+				strlen(ES_DEVICE_OPTION))
+				&& device_count < ES_MAXIMUM_DEVICE_COUNT - 1)
+			device_specs[device_count++] =
+				argv[argc - 1] + strlen(ES_DEVICE_OPTION);
+		else if(!strncmp(
+				argv[argc - 1],
+				ES_CONTROL_OPTION,
+				strlen(ES_CONTROL_OPTION)))
+			control_path = argv[argc - 1] + strlen(ES_CONTROL_OPTION);
+		else if(!strncmp(
+				argv[argc - 1],
+				ES_READER_CPUS_OPTION,
+				strlen(ES_READER_CPUS_OPTION)))
+			reader_cpus = argv[argc - 1] + strlen(ES_READER_CPUS_OPTION);
+		else if(!strncmp(
+				argv[argc - 1],
+				ES_WORKER_CPUS_OPTION,
+				strlen(ES_WORKER_CPUS_OPTION)))
+			worker_cpus = argv[argc - 1] + strlen(ES_WORKER_CPUS_OPTION);
+		else if(!strncmp(
+				argv[argc - 1],
+				ES_SERVER_CPUS_OPTION,
+				strlen(ES_SERVER_CPUS_OPTION)))
+			server_cpus = argv[argc - 1] + strlen(ES_SERVER_CPUS_OPTION);
+		else if(!strcmp(argv[argc - 1], ES_READER_FIFO_OPTION))
+			reader_priority = ES_DEFAULT_REALTIME_PRIORITY;
+		else if(!strncmp(
+				argv[argc - 1],
+				ES_READER_FIFO_OPTION "=",
+				strlen(ES_READER_FIFO_OPTION "=")))
+			reader_priority = atoi(
+				argv[argc - 1] + strlen(ES_READER_FIFO_OPTION "="));
+		else
+			break;
+
+		--argc;
+	}
 
-	if(argc != 5) {
-		printf("Usage: %s <device_port_name> <ssl_port> <cert_file> \
-			<key_file>\n",
+	if(argc != 5 && argc != 6) {
+		printf("Usage: %s <device_spec> <ssl_port> <cert_file> \
+			<key_file> [<spill_file>] [--drbg] [--adaptive-digest] \
+			[--conditioning-workers=<count>] [--mix-sources=<count>] \
+			[--device=<device_spec>]... \
+			[--control=<socket_path>] [--reader-cpus=<cpu_list>] \
+			[--worker-cpus=<cpu_list>] [--server-cpus=<cpu_list>] \
+			[--reader-fifo[=<priority>]]\n\
+			<cpu_list>: <cpu>[-<cpu>][,<cpu>[-<cpu>]]...\n\
+			<device_spec>: <port_name>[:<baud_rate>[:serial|raw]]\n",
 			argv[0]);
 		goto exit;
 	}
 
+	if(reader_cpus || reader_priority) {
+		reader_policy = es_create_thread_policy();
+		if(!reader_policy) {
+			perror("Cannot create reader policy.");
+			goto exit;
+		}
+
+		if(reader_cpus && es_set_thread_policy_cpus(
+				reader_policy,
+				reader_cpus) != ES_SUCCESS) {
+			printf("Invalid reader CPU list %s.\n", reader_cpus);
+			goto exit;
+		}
+
+		if(reader_priority && es_set_thread_policy_realtime(
+				reader_policy,
+				reader_priority) != ES_SUCCESS) {
+			printf("Invalid reader priority %d.\n", reader_priority);
+			goto exit;
+		}
+	}
+
+	if(worker_cpus) {
+		worker_policy = es_create_thread_policy();
+		if(!worker_policy) {
+			perror("Cannot create worker policy.");
+			goto exit;
+		}
+
+		if(es_set_thread_policy_cpus(
+				worker_policy,
+				worker_cpus) != ES_SUCCESS) {
+			printf("Invalid worker CPU list %s.\n", worker_cpus);
+			goto exit;
+		}
+	}
+
+	if(server_cpus) {
+		server_policy = es_create_thread_policy();
+		if(!server_policy) {
+			perror("Cannot create server policy.");
+			goto exit;
+		}
+
+		if(es_set_thread_policy_cpus(
+				server_policy,
+				server_cpus) != ES_SUCCESS) {
+			printf("Invalid server CPU list %s.\n", server_cpus);
+			goto exit;
+		}
+	}
+
 	pool = es_create_entropy_pool(ES_POOL_SIZE, ES_BLOCK_SIZE, ES_CLEAN_ALLOC);
 	if(!pool) {
 		perror("Cannot allocate entropy pool.");
 		goto exit;
 	}
 
-	bundles = (struct es_entropy_bundle**)malloc(
-		ES_DEVICE_COUNT * sizeof(struct entropy_bundle*));
-	if(!bundles) {
-		perror("Cannot allocate bundle collection.");
-		goto exit;
+	if(argc == 6) {
+		spill = es_create_entropy_spill(
+			argv[5],
+			ES_BLOCK_SIZE,
+			ES_DEFAULT_SPILL_FILE_SIZE);
+		if(!spill) {
+			perror("Cannot create entropy spill.");
+			goto exit;
+		}
+
+		if(es_set_entropy_pool_spill(pool, spill) != ES_SUCCESS) {
+			perror("Cannot attach entropy spill.");
+			goto exit;
+		}
+	}
+
+	if(use_policy) {
+		policy = es_create_entropy_policy(
+			ES_POLICY_DIGEST_TYPES,
+			ES_SHA512_DIGEST,
+			ES_BLAKE2B_DIGEST,
+			ES_OPENSSL_DIGEST_BACKEND,
+			ES_POLICY_LOW_WATERMARK,
+			ES_POLICY_HIGH_WATERMARK,
+			ES_POLICY_LOW_TIME_BUDGET,
+			ES_POLICY_HIGH_TIME_BUDGET);
+		if(!policy) {
+			perror("Cannot create digest policy.");
+			goto exit;
+		}
+
+		if(es_set_entropy_pool_policy(pool, policy) != ES_SUCCESS) {
+			perror("Cannot attach digest policy.");
+			goto exit;
+		}
+	}
+
+	if(use_drbg) {
+		drbg = es_create_entropy_drbg(
+			pool,
+			ES_DEFAULT_DRBG_RESEED_BYTES,
+			ES_DEFAULT_DRBG_RESEED_INTERVAL);
+		if(!drbg) {
+			perror("Cannot create DRBG tier.");
+			goto exit;
+		}
 	}
 
-	for(i = 0; i < ES_DEVICE_COUNT; ++i) {
-		descriptor = es_create_device_descriptor(argv[1], B9600);
-		if(!descriptor) {
-			perror("Cannot allocate device descriptor.");
+	if(worker_count > 0) {
+		conditioner = es_create_entropy_conditioner(
+			pool,
+			worker_count,
+			ES_DEFAULT_ENTROPY_RING_SIZE);
+		if(!conditioner) {
+			perror("Cannot create conditioning workers.");
 			goto exit;
 		}
 
-		if(es_init_device(descriptor) != ES_SUCCESS) {
-			perror("Cannot init the Arduino board.");
+		if(es_set_entropy_conditioner_mix_count(
+				conditioner,
+				mix_count) != ES_SUCCESS) {
+			perror("Cannot set the number of mixed sources.");
 			goto exit;
 		}
 
-		bundle = es_create_entropy_bundle(pool, descriptor);
-		if(!bundle) {
-			perror("Cannot allocate entropy bundle.");
+		if(es_set_entropy_conditioner_thread_policy(
+				conditioner,
+				worker_policy) != ES_SUCCESS) {
+			perror("Cannot set the worker policy.");
 			goto exit;
 		}
+	} else if(mix_count != 1) {
+		printf("Mixing sources requires conditioning workers.\n");
+		goto exit;
+	} else if(worker_policy) {
+		printf("Worker CPUs require conditioning workers.\n");
+		goto exit;
+	}
 
-		bundles[i] = bundle;
+	if(es_add_device(argv[1]) != ES_SUCCESS) {
+		printf("Cannot add device %s.\n", argv[1]);
+		goto exit;
+	}
+
+	for(i = device_count - 1; i >= 0; --i) {
+		if(es_add_device(device_specs[i]) != ES_SUCCESS) {
+			printf("Cannot add device %s.\n", device_specs[i]);
+			goto exit;
+		}
 	}
 
 	es_ssl_init();
@@ -239,30 +934,49 @@ int main(int argc, char **argv)
 	ssl_bundle.context = context;
 	ssl_bundle.port = atoi(argv[2]);
 	ssl_bundle.process_request = process_request;
+	ssl_bundle.stream_request = stream_request;
 
 	es_init_signal_handler();
 
-	if(es_collect_entropy(bundles, ES_DEVICE_COUNT) != ES_SUCCESS) {
-		perror("Cannot collect entropy from bundles.");
+	if(es_collect_entropy(control_path) != ES_SUCCESS) {
+		perror("Cannot collect entropy from devices.");
 		goto exit;
 	}
 
 	ret = ES_SUCCESS;
 
 exit:
+	es_remove_devices();
+
+	if(control_path)
+		unlink(control_path);
+
+	if(conditioner) {
+		es_stop_entropy_conditioner(conditioner);
+		es_join_entropy_conditioner(conditioner);
+		es_destroy_entropy_conditioner(&conditioner);
+	}
+
+	if(drbg)
+		es_destroy_entropy_drbg(&drbg);
+
 	if(pool)
 		es_destroy_entropy_pool(&pool);
 
-	if(bundles) {
-		for(i = 0; i < ES_DEVICE_COUNT; ++i) {
-			if(bundles[i]) {
-				if(bundles[i]->descriptor)
-					es_destroy_device_descriptor(&bundles[i]->descriptor);
+	if(spill)
+		es_destroy_entropy_spill(&spill);
 
-				es_destroy_entropy_bundle(&bundle);
-			}
-		}
-	}
+	if(policy)
+		es_destroy_entropy_policy(&policy);
+
+	if(reader_policy)
+		es_destroy_thread_policy(&reader_policy);
+
+	if(worker_policy)
+		es_destroy_thread_policy(&worker_policy);
+
+	if(server_policy)
+		es_destroy_thread_policy(&server_policy);
 
 	return ret;
 }
\ No newline at end of file
@@ -0,0 +1,372 @@
+/**
+ * Copyright (c) 2016, Codrin-Victor Poienaru <cvpoienaru@gmail.com>.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * This software is provided by the copyright holders and contributors "as is"
+ * and any express or implied warranties, including, but not limited to, the
+ * implied warranties of merchantability and fitness for a particular purpose
+ * are disclaimed. In no event shall the copyright holder or contributors be
+ * liable for any direct, indirect, incidental, special, exemplary, or
+ * consequential damages (including, but not limited to, procurement of
+ * substitute goods or services; loss of use, data, or profits; or business
+ * interruption) however caused and on any theory of liability, whether in
+ * contract, strict liability, or tort (including negligence or otherwise)
+ * arising in any way out of the use of this software, even if advised of the
+ * possibility of such damage.
+ */
+
+#include <crypto/chacha_generator.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <openssl/evp.h>
+
+#include <global/defs.h>
+#include <global/math_defs.h>
+#include <global/memory.h>
+
+/** The all-zero plaintext encrypted to obtain the raw keystream. */
+static const unsigned char es_chacha_zeros[ES_CHACHA_CHUNK_SIZE];
+
+/**
+ * Loads the current key and nonce of a ChaCha20 generator into its cipher
+ * context, restarting the block counter from zero.
+ *
+ * @param generator The ChaCha20 generator to be rekeyed.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+static const int es_rekey_chacha_generator(
+	struct es_chacha_generator *generator)
+{
+	int ret = ES_FAILURE;
+	unsigned char iv[ES_CHACHA_IV_SIZE];
+
+	/* The IV is the 32-bit block counter followed by the nonce. */
+	memset(iv, 0, ES_CHACHA_IV_SIZE - ES_CHACHA_NONCE_SIZE);
+	memcpy(
+		iv + ES_CHACHA_IV_SIZE - ES_CHACHA_NONCE_SIZE,
+		generator->key + ES_CHACHA_KEY_SIZE,
+		ES_CHACHA_NONCE_SIZE);
+
+	if(EVP_EncryptInit_ex(
+			generator->context,
+			NULL,
+			NULL,
+			generator->key,
+			iv))
+		ret = ES_SUCCESS;
+
+	es_wipe_memory(iv, ES_CHACHA_IV_SIZE);
+
+	return ret;
+}
+
+/**
+ * Replaces the key and nonce of a ChaCha20 generator with fresh keystream,
+ * erasing the previous key.
+ *
+ * @param generator The ChaCha20 generator whose key is replaced.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+static const int es_erase_chacha_generator_key(
+	struct es_chacha_generator *generator)
+{
+	int length = 0;
+
+	if(!EVP_EncryptUpdate(
+			generator->context,
+			generator->key,
+			&length,
+			es_chacha_zeros,
+			ES_CHACHA_KEY_SIZE + ES_CHACHA_NONCE_SIZE))
+		return ES_FAILURE;
+
+	return es_rekey_chacha_generator(generator);
+}
+
+/**
+ * Allocates memory for a ChaCha20 generator.
+ *
+ * @return The address of a newly allocated ChaCha20 generator if the operation
+ * was successfull, NULL otherwise.
+ */
+struct es_chacha_generator* es_alloc_chacha_generator(void)
+{
+	int status = ES_FAILURE;
+	struct es_chacha_generator *generator = NULL;
+
+	/* Allocate memory for the generator. */
+	generator = (struct es_chacha_generator*)calloc(
+		1,
+		sizeof(struct es_chacha_generator));
+	if(!generator)
+		goto exit;
+
+	/* Allocate the cipher context. */
+	generator->context = EVP_CIPHER_CTX_new();
+	if(!generator->context)
+		goto exit;
+
+	/* Update the operation status. */
+	status = ES_SUCCESS;
+
+exit:
+	/* If the operation failed, free the partially allocated generator. */
+	if(status == ES_FAILURE && generator)
+		es_free_chacha_generator(&generator);
+
+	return generator;
+}
+
+/**
+ * Frees the memory used by a ChaCha20 generator. The generator key is wiped.
+ *
+ * @param generator The ChaCha20 generator to be freed.
+ */
+void es_free_chacha_generator(struct es_chacha_generator **generator)
+{
+	/* Perform sanity checks. */
+	if(!generator || !(*generator))
+		return;
+
+	/* Free the cipher context, which also clears the expanded key. */
+	if((*generator)->context)
+		EVP_CIPHER_CTX_free((*generator)->context);
+
+	/* Wipe the generator state before releasing it. */
+	es_wipe_memory(*generator, sizeof(struct es_chacha_generator));
+
+	/* Free the generator. */
+	free(*generator);
+	*generator = NULL;
+}
+
+/**
+ * Initializes a ChaCha20 generator with the default values. The generator
+ * must still be seeded before use.
+ *
+ * @param generator The ChaCha20 generator to be initialized.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_init_chacha_generator(struct es_chacha_generator *generator)
+{
+	/* Perform sanity checks. */
+	if(!generator || !generator->context)
+		return ES_FAILURE;
+
+	/* Bind the cipher context to ChaCha20; the key is loaded when seeded. */
+	if(!EVP_EncryptInit_ex(
+			generator->context,
+			EVP_chacha20(),
+			NULL,
+			NULL,
+			NULL))
+		return ES_FAILURE;
+
+	memset(generator->key, 0, ES_CHACHA_KEY_SIZE + ES_CHACHA_NONCE_SIZE);
+	generator->generated_bytes = 0;
+	generator->seeded = FALSE;
+
+	return ES_SUCCESS;
+}
+
+/**
+ * Creates a ChaCha20 generator.
+ *
+ * @return The address of a newly allocated ChaCha20 generator if the operation
+ * was successfull, NULL otherwise.
+ */
+struct es_chacha_generator* es_create_chacha_generator(void)
+{
+	int status = ES_FAILURE;
+	struct es_chacha_generator *generator = NULL;
+
+	/* Allocate memory for the generator. */
+	generator = es_alloc_chacha_generator();
+	if(!generator)
+		goto exit;
+
+	/* Initialize the generator. */
+	if(es_init_chacha_generator(generator) != ES_SUCCESS)
+		goto exit;
+
+	/* Update the operation status. */
+	status = ES_SUCCESS;
+
+exit:
+	/* If the operation failed, destroy the partially created generator. */
+	if(status == ES_FAILURE && generator)
+		es_destroy_chacha_generator(&generator);
+
+	return generator;
+}
+
+/**
+ * Destroys a ChaCha20 generator.
+ *
+ * @param generator The ChaCha20 generator to be destroyed.
+ */
+void es_destroy_chacha_generator(struct es_chacha_generator **generator)
+{
+	es_free_chacha_generator(generator);
+}
+
+/**
+ * Validates a ChaCha20 generator.
+ *
+ * @param generator The ChaCha20 generator to be validated.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_validate_chacha_generator(struct es_chacha_generator *generator)
+{
+	/* Perform sanity checks. */
+	if(!generator || !generator->context)
+		return ES_FAILURE;
+
+	return ES_SUCCESS;
+}
+
+/**
+ * Seeds a ChaCha20 generator. The new key and nonce are derived with SHA-512
+ * from the current generator output and the seed material, so reseeding never
+ * discards entropy already held by the generator.
+ *
+ * @param generator The ChaCha20 generator to be seeded.
+ * @param seed The seed material (e.g. a clean entropy block).
+ * @param seed_length The number of bytes of seed material, at least
+ * ES_CHACHA_MINIMUM_SEED_SIZE.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_seed_chacha_generator(
+	struct es_chacha_generator *generator,
+	const char *seed,
+	const int seed_length)
+{
+	int ret = ES_FAILURE;
+	int length = 0;
+	unsigned int digest_length = 0;
+	unsigned char state[EVP_MAX_MD_SIZE];
+	unsigned char digest[EVP_MAX_MD_SIZE];
+	EVP_MD_CTX *context = NULL;
+
+	/* Perform sanity checks. */
+	if(es_validate_chacha_generator(generator) != ES_SUCCESS)
+		return ES_FAILURE;
+
+	if(!seed || seed_length < ES_CHACHA_MINIMUM_SEED_SIZE)
+		return ES_FAILURE;
+
+	/* Carry over the current generator state, if any. */
+	memset(state, 0, EVP_MAX_MD_SIZE);
+	if(generator->seeded) {
+		if(!EVP_EncryptUpdate(
+				generator->context,
+				state,
+				&length,
+				es_chacha_zeros,
+				EVP_MAX_MD_SIZE))
+			goto exit;
+	}
+
+	/* Derive the new key and nonce as SHA-512(state | seed). */
+	context = EVP_MD_CTX_new();
+	if(!context)
+		goto exit;
+
+	if(!EVP_DigestInit_ex(context, EVP_sha512(), NULL))
+		goto exit;
+
+	if(!EVP_DigestUpdate(context, state, EVP_MAX_MD_SIZE))
+		goto exit;
+
+	if(!EVP_DigestUpdate(context, seed, seed_length))
+		goto exit;
+
+	if(!EVP_DigestFinal_ex(context, digest, &digest_length))
+		goto exit;
+
+	memcpy(generator->key, digest, ES_CHACHA_KEY_SIZE + ES_CHACHA_NONCE_SIZE);
+	if(es_rekey_chacha_generator(generator) != ES_SUCCESS)
+		goto exit;
+
+	/* Update the generator status. */
+	generator->generated_bytes = 0;
+	generator->seeded = TRUE;
+
+	/* Update the operation status. */
+	ret = ES_SUCCESS;
+
+exit:
+	if(context)
+		EVP_MD_CTX_free(context);
+
+	/* Wipe the intermediate state. */
+	es_wipe_memory(state, EVP_MAX_MD_SIZE);
+	es_wipe_memory(digest, EVP_MAX_MD_SIZE);
+
+	return ret;
+}
+
+/**
+ * Generates keystream bytes from a ChaCha20 generator. The key is replaced
+ * with fresh keystream after every ES_CHACHA_CHUNK_SIZE bytes and at the end
+ * of the request, so earlier output cannot be recovered from the state.
+ *
+ * @param generator The ChaCha20 generator used to generate the bytes.
+ * @param output The buffer where to write the generated bytes.
+ * @param output_length The number of bytes to be generated.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_generate_chacha_generator(
+	struct es_chacha_generator *generator,
+	char *output,
+	const long output_length)
+{
+	long offset = 0;
+	int chunk = 0;
+	int length = 0;
+
+	/* Perform sanity checks. */
+	if(es_validate_chacha_generator(generator) != ES_SUCCESS)
+		return ES_FAILURE;
+
+	if(!generator->seeded)
+		return ES_FAILURE;
+
+	if(!output || output_length < 0)
+		return ES_FAILURE;
+
+	while(offset < output_length) {
+		chunk = (int)es_min(ES_CHACHA_CHUNK_SIZE, output_length - offset);
+
+		/* Write the raw keystream straight into the output. */
+		if(!EVP_EncryptUpdate(
+				generator->context,
+				(unsigned char*)output + offset,
+				&length,
+				es_chacha_zeros,
+				chunk))
+			return ES_FAILURE;
+
+		offset += chunk;
+
+		/* Fast key erasure: the next key comes from the same keystream. */
+		if(es_erase_chacha_generator_key(generator) != ES_SUCCESS)
+			return ES_FAILURE;
+	}
+
+	generator->generated_bytes += output_length;
+
+	return ES_SUCCESS;
+}
@@ -0,0 +1,180 @@
+/**
+ * Copyright (c) 2016, Codrin-Victor Poienaru <cvpoienaru@gmail.com>.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * This software is provided by the copyright holders and contributors "as is"
+ * and any express or implied warranties, including, but not limited to, the
+ * implied warranties of merchantability and fitness for a particular purpose
+ * are disclaimed. In no event shall the copyright holder or contributors be
+ * liable for any direct, indirect, incidental, special, exemplary, or
+ * consequential damages (including, but not limited to, procurement of
+ * substitute goods or services; loss of use, data, or profits; or business
+ * interruption) however caused and on any theory of liability, whether in
+ * contract, strict liability, or tort (including negligence or otherwise)
+ * arising in any way out of the use of this software, even if advised of the
+ * possibility of such damage.
+ */
+
+#include <crypto/cpu_dispatch.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+
+#include <global/defs.h>
+
+/** The names of the kernel variants, indexed by the ES_CPU_* codes. */
+static const char *es_cpu_level_names[ES_CPU_LEVEL_COUNT] = {
+	"scalar",
+	"sse2",
+	"avx2",
+	"avx512"
+};
+
+/** The kernel variant selected for the running CPU. */
+static int es_cpu_level = ES_CPU_SCALAR;
+
+/** Indicates whether the running CPU implements the SHA extensions. */
+static int es_cpu_sha = FALSE;
+
+/** Guards the one-time CPU probe. */
+static pthread_once_t es_cpu_probe_once = PTHREAD_ONCE_INIT;
+
+/** Probes the running CPU and applies the environment override. */
+static void es_probe_cpu(void)
+{
+	int i;
+	int level = ES_CPU_SCALAR;
+	int forced = FALSE;
+	const char *variant = NULL;
+
+	/* The SIMD variants only exist on x86, elsewhere the scalar one is kept. */
+#if defined(__x86_64__) || defined(__i386__)
+	__builtin_cpu_init();
+
+	if(__builtin_cpu_supports("sse2"))
+		level = ES_CPU_SSE2;
+
+	if(__builtin_cpu_supports("avx2"))
+		level = ES_CPU_AVX2;
+
+	if(__builtin_cpu_supports("avx512f"))
+		level = ES_CPU_AVX512;
+
+	es_cpu_sha = __builtin_cpu_supports("sha") ? TRUE : FALSE;
+#endif
+
+	/* Lower the selected variant if the environment forces one. */
+	variant = getenv(ES_CPU_DISPATCH_ENV);
+	if(variant) {
+		for(i = 0; i < ES_CPU_LEVEL_COUNT; ++i) {
+			if(!strcmp(variant, es_cpu_level_names[i]))
+				break;
+		}
+
+		if(i < ES_CPU_LEVEL_COUNT) {
+			forced = TRUE;
+			if(i < level)
+				level = i;
+		}
+	}
+
+	es_cpu_level = level;
+
+	if(ES_DEBUG) {
+		printf(
+			"CPU dispatch: %s kernels%s%s\n",
+			es_cpu_level_names[es_cpu_level],
+			forced ? " (forced)" : "",
+			es_cpu_sha ? ", SHA-NI available" : "");
+	}
+}
+
+/**
+ * Gets the kernel variant selected for the running CPU. CPUID is probed once,
+ * at the first call, and the environment override is applied. Outside x86 the
+ * scalar variant is always selected.
+ *
+ * @return The selected kernel variant, one of the ES_CPU_* codes above.
+ */
+const int es_get_cpu_level(void)
+{
+	pthread_once(&es_cpu_probe_once, es_probe_cpu);
+
+	return es_cpu_level;
+}
+
+/**
+ * Checks whether the running CPU implements the SHA extensions. The digest
+ * backends delegate to OpenSSL, which uses SHA-NI on its own when present.
+ *
+ * @return TRUE if the SHA extensions are available, FALSE otherwise.
+ */
+const int es_cpu_supports_sha(void)
+{
+	pthread_once(&es_cpu_probe_once, es_probe_cpu);
+
+	return es_cpu_sha;
+}
+
+/**
+ * Gets the name of the specified kernel variant.
+ *
+ * @param level The kernel variant.
+ * @return The name of the kernel variant, or NULL if the variant is invalid.
+ */
+const char* es_get_cpu_level_name(const int level)
+{
+	/* Perform sanity checks. */
+	if(level < 0 || level >= ES_CPU_LEVEL_COUNT)
+		return NULL;
+
+	return es_cpu_level_names[level];
+}
+
+/**
+ * Selects a kernel among its variants, according to the kernel variant
+ * selected for the running CPU. The widest available variant not above the
+ * selected one is returned.
+ *
+ * @param name The kernel name, used when logging the choice.
+ * @param kernels The kernel variants, indexed by the ES_CPU_* codes. Missing
+ * variants are NULL; the scalar variant must be present unless the caller keeps
+ * its own fallback.
+ * @return The selected kernel variant, or NULL if only the missing scalar
+ * variant is left.
+ */
+void* es_select_cpu_kernel(const char *name, void * const *kernels)
+{
+	int level;
+
+	/* Perform sanity checks. */
+	if(!kernels)
+		return NULL;
+
+	/* Walk down from the selected variant to the first available one. */
+	for(level = es_get_cpu_level(); level > ES_CPU_SCALAR; --level) {
+		if(kernels[level])
+			break;
+	}
+
+	if(ES_DEBUG) {
+		printf(
+			"CPU dispatch: %s kernel bound to %s\n",
+			name ? name : "unnamed",
+			es_cpu_level_names[level]);
+	}
+
+	return kernels[level];
+}
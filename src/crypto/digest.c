@@ -28,9 +28,64 @@
 #include <crypto/digest.h>
 
 #include <stdlib.h>
+#include <stdio.h>
 #include <string.h>
+#include <pthread.h>
 
 #include <global/defs.h>
+#include <crypto/digest_backend.h>
+
+/** The key of the per-thread digest cache. */
+static pthread_key_t es_digest_cache_key;
+
+/** Guards the one-time creation of the per-thread digest cache key. */
+static pthread_once_t es_digest_cache_once = PTHREAD_ONCE_INIT;
+
+/**
+ * Destroys the digest cache of an exiting thread.
+ *
+ * @param cache The digest cache of the exiting thread.
+ */
+static void es_destroy_digest_cache(void *cache)
+{
+	int i;
+	struct es_digest **digests = (struct es_digest**)cache;
+
+	/* Destroy every cached digest. */
+	for(i = 0; i < ES_DIGEST_BACKEND_COUNT * ES_DIGEST_TYPE_COUNT; ++i) {
+		if(digests[i])
+			es_destroy_digest(&digests[i]);
+	}
+
+	/* Free the digest cache. */
+	free(digests);
+}
+
+/** Creates the key of the per-thread digest cache. */
+static void es_create_digest_cache_key(void)
+{
+	pthread_key_create(&es_digest_cache_key, es_destroy_digest_cache);
+}
+
+/**
+ * Gets the digest cache slot associated with the specified digest type and
+ * digest backend.
+ *
+ * @param digest_type The digest type is one of the above digest algorithm
+ * codes representing the chosen digest algorithm.
+ * @param digest_backend The digest backend code representing the library
+ * implementing the digest algorithm.
+ * @return The digest cache slot if the pair is valid, -1 otherwise.
+ */
+static inline const int es_get_digest_cache_slot(
+	const int digest_type,
+	const int digest_backend)
+{
+	if(es_validate_digest_pair(digest_type, digest_backend) != ES_SUCCESS)
+		return -1;
+
+	return digest_backend * ES_DIGEST_TYPE_COUNT + digest_type;
+}
 
 /**
  * Allocates memory for a digest.
@@ -40,13 +95,15 @@
  * @return The address of a newly allocated digest if the operation was
  * successfull, NULL otherwise.
  */
-struct es_digest* es_alloc_digest(const int digest_type)
+struct es_digest* es_alloc_digest(
+	const int digest_type,
+	const int digest_backend)
 {
 	int status = ES_FAILURE;
 	struct es_digest *digest = NULL;
 
 	/* Perform sanity checks. */
-	if(es_validate_digest_type(digest_type) != ES_SUCCESS)
+	if(es_validate_digest_pair(digest_type, digest_backend) != ES_SUCCESS)
 		goto exit;
 
 	/* Allocate memory for the digest structure. */
@@ -54,8 +111,15 @@ struct es_digest* es_alloc_digest(const int digest_type)
 	if(!digest)
 		goto exit;
 
+	/*
+	 * The backend operations are needed as early as this in order to be able
+	 * to destroy the underlying algorithm if the allocation fails midway.
+	 */
+	digest->operations = es_get_digest_backend(digest_backend);
+	digest->algorithm = NULL;
+
 	/* Create a new underlying digest algorithm. */
-	digest->algorithm = g_checksum_new(digest_type);
+	digest->algorithm = digest->operations->create(digest_type);
 	if(!digest->algorithm)
 		goto exit;
 
@@ -83,7 +147,7 @@ void es_free_digest(struct es_digest **digest)
 
 	/* If created, destroy the underlying digest algorithm. */
 	if((*digest)->algorithm)
-		g_checksum_free((*digest)->algorithm);
+		(*digest)->operations->destroy((*digest)->algorithm);
 
 	/* Free the digest structure. */
 	free(*digest);
@@ -98,17 +162,21 @@ void es_free_digest(struct es_digest **digest)
  * codes representing the chosen digest algorithm.
  * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
  */
-const int es_init_digest(struct es_digest *digest, const int digest_type)
+const int es_init_digest(
+	struct es_digest *digest,
+	const int digest_type,
+	const int digest_backend)
 {
 	/* Perform sanity checks. */
 	if(!digest)
 		return ES_FAILURE;
 
-	if(es_validate_digest_type(digest_type) != ES_SUCCESS)
+	if(es_validate_digest_pair(digest_type, digest_backend) != ES_SUCCESS)
 		return ES_FAILURE;
 
 	/* Initialize the structure fields with their default values. */
 	digest->type = digest_type;
+	digest->backend = digest_backend;
 
 	return ES_SUCCESS;
 }
@@ -121,22 +189,24 @@ const int es_init_digest(struct es_digest *digest, const int digest_type)
  * @return The address of a newly allocated digest if the operation was
  * successfull, NULL otherwise.
  */
-struct es_digest* es_create_digest(const int digest_type)
+struct es_digest* es_create_digest(
+	const int digest_type,
+	const int digest_backend)
 {
 	int status = ES_FAILURE;
 	struct es_digest *digest = NULL;
 
 	/* Perform sanity checks. */
-	if(es_validate_digest_type(digest_type) != ES_SUCCESS)
+	if(es_validate_digest_pair(digest_type, digest_backend) != ES_SUCCESS)
 		goto exit;
 
 	/* Allocate memory for the new digest. */
-	digest = es_alloc_digest(digest_type);
+	digest = es_alloc_digest(digest_type, digest_backend);
 	if(!digest)
 		goto exit;
 
 	/* Initialize the digest fields with their default values. */
-	if(es_init_digest(digest, digest_type) != ES_SUCCESS)
+	if(es_init_digest(digest, digest_type, digest_backend) != ES_SUCCESS)
 		goto exit;
 
 	/* Update the operation status. */
@@ -161,6 +231,76 @@ void es_destroy_digest(struct es_digest **digest)
 	es_free_digest(digest);
 }
 
+/**
+ * Acquires the digest of the specified type cached for the calling thread. The
+ * digest is created on first use, reset before being handed out and released
+ * automatically when the thread exits, so it must not be destroyed by the
+ * caller. It stays valid until the next acquire of the same type on the same
+ * thread.
+ *
+ * @param digest_type The digest type is one of the above digest algorithm
+ * codes representing the chosen digest algorithm.
+ * @return The address of the cached digest if the operation was successfull,
+ * NULL otherwise.
+ */
+struct es_digest* es_acquire_digest(
+	const int digest_type,
+	const int digest_backend)
+{
+	int slot;
+	struct es_digest **digests = NULL;
+
+	/* Perform sanity checks. */
+	slot = es_get_digest_cache_slot(digest_type, digest_backend);
+	if(slot < 0)
+		return NULL;
+
+	/* Get the digest cache of the calling thread, creating it if needed. */
+	pthread_once(&es_digest_cache_once, es_create_digest_cache_key);
+
+	digests = (struct es_digest**)pthread_getspecific(es_digest_cache_key);
+	if(!digests) {
+		digests = (struct es_digest**)calloc(
+			ES_DIGEST_BACKEND_COUNT * ES_DIGEST_TYPE_COUNT,
+			sizeof(struct es_digest*));
+		if(!digests)
+			return NULL;
+
+		if(pthread_setspecific(es_digest_cache_key, digests) != 0) {
+			free(digests);
+			return NULL;
+		}
+	}
+
+	/* Create the cached digest on first use, otherwise reset it. */
+	if(!digests[slot]) {
+		digests[slot] = es_create_digest(digest_type, digest_backend);
+		return digests[slot];
+	}
+
+	if(es_reset_digest(digests[slot]) != ES_SUCCESS)
+		return NULL;
+
+	return digests[slot];
+}
+
+/**
+ * Resets a digest to its initial state, discarding any data it was updated
+ * with.
+ *
+ * @param digest The digest to be reset.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_reset_digest(struct es_digest *digest)
+{
+	/* Perform sanity checks. */
+	if(es_validate_digest(digest) != ES_SUCCESS)
+		return ES_FAILURE;
+
+	/* Reset the underlying digest algorithm. */
+	return digest->operations->reset(digest->algorithm);
+}
+
 /**
  * Validates the specified digest type.
  *
@@ -175,6 +315,9 @@ inline const int es_validate_digest_type(const int digest_type)
 		case ES_SHA1_DIGEST:
 		case ES_SHA256_DIGEST:
 		case ES_SHA512_DIGEST:
+		case ES_BLAKE2B_DIGEST:
+		case ES_HKDF_SHA512_DIGEST:
+		case ES_TREE_SHA512_DIGEST:
 			/* Digest type is valid. */
 			return ES_SUCCESS;
 
@@ -184,6 +327,34 @@ inline const int es_validate_digest_type(const int digest_type)
 	}
 }
 
+/**
+ * Validates the specified digest type against the specified digest backend.
+ *
+ * @param digest_type The digest type is one of the above digest algorithm
+ * codes representing the chosen digest algorithm.
+ * @param digest_backend The digest backend code representing the library
+ * implementing the digest algorithm.
+ * @return ES_SUCCESS if the backend implements the digest type, ES_FAILURE
+ * otherwise.
+ */
+const int es_validate_digest_pair(
+	const int digest_type,
+	const int digest_backend)
+{
+	const struct es_digest_backend *backend = NULL;
+
+	/* Perform sanity checks. */
+	if(es_validate_digest_type(digest_type) != ES_SUCCESS)
+		return ES_FAILURE;
+
+	backend = es_get_digest_backend(digest_backend);
+	if(!backend)
+		return ES_FAILURE;
+
+	/* Check whether the backend implements the digest type. */
+	return backend->supports(digest_type);
+}
+
 /**
  * Validates a digest.
  *
@@ -200,7 +371,10 @@ const int es_validate_digest(struct es_digest *digest)
 	if(!digest->algorithm)
 		return ES_FAILURE;
 
-	if(es_validate_digest_type(digest->type) != ES_SUCCESS)
+	if(!digest->operations)
+		return ES_FAILURE;
+
+	if(es_validate_digest_pair(digest->type, digest->backend) != ES_SUCCESS)
 		return ES_FAILURE;
 
 	return ES_SUCCESS;
@@ -214,6 +388,27 @@ const int es_validate_digest(struct es_digest *digest)
  * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
  */
 const int es_update_digest(struct es_digest *digest, const char *data)
+{
+	/* Perform sanity checks. */
+	if(!data)
+		return ES_FAILURE;
+
+	/* Update the digest internal buffer using the specified string. */
+	return es_update_digest_bytes(digest, data, strlen(data));
+}
+
+/**
+ * Updates the digest internal buffer using the specified binary data.
+ *
+ * @param digest The digest to be updated.
+ * @param data The data used to update the digest.
+ * @param length The number of bytes of data used to update the digest.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_update_digest_bytes(
+	struct es_digest *digest,
+	const char *data,
+	const int length)
 {
 	/* Perform sanity checks. */
 	if(!digest)
@@ -225,13 +420,11 @@ const int es_update_digest(struct es_digest *digest, const char *data)
 	if(!data)
 		return ES_FAILURE;
 
-	/* Update the digest internal buffer using the specified data. */
-	g_checksum_update(
-		digest->algorithm,
-		(const unsigned char*)data,
-		strlen(data));
+	if(length < 0)
+		return ES_FAILURE;
 
-	return ES_SUCCESS;
+	/* Update the digest internal buffer using the specified data. */
+	return digest->operations->update(digest->algorithm, data, length);
 }
 
 /**
@@ -243,21 +436,90 @@ const int es_update_digest(struct es_digest *digest, const char *data)
  */
 char* es_get_digest_string(struct es_digest *digest)
 {
+	int i;
+	int digest_length = ES_MAXIMUM_DIGEST_SIZE;
+	char digest_bytes[ES_MAXIMUM_DIGEST_SIZE];
 	char *digest_data = NULL;
 
 	/* Perform sanity checks. */
 	if(!digest)
 		return digest_data;
 
-	if(es_validate_digest(digest) != ES_SUCCESS)
+	/* Get the raw bytes of the digest internal buffer. */
+	if(es_get_digest_bytes(digest, digest_bytes, &digest_length) != ES_SUCCESS)
 		return digest_data;
 
-	/* Get the string representation of the digest internal buffer. */
-	digest_data = strdup(g_checksum_get_string(digest->algorithm));
+	/* Hex encode the raw bytes, the same way GLib does. */
+	digest_data = (char*)malloc((2 * digest_length + 1) * sizeof(char));
+	if(digest_data) {
+		for(i = 0; i < digest_length; ++i)
+			sprintf(
+				digest_data + 2 * i,
+				"%02x",
+				(unsigned char)digest_bytes[i]);
+		digest_data[2 * digest_length] = '\0';
+	}
+
+	/* Clear the raw bytes of the digest. */
+	memset(digest_bytes, 0, ES_MAXIMUM_DIGEST_SIZE);
 
 	return digest_data;
 }
 
+/**
+ * Gets the raw bytes of the digest internal buffer. Unlike the string
+ * representation, which is hex encoded, every output byte carries a full byte
+ * of the digest. If the output buffer is shorter than the digest, the digest is
+ * truncated. Once the bytes are read, the digest must be reset before being
+ * updated again.
+ *
+ * @param digest The digest used to get the raw bytes.
+ * @param out The buffer where to write the raw digest bytes.
+ * @param length Input/output parameter representing the size of the output
+ * buffer on input and the number of bytes written to it on output.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_get_digest_bytes(
+	struct es_digest *digest,
+	char *out,
+	int *length)
+{
+	int digest_length = 0;
+	unsigned char digest_data[ES_MAXIMUM_DIGEST_SIZE];
+
+	/* Perform sanity checks. */
+	if(!digest)
+		return ES_FAILURE;
+
+	if(es_validate_digest(digest) != ES_SUCCESS)
+		return ES_FAILURE;
+
+	if(!out || !length)
+		return ES_FAILURE;
+
+	if(*length < 0)
+		return ES_FAILURE;
+
+	/*
+	 * The backends require room for the whole digest, so get it on the stack
+	 * first and copy as much of it as fits in the output buffer.
+	 */
+	if(digest->operations->finish(
+			digest->algorithm,
+			digest_data,
+			&digest_length) != ES_SUCCESS)
+		return ES_FAILURE;
+
+	if(*length > digest_length)
+		*length = digest_length;
+	memcpy(out, digest_data, *length);
+
+	/* Clear the stack copy of the digest. */
+	memset(digest_data, 0, ES_MAXIMUM_DIGEST_SIZE);
+
+	return ES_SUCCESS;
+}
+
 /**
  * Computes the digest size based on the digest type.
  *
@@ -268,5 +530,23 @@ char* es_get_digest_string(struct es_digest *digest)
 inline const int es_get_digest_size(const int digest_type)
 {
 	/* Compute the digest size based on the digest type. */
-	return g_checksum_type_get_length(digest_type);
+	switch(digest_type) {
+		case ES_MD5_DIGEST:
+			return 16;
+
+		case ES_SHA1_DIGEST:
+			return 20;
+
+		case ES_SHA256_DIGEST:
+			return 32;
+
+		case ES_SHA512_DIGEST:
+		case ES_BLAKE2B_DIGEST:
+		case ES_HKDF_SHA512_DIGEST:
+		case ES_TREE_SHA512_DIGEST:
+			return 64;
+
+		default:
+			return 0;
+	}
 }
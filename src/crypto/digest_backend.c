@@ -0,0 +1,394 @@
+/**
+ * Copyright (c) 2016, Codrin-Victor Poienaru <cvpoienaru@gmail.com>.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * This software is provided by the copyright holders and contributors "as is"
+ * and any express or implied warranties, including, but not limited to, the
+ * implied warranties of merchantability and fitness for a particular purpose
+ * are disclaimed. In no event shall the copyright holder or contributors be
+ * liable for any direct, indirect, incidental, special, exemplary, or
+ * consequential damages (including, but not limited to, procurement of
+ * substitute goods or services; loss of use, data, or profits; or business
+ * interruption) however caused and on any theory of liability, whether in
+ * contract, strict liability, or tort (including negligence or otherwise)
+ * arising in any way out of the use of this software, even if advised of the
+ * possibility of such damage.
+ */
+
+#include <crypto/digest_backend.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <openssl/evp.h>
+
+#include <global/defs.h>
+#include <crypto/digest.h>
+
+/**
+ * Maps the specified digest type to the matching GLib checksum type.
+ *
+ * @param digest_type The digest algorithm code.
+ * @return The matching GLib checksum type if the digest type is supported, -1
+ * otherwise.
+ */
+static inline const int es_get_glib_checksum_type(const int digest_type)
+{
+	switch(digest_type) {
+		case ES_MD5_DIGEST:
+			return G_CHECKSUM_MD5;
+
+		case ES_SHA1_DIGEST:
+			return G_CHECKSUM_SHA1;
+
+		case ES_SHA256_DIGEST:
+			return G_CHECKSUM_SHA256;
+
+		case ES_SHA512_DIGEST:
+			return G_CHECKSUM_SHA512;
+
+		default:
+			return -1;
+	}
+}
+
+/**
+ * Checks whether the GLib backend implements the specified digest type.
+ *
+ * @param digest_type The digest algorithm code.
+ * @return ES_SUCCESS if the digest type is supported, ES_FAILURE otherwise.
+ */
+static const int es_glib_digest_supports(const int digest_type)
+{
+	return es_get_glib_checksum_type(digest_type) < 0
+		? ES_FAILURE
+		: ES_SUCCESS;
+}
+
+/**
+ * Creates a GLib backend context for the specified digest type.
+ *
+ * @param digest_type The digest algorithm code.
+ * @return The address of a new backend context if the operation was
+ * successfull, NULL otherwise.
+ */
+static void* es_glib_digest_create(const int digest_type)
+{
+	int checksum_type = es_get_glib_checksum_type(digest_type);
+
+	if(checksum_type < 0)
+		return NULL;
+
+	return g_checksum_new(checksum_type);
+}
+
+/**
+ * Destroys a GLib backend context.
+ *
+ * @param context The backend context to be destroyed.
+ */
+static void es_glib_digest_destroy(void *context)
+{
+	g_checksum_free((GChecksum*)context);
+}
+
+/**
+ * Resets a GLib backend context to its initial state.
+ *
+ * @param context The backend context to be reset.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+static const int es_glib_digest_reset(void *context)
+{
+	g_checksum_reset((GChecksum*)context);
+
+	return ES_SUCCESS;
+}
+
+/**
+ * Updates a GLib backend context using the specified data.
+ *
+ * @param context The backend context to be updated.
+ * @param data The data used to update the context.
+ * @param length The number of bytes of data.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+static const int es_glib_digest_update(
+	void *context,
+	const char *data,
+	const int length)
+{
+	g_checksum_update(
+		(GChecksum*)context,
+		(const unsigned char*)data,
+		length);
+
+	return ES_SUCCESS;
+}
+
+/**
+ * Finalizes a GLib backend context and writes the raw digest bytes.
+ *
+ * @param context The backend context to be finalized.
+ * @param out The buffer where to write the digest.
+ * @param length Output parameter representing the number of digest bytes.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+static const int es_glib_digest_finish(
+	void *context,
+	unsigned char *out,
+	int *length)
+{
+	gsize digest_length = ES_MAXIMUM_DIGEST_SIZE;
+
+	g_checksum_get_digest((GChecksum*)context, out, &digest_length);
+	*length = digest_length;
+
+	return ES_SUCCESS;
+}
+
+/** Represents the OpenSSL backend context. */
+struct es_evp_digest_context {
+	/** The EVP digest context. */
+	EVP_MD_CTX *context;
+
+	/** The EVP digest algorithm the context is initialized with. */
+	const EVP_MD *algorithm;
+};
+
+/**
+ * Maps the specified digest type to the matching EVP digest algorithm.
+ *
+ * @param digest_type The digest algorithm code.
+ * @return The matching EVP digest algorithm if the digest type is supported,
+ * NULL otherwise.
+ */
+static inline const EVP_MD* es_get_evp_digest_algorithm(const int digest_type)
+{
+	switch(digest_type) {
+		case ES_MD5_DIGEST:
+			return EVP_md5();
+
+		case ES_SHA1_DIGEST:
+			return EVP_sha1();
+
+		case ES_SHA256_DIGEST:
+			return EVP_sha256();
+
+		case ES_SHA512_DIGEST:
+		case ES_HKDF_SHA512_DIGEST:
+		case ES_TREE_SHA512_DIGEST:
+			return EVP_sha512();
+
+		case ES_BLAKE2B_DIGEST:
+			return EVP_blake2b512();
+
+		default:
+			return NULL;
+	}
+}
+
+/**
+ * Checks whether the OpenSSL backend implements the specified digest type.
+ *
+ * @param digest_type The digest algorithm code.
+ * @return ES_SUCCESS if the digest type is supported, ES_FAILURE otherwise.
+ */
+static const int es_evp_digest_supports(const int digest_type)
+{
+	return es_get_evp_digest_algorithm(digest_type)
+		? ES_SUCCESS
+		: ES_FAILURE;
+}
+
+/**
+ * Destroys an OpenSSL backend context.
+ *
+ * @param context The backend context to be destroyed.
+ */
+static void es_evp_digest_destroy(void *context)
+{
+	struct es_evp_digest_context *evp = (struct es_evp_digest_context*)context;
+
+	if(!evp)
+		return;
+
+	if(evp->context)
+		EVP_MD_CTX_free(evp->context);
+
+	free(evp);
+}
+
+/**
+ * Resets an OpenSSL backend context to its initial state.
+ *
+ * @param context The backend context to be reset.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+static const int es_evp_digest_reset(void *context)
+{
+	struct es_evp_digest_context *evp = (struct es_evp_digest_context*)context;
+
+	if(EVP_DigestInit_ex(evp->context, evp->algorithm, NULL) != 1)
+		return ES_FAILURE;
+
+	return ES_SUCCESS;
+}
+
+/**
+ * Creates an OpenSSL backend context for the specified digest type.
+ *
+ * @param digest_type The digest algorithm code.
+ * @return The address of a new backend context if the operation was
+ * successfull, NULL otherwise.
+ */
+static void* es_evp_digest_create(const int digest_type)
+{
+	int status = ES_FAILURE;
+	struct es_evp_digest_context *evp = NULL;
+
+	/* Allocate memory for the backend context. */
+	evp = (struct es_evp_digest_context*)calloc(
+		1,
+		sizeof(struct es_evp_digest_context));
+	if(!evp)
+		goto exit;
+
+	/* Resolve the EVP digest algorithm and create the EVP context. */
+	evp->algorithm = es_get_evp_digest_algorithm(digest_type);
+	if(!evp->algorithm)
+		goto exit;
+
+	evp->context = EVP_MD_CTX_new();
+	if(!evp->context)
+		goto exit;
+
+	if(es_evp_digest_reset(evp) != ES_SUCCESS)
+		goto exit;
+
+	/* Update the operation status. */
+	status = ES_SUCCESS;
+
+exit:
+	/* If the operation failed, destroy the partially created context. */
+	if(status == ES_FAILURE && evp) {
+		es_evp_digest_destroy(evp);
+		evp = NULL;
+	}
+
+	return evp;
+}
+
+/**
+ * Updates an OpenSSL backend context using the specified data.
+ *
+ * @param context The backend context to be updated.
+ * @param data The data used to update the context.
+ * @param length The number of bytes of data.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+static const int es_evp_digest_update(
+	void *context,
+	const char *data,
+	const int length)
+{
+	struct es_evp_digest_context *evp = (struct es_evp_digest_context*)context;
+
+	if(EVP_DigestUpdate(evp->context, data, length) != 1)
+		return ES_FAILURE;
+
+	return ES_SUCCESS;
+}
+
+/**
+ * Finalizes an OpenSSL backend context and writes the raw digest bytes.
+ *
+ * @param context The backend context to be finalized.
+ * @param out The buffer where to write the digest.
+ * @param length Output parameter representing the number of digest bytes.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+static const int es_evp_digest_finish(
+	void *context,
+	unsigned char *out,
+	int *length)
+{
+	unsigned int digest_length = 0;
+	struct es_evp_digest_context *evp = (struct es_evp_digest_context*)context;
+
+	if(EVP_DigestFinal_ex(evp->context, out, &digest_length) != 1)
+		return ES_FAILURE;
+
+	*length = digest_length;
+
+	return ES_SUCCESS;
+}
+
+/** The table of the supported digest backends, indexed by backend code. */
+static const struct es_digest_backend es_digest_backends[] = {
+	[ES_GLIB_DIGEST_BACKEND] = {
+		.name = "glib",
+		.supports = es_glib_digest_supports,
+		.create = es_glib_digest_create,
+		.destroy = es_glib_digest_destroy,
+		.reset = es_glib_digest_reset,
+		.update = es_glib_digest_update,
+		.finish = es_glib_digest_finish
+	},
+	[ES_OPENSSL_DIGEST_BACKEND] = {
+		.name = "openssl",
+		.supports = es_evp_digest_supports,
+		.create = es_evp_digest_create,
+		.destroy = es_evp_digest_destroy,
+		.reset = es_evp_digest_reset,
+		.update = es_evp_digest_update,
+		.finish = es_evp_digest_finish
+	}
+};
+
+/**
+ * Gets the digest backend associated with the specified backend code.
+ *
+ * @param digest_backend The digest backend code.
+ * @return The address of the digest backend if the backend code is valid,
+ * NULL otherwise.
+ */
+const struct es_digest_backend* es_get_digest_backend(
+	const int digest_backend)
+{
+	/* Perform sanity checks. */
+	if(es_validate_digest_backend(digest_backend) != ES_SUCCESS)
+		return NULL;
+
+	return &es_digest_backends[digest_backend];
+}
+
+/**
+ * Validates the specified digest backend code.
+ *
+ * @param digest_backend The digest backend code.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+inline const int es_validate_digest_backend(const int digest_backend)
+{
+	switch(digest_backend) {
+		case ES_GLIB_DIGEST_BACKEND:
+		case ES_OPENSSL_DIGEST_BACKEND:
+			/* Digest backend is valid. */
+			return ES_SUCCESS;
+
+		default:
+			/* Digest backend is invalid. */
+			return ES_FAILURE;
+	}
+}
@@ -0,0 +1,176 @@
+/**
+ * Copyright (c) 2016, Codrin-Victor Poienaru <cvpoienaru@gmail.com>.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * This software is provided by the copyright holders and contributors "as is"
+ * and any express or implied warranties, including, but not limited to, the
+ * implied warranties of merchantability and fitness for a particular purpose
+ * are disclaimed. In no event shall the copyright holder or contributors be
+ * liable for any direct, indirect, incidental, special, exemplary, or
+ * consequential damages (including, but not limited to, procurement of
+ * substitute goods or services; loss of use, data, or profits; or business
+ * interruption) however caused and on any theory of liability, whether in
+ * contract, strict liability, or tort (including negligence or otherwise)
+ * arising in any way out of the use of this software, even if advised of the
+ * possibility of such damage.
+ */
+
+#include <crypto/hkdf.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+
+#include <global/defs.h>
+#include <global/math_defs.h>
+#include <global/memory.h>
+
+/**
+ * Extracts a pseudorandom key from the given input keying material, as
+ * HMAC-SHA-512(salt, input) (RFC 5869).
+ *
+ * @param salt The salt, used as the HMAC key. May be empty.
+ * @param salt_length The number of bytes of salt.
+ * @param input The input keying material (e.g. raw device data).
+ * @param input_length The number of bytes of input keying material.
+ * @param prk The buffer where to write the pseudorandom key, of
+ * ES_HKDF_PRK_SIZE bytes.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_hkdf_extract(
+	const char *salt,
+	const int salt_length,
+	const char *input,
+	const int input_length,
+	unsigned char *prk)
+{
+	unsigned int prk_length = ES_HKDF_PRK_SIZE;
+	static const char empty_salt[ES_HKDF_PRK_SIZE];
+
+	/* Perform sanity checks. */
+	if(salt_length < 0 || (salt_length > 0 && !salt))
+		return ES_FAILURE;
+
+	if(!input || input_length < 0)
+		return ES_FAILURE;
+
+	if(!prk)
+		return ES_FAILURE;
+
+	/* An empty salt is replaced by a string of zeros of the hash length. */
+	if(salt_length == 0)
+		salt = empty_salt;
+
+	/* Compute the pseudorandom key. */
+	if(!HMAC(
+			EVP_sha512(),
+			salt,
+			salt_length ? salt_length : ES_HKDF_PRK_SIZE,
+			(const unsigned char*)input,
+			input_length,
+			prk,
+			&prk_length))
+		return ES_FAILURE;
+
+	return ES_SUCCESS;
+}
+
+/**
+ * Expands a pseudorandom key into the requested number of output bytes, using
+ * HMAC-SHA-512 (RFC 5869).
+ *
+ * @param prk The pseudorandom key, of ES_HKDF_PRK_SIZE bytes.
+ * @param info The context information binding the output to its use.
+ * @param info_length The number of bytes of context information, at most
+ * ES_HKDF_MAXIMUM_INFO_SIZE.
+ * @param output The buffer where to write the output bytes.
+ * @param output_length The number of output bytes, at most
+ * ES_HKDF_MAXIMUM_OUTPUT_SIZE.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_hkdf_expand(
+	const unsigned char *prk,
+	const char *info,
+	const int info_length,
+	char *output,
+	const int output_length)
+{
+	int ret = ES_FAILURE;
+	int offset = 0;
+	int message_length = 0;
+	int previous_length = 0;
+	unsigned int block_length = 0;
+	unsigned char counter = 0;
+	unsigned char block[ES_HKDF_PRK_SIZE];
+	unsigned char message[
+		ES_HKDF_PRK_SIZE + ES_HKDF_MAXIMUM_INFO_SIZE + 1];
+
+	/* Perform sanity checks. */
+	if(!prk)
+		return ES_FAILURE;
+
+	if(info_length < 0 || info_length > ES_HKDF_MAXIMUM_INFO_SIZE)
+		return ES_FAILURE;
+
+	if(info_length > 0 && !info)
+		return ES_FAILURE;
+
+	if(!output)
+		return ES_FAILURE;
+
+	if(output_length < 0 || output_length > ES_HKDF_MAXIMUM_OUTPUT_SIZE)
+		return ES_FAILURE;
+
+	/* T(i) = HMAC(PRK, T(i - 1) | info | i), with T(0) empty. */
+	while(offset < output_length) {
+		++counter;
+
+		message_length = 0;
+		memcpy(message, block, previous_length);
+		message_length += previous_length;
+		if(info_length > 0)
+			memcpy(message + message_length, info, info_length);
+		message_length += info_length;
+		message[message_length++] = counter;
+
+		if(!HMAC(
+				EVP_sha512(),
+				prk,
+				ES_HKDF_PRK_SIZE,
+				message,
+				message_length,
+				block,
+				&block_length))
+			goto exit;
+
+		/* Append as much of the block as still needed to the output. */
+		memcpy(
+			output + offset,
+			block,
+			es_min(block_length, output_length - offset));
+		offset += block_length;
+		previous_length = block_length;
+	}
+
+	/* Update the operation status. */
+	ret = ES_SUCCESS;
+
+exit:
+	/* Wipe the intermediate blocks. */
+	es_wipe_memory(block, ES_HKDF_PRK_SIZE);
+	es_wipe_memory(message, sizeof(message));
+
+	return ret;
+}
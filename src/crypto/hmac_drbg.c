@@ -0,0 +1,444 @@
+/**
+ * Copyright (c) 2016, Codrin-Victor Poienaru <cvpoienaru@gmail.com>.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * This software is provided by the copyright holders and contributors "as is"
+ * and any express or implied warranties, including, but not limited to, the
+ * implied warranties of merchantability and fitness for a particular purpose
+ * are disclaimed. In no event shall the copyright holder or contributors be
+ * liable for any direct, indirect, incidental, special, exemplary, or
+ * consequential damages (including, but not limited to, procurement of
+ * substitute goods or services; loss of use, data, or profits; or business
+ * interruption) however caused and on any theory of liability, whether in
+ * contract, strict liability, or tort (including negligence or otherwise)
+ * arising in any way out of the use of this software, even if advised of the
+ * possibility of such damage.
+ */
+
+#include <crypto/hmac_drbg.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <openssl/evp.h>
+#include <openssl/core_names.h>
+#include <openssl/params.h>
+
+#include <global/defs.h>
+#include <global/math_defs.h>
+#include <global/memory.h>
+
+/**
+ * Computes HMAC-SHA-512 over the concatenation of the given parts.
+ *
+ * @param drbg The HMAC_DRBG whose context is used for the computation.
+ * @param key The HMAC key, or NULL to reuse the key of the previous
+ * computation.
+ * @param parts The parts to be authenticated.
+ * @param lengths The number of bytes of each part.
+ * @param count The number of parts.
+ * @param output The buffer where to write the HMAC, of
+ * ES_HMAC_DRBG_OUTPUT_SIZE bytes.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+static const int es_compute_hmac_drbg_mac(
+	struct es_hmac_drbg *drbg,
+	const unsigned char *key,
+	const unsigned char **parts,
+	const int *lengths,
+	const int count,
+	unsigned char *output)
+{
+	int i;
+	size_t output_length = 0;
+
+	if(!EVP_MAC_init(
+			drbg->context,
+			key,
+			key ? ES_HMAC_DRBG_OUTPUT_SIZE : 0,
+			NULL))
+		return ES_FAILURE;
+
+	for(i = 0; i < count; ++i) {
+		if(lengths[i] == 0)
+			continue;
+
+		if(!EVP_MAC_update(drbg->context, parts[i], lengths[i]))
+			return ES_FAILURE;
+	}
+
+	if(!EVP_MAC_final(
+			drbg->context,
+			output,
+			&output_length,
+			ES_HMAC_DRBG_OUTPUT_SIZE))
+		return ES_FAILURE;
+
+	return ES_SUCCESS;
+}
+
+/**
+ * Applies the HMAC_DRBG update function to the given provided data.
+ *
+ * @param drbg The HMAC_DRBG to be updated.
+ * @param data The provided data, or NULL if there is none.
+ * @param data_length The number of bytes of provided data.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+static const int es_update_hmac_drbg(
+	struct es_hmac_drbg *drbg,
+	const char *data,
+	const int data_length)
+{
+	unsigned char separator;
+	const unsigned char *parts[3];
+	int lengths[3];
+
+	parts[0] = drbg->value;
+	lengths[0] = ES_HMAC_DRBG_OUTPUT_SIZE;
+	parts[1] = &separator;
+	lengths[1] = 1;
+	parts[2] = (const unsigned char*)data;
+	lengths[2] = data ? data_length : 0;
+
+	/* K = HMAC(K, V || 0x00 || data), V = HMAC(K, V). */
+	separator = 0x00;
+	if(es_compute_hmac_drbg_mac(
+			drbg, drbg->key, parts, lengths, 3, drbg->key) != ES_SUCCESS)
+		return ES_FAILURE;
+
+	if(es_compute_hmac_drbg_mac(
+			drbg, drbg->key, parts, lengths, 1, drbg->value) != ES_SUCCESS)
+		return ES_FAILURE;
+
+	if(lengths[2] == 0)
+		return ES_SUCCESS;
+
+	/* K = HMAC(K, V || 0x01 || data), V = HMAC(K, V). */
+	separator = 0x01;
+	if(es_compute_hmac_drbg_mac(
+			drbg, drbg->key, parts, lengths, 3, drbg->key) != ES_SUCCESS)
+		return ES_FAILURE;
+
+	if(es_compute_hmac_drbg_mac(
+			drbg, drbg->key, parts, lengths, 1, drbg->value) != ES_SUCCESS)
+		return ES_FAILURE;
+
+	return ES_SUCCESS;
+}
+
+/**
+ * Allocates memory for an HMAC_DRBG.
+ *
+ * @return The address of a newly allocated HMAC_DRBG if the operation was
+ * successfull, NULL otherwise.
+ */
+struct es_hmac_drbg* es_alloc_hmac_drbg(void)
+{
+	int status = ES_FAILURE;
+	struct es_hmac_drbg *drbg = NULL;
+
+	/* Allocate memory for the DRBG. */
+	drbg = (struct es_hmac_drbg*)malloc(sizeof(struct es_hmac_drbg));
+	if(!drbg)
+		goto exit;
+	memset(drbg, 0, sizeof(struct es_hmac_drbg));
+
+	/* Fetch the HMAC algorithm and allocate its context. */
+	drbg->mac = EVP_MAC_fetch(NULL, "HMAC", NULL);
+	if(!drbg->mac)
+		goto exit;
+
+	drbg->context = EVP_MAC_CTX_new(drbg->mac);
+	if(!drbg->context)
+		goto exit;
+
+	/* Update the operation status. */
+	status = ES_SUCCESS;
+
+exit:
+	/* If the operation failed, free the partially allocated DRBG. */
+	if(status == ES_FAILURE && drbg)
+		es_free_hmac_drbg(&drbg);
+
+	return drbg;
+}
+
+/**
+ * Frees the memory used by an HMAC_DRBG. The DRBG state is wiped.
+ *
+ * @param drbg The HMAC_DRBG to be freed.
+ */
+void es_free_hmac_drbg(struct es_hmac_drbg **drbg)
+{
+	/* Perform sanity checks. */
+	if(!drbg || !(*drbg))
+		return;
+
+	/* Free the HMAC context and algorithm. */
+	if((*drbg)->context)
+		EVP_MAC_CTX_free((*drbg)->context);
+
+	if((*drbg)->mac)
+		EVP_MAC_free((*drbg)->mac);
+
+	/* Wipe the DRBG state before releasing it. */
+	es_wipe_memory(*drbg, sizeof(struct es_hmac_drbg));
+
+	/* Free the DRBG. */
+	free(*drbg);
+	*drbg = NULL;
+}
+
+/**
+ * Initializes an HMAC_DRBG with the default values. The DRBG must still be
+ * instantiated before use.
+ *
+ * @param drbg The HMAC_DRBG to be initialized.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_init_hmac_drbg(struct es_hmac_drbg *drbg)
+{
+	OSSL_PARAM params[2];
+
+	/* Perform sanity checks. */
+	if(!drbg || !drbg->context)
+		return ES_FAILURE;
+
+	/* Bind the HMAC context to SHA-512. */
+	params[0] = OSSL_PARAM_construct_utf8_string(
+		OSSL_MAC_PARAM_DIGEST,
+		"SHA512",
+		0);
+	params[1] = OSSL_PARAM_construct_end();
+	if(!EVP_MAC_CTX_set_params(drbg->context, params))
+		return ES_FAILURE;
+
+	/* Initialize the DRBG state. */
+	memset(drbg->key, 0x00, ES_HMAC_DRBG_OUTPUT_SIZE);
+	memset(drbg->value, 0x01, ES_HMAC_DRBG_OUTPUT_SIZE);
+	drbg->reseed_counter = 0;
+	drbg->instantiated = FALSE;
+
+	return ES_SUCCESS;
+}
+
+/**
+ * Creates an HMAC_DRBG.
+ *
+ * @return The address of a newly allocated HMAC_DRBG if the operation was
+ * successfull, NULL otherwise.
+ */
+struct es_hmac_drbg* es_create_hmac_drbg(void)
+{
+	int status = ES_FAILURE;
+	struct es_hmac_drbg *drbg = NULL;
+
+	/* Allocate memory for the DRBG. */
+	drbg = es_alloc_hmac_drbg();
+	if(!drbg)
+		goto exit;
+
+	/* Initialize the DRBG. */
+	if(es_init_hmac_drbg(drbg) != ES_SUCCESS)
+		goto exit;
+
+	/* Update the operation status. */
+	status = ES_SUCCESS;
+
+exit:
+	/* If the operation failed, destroy the partially created DRBG. */
+	if(status == ES_FAILURE && drbg)
+		es_destroy_hmac_drbg(&drbg);
+
+	return drbg;
+}
+
+/**
+ * Destroys an HMAC_DRBG.
+ *
+ * @param drbg The HMAC_DRBG to be destroyed.
+ */
+void es_destroy_hmac_drbg(struct es_hmac_drbg **drbg)
+{
+	es_free_hmac_drbg(drbg);
+}
+
+/**
+ * Validates an HMAC_DRBG.
+ *
+ * @param drbg The HMAC_DRBG to be validated.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_validate_hmac_drbg(struct es_hmac_drbg *drbg)
+{
+	/* Perform sanity checks. */
+	if(!drbg)
+		return ES_FAILURE;
+
+	if(!drbg->mac || !drbg->context)
+		return ES_FAILURE;
+
+	return ES_SUCCESS;
+}
+
+/**
+ * Instantiates an HMAC_DRBG from the specified seed material (entropy input,
+ * nonce and personalization string, concatenated).
+ *
+ * @param drbg The HMAC_DRBG to be instantiated.
+ * @param seed The seed material.
+ * @param seed_length The number of bytes of seed material, at least
+ * ES_HMAC_DRBG_MINIMUM_ENTROPY_SIZE.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_instantiate_hmac_drbg(
+	struct es_hmac_drbg *drbg,
+	const char *seed,
+	const int seed_length)
+{
+	/* Perform sanity checks. */
+	if(es_validate_hmac_drbg(drbg) != ES_SUCCESS)
+		return ES_FAILURE;
+
+	if(!seed || seed_length < ES_HMAC_DRBG_MINIMUM_ENTROPY_SIZE)
+		return ES_FAILURE;
+
+	/* Start from the initial key and value. */
+	memset(drbg->key, 0x00, ES_HMAC_DRBG_OUTPUT_SIZE);
+	memset(drbg->value, 0x01, ES_HMAC_DRBG_OUTPUT_SIZE);
+	drbg->instantiated = FALSE;
+
+	if(es_update_hmac_drbg(drbg, seed, seed_length) != ES_SUCCESS)
+		return ES_FAILURE;
+
+	/* Update the DRBG status. */
+	drbg->reseed_counter = 1;
+	drbg->instantiated = TRUE;
+
+	return ES_SUCCESS;
+}
+
+/**
+ * Reseeds an HMAC_DRBG with fresh entropy input.
+ *
+ * @param drbg The HMAC_DRBG to be reseeded.
+ * @param entropy The fresh entropy input.
+ * @param entropy_length The number of bytes of entropy input, at least
+ * ES_HMAC_DRBG_MINIMUM_ENTROPY_SIZE.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_reseed_hmac_drbg(
+	struct es_hmac_drbg *drbg,
+	const char *entropy,
+	const int entropy_length)
+{
+	/* Perform sanity checks. */
+	if(es_validate_hmac_drbg(drbg) != ES_SUCCESS)
+		return ES_FAILURE;
+
+	if(!drbg->instantiated)
+		return ES_FAILURE;
+
+	if(!entropy || entropy_length < ES_HMAC_DRBG_MINIMUM_ENTROPY_SIZE)
+		return ES_FAILURE;
+
+	if(es_update_hmac_drbg(drbg, entropy, entropy_length) != ES_SUCCESS)
+		return ES_FAILURE;
+
+	/* Update the DRBG status. */
+	drbg->reseed_counter = 1;
+
+	return ES_SUCCESS;
+}
+
+/**
+ * Generates pseudorandom bytes from an HMAC_DRBG. Requests larger than
+ * ES_HMAC_DRBG_MAXIMUM_REQUEST_SIZE are split into several generate requests.
+ *
+ * @param drbg The HMAC_DRBG used to generate the bytes.
+ * @param output The buffer where to write the generated bytes.
+ * @param output_length The number of bytes to be generated.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise
+ * (including the case when the DRBG must be reseeded first).
+ */
+const int es_generate_hmac_drbg(
+	struct es_hmac_drbg *drbg,
+	char *output,
+	const int output_length)
+{
+	int offset = 0;
+	int request_end = 0;
+	const unsigned char *parts[1];
+	int lengths[1];
+
+	/* Perform sanity checks. */
+	if(es_validate_hmac_drbg(drbg) != ES_SUCCESS)
+		return ES_FAILURE;
+
+	if(!drbg->instantiated)
+		return ES_FAILURE;
+
+	if(!output || output_length < 0)
+		return ES_FAILURE;
+
+	parts[0] = drbg->value;
+	lengths[0] = ES_HMAC_DRBG_OUTPUT_SIZE;
+
+	while(offset < output_length) {
+		/* A reseed is required once the reseed interval is exhausted. */
+		if(drbg->reseed_counter > ES_HMAC_DRBG_RESEED_INTERVAL)
+			return ES_FAILURE;
+
+		request_end = offset + es_min(
+			ES_HMAC_DRBG_MAXIMUM_REQUEST_SIZE,
+			output_length - offset);
+
+		/* Load the key once, then chain V = HMAC(K, V). */
+		if(es_compute_hmac_drbg_mac(
+				drbg,
+				drbg->key,
+				parts,
+				lengths,
+				1,
+				drbg->value) != ES_SUCCESS)
+			return ES_FAILURE;
+
+		while(1) {
+			memcpy(
+				output + offset,
+				drbg->value,
+				es_min(ES_HMAC_DRBG_OUTPUT_SIZE, request_end - offset));
+			offset += es_min(ES_HMAC_DRBG_OUTPUT_SIZE, request_end - offset);
+			if(offset >= request_end)
+				break;
+
+			if(es_compute_hmac_drbg_mac(
+					drbg,
+					NULL,
+					parts,
+					lengths,
+					1,
+					drbg->value) != ES_SUCCESS)
+				return ES_FAILURE;
+		}
+
+		/* Backtracking resistance: refresh the key and value. */
+		if(es_update_hmac_drbg(drbg, NULL, 0) != ES_SUCCESS)
+			return ES_FAILURE;
+
+		++drbg->reseed_counter;
+	}
+
+	return ES_SUCCESS;
+}
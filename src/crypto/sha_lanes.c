@@ -0,0 +1,565 @@
+/**
+ * Copyright (c) 2016, Codrin-Victor Poienaru <cvpoienaru@gmail.com>.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * This software is provided by the copyright holders and contributors "as is"
+ * and any express or implied warranties, including, but not limited to, the
+ * implied warranties of merchantability and fitness for a particular purpose
+ * are disclaimed. In no event shall the copyright holder or contributors be
+ * liable for any direct, indirect, incidental, special, exemplary, or
+ * consequential damages (including, but not limited to, procurement of
+ * substitute goods or services; loss of use, data, or profits; or business
+ * interruption) however caused and on any theory of liability, whether in
+ * contract, strict liability, or tort (including negligence or otherwise)
+ * arising in any way out of the use of this software, even if advised of the
+ * possibility of such damage.
+ */
+
+
+#include <crypto/sha_lanes.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+#include <global/defs.h>
+#include <global/memory.h>
+#include <crypto/digest.h>
+#include <crypto/cpu_dispatch.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+/** The SHA-256 round constants. */
+static const uint32_t es_sha256_constants[64] = {
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
+	0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+	0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+	0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+	0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
+	0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+	0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+	0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+	0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+	0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+	0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+	0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+	0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
+	0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+	0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+	0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+/** The SHA-256 initial hash value. */
+static const uint32_t es_sha256_initial_state[8] = {
+	0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+	0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+};
+
+/** The SHA-512 round constants. */
+static const uint64_t es_sha512_constants[80] = {
+	0x428a2f98d728ae22ULL, 0x7137449123ef65cdULL,
+	0xb5c0fbcfec4d3b2fULL, 0xe9b5dba58189dbbcULL,
+	0x3956c25bf348b538ULL, 0x59f111f1b605d019ULL,
+	0x923f82a4af194f9bULL, 0xab1c5ed5da6d8118ULL,
+	0xd807aa98a3030242ULL, 0x12835b0145706fbeULL,
+	0x243185be4ee4b28cULL, 0x550c7dc3d5ffb4e2ULL,
+	0x72be5d74f27b896fULL, 0x80deb1fe3b1696b1ULL,
+	0x9bdc06a725c71235ULL, 0xc19bf174cf692694ULL,
+	0xe49b69c19ef14ad2ULL, 0xefbe4786384f25e3ULL,
+	0x0fc19dc68b8cd5b5ULL, 0x240ca1cc77ac9c65ULL,
+	0x2de92c6f592b0275ULL, 0x4a7484aa6ea6e483ULL,
+	0x5cb0a9dcbd41fbd4ULL, 0x76f988da831153b5ULL,
+	0x983e5152ee66dfabULL, 0xa831c66d2db43210ULL,
+	0xb00327c898fb213fULL, 0xbf597fc7beef0ee4ULL,
+	0xc6e00bf33da88fc2ULL, 0xd5a79147930aa725ULL,
+	0x06ca6351e003826fULL, 0x142929670a0e6e70ULL,
+	0x27b70a8546d22ffcULL, 0x2e1b21385c26c926ULL,
+	0x4d2c6dfc5ac42aedULL, 0x53380d139d95b3dfULL,
+	0x650a73548baf63deULL, 0x766a0abb3c77b2a8ULL,
+	0x81c2c92e47edaee6ULL, 0x92722c851482353bULL,
+	0xa2bfe8a14cf10364ULL, 0xa81a664bbc423001ULL,
+	0xc24b8b70d0f89791ULL, 0xc76c51a30654be30ULL,
+	0xd192e819d6ef5218ULL, 0xd69906245565a910ULL,
+	0xf40e35855771202aULL, 0x106aa07032bbd1b8ULL,
+	0x19a4c116b8d2d0c8ULL, 0x1e376c085141ab53ULL,
+	0x2748774cdf8eeb99ULL, 0x34b0bcb5e19b48a8ULL,
+	0x391c0cb3c5c95a63ULL, 0x4ed8aa4ae3418acbULL,
+	0x5b9cca4f7763e373ULL, 0x682e6ff3d6b2b8a3ULL,
+	0x748f82ee5defb2fcULL, 0x78a5636f43172f60ULL,
+	0x84c87814a1f0ab72ULL, 0x8cc702081a6439ecULL,
+	0x90befffa23631e28ULL, 0xa4506cebde82bde9ULL,
+	0xbef9a3f7b2c67915ULL, 0xc67178f2e372532bULL,
+	0xca273eceea26619cULL, 0xd186b8c721c0c207ULL,
+	0xeada7dd6cde0eb1eULL, 0xf57d4f7fee6ed178ULL,
+	0x06f067aa72176fbaULL, 0x0a637dc5a2c898a6ULL,
+	0x113f9804bef90daeULL, 0x1b710b35131c471bULL,
+	0x28db77f523047d84ULL, 0x32caab7b40c72493ULL,
+	0x3c9ebe0a15c9bebcULL, 0x431d67c49c100d4cULL,
+	0x4cc5d4becb3e42b6ULL, 0x597f299cfc657e2aULL,
+	0x5fcb6fab3ad6faecULL, 0x6c44198c4a475817ULL
+};
+
+/** The SHA-512 initial hash value. */
+static const uint64_t es_sha512_initial_state[8] = {
+	0x6a09e667f3bcc908ULL, 0xbb67ae8584caa73bULL,
+	0x3c6ef372fe94f82bULL, 0xa54ff53a5f1d36f1ULL,
+	0x510e527fade682d1ULL, 0x9b05688c2b3e6c1fULL,
+	0x1f83d9abfb41bd6bULL, 0x5be0cd19137e2179ULL
+};
+
+/** Loads a big endian 32-bit word. */
+static inline uint32_t es_load_big_endian_32(const unsigned char *data)
+{
+	uint32_t word;
+
+	memcpy(&word, data, sizeof(uint32_t));
+
+	return __builtin_bswap32(word);
+}
+
+/** Loads a big endian 64-bit word. */
+static inline uint64_t es_load_big_endian_64(const unsigned char *data)
+{
+	uint64_t word;
+
+	memcpy(&word, data, sizeof(uint64_t));
+
+	return __builtin_bswap64(word);
+}
+
+/** Stores a big endian 32-bit word. */
+static inline void es_store_big_endian_32(unsigned char *data, uint32_t word)
+{
+	word = __builtin_bswap32(word);
+	memcpy(data, &word, sizeof(uint32_t));
+}
+
+/** Stores a big endian 64-bit word. */
+static inline void es_store_big_endian_64(unsigned char *data, uint64_t word)
+{
+	word = __builtin_bswap64(word);
+	memcpy(data, &word, sizeof(uint64_t));
+}
+
+/**
+ * Defines a multi-lane SHA-2 kernel over the given vector operations. The
+ * message schedule and the rounds run on every lane at once, so a kernel with N
+ * lanes digests N messages for roughly the cost of one. The final padded
+ * blocks of every lane are built on the stack and wiped once digested.
+ *
+ * @param NAME The kernel function name.
+ * @param TARGET The instruction set the kernel is compiled for.
+ * @param LANES The number of lanes.
+ * @param VECTOR The vector type holding one word of every lane.
+ * @param WORD The message word type.
+ * @param BLOCK_SIZE The message block size in bytes.
+ * @param ROUNDS The number of rounds.
+ * @param DIGEST_SIZE The size in bytes of the digest.
+ * @param CONSTANTS The round constants.
+ * @param INITIAL_STATE The initial hash value.
+ * @param LOAD_WORD The big endian word load.
+ * @param STORE_WORD The big endian word store.
+ * @param SIGMA_0 The small sigma 0 function of the message schedule.
+ * @param SIGMA_1 The small sigma 1 function of the message schedule.
+ * @param SUM_0 The big sigma 0 function of the rounds.
+ * @param SUM_1 The big sigma 1 function of the rounds.
+ * @param ADD The lane-wise word addition.
+ * @param XOR The lane-wise XOR.
+ * @param AND The lane-wise AND.
+ * @param OR The lane-wise OR.
+ * @param ANDNOT The lane-wise AND of the complemented first operand.
+ * @param BROADCAST The word broadcast to every lane.
+ * @param LOAD The unaligned vector load.
+ * @param STORE The unaligned vector store.
+ */
+#define ES_DEFINE_SHA_LANES(NAME, TARGET, LANES, VECTOR, WORD, BLOCK_SIZE, \
+		ROUNDS, DIGEST_SIZE, CONSTANTS, INITIAL_STATE, LOAD_WORD, \
+		STORE_WORD, SIGMA_0, SIGMA_1, SUM_0, SUM_1, ADD, XOR, AND, OR, \
+		ANDNOT, BROADCAST, LOAD, STORE) \
+__attribute__((target(TARGET))) \
+static void NAME( \
+	const unsigned char * const *data, \
+	const int length, \
+	unsigned char * const *digests) \
+{ \
+	int i; \
+	int j; \
+	int t; \
+	int block; \
+	int block_count; \
+	int full_count = length / (BLOCK_SIZE); \
+	int tail_length = length % (BLOCK_SIZE); \
+	int tail_count = \
+		(tail_length + 1 + 2 * sizeof(WORD) > (BLOCK_SIZE)) ? 2 : 1; \
+	VECTOR state[8]; \
+	VECTOR work[8]; \
+	VECTOR schedule[16]; \
+	VECTOR sum_1; \
+	VECTOR sum_2; \
+	WORD words[LANES]; \
+	const unsigned char *blocks[LANES]; \
+	unsigned char tails[LANES][2 * (BLOCK_SIZE)]; \
+\
+	/* \
+	 * Build the final blocks of every lane: the message tail, the 0x80 \
+	 * end marker, the zero padding and the message length in bits. \
+	 */ \
+	for(i = 0; i < (LANES); ++i) { \
+		memset(tails[i], 0, 2 * (BLOCK_SIZE)); \
+		memcpy( \
+			tails[i], \
+			data[i] + full_count * (BLOCK_SIZE), \
+			tail_length); \
+		tails[i][tail_length] = 0x80; \
+		STORE_WORD( \
+			tails[i] + tail_count * (BLOCK_SIZE) - sizeof(WORD), \
+			(WORD)length << 3); \
+	} \
+\
+	for(j = 0; j < 8; ++j) \
+		state[j] = BROADCAST((INITIAL_STATE)[j]); \
+\
+	block_count = full_count + tail_count; \
+	for(block = 0; block < block_count; ++block) { \
+		for(i = 0; i < (LANES); ++i) \
+			blocks[i] = (block < full_count) \
+				? data[i] + block * (BLOCK_SIZE) \
+				: tails[i] \
+					+ (block - full_count) * (BLOCK_SIZE); \
+\
+		for(j = 0; j < 8; ++j) \
+			work[j] = state[j]; \
+\
+		for(t = 0; t < (ROUNDS); ++t) { \
+			/* Transpose the next message word of every lane. */ \
+			if(t < 16) { \
+				for(i = 0; i < (LANES); ++i) \
+					words[i] = LOAD_WORD( \
+						blocks[i] + t * sizeof(WORD)); \
+				schedule[t] = LOAD(words); \
+			} else { \
+				sum_1 = SIGMA_0(schedule[(t + 1) & 15]); \
+				sum_2 = SIGMA_1(schedule[(t + 14) & 15]); \
+				schedule[t & 15] = ADD( \
+					ADD(schedule[t & 15], sum_1), \
+					ADD(schedule[(t + 9) & 15], sum_2)); \
+			} \
+\
+			/* sum_1 = h + S1(e) + Ch(e, f, g) + K[t] + W[t] */ \
+			sum_1 = ADD( \
+				ADD(work[7], SUM_1(work[4])), \
+				ADD( \
+					XOR( \
+						AND(work[4], work[5]), \
+						ANDNOT(work[4], work[6])), \
+					ADD( \
+						BROADCAST((CONSTANTS)[t]), \
+						schedule[t & 15]))); \
+\
+			/* sum_2 = S0(a) + Maj(a, b, c) */ \
+			sum_2 = ADD( \
+				SUM_0(work[0]), \
+				OR( \
+					AND(work[0], work[1]), \
+					AND(work[2], OR(work[0], work[1])))); \
+\
+			work[7] = work[6]; \
+			work[6] = work[5]; \
+			work[5] = work[4]; \
+			work[4] = ADD(work[3], sum_1); \
+			work[3] = work[2]; \
+			work[2] = work[1]; \
+			work[1] = work[0]; \
+			work[0] = ADD(sum_1, sum_2); \
+		} \
+\
+		for(j = 0; j < 8; ++j) \
+			state[j] = ADD(state[j], work[j]); \
+	} \
+\
+	/* Untranspose the hash value of every lane into its digest. */ \
+	for(j = 0; j < (DIGEST_SIZE) / sizeof(WORD); ++j) { \
+		STORE(words, state[j]); \
+		for(i = 0; i < (LANES); ++i) \
+			STORE_WORD(digests[i] + j * sizeof(WORD), words[i]); \
+	} \
+\
+	/* Wipe every trace of the messages. */ \
+	es_wipe_memory(tails, sizeof(tails)); \
+	es_wipe_memory(words, sizeof(words)); \
+	es_wipe_memory(schedule, sizeof(schedule)); \
+	es_wipe_memory(work, sizeof(work)); \
+	es_wipe_memory(state, sizeof(state)); \
+}
+
+/** Rotates every 32-bit lane of an AVX2 vector right. */
+#define ES_ROR32_AVX2(X, N) _mm256_or_si256( \
+	_mm256_srli_epi32((X), (N)), \
+	_mm256_slli_epi32((X), 32 - (N)))
+
+/** Rotates every 64-bit lane of an AVX2 vector right. */
+#define ES_ROR64_AVX2(X, N) _mm256_or_si256( \
+	_mm256_srli_epi64((X), (N)), \
+	_mm256_slli_epi64((X), 64 - (N)))
+
+#define ES_SHA256_SIGMA_0_AVX2(X) _mm256_xor_si256( \
+	_mm256_xor_si256(ES_ROR32_AVX2((X), 7), ES_ROR32_AVX2((X), 18)), \
+	_mm256_srli_epi32((X), 3))
+#define ES_SHA256_SIGMA_1_AVX2(X) _mm256_xor_si256( \
+	_mm256_xor_si256(ES_ROR32_AVX2((X), 17), ES_ROR32_AVX2((X), 19)), \
+	_mm256_srli_epi32((X), 10))
+#define ES_SHA256_SUM_0_AVX2(X) _mm256_xor_si256( \
+	_mm256_xor_si256(ES_ROR32_AVX2((X), 2), ES_ROR32_AVX2((X), 13)), \
+	ES_ROR32_AVX2((X), 22))
+#define ES_SHA256_SUM_1_AVX2(X) _mm256_xor_si256( \
+	_mm256_xor_si256(ES_ROR32_AVX2((X), 6), ES_ROR32_AVX2((X), 11)), \
+	ES_ROR32_AVX2((X), 25))
+
+#define ES_SHA512_SIGMA_0_AVX2(X) _mm256_xor_si256( \
+	_mm256_xor_si256(ES_ROR64_AVX2((X), 1), ES_ROR64_AVX2((X), 8)), \
+	_mm256_srli_epi64((X), 7))
+#define ES_SHA512_SIGMA_1_AVX2(X) _mm256_xor_si256( \
+	_mm256_xor_si256(ES_ROR64_AVX2((X), 19), ES_ROR64_AVX2((X), 61)), \
+	_mm256_srli_epi64((X), 6))
+#define ES_SHA512_SUM_0_AVX2(X) _mm256_xor_si256( \
+	_mm256_xor_si256(ES_ROR64_AVX2((X), 28), ES_ROR64_AVX2((X), 34)), \
+	ES_ROR64_AVX2((X), 39))
+#define ES_SHA512_SUM_1_AVX2(X) _mm256_xor_si256( \
+	_mm256_xor_si256(ES_ROR64_AVX2((X), 14), ES_ROR64_AVX2((X), 18)), \
+	ES_ROR64_AVX2((X), 41))
+
+#define ES_SHA256_SIGMA_0_AVX512(X) _mm512_ternarylogic_epi32( \
+	_mm512_ror_epi32((X), 7), _mm512_ror_epi32((X), 18), \
+	_mm512_srli_epi32((X), 3), 0x96)
+#define ES_SHA256_SIGMA_1_AVX512(X) _mm512_ternarylogic_epi32( \
+	_mm512_ror_epi32((X), 17), _mm512_ror_epi32((X), 19), \
+	_mm512_srli_epi32((X), 10), 0x96)
+#define ES_SHA256_SUM_0_AVX512(X) _mm512_ternarylogic_epi32( \
+	_mm512_ror_epi32((X), 2), _mm512_ror_epi32((X), 13), \
+	_mm512_ror_epi32((X), 22), 0x96)
+#define ES_SHA256_SUM_1_AVX512(X) _mm512_ternarylogic_epi32( \
+	_mm512_ror_epi32((X), 6), _mm512_ror_epi32((X), 11), \
+	_mm512_ror_epi32((X), 25), 0x96)
+
+#define ES_SHA512_SIGMA_0_AVX512(X) _mm512_ternarylogic_epi64( \
+	_mm512_ror_epi64((X), 1), _mm512_ror_epi64((X), 8), \
+	_mm512_srli_epi64((X), 7), 0x96)
+#define ES_SHA512_SIGMA_1_AVX512(X) _mm512_ternarylogic_epi64( \
+	_mm512_ror_epi64((X), 19), _mm512_ror_epi64((X), 61), \
+	_mm512_srli_epi64((X), 6), 0x96)
+#define ES_SHA512_SUM_0_AVX512(X) _mm512_ternarylogic_epi64( \
+	_mm512_ror_epi64((X), 28), _mm512_ror_epi64((X), 34), \
+	_mm512_ror_epi64((X), 39), 0x96)
+#define ES_SHA512_SUM_1_AVX512(X) _mm512_ternarylogic_epi64( \
+	_mm512_ror_epi64((X), 14), _mm512_ror_epi64((X), 18), \
+	_mm512_ror_epi64((X), 41), 0x96)
+
+#define ES_LOAD_AVX2(X) _mm256_loadu_si256((const __m256i*)(X))
+#define ES_STORE_AVX2(X, V) _mm256_storeu_si256((__m256i*)(X), (V))
+#define ES_LOAD_AVX512(X) _mm512_loadu_si512((const void*)(X))
+#define ES_STORE_AVX512(X, V) _mm512_storeu_si512((void*)(X), (V))
+
+/** Digests eight SHA-256 messages at once, using AVX2. */
+ES_DEFINE_SHA_LANES(es_sha256_lanes_avx2, "avx2", 8, __m256i, uint32_t,
+	64, 64, 32, es_sha256_constants, es_sha256_initial_state,
+	es_load_big_endian_32, es_store_big_endian_32,
+	ES_SHA256_SIGMA_0_AVX2, ES_SHA256_SIGMA_1_AVX2,
+	ES_SHA256_SUM_0_AVX2, ES_SHA256_SUM_1_AVX2,
+	_mm256_add_epi32, _mm256_xor_si256, _mm256_and_si256, _mm256_or_si256,
+	_mm256_andnot_si256, _mm256_set1_epi32, ES_LOAD_AVX2, ES_STORE_AVX2)
+
+/** Digests sixteen SHA-256 messages at once, using AVX-512. */
+ES_DEFINE_SHA_LANES(es_sha256_lanes_avx512, "avx512f", 16, __m512i, uint32_t,
+	64, 64, 32, es_sha256_constants, es_sha256_initial_state,
+	es_load_big_endian_32, es_store_big_endian_32,
+	ES_SHA256_SIGMA_0_AVX512, ES_SHA256_SIGMA_1_AVX512,
+	ES_SHA256_SUM_0_AVX512, ES_SHA256_SUM_1_AVX512,
+	_mm512_add_epi32, _mm512_xor_si512, _mm512_and_si512, _mm512_or_si512,
+	_mm512_andnot_si512, _mm512_set1_epi32, ES_LOAD_AVX512, ES_STORE_AVX512)
+
+/** Digests four SHA-512 messages at once, using AVX2. */
+ES_DEFINE_SHA_LANES(es_sha512_lanes_avx2, "avx2", 4, __m256i, uint64_t,
+	128, 80, 64, es_sha512_constants, es_sha512_initial_state,
+	es_load_big_endian_64, es_store_big_endian_64,
+	ES_SHA512_SIGMA_0_AVX2, ES_SHA512_SIGMA_1_AVX2,
+	ES_SHA512_SUM_0_AVX2, ES_SHA512_SUM_1_AVX2,
+	_mm256_add_epi64, _mm256_xor_si256, _mm256_and_si256, _mm256_or_si256,
+	_mm256_andnot_si256, _mm256_set1_epi64x, ES_LOAD_AVX2, ES_STORE_AVX2)
+
+/** Digests eight SHA-512 messages at once, using AVX-512. */
+ES_DEFINE_SHA_LANES(es_sha512_lanes_avx512, "avx512f", 8, __m512i, uint64_t,
+	128, 80, 64, es_sha512_constants, es_sha512_initial_state,
+	es_load_big_endian_64, es_store_big_endian_64,
+	ES_SHA512_SIGMA_0_AVX512, ES_SHA512_SIGMA_1_AVX512,
+	ES_SHA512_SUM_0_AVX512, ES_SHA512_SUM_1_AVX512,
+	_mm512_add_epi64, _mm512_xor_si512, _mm512_and_si512, _mm512_or_si512,
+	_mm512_andnot_si512, _mm512_set1_epi64, ES_LOAD_AVX512, ES_STORE_AVX512)
+
+/** The SHA-256 kernel variants, indexed by the CPU dispatch level. */
+static void * const es_sha256_lanes_kernels[ES_CPU_LEVEL_COUNT] = {
+	NULL,
+	NULL,
+	es_sha256_lanes_avx2,
+	es_sha256_lanes_avx512
+};
+
+/** The SHA-512 kernel variants, indexed by the CPU dispatch level. */
+static void * const es_sha512_lanes_kernels[ES_CPU_LEVEL_COUNT] = {
+	NULL,
+	NULL,
+	es_sha512_lanes_avx2,
+	es_sha512_lanes_avx512
+};
+#else
+/** The SHA-256 kernel variants; none exists outside x86. */
+static void * const es_sha256_lanes_kernels[ES_CPU_LEVEL_COUNT] = {
+	NULL,
+	NULL,
+	NULL,
+	NULL
+};
+
+/** The SHA-512 kernel variants; none exists outside x86. */
+static void * const es_sha512_lanes_kernels[ES_CPU_LEVEL_COUNT] = {
+	NULL,
+	NULL,
+	NULL,
+	NULL
+};
+#endif
+
+/** The lane counts of the kernel variants, indexed by the dispatch level. */
+static const int es_sha256_lanes_counts[ES_CPU_LEVEL_COUNT] = {0, 0, 8, 16};
+static const int es_sha512_lanes_counts[ES_CPU_LEVEL_COUNT] = {0, 0, 4, 8};
+
+/** The SHA-256 kernel bound for the running CPU & its lane counts. */
+static es_sha_lanes_kernel es_selected_sha256_lanes_kernel = NULL;
+static int es_selected_sha256_lanes = 0;
+static int es_selected_sha256_minimum_count = 0;
+
+/** The SHA-512 kernel bound for the running CPU & its lane counts. */
+static es_sha_lanes_kernel es_selected_sha512_lanes_kernel = NULL;
+static int es_selected_sha512_lanes = 0;
+static int es_selected_sha512_minimum_count = 0;
+
+/** Guards the one-time kernel binding. */
+static pthread_once_t es_sha_lanes_kernel_once = PTHREAD_ONCE_INIT;
+
+/**
+ * Gets the lane count of the specified kernel variant.
+ *
+ * @param kernels The kernel variants, indexed by the CPU dispatch level.
+ * @param counts The lane counts, indexed by the CPU dispatch level.
+ * @param kernel The kernel variant.
+ * @return The lane count of the kernel variant, or zero if it is NULL.
+ */
+static const int es_get_sha_lanes_count(
+	void * const *kernels,
+	const int *counts,
+	void *kernel)
+{
+	int i;
+
+	for(i = 0; kernel && i < ES_CPU_LEVEL_COUNT; ++i) {
+		if(kernels[i] == kernel)
+			return counts[i];
+	}
+
+	return 0;
+}
+
+/** Binds the kernels selected by the CPU dispatch layer. */
+static void es_bind_sha_lanes_kernels(void)
+{
+	void *kernel = NULL;
+
+	kernel = es_select_cpu_kernel("sha256 lanes", es_sha256_lanes_kernels);
+
+	/*
+	 * With the SHA extensions, a single SHA-256 stream digested by OpenSSL
+	 * outruns the eight AVX2 lanes together, so no kernel is bound.
+	 */
+	if(es_cpu_supports_sha()
+			&& kernel == es_sha256_lanes_kernels[ES_CPU_AVX2])
+		kernel = NULL;
+
+	es_selected_sha256_lanes_kernel = (es_sha_lanes_kernel)kernel;
+	es_selected_sha256_lanes = es_get_sha_lanes_count(
+		es_sha256_lanes_kernels,
+		es_sha256_lanes_counts,
+		kernel);
+	es_selected_sha256_minimum_count = es_cpu_supports_sha()
+		? es_selected_sha256_lanes
+		: es_selected_sha256_lanes / 2;
+
+	kernel = es_select_cpu_kernel("sha512 lanes", es_sha512_lanes_kernels);
+	es_selected_sha512_lanes_kernel = (es_sha_lanes_kernel)kernel;
+	es_selected_sha512_lanes = es_get_sha_lanes_count(
+		es_sha512_lanes_kernels,
+		es_sha512_lanes_counts,
+		kernel);
+	es_selected_sha512_minimum_count = es_selected_sha512_lanes / 2;
+}
+
+/**
+ * Gets the multi-lane kernel bound for the specified digest type. SHA-256 and
+ * SHA-512 have AVX2 and AVX-512 kernels (on x86 only), bound once, at the first
+ * call, by the CPU dispatch layer. There is no scalar kernel: callers keep
+ * their own single-stream path when no kernel is bound, or when fewer messages
+ * than the minimum count are at hand. The minimum count is half of the lanes,
+ * or all of them for SHA-256 on CPUs implementing the SHA extensions, whose
+ * single stream outruns a half empty kernel; the AVX2 kernel, which is never
+ * faster there, is not bound at all.
+ *
+ * @param digest_type The digest type represents the digest algorithm code.
+ * @param kernel Output parameter representing the bound kernel, or NULL if no
+ * kernel is bound. It may be NULL.
+ * @param minimum_count Output parameter representing the minimum number of
+ * messages for which the kernel outruns the single-stream path. It may be NULL.
+ * @return The number of lanes of the bound kernel, or zero if no kernel is
+ * bound for the digest type and the running CPU.
+ */
+const int es_get_sha_lanes_kernel(
+	const int digest_type,
+	es_sha_lanes_kernel *kernel,
+	int *minimum_count)
+{
+	es_sha_lanes_kernel selected_kernel = NULL;
+	int lanes = 0;
+	int selected_minimum_count = 0;
+
+	/* Bind the kernels on first use. */
+	pthread_once(&es_sha_lanes_kernel_once, es_bind_sha_lanes_kernels);
+
+	if(digest_type == ES_SHA256_DIGEST) {
+		selected_kernel = es_selected_sha256_lanes_kernel;
+		lanes = es_selected_sha256_lanes;
+		selected_minimum_count = es_selected_sha256_minimum_count;
+	} else if(digest_type == ES_SHA512_DIGEST) {
+		selected_kernel = es_selected_sha512_lanes_kernel;
+		lanes = es_selected_sha512_lanes;
+		selected_minimum_count = es_selected_sha512_minimum_count;
+	}
+
+	if(kernel)
+		*kernel = selected_kernel;
+
+	if(minimum_count)
+		*minimum_count = selected_minimum_count;
+
+	return lanes;
+}
@@ -0,0 +1,644 @@
+/**
+ * Copyright (c) 2016, Codrin-Victor Poienaru <cvpoienaru@gmail.com>.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * This software is provided by the copyright holders and contributors "as is"
+ * and any express or implied warranties, including, but not limited to, the
+ * implied warranties of merchantability and fitness for a particular purpose
+ * are disclaimed. In no event shall the copyright holder or contributors be
+ * liable for any direct, indirect, incidental, special, exemplary, or
+ * consequential damages (including, but not limited to, procurement of
+ * substitute goods or services; loss of use, data, or profits; or business
+ * interruption) however caused and on any theory of liability, whether in
+ * contract, strict liability, or tort (including negligence or otherwise)
+ * arising in any way out of the use of this software, even if advised of the
+ * possibility of such damage.
+ */
+
+#include <crypto/tree_hash.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include <global/defs.h>
+#include <global/math_defs.h>
+#include <global/memory.h>
+#include <crypto/digest.h>
+#include <crypto/sha_lanes.h>
+
+/** The domain separation prefix of the leaf nodes. */
+#define ES_TREE_HASH_LEAF_PREFIX 0x00
+
+/** The domain separation prefix of the parent nodes. */
+#define ES_TREE_HASH_PARENT_PREFIX 0x01
+
+/** The size in bytes of a leaf prefix: the domain byte and the chunk index. */
+#define ES_TREE_HASH_LEAF_PREFIX_SIZE (1 + sizeof(long))
+
+/** The size in bytes of a full leaf message. */
+#define ES_TREE_HASH_LEAF_MESSAGE_SIZE \
+	(ES_TREE_HASH_LEAF_PREFIX_SIZE + ES_TREE_HASH_CHUNK_SIZE)
+
+/** The size in bytes of a parent message. */
+#define ES_TREE_HASH_PARENT_MESSAGE_SIZE (1 + 2 * ES_TREE_HASH_NODE_SIZE)
+
+/** Structure defining a tree hash job shared with the worker threads. */
+struct es_tree_hash_job {
+	/** The data sets to be hashed. */
+	const char * const *data;
+
+	/** The number of bytes of every data set. */
+	const long *lengths;
+
+	/** The number of data sets. */
+	int count;
+
+	/** The total number of bytes of the data sets. */
+	long length;
+
+	/**
+	 * The index of the first leaf of every data set, followed by the total
+	 * number of leaves.
+	 */
+	long leaf_offsets[ES_TREE_HASH_MAXIMUM_BATCH_SIZE + 1];
+
+	/** The number of leaves. */
+	long leaf_count;
+
+	/** The number of leaves claimed at once, to fill the kernel lanes. */
+	long group_size;
+
+	/** The tree nodes, ES_TREE_HASH_NODE_SIZE bytes each. */
+	unsigned char *nodes;
+
+	/** The index of the next leaf to be hashed. */
+	long next_leaf;
+
+	/** The number of leaves already hashed. */
+	long done_leaves;
+
+	/** The number of worker threads currently working on the job. */
+	int active_workers;
+
+	/** The status of the job. */
+	int status;
+};
+
+/** Structure defining the shared pool of tree hash worker threads. */
+struct es_tree_hash_workers {
+	/** The number of worker threads. */
+	int count;
+
+	/** The job currently offered to the workers, or NULL. */
+	struct es_tree_hash_job *job;
+
+	/** The generation of the job currently offered to the workers. */
+	unsigned long generation;
+
+	/** Serializes the jobs submitted to the workers. */
+	pthread_mutex_t submit_mutex;
+
+	/** Guards the job, its generation and its active worker count. */
+	pthread_mutex_t mutex;
+
+	/** Signaled when a new job is offered to the workers. */
+	pthread_cond_t job_cond;
+
+	/** Signaled when a worker leaves a job. */
+	pthread_cond_t done_cond;
+};
+
+/** The shared pool of tree hash worker threads. */
+static struct es_tree_hash_workers es_tree_hash_workers = {
+	0,
+	NULL,
+	0,
+	PTHREAD_MUTEX_INITIALIZER,
+	PTHREAD_MUTEX_INITIALIZER,
+	PTHREAD_COND_INITIALIZER,
+	PTHREAD_COND_INITIALIZER
+};
+
+/** Guards the one-time creation of the worker threads. */
+static pthread_once_t es_tree_hash_workers_once = PTHREAD_ONCE_INIT;
+
+/**
+ * Hashes a node of the tree, as the SHA-512 digest of its message.
+ *
+ * @param message The node message.
+ * @param length The number of bytes of the message.
+ * @param node The buffer where to write the node, of ES_TREE_HASH_NODE_SIZE
+ * bytes.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+static const int es_hash_tree_node(
+	const unsigned char *message,
+	const int length,
+	unsigned char *node)
+{
+	int ret = ES_FAILURE;
+	int node_length = ES_TREE_HASH_NODE_SIZE;
+	struct es_digest *digest = NULL;
+
+	/* Use the SHA-512 digest cached for the calling thread. */
+	digest = es_acquire_digest(ES_SHA512_DIGEST, ES_OPENSSL_DIGEST_BACKEND);
+	if(!digest)
+		return ES_FAILURE;
+
+	if(es_update_digest_bytes(digest, (const char*)message, length)
+			!= ES_SUCCESS)
+		goto exit;
+
+	if(es_get_digest_bytes(digest, (char*)node, &node_length) != ES_SUCCESS)
+		goto exit;
+
+	/* Update the operation status. */
+	ret = ES_SUCCESS;
+
+exit:
+	es_reset_digest(digest);
+
+	return ret;
+}
+
+/**
+ * Hashes a group of equally long node messages. The messages are hashed side
+ * by side by the SHA-512 multi-lane kernel, a group of lanes at a time, while
+ * enough of them are left; the others are hashed one at a time.
+ *
+ * @param messages The node messages.
+ * @param length The number of bytes of every message.
+ * @param nodes The buffers where to write the nodes, of ES_TREE_HASH_NODE_SIZE
+ * bytes each.
+ * @param count The number of messages.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+static const int es_hash_tree_nodes(
+	const unsigned char * const *messages,
+	const int length,
+	unsigned char * const *nodes,
+	const int count)
+{
+	int i;
+	int j;
+	int lanes;
+	int group;
+	int minimum_count;
+	int ret = ES_SUCCESS;
+	es_sha_lanes_kernel kernel = NULL;
+	const unsigned char *data[ES_SHA_MAXIMUM_LANES];
+	unsigned char *digests[ES_SHA_MAXIMUM_LANES];
+	unsigned char spare_node[ES_TREE_HASH_NODE_SIZE];
+
+	lanes = es_get_sha_lanes_kernel(ES_SHA512_DIGEST, &kernel, &minimum_count);
+
+	for(i = 0; i < count; i += group) {
+		group = es_min(lanes, count - i);
+
+		/*
+		 * Hash a group of messages side by side. The lanes left without a
+		 * message repeat the first one and write a spare node.
+		 */
+		if(lanes > 0 && group >= minimum_count) {
+			for(j = 0; j < lanes; ++j) {
+				data[j] = messages[i + ((j < group) ? j : 0)];
+				digests[j] = (j < group) ? nodes[i + j] : spare_node;
+			}
+
+			kernel(data, length, digests);
+			continue;
+		}
+
+		/* Hash the remaining messages one at a time. */
+		group = 1;
+		if(es_hash_tree_node(messages[i], length, nodes[i]) != ES_SUCCESS)
+			ret = ES_FAILURE;
+	}
+
+	/* Wipe the spare node. */
+	es_wipe_memory(spare_node, ES_TREE_HASH_NODE_SIZE);
+
+	return ret;
+}
+
+/**
+ * Hashes the leaves of a tree hash job until none is left. Leaves are claimed
+ * a group at a time, so the calling thread and the workers share the job
+ * evenly while filling the kernel lanes. The full leaves of a group are hashed
+ * side by side; the short last leaf of a data set is hashed on its own.
+ *
+ * @param job The tree hash job.
+ */
+static void es_hash_tree_leaves(struct es_tree_hash_job *job)
+{
+	int i;
+	int k;
+	int full_count;
+	long leaf;
+	long first_leaf;
+	long last_leaf;
+	long local_leaf;
+	long offset;
+	int chunk_length;
+	unsigned char *message = NULL;
+	const unsigned char *full_messages[ES_SHA_MAXIMUM_LANES];
+	unsigned char *full_nodes[ES_SHA_MAXIMUM_LANES];
+	unsigned char messages[ES_SHA_MAXIMUM_LANES]
+		[ES_TREE_HASH_LEAF_MESSAGE_SIZE];
+
+	while(TRUE) {
+		first_leaf = __atomic_fetch_add(
+			&job->next_leaf,
+			job->group_size,
+			__ATOMIC_RELAXED);
+		if(first_leaf >= job->leaf_count)
+			break;
+
+		last_leaf = es_min(first_leaf + job->group_size, job->leaf_count);
+		full_count = 0;
+
+		for(leaf = first_leaf, k = 0; leaf < last_leaf; ++leaf) {
+			/* Find the data set of the leaf and its chunk. */
+			while(leaf >= job->leaf_offsets[k + 1])
+				++k;
+
+			local_leaf = leaf - job->leaf_offsets[k];
+			offset = local_leaf * ES_TREE_HASH_CHUNK_SIZE;
+			chunk_length = (int)es_min(
+				ES_TREE_HASH_CHUNK_SIZE,
+				job->lengths[k] - offset);
+
+			/* The leaf prefix holds the big endian chunk index. */
+			message = messages[leaf - first_leaf];
+			message[0] = ES_TREE_HASH_LEAF_PREFIX;
+			for(i = 0; i < sizeof(long); ++i)
+				message[1 + i] = (unsigned char)
+					(local_leaf >> (8 * (sizeof(long) - 1 - i)));
+
+			memcpy(
+				message + ES_TREE_HASH_LEAF_PREFIX_SIZE,
+				job->data[k] + offset,
+				chunk_length);
+
+			if(chunk_length == ES_TREE_HASH_CHUNK_SIZE) {
+				full_messages[full_count] = message;
+				full_nodes[full_count++] =
+					job->nodes + leaf * ES_TREE_HASH_NODE_SIZE;
+			} else if(es_hash_tree_node(
+					message,
+					ES_TREE_HASH_LEAF_PREFIX_SIZE + chunk_length,
+					job->nodes + leaf * ES_TREE_HASH_NODE_SIZE)
+					!= ES_SUCCESS) {
+				__atomic_store_n(&job->status, ES_FAILURE, __ATOMIC_RELAXED);
+			}
+		}
+
+		if(es_hash_tree_nodes(
+				full_messages,
+				ES_TREE_HASH_LEAF_MESSAGE_SIZE,
+				full_nodes,
+				full_count) != ES_SUCCESS)
+			__atomic_store_n(&job->status, ES_FAILURE, __ATOMIC_RELAXED);
+
+		/* Wipe the leaf messages. */
+		es_wipe_memory(
+			messages,
+			(last_leaf - first_leaf) * ES_TREE_HASH_LEAF_MESSAGE_SIZE);
+
+		__atomic_add_fetch(
+			&job->done_leaves,
+			last_leaf - first_leaf,
+			__ATOMIC_RELEASE);
+	}
+}
+
+/**
+ * Runs a tree hash worker thread, hashing the leaves of every job offered.
+ *
+ * @param arg Unused.
+ * @return Never returns.
+ */
+static void* es_run_tree_hash_worker(void *arg)
+{
+	unsigned long generation = 0;
+	struct es_tree_hash_job *job = NULL;
+	struct es_tree_hash_workers *workers = &es_tree_hash_workers;
+
+	while(TRUE) {
+		/* Wait for a new job and join it, if still offered. */
+		pthread_mutex_lock(&workers->mutex);
+		while(workers->generation == generation)
+			pthread_cond_wait(&workers->job_cond, &workers->mutex);
+
+		generation = workers->generation;
+		job = workers->job;
+		if(job)
+			++job->active_workers;
+		pthread_mutex_unlock(&workers->mutex);
+
+		if(!job)
+			continue;
+
+		es_hash_tree_leaves(job);
+
+		/* Leave the job. */
+		pthread_mutex_lock(&workers->mutex);
+		--job->active_workers;
+		pthread_cond_broadcast(&workers->done_cond);
+		pthread_mutex_unlock(&workers->mutex);
+	}
+
+	return NULL;
+}
+
+/** Creates the tree hash worker threads, one per additional online CPU. */
+static void es_create_tree_hash_workers(void)
+{
+	int i;
+	long count;
+	pthread_t thread;
+	pthread_attr_t attributes;
+
+	/* The calling thread hashes leaves as well, so it counts as one CPU. */
+	count = sysconf(_SC_NPROCESSORS_ONLN) - 1;
+	count = es_max(0, es_min(count, ES_TREE_HASH_MAXIMUM_WORKERS));
+
+	if(pthread_attr_init(&attributes))
+		return;
+	pthread_attr_setdetachstate(&attributes, PTHREAD_CREATE_DETACHED);
+
+	for(i = 0; i < count; ++i) {
+		if(pthread_create(
+				&thread,
+				&attributes,
+				es_run_tree_hash_worker,
+				NULL))
+			break;
+	}
+
+	es_tree_hash_workers.count = i;
+	pthread_attr_destroy(&attributes);
+}
+
+/**
+ * Hashes the leaves of a tree hash job, with the help of the worker threads
+ * if they are idle.
+ *
+ * @param job The tree hash job.
+ */
+static void es_run_tree_hash_job(struct es_tree_hash_job *job)
+{
+	struct es_tree_hash_workers *workers = &es_tree_hash_workers;
+
+	/* Hash small batches on the calling thread. */
+	if(job->length < ES_TREE_HASH_PARALLEL_THRESHOLD) {
+		es_hash_tree_leaves(job);
+		return;
+	}
+
+	/*
+	 * Batches submitted while the workers are busy with another job are hashed
+	 * on the calling thread as well.
+	 */
+	pthread_once(&es_tree_hash_workers_once, es_create_tree_hash_workers);
+	if(workers->count == 0
+			|| pthread_mutex_trylock(&workers->submit_mutex)) {
+		es_hash_tree_leaves(job);
+		return;
+	}
+
+	/* Offer the job to the workers. */
+	pthread_mutex_lock(&workers->mutex);
+	workers->job = job;
+	++workers->generation;
+	pthread_cond_broadcast(&workers->job_cond);
+	pthread_mutex_unlock(&workers->mutex);
+
+	es_hash_tree_leaves(job);
+
+	/* Wait for the workers to leave the job, then withdraw it. */
+	pthread_mutex_lock(&workers->mutex);
+	while(job->active_workers > 0
+			|| __atomic_load_n(&job->done_leaves, __ATOMIC_ACQUIRE)
+				< job->leaf_count)
+		pthread_cond_wait(&workers->done_cond, &workers->mutex);
+
+	workers->job = NULL;
+	pthread_mutex_unlock(&workers->mutex);
+
+	pthread_mutex_unlock(&workers->submit_mutex);
+}
+
+/**
+ * Combines the nodes of every data set of a tree hash job level by level, in
+ * place, up to the roots. The parents of a level are hashed side by side
+ * across the whole batch.
+ *
+ * @param job The tree hash job, whose leaves are hashed.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+static const int es_hash_tree_parents(struct es_tree_hash_job *job)
+{
+	int k;
+	int more;
+	int pending;
+	long i;
+	long counts[ES_TREE_HASH_MAXIMUM_BATCH_SIZE];
+	int ret = ES_SUCCESS;
+	unsigned char *level_nodes = NULL;
+	const unsigned char *pending_messages[ES_SHA_MAXIMUM_LANES];
+	unsigned char *pending_nodes[ES_SHA_MAXIMUM_LANES];
+	unsigned char messages[ES_SHA_MAXIMUM_LANES]
+		[ES_TREE_HASH_PARENT_MESSAGE_SIZE];
+
+	more = FALSE;
+	for(k = 0; k < job->count; ++k) {
+		counts[k] = job->leaf_offsets[k + 1] - job->leaf_offsets[k];
+		if(counts[k] > 1)
+			more = TRUE;
+	}
+
+	while(more) {
+		/*
+		 * Queue the parents of the level. A parent overwrites a node of a
+		 * lower index than the pairs queued after it, so the pairs are read
+		 * before being overwritten.
+		 */
+		pending = 0;
+		for(k = 0; k < job->count; ++k) {
+			level_nodes = job->nodes
+				+ job->leaf_offsets[k] * ES_TREE_HASH_NODE_SIZE;
+
+			for(i = 0; i < counts[k] / 2; ++i) {
+				messages[pending][0] = ES_TREE_HASH_PARENT_PREFIX;
+				memcpy(
+					messages[pending] + 1,
+					level_nodes + 2 * i * ES_TREE_HASH_NODE_SIZE,
+					2 * ES_TREE_HASH_NODE_SIZE);
+				pending_messages[pending] = messages[pending];
+				pending_nodes[pending++] =
+					level_nodes + i * ES_TREE_HASH_NODE_SIZE;
+
+				if(pending < ES_SHA_MAXIMUM_LANES)
+					continue;
+
+				if(es_hash_tree_nodes(
+						pending_messages,
+						ES_TREE_HASH_PARENT_MESSAGE_SIZE,
+						pending_nodes,
+						pending) != ES_SUCCESS)
+					ret = ES_FAILURE;
+				pending = 0;
+			}
+		}
+
+		if(es_hash_tree_nodes(
+				pending_messages,
+				ES_TREE_HASH_PARENT_MESSAGE_SIZE,
+				pending_nodes,
+				pending) != ES_SUCCESS)
+			ret = ES_FAILURE;
+
+		/* Promote the unpaired nodes and move up a level. */
+		more = FALSE;
+		for(k = 0; k < job->count; ++k) {
+			level_nodes = job->nodes
+				+ job->leaf_offsets[k] * ES_TREE_HASH_NODE_SIZE;
+
+			if(counts[k] % 2)
+				memmove(
+					level_nodes + (counts[k] / 2) * ES_TREE_HASH_NODE_SIZE,
+					level_nodes + (counts[k] - 1) * ES_TREE_HASH_NODE_SIZE,
+					ES_TREE_HASH_NODE_SIZE);
+
+			counts[k] = (counts[k] + 1) / 2;
+			if(counts[k] > 1)
+				more = TRUE;
+		}
+	}
+
+	/* Wipe the parent messages. */
+	es_wipe_memory(messages, sizeof(messages));
+
+	return ret;
+}
+
+/**
+ * Computes the Merkle tree hash of the specified data over SHA-512. The data
+ * is split into ES_TREE_HASH_CHUNK_SIZE chunks; each leaf is
+ * SHA-512(0x00 | chunk index | chunk) and each parent is
+ * SHA-512(0x01 | left | right), an unpaired node being promoted to the next
+ * level as is. See es_compute_tree_hashes.
+ *
+ * @param data The data to be hashed.
+ * @param length The number of bytes of data.
+ * @param digest The buffer where to write the root hash, of
+ * ES_TREE_HASH_NODE_SIZE bytes.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_compute_tree_hash(
+	const char *data,
+	const long length,
+	char *digest)
+{
+	return es_compute_tree_hashes(&data, &length, &digest, 1);
+}
+
+/**
+ * Computes the Merkle tree hashes of a batch of data sets, each one the same
+ * as es_compute_tree_hash would. The leaves of the whole batch form a single
+ * job: they are hashed side by side by the SHA-512 multi-lane kernel, when the
+ * CPU dispatch layer bound one, and batches of at least
+ * ES_TREE_HASH_PARALLEL_THRESHOLD bytes are shared with a pool of worker
+ * threads, created on first use with one worker per additional online CPU.
+ * The parents of every level of the batch are hashed side by side as well.
+ *
+ * @param data The data sets to be hashed.
+ * @param lengths The number of bytes of every data set.
+ * @param digests The buffers where to write the root hashes, of
+ * ES_TREE_HASH_NODE_SIZE bytes each.
+ * @param count The number of data sets, at most
+ * ES_TREE_HASH_MAXIMUM_BATCH_SIZE.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_compute_tree_hashes(
+	const char * const *data,
+	const long *lengths,
+	char * const *digests,
+	const int count)
+{
+	int ret = ES_FAILURE;
+	int k;
+	struct es_tree_hash_job job;
+
+	/* Perform sanity checks. */
+	if(!data || !lengths || !digests)
+		return ES_FAILURE;
+
+	if(count <= 0 || count > ES_TREE_HASH_MAXIMUM_BATCH_SIZE)
+		return ES_FAILURE;
+
+	/* Set up the job; an empty data set still has a single (empty) leaf. */
+	memset(&job, 0, sizeof(struct es_tree_hash_job));
+	job.data = data;
+	job.lengths = lengths;
+	job.count = count;
+	job.status = ES_SUCCESS;
+
+	for(k = 0; k < count; ++k) {
+		if(!data[k] || lengths[k] < 0 || !digests[k])
+			return ES_FAILURE;
+
+		job.length += lengths[k];
+		job.leaf_offsets[k + 1] = job.leaf_offsets[k]
+			+ es_max(1, (lengths[k] + ES_TREE_HASH_CHUNK_SIZE - 1)
+				/ ES_TREE_HASH_CHUNK_SIZE);
+	}
+
+	job.leaf_count = job.leaf_offsets[count];
+	job.group_size = es_max(
+		1,
+		es_get_sha_lanes_kernel(ES_SHA512_DIGEST, NULL, NULL));
+
+	job.nodes = (unsigned char*)malloc(
+		job.leaf_count * ES_TREE_HASH_NODE_SIZE);
+	if(!job.nodes)
+		return ES_FAILURE;
+
+	/* Hash the leaves. */
+	es_run_tree_hash_job(&job);
+	if(job.status != ES_SUCCESS)
+		goto exit;
+
+	/* Combine the nodes level by level up to the roots. */
+	if(es_hash_tree_parents(&job) != ES_SUCCESS)
+		goto exit;
+
+	for(k = 0; k < count; ++k)
+		memcpy(
+			digests[k],
+			job.nodes + job.leaf_offsets[k] * ES_TREE_HASH_NODE_SIZE,
+			ES_TREE_HASH_NODE_SIZE);
+
+	/* Update the operation status. */
+	ret = ES_SUCCESS;
+
+exit:
+	/* Wipe the intermediate nodes. */
+	es_wipe_memory(job.nodes, job.leaf_count * ES_TREE_HASH_NODE_SIZE);
+	free(job.nodes);
+
+	return ret;
+}
@@ -0,0 +1,242 @@
+/**
+ * Copyright (c) 2016, Codrin-Victor Poienaru <cvpoienaru@gmail.com>.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * This software is provided by the copyright holders and contributors "as is"
+ * and any express or implied warranties, including, but not limited to, the
+ * implied warranties of merchantability and fitness for a particular purpose
+ * are disclaimed. In no event shall the copyright holder or contributors be
+ * liable for any direct, indirect, incidental, special, exemplary, or
+ * consequential damages (including, but not limited to, procurement of
+ * substitute goods or services; loss of use, data, or profits; or business
+ * interruption) however caused and on any theory of liability, whether in
+ * contract, strict liability, or tort (including negligence or otherwise)
+ * arising in any way out of the use of this software, even if advised of the
+ * possibility of such damage.
+ */
+
+#include <crypto/xor.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+#include <global/defs.h>
+#include <crypto/cpu_dispatch.h>
+
+/** Represents a function pointer definition for a XOR kernel. */
+typedef void (*es_xor_kernel)(
+	char *destination,
+	const char *source_1,
+	const char *source_2,
+	const int length);
+
+/**
+ * Combines two byte arrays with XOR, one machine word at a time.
+ *
+ * @param destination The array where to write the combined bytes.
+ * @param source_1 The first array to be combined.
+ * @param source_2 The second array to be combined.
+ * @param length The number of bytes to be combined.
+ */
+static void es_xor_bytes_portable(
+	char *destination,
+	const char *source_1,
+	const char *source_2,
+	const int length)
+{
+	int i = 0;
+	uint64_t word_1;
+	uint64_t word_2;
+
+	/* Combine whole words, using memcpy to stay clear of alignment issues. */
+	for(; i + (int)sizeof(uint64_t) <= length; i += sizeof(uint64_t)) {
+		memcpy(&word_1, source_1 + i, sizeof(uint64_t));
+		memcpy(&word_2, source_2 + i, sizeof(uint64_t));
+		word_1 ^= word_2;
+		memcpy(destination + i, &word_1, sizeof(uint64_t));
+	}
+
+	/* Combine the remaining bytes. */
+	for(; i < length; ++i)
+		destination[i] = source_1[i] ^ source_2[i];
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+/**
+ * Combines two byte arrays with XOR, 16 bytes at a time, using SSE2.
+ *
+ * @param destination The array where to write the combined bytes.
+ * @param source_1 The first array to be combined.
+ * @param source_2 The second array to be combined.
+ * @param length The number of bytes to be combined.
+ */
+__attribute__((target("sse2")))
+static void es_xor_bytes_sse2(
+	char *destination,
+	const char *source_1,
+	const char *source_2,
+	const int length)
+{
+	int i = 0;
+	__m128i vector_1;
+	__m128i vector_2;
+
+	for(; i + 16 <= length; i += 16) {
+		vector_1 = _mm_loadu_si128((const __m128i*)(source_1 + i));
+		vector_2 = _mm_loadu_si128((const __m128i*)(source_2 + i));
+		_mm_storeu_si128(
+			(__m128i*)(destination + i),
+			_mm_xor_si128(vector_1, vector_2));
+	}
+
+	/* Combine the remaining bytes. */
+	es_xor_bytes_portable(
+		destination + i,
+		source_1 + i,
+		source_2 + i,
+		length - i);
+}
+
+/**
+ * Combines two byte arrays with XOR, 32 bytes at a time, using AVX2.
+ *
+ * @param destination The array where to write the combined bytes.
+ * @param source_1 The first array to be combined.
+ * @param source_2 The second array to be combined.
+ * @param length The number of bytes to be combined.
+ */
+__attribute__((target("avx2")))
+static void es_xor_bytes_avx2(
+	char *destination,
+	const char *source_1,
+	const char *source_2,
+	const int length)
+{
+	int i = 0;
+	__m256i vector_1;
+	__m256i vector_2;
+
+	for(; i + 32 <= length; i += 32) {
+		vector_1 = _mm256_loadu_si256((const __m256i*)(source_1 + i));
+		vector_2 = _mm256_loadu_si256((const __m256i*)(source_2 + i));
+		_mm256_storeu_si256(
+			(__m256i*)(destination + i),
+			_mm256_xor_si256(vector_1, vector_2));
+	}
+
+	/* Combine the remaining bytes with the narrower kernel. */
+	es_xor_bytes_sse2(
+		destination + i,
+		source_1 + i,
+		source_2 + i,
+		length - i);
+}
+
+/**
+ * Combines two byte arrays with XOR, 64 bytes at a time, using AVX-512.
+ *
+ * @param destination The array where to write the combined bytes.
+ * @param source_1 The first array to be combined.
+ * @param source_2 The second array to be combined.
+ * @param length The number of bytes to be combined.
+ */
+__attribute__((target("avx512f")))
+static void es_xor_bytes_avx512(
+	char *destination,
+	const char *source_1,
+	const char *source_2,
+	const int length)
+{
+	int i = 0;
+	__m512i vector_1;
+	__m512i vector_2;
+
+	for(; i + 64 <= length; i += 64) {
+		vector_1 = _mm512_loadu_si512((const void*)(source_1 + i));
+		vector_2 = _mm512_loadu_si512((const void*)(source_2 + i));
+		_mm512_storeu_si512(
+			(void*)(destination + i),
+			_mm512_xor_si512(vector_1, vector_2));
+	}
+
+	/* Combine the remaining bytes with the narrower kernel. */
+	es_xor_bytes_avx2(
+		destination + i,
+		source_1 + i,
+		source_2 + i,
+		length - i);
+}
+
+/** The XOR kernel variants, indexed by the CPU dispatch level. */
+static void * const es_xor_kernels[ES_CPU_LEVEL_COUNT] = {
+	es_xor_bytes_portable,
+	es_xor_bytes_sse2,
+	es_xor_bytes_avx2,
+	es_xor_bytes_avx512
+};
+#else
+/** The XOR kernel variants; only the portable one exists outside x86. */
+static void * const es_xor_kernels[ES_CPU_LEVEL_COUNT] = {
+	es_xor_bytes_portable,
+	NULL,
+	NULL,
+	NULL
+};
+#endif
+
+/** The XOR kernel bound for the running CPU. */
+static es_xor_kernel es_selected_xor_kernel = es_xor_bytes_portable;
+
+/** Guards the one-time XOR kernel binding. */
+static pthread_once_t es_xor_kernel_once = PTHREAD_ONCE_INIT;
+
+/** Binds the XOR kernel selected by the CPU dispatch layer. */
+static void es_bind_xor_kernel(void)
+{
+	es_selected_xor_kernel = (es_xor_kernel)es_select_cpu_kernel(
+		"xor",
+		es_xor_kernels);
+}
+
+/**
+ * Combines two byte arrays with XOR. The kernel is bound once, at the first
+ * call, by the CPU dispatch layer among AVX-512, AVX2, SSE2 (on x86 only) and
+ * a portable word-sized implementation.
+ *
+ * @param destination The array where to write the combined bytes. It may be
+ * the same array as any of the sources, but must not partially overlap them.
+ * @param source_1 The first array to be combined.
+ * @param source_2 The second array to be combined.
+ * @param length The number of bytes to be combined.
+ */
+void es_xor_bytes(
+	char *destination,
+	const char *source_1,
+	const char *source_2,
+	const int length)
+{
+	/* Perform sanity checks. */
+	if(!destination || !source_1 || !source_2 || length <= 0)
+		return;
+
+	/* Bind the kernel on first use. */
+	pthread_once(&es_xor_kernel_once, es_bind_xor_kernel);
+
+	es_selected_xor_kernel(destination, source_1, source_2, length);
+}
@@ -29,10 +29,12 @@
 
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 #include <termios.h>
 
 #include <global/defs.h>
 #include <device/serial_bundle.h>
+#include <device/serial_driver.h>
 
 /**
  * Allocates memory for a device descriptor.
@@ -61,6 +63,8 @@ struct es_device_descriptor* es_alloc_device_descriptor(
 	if(!descriptor)
 		goto exit;
 
+	descriptor->fd = ES_DEFAULT_DESCRIPTOR;
+
 	/* Create a new serial bundle for the device descriptor. */
 	descriptor->serial_bundle = es_create_serial_bundle(port_name, baud_rate);
 	if(!descriptor->serial_bundle)
@@ -90,6 +94,12 @@ void es_free_device_descriptor(struct es_device_descriptor **descriptor)
 	if(!descriptor || !(*descriptor))
 		return;
 
+	/* If opened, stop any data stream and close the associated file. */
+	if((*descriptor)->fd >= 0) {
+		es_stop_device_stream(*descriptor);
+		close((*descriptor)->fd);
+	}
+
 	/* If created, destroy the serial bundle. */
 	if((*descriptor)->serial_bundle)
 		es_destroy_serial_bundle(&(*descriptor)->serial_bundle);
@@ -114,6 +124,8 @@ const int es_init_device_descriptor(struct es_device_descriptor *descriptor)
 	/* Initialize the structure fields with their default values. */
 	descriptor->fd = ES_DEFAULT_DESCRIPTOR;
 	descriptor->runnable = TRUE;
+	descriptor->source_type = ES_SERIAL_SOURCE_TYPE;
+	descriptor->streaming = FALSE;
 
 	return ES_SUCCESS;
 }
@@ -196,5 +208,38 @@ const int es_validate_device_descriptor(
 	if(descriptor->runnable != TRUE && descriptor->runnable != FALSE)
 		return ES_FAILURE;
 
+	if(descriptor->source_type != ES_SERIAL_SOURCE_TYPE
+			&& descriptor->source_type != ES_RAW_SOURCE_TYPE)
+		return ES_FAILURE;
+
+	return ES_SUCCESS;
+}
+
+/**
+ * Sets the source type of a device descriptor. Must be called before the
+ * device is initialized.
+ *
+ * @param descriptor The device descriptor to be updated.
+ * @param source_type The source type of the connected device.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_set_device_source_type(
+	struct es_device_descriptor *descriptor,
+	const int source_type)
+{
+	/* Perform sanity checks. */
+	if(!descriptor)
+		return ES_FAILURE;
+
+	if(source_type != ES_SERIAL_SOURCE_TYPE
+			&& source_type != ES_RAW_SOURCE_TYPE)
+		return ES_FAILURE;
+
+	/* The source type cannot change once the device is opened. */
+	if(descriptor->fd >= 0)
+		return ES_FAILURE;
+
+	descriptor->source_type = source_type;
+
 	return ES_SUCCESS;
 }
@@ -0,0 +1,218 @@
+/**
+ * Copyright (c) 2016, Codrin-Victor Poienaru <cvpoienaru@gmail.com>.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * This software is provided by the copyright holders and contributors "as is"
+ * and any express or implied warranties, including, but not limited to, the
+ * implied warranties of merchantability and fitness for a particular purpose
+ * are disclaimed. In no event shall the copyright holder or contributors be
+ * liable for any direct, indirect, incidental, special, exemplary, or
+ * consequential damages (including, but not limited to, procurement of
+ * substitute goods or services; loss of use, data, or profits; or business
+ * interruption) however caused and on any theory of liability, whether in
+ * contract, strict liability, or tort (including negligence or otherwise)
+ * arising in any way out of the use of this software, even if advised of the
+ * possibility of such damage.
+ */
+
+#include <device/device_spec.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+
+#include <global/defs.h>
+#include <device/descriptor.h>
+#include <device/serial_driver.h>
+
+/**
+ * Gets the baud rate code of a baud rate given in bits per second.
+ *
+ * @param bits_per_second The baud rate in bits per second.
+ * @param baud_rate Output parameter holding the baud rate code.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+static const int es_get_baud_rate_code(
+	const long bits_per_second,
+	speed_t *baud_rate)
+{
+	switch(bits_per_second) {
+		case 9600:
+			*baud_rate = B9600;
+			break;
+
+		case 19200:
+			*baud_rate = B19200;
+			break;
+
+		case 38400:
+			*baud_rate = B38400;
+			break;
+
+		case 57600:
+			*baud_rate = B57600;
+			break;
+
+		case 115200:
+			*baud_rate = B115200;
+			break;
+
+		case 230400:
+			*baud_rate = B230400;
+			break;
+
+		default:
+			return ES_FAILURE;
+	}
+
+	return ES_SUCCESS;
+}
+
+/**
+ * Parses a device specification of the form
+ * <port_name>[:<baud_rate>[:<source_type>]], where the baud rate is given in
+ * bits per second and the source type is either "serial" or "raw".
+ *
+ * @param spec The device specification to be parsed.
+ * @param device_spec Output parameter holding the parsed specification.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_parse_device_spec(
+	const char *spec,
+	struct es_device_spec *device_spec)
+{
+	long bits_per_second;
+	char *end = NULL;
+	const char *separator = NULL;
+	size_t length;
+
+	/* Perform sanity checks. */
+	if(!spec || !device_spec)
+		return ES_FAILURE;
+
+	/* Initialize the specification with the default values. */
+	memset(device_spec, 0, sizeof(struct es_device_spec));
+	device_spec->baud_rate = ES_DEFAULT_DEVICE_BAUD_RATE;
+	device_spec->source_type = ES_SERIAL_SOURCE_TYPE;
+
+	/* Extract the port name. */
+	separator = strchr(spec, ES_DEVICE_SPEC_SEPARATOR);
+	length = separator ? (size_t)(separator - spec) : strlen(spec);
+	if(length == 0 || length >= ES_MAXIMUM_PORT_NAME_SIZE)
+		return ES_FAILURE;
+
+	memcpy(device_spec->port_name, spec, length);
+	device_spec->port_name[length] = '\0';
+
+	if(!separator)
+		return ES_SUCCESS;
+
+	/* Extract the baud rate, if any. */
+	spec = separator + 1;
+	if(*spec != ES_DEVICE_SPEC_SEPARATOR) {
+		bits_per_second = strtol(spec, &end, 10);
+		if(end == spec)
+			return ES_FAILURE;
+
+		if(*end != '\0' && *end != ES_DEVICE_SPEC_SEPARATOR)
+			return ES_FAILURE;
+
+		if(es_get_baud_rate_code(
+				bits_per_second,
+				&device_spec->baud_rate) != ES_SUCCESS)
+			return ES_FAILURE;
+
+		spec = end;
+	}
+
+	if(*spec == '\0')
+		return ES_SUCCESS;
+
+	/* Extract the source type. */
+	++spec;
+	if(!strcmp(spec, ES_SERIAL_SOURCE_TYPE_NAME))
+		device_spec->source_type = ES_SERIAL_SOURCE_TYPE;
+	else if(!strcmp(spec, ES_RAW_SOURCE_TYPE_NAME))
+		device_spec->source_type = ES_RAW_SOURCE_TYPE;
+	else
+		return ES_FAILURE;
+
+	return ES_SUCCESS;
+}
+
+/**
+ * Creates and initializes the device descriptor of a device specification.
+ * The device is opened and ready to be read.
+ *
+ * @param device_spec The device specification.
+ * @return The address of a newly allocated device descriptor if the operation
+ * was successfull, NULL otherwise.
+ */
+struct es_device_descriptor* es_open_device_spec(
+	const struct es_device_spec *device_spec)
+{
+	int status = ES_FAILURE;
+	struct es_device_descriptor *descriptor = NULL;
+
+	/* Perform sanity checks. */
+	if(!device_spec)
+		goto exit;
+
+	/* Create the device descriptor. */
+	descriptor = es_create_device_descriptor(
+		device_spec->port_name,
+		device_spec->baud_rate);
+	if(!descriptor)
+		goto exit;
+
+	if(es_set_device_source_type(
+			descriptor,
+			device_spec->source_type) != ES_SUCCESS)
+		goto exit;
+
+	/* Open the device. */
+	if(es_init_device(descriptor) != ES_SUCCESS)
+		goto exit;
+
+	/* Update the operation status. */
+	status = ES_SUCCESS;
+
+exit:
+	/*
+	 * If the operation failed, destroy the partially created device
+	 * descriptor.
+	 */
+	if(status == ES_FAILURE && descriptor)
+		es_destroy_device_descriptor(&descriptor);
+
+	return descriptor;
+}
+
+/**
+ * Gets the name of a device source type.
+ *
+ * @param source_type The device source type.
+ * @return The name of the source type, or NULL if the source type is invalid.
+ */
+const char* es_get_device_source_type_name(const int source_type)
+{
+	switch(source_type) {
+		case ES_SERIAL_SOURCE_TYPE:
+			return ES_SERIAL_SOURCE_TYPE_NAME;
+
+		case ES_RAW_SOURCE_TYPE:
+			return ES_RAW_SOURCE_TYPE_NAME;
+	}
+
+	return NULL;
+}
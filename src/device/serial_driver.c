@@ -163,6 +163,15 @@ const int es_init_device(struct es_device_descriptor *descriptor)
 	if(es_validate_serial_bundle(descriptor->serial_bundle) != ES_SUCCESS)
 		return ES_FAILURE;
 
+	/* A raw character device is read as it is. */
+	if(descriptor->source_type == ES_RAW_SOURCE_TYPE) {
+		descriptor->fd = open(
+			descriptor->serial_bundle->port_name,
+			O_RDONLY | O_NOCTTY);
+
+		return (descriptor->fd < 0) ? ES_FAILURE : ES_SUCCESS;
+	}
+
 	/* Initialize the device serial port. */
 	if(es_init_device_serial_port(
 			descriptor->serial_bundle,
@@ -180,24 +189,69 @@ const int es_init_device(struct es_device_descriptor *descriptor)
 }
 
 /**
- * Reads data from the device.
+ * Reads exactly the specified number of raw bytes from the device, straight
+ * into the given buffer. The bytes are binary and may include NUL characters.
  *
  * @param descriptor The device descriptor associated with the connected device.
  * @param size The number of bytes to read from the device.
  * @param buffer The buffer where to store the data read from the device.
  * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
  */
-const int es_read_device_data(
+static const int es_read_device(
 	struct es_device_descriptor *descriptor,
 	const int size,
 	char *buffer)
 {
-	int ret = ES_FAILURE;
 	int buffer_size = 0;
-	int copy_size = 0;
 	int rbytes = 0;
+	int serial = (descriptor->source_type == ES_SERIAL_SOURCE_TYPE
+		&& !descriptor->streaming);
 	char data_transfer_code;
-	char *tmp_buffer = NULL;
+
+	/* Begin the data transfer by sending the start transfer code. */
+	data_transfer_code = ES_SERIAL_START_TRANSFER_CODE;
+	if(serial && write(descriptor->fd, &data_transfer_code, sizeof(char)) < 0)
+		return ES_FAILURE;
+
+	/* Read data from the device until the specified number of bytes is read. */
+	while(buffer_size < size) {
+		if((rbytes = read(
+				descriptor->fd,
+				buffer + buffer_size,
+				size - buffer_size)) < 0)
+			return ES_FAILURE;
+
+		/* A raw device reaching its end will not produce more data. */
+		if(descriptor->source_type == ES_RAW_SOURCE_TYPE && rbytes == 0)
+			return ES_FAILURE;
+
+		buffer_size += rbytes;
+	}
+
+	/* Stop the data transfer by sending the end transfer code. */
+	data_transfer_code = ES_SERIAL_STOP_TRANSFER_CODE;
+	if(serial && write(descriptor->fd, &data_transfer_code, sizeof(char)) < 0)
+		return ES_FAILURE;
+
+	return ES_SUCCESS;
+}
+
+/**
+ * Reads data from the device. Unless the device is streaming, the read is
+ * wrapped in start/stop transfer codes. The buffer is terminated with a NULL
+ * character, so at most size - 1 bytes are read.
+ *
+ * @param descriptor The device descriptor associated with the connected device.
+ * @param size The number of bytes to read from the device.
+ * @param buffer The buffer where to store the data read from the device.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_read_device_data(
+	struct es_device_descriptor *descriptor,
+	const int size,
+	char *buffer)
+{
+	int ret = ES_FAILURE;
 
 	/* Perform sanity checks. */
 	if(!descriptor)
@@ -215,58 +269,141 @@ const int es_read_device_data(
 	/* Clear the buffer. */
 	memset(buffer, 0, size * sizeof(char));
 
-	/* Allocate memory for a temporary buffer. */
-	tmp_buffer = (char*)malloc(size * sizeof(char));
-	if(!tmp_buffer)
-		goto exit;
-
-	/* Begin the data transfer by sending the start transfer code. */
-	data_transfer_code = ES_SERIAL_START_TRANSFER_CODE;
-	if(write(descriptor->fd, &data_transfer_code, sizeof(char)) < 0)
+	/* Read the data and terminate the buffer with a NULL character. */
+	if(es_read_device(descriptor, size - 1, buffer) != ES_SUCCESS)
 		goto exit;
 
-	while(TRUE) {
-		/* If we have already read the specified number of bits ... */
-		if(buffer_size == size - 1) {
-			/* Stop the data transfer by sending the end transfer code. */
-			data_transfer_code = ES_SERIAL_STOP_TRANSFER_CODE;
-			if(write(descriptor->fd, &data_transfer_code, sizeof(char)) < 0)
-				goto exit;
-
-			/* Terminate the buffer with a NULL character and exit. */
-			buffer[buffer_size] = '\0';
-			break;
-		}
-
-		/* Clear the temporary buffer. */
-		memset(tmp_buffer, 0, size * sizeof(char));
-
-		/* Read data from the device. */
-		if((rbytes = read(descriptor->fd, tmp_buffer, size)) < 0)
-			goto exit;
-
-		/* Append the read data to the main buffer. */
-		copy_size = es_min(rbytes, size - buffer_size - 1);
-		buffer_size += copy_size;
-		strncat(buffer, tmp_buffer, copy_size);
-	}
+	buffer[size - 1] = '\0';
 
 	/* Update the operation status. */
 	ret = ES_SUCCESS;
 
 exit:
 	/* If the operation failed, clear the main buffer. */
-	if(ret == ES_FAILURE) {
+	if(ret == ES_FAILURE && buffer && size > 0)
 		memset(buffer, 0, size * sizeof(char));
-		buffer[0] = '\0';
-	}
 
-	/* Clear & free the temporary buffer. */
-	if(tmp_buffer) {
-		memset(tmp_buffer, 0, size * sizeof(char));
-		free(tmp_buffer);
-		tmp_buffer = NULL;
+	return ret;
+}
+
+/**
+ * Reads raw binary data from the device. Unlike es_read_device_data, the
+ * buffer is filled completely and is not terminated with a NULL character, so
+ * NUL bytes coming from the device are kept.
+ *
+ * @param descriptor The device descriptor associated with the connected device.
+ * @param size The number of bytes to read from the device.
+ * @param buffer The buffer where to store the data read from the device.
+ * @param length Output parameter representing the number of bytes read.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_read_device_bytes(
+	struct es_device_descriptor *descriptor,
+	const int size,
+	char *buffer,
+	int *length)
+{
+	/* Perform sanity checks. */
+	if(!length)
+		return ES_FAILURE;
+
+	*length = 0;
+
+	if(!descriptor)
+		return ES_FAILURE;
+
+	if(es_validate_device_descriptor(descriptor) != ES_SUCCESS)
+		return ES_FAILURE;
+
+	if(!buffer)
+		return ES_FAILURE;
+
+	if(size <= 0)
+		return ES_FAILURE;
+
+	/* Read the raw data. */
+	if(es_read_device(descriptor, size, buffer) != ES_SUCCESS) {
+		memset(buffer, 0, size * sizeof(char));
+		return ES_FAILURE;
 	}
 
-	return ret;
+	*length = size;
+
+	return ES_SUCCESS;
+}
+
+/**
+ * Sends a transfer code to the device.
+ *
+ * @param descriptor The device descriptor associated with the connected device.
+ * @param data_transfer_code The transfer code to be sent.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+static const int es_send_device_transfer_code(
+	struct es_device_descriptor *descriptor,
+	const char data_transfer_code)
+{
+	/* Only serial boards understand transfer codes. */
+	if(descriptor->source_type != ES_SERIAL_SOURCE_TYPE)
+		return ES_SUCCESS;
+
+	if(write(descriptor->fd, &data_transfer_code, sizeof(char)) < 0)
+		return ES_FAILURE;
+
+	return ES_SUCCESS;
+}
+
+/**
+ * Asks the device to stream data continuously, so that following reads do not
+ * pay the start/stop transfer round trip. Does nothing if the device is
+ * already streaming.
+ *
+ * @param descriptor The device descriptor associated with the connected device.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_start_device_stream(struct es_device_descriptor *descriptor)
+{
+	/* Perform sanity checks. */
+	if(es_validate_device_descriptor(descriptor) != ES_SUCCESS)
+		return ES_FAILURE;
+
+	if(descriptor->streaming)
+		return ES_SUCCESS;
+
+	/* Begin the data transfer by sending the start transfer code. */
+	if(es_send_device_transfer_code(
+			descriptor,
+			ES_SERIAL_START_TRANSFER_CODE) != ES_SUCCESS)
+		return ES_FAILURE;
+
+	descriptor->streaming = TRUE;
+
+	return ES_SUCCESS;
+}
+
+/**
+ * Asks the device to stop streaming data. Does nothing if the device is not
+ * streaming.
+ *
+ * @param descriptor The device descriptor associated with the connected device.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_stop_device_stream(struct es_device_descriptor *descriptor)
+{
+	/* Perform sanity checks. */
+	if(es_validate_device_descriptor(descriptor) != ES_SUCCESS)
+		return ES_FAILURE;
+
+	if(!descriptor->streaming)
+		return ES_SUCCESS;
+
+	/* Stop the data transfer by sending the end transfer code. */
+	if(es_send_device_transfer_code(
+			descriptor,
+			ES_SERIAL_STOP_TRANSFER_CODE) != ES_SUCCESS)
+		return ES_FAILURE;
+
+	descriptor->streaming = FALSE;
+
+	return ES_SUCCESS;
 }
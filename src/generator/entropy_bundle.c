@@ -33,6 +33,9 @@
 #include <device/descriptor.h>
 #include <device/serial_driver.h>
 #include <pool/entropy_pool.h>
+#include <generator/entropy_ring.h>
+#include <generator/entropy_health.h>
+#include <generator/entropy_score.h>
 
 /**
  * Allocates memory for an entropy bundle.
@@ -45,14 +48,16 @@ struct es_entropy_bundle* es_alloc_entropy_bundle(void)
 	struct es_entropy_bundle *bundle = NULL;
 
 	/* Allocate memory for the entropy bundle structure. */
-	bundle = (struct es_entropy_bundle*)malloc(
+	bundle = (struct es_entropy_bundle*)calloc(
+		1,
 		sizeof(struct es_entropy_bundle));
 
 	return bundle;
 }
 
 /**
- * Frees the memory used by an entropy bundle.
+ * Frees the memory used by an entropy bundle. The health test state and the
+ * score of the entropy bundle are freed as well.
  *
  * @param bundle The entropy bundle to be freed.
  */
@@ -62,6 +67,10 @@ void es_free_entropy_bundle(struct es_entropy_bundle **bundle)
 	if(!bundle || !(*bundle))
 		return;
 
+	/* Free the health test state & the score. */
+	es_destroy_entropy_health(&(*bundle)->health);
+	es_destroy_entropy_score(&(*bundle)->score);
+
 	/* Free the entropy bundle structure. */
 	free(*bundle);
 	*bundle = NULL;
@@ -99,6 +108,21 @@ const int es_init_entropy_bundle(
 	/* Initialize the structure fields with their default values. */
 	bundle->pool = pool;
 	bundle->descriptor = descriptor;
+	bundle->ring = NULL;
+	bundle->staging = NULL;
+	bundle->source_count = 0;
+
+	/* Create the health test state of the device stream. */
+	es_destroy_entropy_health(&bundle->health);
+	bundle->health = es_create_entropy_health(ES_DEFAULT_HEALTH_MIN_ENTROPY);
+	if(!bundle->health)
+		return ES_FAILURE;
+
+	/* Create the score of the device. */
+	es_destroy_entropy_score(&bundle->score);
+	bundle->score = es_create_entropy_score();
+	if(!bundle->score)
+		return ES_FAILURE;
 
 	return ES_SUCCESS;
 }
@@ -151,6 +175,53 @@ exit:
 	return bundle;
 }
 
+/**
+ * Creates a mixing entropy bundle. A mixing entropy bundle has no device of its
+ * own and draws its readings from the ring buffers of several devices.
+ *
+ * @param pool The entropy pool associated with the entropy bundle.
+ * @return The address of a newly allocated entropy bundle if the operation was
+ * successfull, NULL otherwise.
+ */
+struct es_entropy_bundle* es_create_entropy_mixing_bundle(
+	struct es_entropy_pool *pool)
+{
+	int status = ES_FAILURE;
+	struct es_entropy_bundle *bundle = NULL;
+
+	/* Perform sanity checks. */
+	if(!pool)
+		goto exit;
+
+	if(es_validate_entropy_pool(pool) != ES_SUCCESS)
+		goto exit;
+
+	/* Allocate memory for the new entropy bundle. */
+	bundle = es_alloc_entropy_bundle();
+	if(!bundle)
+		goto exit;
+
+	/* Initialize the entropy bundle fields, leaving it without a device. */
+	bundle->pool = pool;
+	bundle->health = es_create_entropy_health(ES_DEFAULT_HEALTH_MIN_ENTROPY);
+	if(!bundle->health)
+		goto exit;
+
+	bundle->score = es_create_entropy_score();
+	if(!bundle->score)
+		goto exit;
+
+	/* Update the operation status. */
+	status = ES_SUCCESS;
+
+exit:
+	/* If the operation failed, destroy the partially created entropy bundle. */
+	if(status == ES_FAILURE && bundle)
+		es_destroy_entropy_bundle(&bundle);
+
+	return bundle;
+}
+
 /**
  * Destroys an entropy bundle.
  *
@@ -178,14 +249,84 @@ const int es_validate_entropy_bundle(struct es_entropy_bundle *bundle)
 	if(!bundle->pool)
 		return ES_FAILURE;
 
-	if(!bundle->descriptor)
+	if(bundle->source_count < 0
+			|| bundle->source_count > ES_MAXIMUM_MIXING_SOURCE_COUNT)
+		return ES_FAILURE;
+
+	if(es_validate_entropy_health(bundle->health) != ES_SUCCESS)
+		return ES_FAILURE;
+
+	if(es_validate_entropy_score(bundle->score) != ES_SUCCESS)
 		return ES_FAILURE;
 
 	if(es_validate_entropy_pool(bundle->pool) != ES_SUCCESS)
 		return ES_FAILURE;
 
-	if(es_validate_device_descriptor(bundle->descriptor) != ES_SUCCESS)
+	/* Mixing entropy bundles have no device of their own. */
+	if(bundle->descriptor
+			&& es_validate_device_descriptor(bundle->descriptor) != ES_SUCCESS)
+		return ES_FAILURE;
+
+	return ES_SUCCESS;
+}
+
+/**
+ * Attaches a ring buffer to an entropy bundle. Once attached, device readings
+ * are taken from the ring instead of the device.
+ *
+ * @param bundle The entropy bundle to which the ring buffer will be attached.
+ * @param ring The ring buffer to be attached, or NULL to detach the current
+ * one.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_set_entropy_bundle_ring(
+	struct es_entropy_bundle *bundle,
+	struct es_entropy_ring *ring)
+{
+	/* Perform sanity checks. */
+	if(!bundle)
+		return ES_FAILURE;
+
+	if(ring && es_validate_entropy_ring(ring) != ES_SUCCESS)
 		return ES_FAILURE;
 
+	/* Attach the ring buffer. */
+	bundle->ring = ring;
+
+	return ES_SUCCESS;
+}
+
+/**
+ * Sets the ring buffers a mixing entropy bundle draws from.
+ *
+ * @param bundle The mixing entropy bundle.
+ * @param sources The ring buffers to draw from.
+ * @param count The number of ring buffers, at most
+ * ES_MAXIMUM_MIXING_SOURCE_COUNT, or zero to detach the current ones.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_set_entropy_bundle_sources(
+	struct es_entropy_bundle *bundle,
+	struct es_entropy_ring **sources,
+	const int count)
+{
+	int i;
+
+	/* Perform sanity checks. */
+	if(!bundle || bundle->descriptor)
+		return ES_FAILURE;
+
+	if(count < 0 || count > ES_MAXIMUM_MIXING_SOURCE_COUNT)
+		return ES_FAILURE;
+
+	if(count > 0 && !sources)
+		return ES_FAILURE;
+
+	/* Attach the ring buffers. */
+	for(i = 0; i < count; ++i)
+		bundle->sources[i] = sources[i];
+
+	bundle->source_count = count;
+
 	return ES_SUCCESS;
 }
@@ -0,0 +1,754 @@
+/**
+ * Copyright (c) 2016, Codrin-Victor Poienaru <cvpoienaru@gmail.com>.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * This software is provided by the copyright holders and contributors "as is"
+ * and any express or implied warranties, including, but not limited to, the
+ * implied warranties of merchantability and fitness for a particular purpose
+ * are disclaimed. In no event shall the copyright holder or contributors be
+ * liable for any direct, indirect, incidental, special, exemplary, or
+ * consequential damages (including, but not limited to, procurement of
+ * substitute goods or services; loss of use, data, or profits; or business
+ * interruption) however caused and on any theory of liability, whether in
+ * contract, strict liability, or tort (including negligence or otherwise)
+ * arising in any way out of the use of this software, even if advised of the
+ * possibility of such damage.
+ */
+
+#include <generator/entropy_conditioner.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include <global/defs.h>
+#include <global/math_defs.h>
+#include <global/thread_policy.h>
+#include <generator/entropy_bundle.h>
+#include <generator/entropy_generator.h>
+#include <generator/entropy_ring.h>
+#include <pool/entropy_block.h>
+#include <pool/entropy_pool.h>
+
+/**
+ * Selects the entropy bundles a conditioning worker consumes next. The bundles
+ * whose rings hold the most raw bytes are preferred, and the search start
+ * rotates between calls so that ties are spread across the devices. Either as
+ * many bundles as requested (or every bundle, if fewer feed the conditioner)
+ * holding raw bytes are selected, or none is. The selected sources are marked
+ * as used until they are released.
+ *
+ * @param conditioner The conditioner owning the entropy bundles.
+ * @param selected Output parameter holding the selected sources.
+ * @param count The number of sources to select.
+ * @return The number of selected sources.
+ */
+static const int es_acquire_conditioning_sources(
+	struct es_entropy_conditioner *conditioner,
+	struct es_conditioning_source **selected,
+	const int count)
+{
+	int i;
+	int j;
+	int length;
+	int best_length;
+	int source_count = 0;
+	int selected_count = 0;
+	unsigned int start;
+	struct es_conditioning_source *source = NULL;
+	struct es_conditioning_source *best = NULL;
+
+	pthread_mutex_lock(&conditioner->mutex);
+
+	start = conditioner->next_source++;
+	for(i = 0; i < conditioner->source_count; ++i) {
+		if(!conditioner->sources[i]->removing)
+			++source_count;
+	}
+
+	while(selected_count < count) {
+		best = NULL;
+		best_length = 0;
+
+		for(i = 0; i < conditioner->source_count; ++i) {
+			source = conditioner->sources[
+				(start + i) % conditioner->source_count];
+			if(source->removing)
+				continue;
+
+			/* Skip the sources already selected. */
+			for(j = 0; j < selected_count; ++j) {
+				if(selected[j] == source)
+					break;
+			}
+
+			if(j < selected_count)
+				continue;
+
+			length = es_get_entropy_ring_length(source->ring);
+			if(length > best_length) {
+				best_length = length;
+				best = source;
+			}
+		}
+
+		if(!best)
+			break;
+
+		selected[selected_count++] = best;
+	}
+
+	/* Give up unless enough distinct sources hold raw bytes. */
+	if(selected_count == 0 || selected_count < es_min(count, source_count))
+		selected_count = 0;
+
+	for(i = 0; i < selected_count; ++i)
+		++selected[i]->users;
+
+	pthread_mutex_unlock(&conditioner->mutex);
+
+	return selected_count;
+}
+
+/**
+ * Releases the sources acquired by a conditioning worker.
+ *
+ * @param conditioner The conditioner owning the sources.
+ * @param sources The sources to be released.
+ * @param count The number of sources.
+ */
+static void es_release_conditioning_sources(
+	struct es_entropy_conditioner *conditioner,
+	struct es_conditioning_source **sources,
+	const int count)
+{
+	int i;
+
+	pthread_mutex_lock(&conditioner->mutex);
+	for(i = 0; i < count; ++i) {
+		if(--sources[i]->users == 0)
+			pthread_cond_broadcast(&conditioner->released);
+	}
+	pthread_mutex_unlock(&conditioner->mutex);
+}
+
+/**
+ * Cleans a batch of dirty blocks with input interleaved from the rings of the
+ * specified sources, through the mixing entropy bundle of a worker.
+ *
+ * @param bundle The mixing entropy bundle of the worker.
+ * @param sources The sources to draw input from.
+ * @param count The number of sources.
+ * @param spill_block The scratch entropy block used to feed the spill tier, or
+ * NULL.
+ * @return ES_SUCCESS if some work was done, ES_FAILURE otherwise.
+ */
+static const int es_clean_mixed_entropy_pool_batch(
+	struct es_entropy_bundle *bundle,
+	struct es_conditioning_source **sources,
+	const int count,
+	struct es_entropy_block *spill_block)
+{
+	int i;
+	int status;
+	struct es_entropy_ring *rings[ES_MAXIMUM_MIXING_SOURCE_COUNT];
+
+	for(i = 0; i < count; ++i)
+		rings[i] = sources[i]->ring;
+
+	if(es_set_entropy_bundle_sources(bundle, rings, count) != ES_SUCCESS)
+		return ES_FAILURE;
+
+	status = es_clean_entropy_pool_batch(bundle, spill_block);
+	es_set_entropy_bundle_sources(bundle, NULL, 0);
+
+	return status;
+}
+
+/**
+ * Runs a conditioning worker until the conditioner is stopped.
+ *
+ * @param arg The conditioner owning the worker.
+ * @return NULL.
+ */
+static void* es_run_conditioning_worker(void *arg)
+{
+	int count;
+	int status;
+	struct es_entropy_conditioner *conditioner =
+		(struct es_entropy_conditioner*)arg;
+	struct es_conditioning_source *sources[ES_MAXIMUM_MIXING_SOURCE_COUNT];
+	struct es_entropy_bundle *mixing_bundle = NULL;
+	struct es_entropy_block *spill_block = NULL;
+
+	/*
+	 * If blocks draw input from several devices, create the mixing bundle
+	 * interleaving the device rings.
+	 */
+	if(conditioner->mix_count > 1) {
+		mixing_bundle = es_create_entropy_mixing_bundle(conditioner->pool);
+		if(!mixing_bundle)
+			return NULL;
+	}
+
+	/*
+	 * If the pool has a spill tier, create a scratch block used to condition
+	 * device data while every block in the pool is clean.
+	 */
+	spill_block = es_create_entropy_spill_block(conditioner->pool);
+
+	while(__atomic_load_n(&conditioner->runnable, __ATOMIC_RELAXED)) {
+		count = es_acquire_conditioning_sources(
+			conditioner,
+			sources,
+			conditioner->mix_count);
+		if(count > 0) {
+			status = mixing_bundle
+				? es_clean_mixed_entropy_pool_batch(
+					mixing_bundle,
+					sources,
+					count,
+					spill_block)
+				: es_clean_entropy_pool_batch(sources[0]->bundle, spill_block);
+			es_release_conditioning_sources(conditioner, sources, count);
+
+			if(status == ES_SUCCESS)
+				continue;
+		}
+
+		/* Wait for device data or for some dirty blocks. */
+		usleep(ES_CONDITIONING_WORKER_SLEEP);
+	}
+
+	/* Destroy the scratch block & the mixing bundle. */
+	if(spill_block)
+		es_destroy_entropy_block(&spill_block);
+
+	if(mixing_bundle)
+		es_destroy_entropy_bundle(&mixing_bundle);
+
+	return NULL;
+}
+
+/**
+ * Allocates memory for a conditioner.
+ *
+ * @param worker_count The number of conditioning workers.
+ * @return The address of a newly allocated conditioner if the operation was
+ * successfull, NULL otherwise.
+ */
+struct es_entropy_conditioner* es_alloc_entropy_conditioner(
+	const int worker_count)
+{
+	int status = ES_FAILURE;
+	struct es_entropy_conditioner *conditioner = NULL;
+
+	/* Perform sanity checks. */
+	if(worker_count <= 0 || worker_count > ES_MAXIMUM_CONDITIONING_WORKER_COUNT)
+		goto exit;
+
+	/* Allocate memory for the conditioner structure. */
+	conditioner = (struct es_entropy_conditioner*)calloc(
+		1,
+		sizeof(struct es_entropy_conditioner));
+	if(!conditioner)
+		goto exit;
+
+	conditioner->worker_count = worker_count;
+
+	/* Initialize the underlying synchronization primitives. */
+	if(pthread_mutex_init(&conditioner->mutex, NULL))
+		goto exit;
+
+	if(pthread_cond_init(&conditioner->released, NULL))
+		goto exit;
+
+	/* Allocate memory for the internal arrays. */
+	conditioner->sources = (struct es_conditioning_source**)calloc(
+		ES_MAXIMUM_CONDITIONING_SOURCE_COUNT,
+		sizeof(struct es_conditioning_source*));
+	if(!conditioner->sources)
+		goto exit;
+
+	conditioner->workers = (pthread_t*)calloc(worker_count, sizeof(pthread_t));
+	if(!conditioner->workers)
+		goto exit;
+
+	/* Update the operation status. */
+	status = ES_SUCCESS;
+
+exit:
+	/* If the operation failed, free the partially allocated conditioner. */
+	if(status == ES_FAILURE && conditioner)
+		es_free_entropy_conditioner(&conditioner);
+
+	return conditioner;
+}
+
+/**
+ * Frees the memory used by a conditioner. The ring buffers are detached from
+ * their entropy bundles and destroyed.
+ *
+ * @param conditioner The conditioner to be freed.
+ */
+void es_free_entropy_conditioner(struct es_entropy_conditioner **conditioner)
+{
+	int i;
+	struct es_conditioning_source *source = NULL;
+
+	/* Perform sanity checks. */
+	if(!conditioner || !(*conditioner))
+		return;
+
+	/* Detach & destroy the ring buffers. */
+	for(i = 0; i < (*conditioner)->source_count; ++i) {
+		source = (*conditioner)->sources[i];
+
+		es_set_entropy_bundle_ring(source->bundle, NULL);
+		es_destroy_entropy_ring(&source->ring);
+		free(source);
+	}
+
+	/* Free the internal arrays. */
+	free((*conditioner)->sources);
+	free((*conditioner)->workers);
+
+	/* Destroy the synchronization primitives of the current conditioner. */
+	pthread_cond_destroy(&(*conditioner)->released);
+	pthread_mutex_destroy(&(*conditioner)->mutex);
+
+	/* Free the conditioner structure. */
+	free(*conditioner);
+	*conditioner = NULL;
+}
+
+/**
+ * Initializes a conditioner with no entropy bundles.
+ *
+ * @param conditioner The conditioner to be initialized.
+ * @param pool The entropy pool fed by the conditioner.
+ * @param ring_size The size in bytes of every ring buffer.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_init_entropy_conditioner(
+	struct es_entropy_conditioner *conditioner,
+	struct es_entropy_pool *pool,
+	const int ring_size)
+{
+	/* Perform sanity checks. */
+	if(!conditioner)
+		return ES_FAILURE;
+
+	if(es_validate_entropy_pool(pool) != ES_SUCCESS)
+		return ES_FAILURE;
+
+	if(ring_size <= 0)
+		return ES_FAILURE;
+
+	/* Initialize the structure fields with their default values. */
+	conditioner->pool = pool;
+	conditioner->source_count = 0;
+	conditioner->ring_size = ring_size;
+	conditioner->mix_count = 1;
+	conditioner->policy = NULL;
+	conditioner->started_count = 0;
+	conditioner->next_source = 0;
+	conditioner->runnable = FALSE;
+
+	return ES_SUCCESS;
+}
+
+/**
+ * Creates a conditioner.
+ *
+ * @param pool The entropy pool fed by the conditioner.
+ * @param worker_count The number of conditioning workers, between 1 and
+ * ES_MAXIMUM_CONDITIONING_WORKER_COUNT.
+ * @param ring_size The size in bytes of every ring buffer.
+ * @return The address of a newly allocated conditioner if the operation was
+ * successfull, NULL otherwise.
+ */
+struct es_entropy_conditioner* es_create_entropy_conditioner(
+	struct es_entropy_pool *pool,
+	const int worker_count,
+	const int ring_size)
+{
+	int status = ES_FAILURE;
+	struct es_entropy_conditioner *conditioner = NULL;
+
+	/* Allocate memory for the new conditioner. */
+	conditioner = es_alloc_entropy_conditioner(worker_count);
+	if(!conditioner)
+		goto exit;
+
+	/* Initialize the conditioner fields with their default values. */
+	if(es_init_entropy_conditioner(
+			conditioner,
+			pool,
+			ring_size) != ES_SUCCESS)
+		goto exit;
+
+	/* Update the operation status. */
+	status = ES_SUCCESS;
+
+exit:
+	/* If the operation failed, destroy the partially created conditioner. */
+	if(status == ES_FAILURE && conditioner)
+		es_destroy_entropy_conditioner(&conditioner);
+
+	return conditioner;
+}
+
+/**
+ * Destroys a conditioner. The conditioning workers must be stopped first.
+ *
+ * @param conditioner The conditioner to be destroyed.
+ */
+void es_destroy_entropy_conditioner(
+	struct es_entropy_conditioner **conditioner)
+{
+	/* Free the given conditioner. */
+	es_free_entropy_conditioner(conditioner);
+}
+
+/**
+ * Validates a conditioner.
+ *
+ * @param conditioner The conditioner to be validated.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_validate_entropy_conditioner(
+	struct es_entropy_conditioner *conditioner)
+{
+	/* Perform sanity checks. */
+	if(!conditioner)
+		return ES_FAILURE;
+
+	/* Perform field validation. */
+	if(!conditioner->pool || !conditioner->sources || !conditioner->workers)
+		return ES_FAILURE;
+
+	if(conditioner->source_count < 0
+			|| conditioner->source_count > ES_MAXIMUM_CONDITIONING_SOURCE_COUNT)
+		return ES_FAILURE;
+
+	if(conditioner->worker_count <= 0 || conditioner->ring_size <= 0)
+		return ES_FAILURE;
+
+	if(conditioner->mix_count <= 0
+			|| conditioner->mix_count > ES_MAXIMUM_MIXING_SOURCE_COUNT)
+		return ES_FAILURE;
+
+	return ES_SUCCESS;
+}
+
+/**
+ * Adds an entropy bundle to a conditioner. A ring buffer is created and
+ * attached to the bundle, so the device reader thread of the bundle must be
+ * started afterwards.
+ *
+ * @param conditioner The conditioner to be fed by the entropy bundle.
+ * @param bundle The entropy bundle to be added.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_add_entropy_conditioner_bundle(
+	struct es_entropy_conditioner *conditioner,
+	struct es_entropy_bundle *bundle)
+{
+	int ret = ES_FAILURE;
+	struct es_entropy_ring *ring = NULL;
+	struct es_conditioning_source *source = NULL;
+
+	/* Perform sanity checks. */
+	if(es_validate_entropy_conditioner(conditioner) != ES_SUCCESS)
+		return ES_FAILURE;
+
+	if(es_validate_entropy_bundle(bundle) != ES_SUCCESS)
+		return ES_FAILURE;
+
+	if(bundle->pool != conditioner->pool || bundle->ring || !bundle->descriptor)
+		return ES_FAILURE;
+
+	/* Create the source & the ring buffer. */
+	source = (struct es_conditioning_source*)calloc(
+		1,
+		sizeof(struct es_conditioning_source));
+	if(!source)
+		return ES_FAILURE;
+
+	ring = es_create_entropy_ring(conditioner->ring_size);
+	if(!ring) {
+		free(source);
+		return ES_FAILURE;
+	}
+
+	/* Attach the ring buffer. */
+	pthread_mutex_lock(&conditioner->mutex);
+	if(conditioner->source_count == ES_MAXIMUM_CONDITIONING_SOURCE_COUNT)
+		goto exit;
+
+	if(es_set_entropy_bundle_ring(bundle, ring) != ES_SUCCESS)
+		goto exit;
+
+	source->bundle = bundle;
+	source->ring = ring;
+	source->users = 0;
+	source->removing = FALSE;
+	conditioner->sources[conditioner->source_count++] = source;
+
+	/* Update the operation status. */
+	ret = ES_SUCCESS;
+
+exit:
+	pthread_mutex_unlock(&conditioner->mutex);
+
+	if(ret != ES_SUCCESS) {
+		es_destroy_entropy_ring(&ring);
+		free(source);
+	}
+
+	return ret;
+}
+
+/**
+ * Removes an entropy bundle from a conditioner. The device reader thread of the
+ * bundle must be stopped first. Waits until no worker consumes the ring of the
+ * bundle, then detaches and destroys the ring.
+ *
+ * @param conditioner The conditioner fed by the entropy bundle.
+ * @param bundle The entropy bundle to be removed.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_remove_entropy_conditioner_bundle(
+	struct es_entropy_conditioner *conditioner,
+	struct es_entropy_bundle *bundle)
+{
+	int i;
+	struct es_conditioning_source *source = NULL;
+
+	/* Perform sanity checks. */
+	if(es_validate_entropy_conditioner(conditioner) != ES_SUCCESS)
+		return ES_FAILURE;
+
+	if(!bundle)
+		return ES_FAILURE;
+
+	pthread_mutex_lock(&conditioner->mutex);
+
+	for(i = 0; i < conditioner->source_count; ++i) {
+		if(conditioner->sources[i]->bundle == bundle)
+			break;
+	}
+
+	if(i == conditioner->source_count || conditioner->sources[i]->removing) {
+		pthread_mutex_unlock(&conditioner->mutex);
+		return ES_FAILURE;
+	}
+
+	/* Keep new workers away and wait for the current ones to finish. */
+	source = conditioner->sources[i];
+	source->removing = TRUE;
+	while(source->users > 0)
+		pthread_cond_wait(&conditioner->released, &conditioner->mutex);
+
+	/* Detach & destroy the ring buffer. */
+	es_set_entropy_bundle_ring(bundle, NULL);
+	es_destroy_entropy_ring(&source->ring);
+	free(source);
+
+	/*
+	 * Fill the hole with the last source. Only the pointer moves, so the
+	 * workers holding the last source keep releasing the right one.
+	 */
+	conditioner->sources[i] = conditioner->sources[--conditioner->source_count];
+	conditioner->sources[conditioner->source_count] = NULL;
+
+	pthread_mutex_unlock(&conditioner->mutex);
+
+	return ES_SUCCESS;
+}
+
+/**
+ * Sets the number of distinct entropy bundles every block draws input from.
+ * While fewer bundles feed the conditioner, blocks draw input from all of them.
+ * Must be called before the conditioning workers are started.
+ *
+ * @param conditioner The conditioner to be updated.
+ * @param mix_count The number of entropy bundles, between 1 and
+ * ES_MAXIMUM_MIXING_SOURCE_COUNT.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_set_entropy_conditioner_mix_count(
+	struct es_entropy_conditioner *conditioner,
+	const int mix_count)
+{
+	/* Perform sanity checks. */
+	if(es_validate_entropy_conditioner(conditioner) != ES_SUCCESS)
+		return ES_FAILURE;
+
+	if(mix_count <= 0 || mix_count > ES_MAXIMUM_MIXING_SOURCE_COUNT)
+		return ES_FAILURE;
+
+	if(conditioner->started_count > 0)
+		return ES_FAILURE;
+
+	conditioner->mix_count = mix_count;
+
+	return ES_SUCCESS;
+}
+
+/**
+ * Sets the placement and scheduling applied to the conditioning workers. Must
+ * be called before the conditioning workers are started.
+ *
+ * @param conditioner The conditioner to be updated.
+ * @param policy The thread policy to be applied, or NULL to leave the workers
+ * untouched. The policy must outlive the conditioner.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_set_entropy_conditioner_thread_policy(
+	struct es_entropy_conditioner *conditioner,
+	struct es_thread_policy *policy)
+{
+	/* Perform sanity checks. */
+	if(es_validate_entropy_conditioner(conditioner) != ES_SUCCESS)
+		return ES_FAILURE;
+
+	if(policy && es_validate_thread_policy(policy) != ES_SUCCESS)
+		return ES_FAILURE;
+
+	if(conditioner->started_count > 0)
+		return ES_FAILURE;
+
+	conditioner->policy = policy;
+
+	return ES_SUCCESS;
+}
+
+/**
+ * Gets the CPU time consumed by a conditioning worker.
+ *
+ * @param conditioner The conditioner owning the worker.
+ * @param index The index of the worker, lower than the number of started
+ * workers.
+ * @param cpu_time Output parameter holding the CPU time in nanoseconds.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_get_entropy_conditioner_worker_cpu_time(
+	struct es_entropy_conditioner *conditioner,
+	const int index,
+	unsigned long *cpu_time)
+{
+	/* Perform sanity checks. */
+	if(es_validate_entropy_conditioner(conditioner) != ES_SUCCESS)
+		return ES_FAILURE;
+
+	if(index < 0 || index >= conditioner->started_count)
+		return ES_FAILURE;
+
+	return es_get_thread_cpu_time(conditioner->workers[index], cpu_time);
+}
+
+/**
+ * Starts the conditioning workers.
+ *
+ * @param conditioner The conditioner whose workers will be started.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_start_entropy_conditioner(
+	struct es_entropy_conditioner *conditioner)
+{
+	int applied;
+
+	/* Perform sanity checks. */
+	if(es_validate_entropy_conditioner(conditioner) != ES_SUCCESS)
+		return ES_FAILURE;
+
+	if(conditioner->started_count > 0)
+		return ES_FAILURE;
+
+	conditioner->runnable = TRUE;
+
+	/* Start the conditioning workers. */
+	while(conditioner->started_count < conditioner->worker_count) {
+		if(es_create_policy_thread(
+				conditioner->policy,
+				&conditioner->workers[conditioner->started_count],
+				es_run_conditioning_worker,
+				conditioner,
+				&applied) != ES_SUCCESS) {
+			/* Stop the workers started so far. */
+			es_stop_entropy_conditioner(conditioner);
+			es_join_entropy_conditioner(conditioner);
+			return ES_FAILURE;
+		}
+
+		/* A worker running unpinned is only slower, so keep it running. */
+		if(!applied && ES_DEBUG) {
+			printf(
+				"Cannot apply the thread policy to conditioning worker %d\n",
+				conditioner->started_count);
+		}
+
+		++conditioner->started_count;
+	}
+
+	if(ES_DEBUG) {
+		printf(
+			"Started %d conditioning workers\n",
+			conditioner->worker_count);
+	}
+
+	return ES_SUCCESS;
+}
+
+/**
+ * Asks the conditioning workers to stop. Only sets a flag, so it can be called
+ * from a signal handler.
+ *
+ * @param conditioner The conditioner whose workers will be stopped.
+ */
+void es_stop_entropy_conditioner(struct es_entropy_conditioner *conditioner)
+{
+	/* Perform sanity checks. */
+	if(!conditioner)
+		return;
+
+	__atomic_store_n(&conditioner->runnable, FALSE, __ATOMIC_RELAXED);
+}
+
+/**
+ * Waits for the conditioning workers to stop.
+ *
+ * @param conditioner The conditioner whose workers will be joined.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_join_entropy_conditioner(
+	struct es_entropy_conditioner *conditioner)
+{
+	int ret = ES_SUCCESS;
+
+	/* Perform sanity checks. */
+	if(!conditioner)
+		return ES_FAILURE;
+
+	while(conditioner->started_count > 0) {
+		if(pthread_join(
+				conditioner->workers[--conditioner->started_count],
+				NULL))
+			ret = ES_FAILURE;
+	}
+
+	return ret;
+}
@@ -0,0 +1,319 @@
+/**
+ * Copyright (c) 2016, Codrin-Victor Poienaru <cvpoienaru@gmail.com>.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * This software is provided by the copyright holders and contributors "as is"
+ * and any express or implied warranties, including, but not limited to, the
+ * implied warranties of merchantability and fitness for a particular purpose
+ * are disclaimed. In no event shall the copyright holder or contributors be
+ * liable for any direct, indirect, incidental, special, exemplary, or
+ * consequential damages (including, but not limited to, procurement of
+ * substitute goods or services; loss of use, data, or profits; or business
+ * interruption) however caused and on any theory of liability, whether in
+ * contract, strict liability, or tort (including negligence or otherwise)
+ * arising in any way out of the use of this software, even if advised of the
+ * possibility of such damage.
+ */
+
+#include <generator/entropy_drbg.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#include <global/defs.h>
+#include <global/memory.h>
+#include <crypto/hmac_drbg.h>
+#include <generator/entropy_generator.h>
+#include <pool/entropy_pool.h>
+
+/**
+ * Gets the current monotonic time in seconds.
+ *
+ * @return The current monotonic time in seconds.
+ */
+static const long es_get_entropy_drbg_time(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (long)now.tv_sec;
+}
+
+/**
+ * Gathers fresh seed material from the entropy pool and instantiates or
+ * reseeds the DRBG with it. Must be called with the tier mutex held.
+ *
+ * @param tier The DRBG tier to be reseeded.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+static const int es_reseed_entropy_drbg(struct es_entropy_drbg *tier)
+{
+	int ret = ES_FAILURE;
+	int offset = 0;
+	int length = 0;
+	char seed[ES_ENTROPY_DRBG_SEED_SIZE];
+
+	/* Consume clean entropy blocks until enough seed material is gathered. */
+	while(offset < ES_ENTROPY_DRBG_SEED_SIZE) {
+		if(es_consume_entropy_block_into(
+				tier->pool,
+				seed + offset,
+				ES_ENTROPY_DRBG_SEED_SIZE - offset,
+				&length) != ES_SUCCESS)
+			goto exit;
+
+		offset += length;
+	}
+
+	if(tier->drbg->instantiated) {
+		if(es_reseed_hmac_drbg(
+				tier->drbg,
+				seed,
+				ES_ENTROPY_DRBG_SEED_SIZE) != ES_SUCCESS)
+			goto exit;
+	} else {
+		if(es_instantiate_hmac_drbg(
+				tier->drbg,
+				seed,
+				ES_ENTROPY_DRBG_SEED_SIZE) != ES_SUCCESS)
+			goto exit;
+	}
+
+	/* Restart the reseed intervals. */
+	tier->generated_bytes = 0;
+	tier->last_reseed = es_get_entropy_drbg_time();
+
+	/* Update the operation status. */
+	ret = ES_SUCCESS;
+
+exit:
+	/* Wipe the seed material. */
+	es_wipe_memory(seed, ES_ENTROPY_DRBG_SEED_SIZE);
+
+	return ret;
+}
+
+/**
+ * Allocates memory for a DRBG tier.
+ *
+ * @return The address of a newly allocated DRBG tier if the operation was
+ * successfull, NULL otherwise.
+ */
+struct es_entropy_drbg* es_alloc_entropy_drbg(void)
+{
+	int status = ES_FAILURE;
+	struct es_entropy_drbg *tier = NULL;
+
+	/* Allocate memory for the DRBG tier structure. */
+	tier = (struct es_entropy_drbg*)calloc(1, sizeof(struct es_entropy_drbg));
+	if(!tier)
+		goto exit;
+
+	/* Create the underlying DRBG. */
+	tier->drbg = es_create_hmac_drbg();
+	if(!tier->drbg)
+		goto exit;
+
+	/* Initialize the underlying mutex. */
+	if(pthread_mutex_init(&tier->mutex, NULL))
+		goto exit;
+
+	/* Update the operation status. */
+	status = ES_SUCCESS;
+
+exit:
+	/* If the operation failed, free the partially allocated DRBG tier. */
+	if(status == ES_FAILURE && tier)
+		es_free_entropy_drbg(&tier);
+
+	return tier;
+}
+
+/**
+ * Frees the memory used by a DRBG tier.
+ *
+ * @param tier The DRBG tier to be freed.
+ */
+void es_free_entropy_drbg(struct es_entropy_drbg **tier)
+{
+	/* Perform sanity checks. */
+	if(!tier || !(*tier))
+		return;
+
+	/* Destroy the underlying DRBG, wiping its state. */
+	if((*tier)->drbg)
+		es_destroy_hmac_drbg(&(*tier)->drbg);
+
+	/* Destroy the mutex associated with the current DRBG tier. */
+	pthread_mutex_destroy(&(*tier)->mutex);
+
+	/* Free the DRBG tier structure. */
+	free(*tier);
+	*tier = NULL;
+}
+
+/**
+ * Initializes a DRBG tier with the default values. The DRBG is seeded lazily,
+ * on the first generate request, so that the device threads have time to fill
+ * the entropy pool.
+ *
+ * @param tier The DRBG tier to be initialized.
+ * @param pool The entropy pool used to seed the DRBG.
+ * @param reseed_bytes The number of bytes served between two reseeds.
+ * @param reseed_interval The number of seconds between two reseeds.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_init_entropy_drbg(
+	struct es_entropy_drbg *tier,
+	struct es_entropy_pool *pool,
+	const long reseed_bytes,
+	const long reseed_interval)
+{
+	/* Perform sanity checks. */
+	if(!tier || !pool)
+		return ES_FAILURE;
+
+	if(reseed_bytes <= 0 || reseed_interval <= 0)
+		return ES_FAILURE;
+
+	/* Initialize the DRBG tier. */
+	tier->pool = pool;
+	tier->reseed_bytes = reseed_bytes;
+	tier->reseed_interval = reseed_interval;
+	tier->generated_bytes = 0;
+	tier->last_reseed = 0;
+
+	return ES_SUCCESS;
+}
+
+/**
+ * Creates a DRBG tier.
+ *
+ * @param pool The entropy pool used to seed the DRBG.
+ * @param reseed_bytes The number of bytes served between two reseeds.
+ * @param reseed_interval The number of seconds between two reseeds.
+ * @return The address of a newly allocated DRBG tier if the operation was
+ * successfull, NULL otherwise.
+ */
+struct es_entropy_drbg* es_create_entropy_drbg(
+	struct es_entropy_pool *pool,
+	const long reseed_bytes,
+	const long reseed_interval)
+{
+	int status = ES_FAILURE;
+	struct es_entropy_drbg *tier = NULL;
+
+	/* Allocate memory for the DRBG tier. */
+	tier = es_alloc_entropy_drbg();
+	if(!tier)
+		goto exit;
+
+	/* Initialize the DRBG tier. */
+	if(es_init_entropy_drbg(
+			tier,
+			pool,
+			reseed_bytes,
+			reseed_interval) != ES_SUCCESS)
+		goto exit;
+
+	/* Update the operation status. */
+	status = ES_SUCCESS;
+
+exit:
+	/* If the operation failed, destroy the partially created DRBG tier. */
+	if(status == ES_FAILURE && tier)
+		es_destroy_entropy_drbg(&tier);
+
+	return tier;
+}
+
+/**
+ * Destroys a DRBG tier.
+ *
+ * @param tier The DRBG tier to be destroyed.
+ */
+void es_destroy_entropy_drbg(struct es_entropy_drbg **tier)
+{
+	es_free_entropy_drbg(tier);
+}
+
+/**
+ * Validates a DRBG tier.
+ *
+ * @param tier The DRBG tier to be validated.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_validate_entropy_drbg(struct es_entropy_drbg *tier)
+{
+	/* Perform sanity checks. */
+	if(!tier || !tier->pool)
+		return ES_FAILURE;
+
+	if(es_validate_hmac_drbg(tier->drbg) != ES_SUCCESS)
+		return ES_FAILURE;
+
+	if(tier->reseed_bytes <= 0 || tier->reseed_interval <= 0)
+		return ES_FAILURE;
+
+	return ES_SUCCESS;
+}
+
+/**
+ * Generates bytes from the DRBG tier. The DRBG is reseeded from fresh entropy
+ * pool blocks first if the byte or time reseed interval has elapsed.
+ *
+ * @param tier The DRBG tier used to generate the bytes.
+ * @param buffer The buffer where to write the generated bytes.
+ * @param size The number of bytes to be generated.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_generate_entropy_drbg(
+	struct es_entropy_drbg *tier,
+	char *buffer,
+	const int size)
+{
+	int ret = ES_FAILURE;
+
+	/* Perform sanity checks. */
+	if(es_validate_entropy_drbg(tier) != ES_SUCCESS)
+		return ES_FAILURE;
+
+	if(!buffer || size <= 0)
+		return ES_FAILURE;
+
+	pthread_mutex_lock(&tier->mutex);
+
+	/* Seed the DRBG on first use and whenever a reseed interval elapsed. */
+	if(!tier->drbg->instantiated
+			|| tier->generated_bytes >= tier->reseed_bytes
+			|| es_get_entropy_drbg_time() - tier->last_reseed
+				>= tier->reseed_interval) {
+		if(es_reseed_entropy_drbg(tier) != ES_SUCCESS)
+			goto exit;
+	}
+
+	if(es_generate_hmac_drbg(tier->drbg, buffer, size) != ES_SUCCESS)
+		goto exit;
+
+	tier->generated_bytes += size;
+
+	/* Update the operation status. */
+	ret = ES_SUCCESS;
+
+exit:
+	pthread_mutex_unlock(&tier->mutex);
+
+	return ret;
+}
@@ -31,14 +31,22 @@
 #include <stdio.h>
 #include <string.h>
 #include <unistd.h>
+#include <time.h>
 #include <pthread.h>
 
 #include <global/defs.h>
 #include <global/math_defs.h>
+#include <global/alloc_type.h>
+#include <global/memory.h>
 #include <collections/queue.h>
 #include <generator/entropy_bundle.h>
+#include <generator/entropy_ring.h>
+#include <generator/entropy_health.h>
+#include <generator/entropy_score.h>
 #include <pool/entropy_block.h>
 #include <pool/entropy_pool.h>
+#include <pool/entropy_spill.h>
+#include <pool/entropy_policy.h>
 #include <device/descriptor.h>
 #include <device/serial_driver.h>
 
@@ -98,6 +106,38 @@ int* es_get_dirty_entropy_block_index(struct es_entropy_pool *pool)
 	return es_get_entropy_block_index(pool, ES_DIRTY_BLOCK_STATE);
 }
 
+/**
+ * Gets up to the specified number of dirty entropy block indexes from the dirty
+ * queue, in a single queue operation.
+ *
+ * @param pool The pool from which to extract the dirty block indexes.
+ * @param indexes Output parameter holding the extracted indexes.
+ * @param count The maximum number of indexes to be extracted.
+ * @return The number of extracted indexes.
+ */
+static const int es_get_dirty_entropy_block_indexes(
+	struct es_entropy_pool *pool,
+	int **indexes,
+	const int count)
+{
+	int extracted = 0;
+
+	/* Perform sanity checks. */
+	if(!pool)
+		return extracted;
+
+	if(es_validate_entropy_pool(pool) != ES_SUCCESS)
+		return extracted;
+
+	/* Atomic queue extract operation. */
+	pthread_mutex_lock(&pool->mutex);
+	while(extracted < count && !es_check_queue_is_empty(pool->dirty_queue))
+		indexes[extracted++] = es_pop_queue(pool->dirty_queue);
+	pthread_mutex_unlock(&pool->mutex);
+
+	return extracted;
+}
+
 /**
  * Gets the index of a clean entropy block from the clean queue.
  *
@@ -111,6 +151,72 @@ int* es_get_clean_entropy_block_index(struct es_entropy_pool *pool)
 	return es_get_entropy_block_index(pool, ES_CLEAN_BLOCK_STATE);
 }
 
+/**
+ * Waits until a clean entropy block becomes available and extracts its index
+ * from the clean queue.
+ *
+ * @param pool The pool from where to extract the clean block index.
+ * @return The address of a clean entropy block index.
+ */
+static int* es_wait_clean_entropy_block_index(struct es_entropy_pool *pool)
+{
+	int *index = NULL;
+
+	/*
+	 * Blocking call simulation for clean entropy block extraction.
+	 * At a given point in time it is possible that no clean entropy block is
+	 * available, so we wait until one becomes.
+	 */
+	while(TRUE) {
+		/* Extract a clean entropy block index. */
+		index = es_get_clean_entropy_block_index(pool);
+		if(index)
+			break;
+
+		/* If no such index was found, sleep for a predefined amount of time. */
+		sleep(ES_REQUEST_THREAD_SLEEP);
+	}
+
+	return index;
+}
+
+/**
+ * Returns a consumed entropy block index to the queue matching the state of the
+ * block. A block whose consume operation failed may still be clean, or may be
+ * held by another thread, so it is never destroyed here: its index is queued
+ * where the block will be once it is released.
+ *
+ * @param pool The pool from where the entropy block was consumed.
+ * @param index The index of the consumed entropy block.
+ * @param status The status of the consume operation.
+ */
+static void es_release_consumed_entropy_block_index(
+	struct es_entropy_pool *pool,
+	int *index,
+	const int status)
+{
+	struct es_queue *queue = pool->dirty_queue;
+
+	/* Select the queue matching the current block state. */
+	if(status != ES_SUCCESS) {
+		switch(es_get_entropy_block_state(pool->blocks[*index])) {
+			case ES_CLEAN_BLOCK_STATE:
+			case ES_FILLING_BLOCK_STATE:
+				queue = pool->clean_queue;
+				break;
+
+			default:
+				queue = pool->dirty_queue;
+				break;
+		}
+	}
+
+	/* Atomic queue push operation. */
+	pthread_mutex_lock(&pool->mutex);
+	es_push_queue(queue, index);
+	pthread_mutex_unlock(&pool->mutex);
+}
+
 /**
  * Consumes a clean entropy block.
  *
@@ -134,96 +240,902 @@ const int es_consume_entropy_block(struct es_entropy_pool *pool, char **content)
 	if(es_validate_entropy_pool(pool) != ES_SUCCESS)
 		return ES_FAILURE;
 
+	/* Wait for a clean entropy block. */
+	index = es_wait_clean_entropy_block_index(pool);
+	block = pool->blocks[*index];
+
 	/*
-	 * Blocking call simulation for clean entropy block extraction.
-	 * At a given point in time it is possible that no clean entropy block is
-	 * available, so we wait until one becomes.
+	 * Lock-free entropy block content request operation. The block claim is a
+	 * compare-and-swap on the block state word.
 	 */
-	while(TRUE) {
-		/* Extract a clean entropy block index. */
-		index = es_get_clean_entropy_block_index(pool);
-		if(index)
-			break;
+	status = es_request_entropy_block_content(block, content);
 
-		/* If no such index was found, sleep for a predefined amount of time. */
-		sleep(ES_REQUEST_THREAD_SLEEP);
-	}
+	/* Return the consumed entropy block to the dirty queue. */
+	es_release_consumed_entropy_block_index(pool, index, status);
+
+	return status;
+}
 
+/**
+ * Consumes a clean entropy block directly into the specified buffer. The block
+ * content is read in place from the published half of the block double buffer,
+ * so no intermediate copy is allocated.
+ *
+ * @param pool The pool from where to extract the clean block to be consumed.
+ * @param buffer The buffer where to write the content of the clean entropy
+ * block extracted.
+ * @param size The size of the specified buffer.
+ * @param length The number of entropy bytes written to the buffer.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_consume_entropy_block_into(
+	struct es_entropy_pool *pool,
+	char *buffer,
+	const int size,
+	int *length)
+{
+	int status = ES_FAILURE;
+	int *index = NULL;
+	unsigned long ticket;
+	const char *content = NULL;
+	struct es_entropy_block *block = NULL;
+
+	/* The default length value when exiting should be zero. */
+	*length = 0;
+
+	/* Perform sanity checks. */
+	if(!pool)
+		return ES_FAILURE;
+
+	if(es_validate_entropy_pool(pool) != ES_SUCCESS)
+		return ES_FAILURE;
+
+	if(!buffer)
+		return ES_FAILURE;
+
+	if(size <= 0)
+		return ES_FAILURE;
+
+	/* Wait for a clean entropy block. */
+	index = es_wait_clean_entropy_block_index(pool);
 	block = pool->blocks[*index];
 
-	/* Atomic entropy block content request operation. */
-	pthread_mutex_lock(&block->mutex);
-	status = es_request_entropy_block_content(block, content);
-	pthread_mutex_unlock(&block->mutex);
+	/* Claim the clean entropy block for reading. */
+	if(es_claim_entropy_block(
+			block,
+			ES_CLEAN_BLOCK_STATE,
+			ES_READING_BLOCK_STATE,
+			&ticket) == ES_SUCCESS) {
+		content = es_get_entropy_block_content(block);
+		if(content) {
+			/*
+			 * Write the published raw content straight into the caller buffer.
+			 * The content is binary, so the buffer is not NUL terminated.
+			 */
+			*length = es_min(block->size, size);
+			memcpy(buffer, content, *length);
+		}
 
-	/* Atomic queue push operation. */
-	pthread_mutex_lock(&pool->mutex);
-	if(status != ES_SUCCESS) {
-		/* Something went very wrong ... */
-		if(block)
-			es_destroy_entropy_block(&block);
+		/*
+		 * Change the block state to dirty now that the block content has been
+		 * consumed.
+		 */
+		if(es_release_entropy_block(
+				block,
+				ticket,
+				ES_DIRTY_BLOCK_STATE) == ES_SUCCESS && content)
+			status = ES_SUCCESS;
+	}
+
+	/* Return the consumed entropy block to the dirty queue. */
+	es_release_consumed_entropy_block_index(pool, index, status);
+
+	return status;
+}
 
-		free(index);
-	} else {
-		es_push_queue(pool->dirty_queue, index);
+/**
+ * Reads raw bytes from the device of an entropy bundle. The device is asked to
+ * stream data first, so the read does not pay the start/stop transfer round
+ * trip. If the read fails, the stream is stopped so that the next read starts
+ * a fresh one.
+ *
+ * The bytes are run through the health tests of the device stream before they
+ * are handed out. If a test fails, the bytes are wiped and the device is taken
+ * out of rotation by stopping its thread. Every read is timed and recorded in
+ * the score of the device, and the scheduling weight of the pool is updated.
+ *
+ * @param bundle The entropy bundle associated with the current device thread.
+ * @param size The number of bytes to read from the device.
+ * @param buffer The buffer where to store the data read from the device.
+ * @param length Output parameter representing the number of bytes read.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+static const int es_read_entropy_device_bytes(
+	struct es_entropy_bundle *bundle,
+	const int size,
+	char *buffer,
+	int *length)
+{
+	int ret = ES_FAILURE;
+	int healthy = TRUE;
+	long weight_change;
+	struct timespec read_start;
+	struct timespec read_end;
+
+	*length = 0;
+	clock_gettime(CLOCK_MONOTONIC, &read_start);
+
+	if(es_start_device_stream(bundle->descriptor) != ES_SUCCESS
+			|| es_read_device_bytes(
+				bundle->descriptor,
+				size,
+				buffer,
+				length) != ES_SUCCESS) {
+		es_stop_device_stream(bundle->descriptor);
+		goto exit;
 	}
+
+	/* Run the health tests before any byte is credited to a block. */
+	if(es_test_entropy_health(bundle->health, buffer, *length) != ES_SUCCESS) {
+		es_wipe_memory(buffer, *length);
+		*length = 0;
+		healthy = FALSE;
+
+		es_stop_device_stream(bundle->descriptor);
+		bundle->descriptor->runnable = FALSE;
+
+		if(ES_DEBUG) {
+			printf(
+				"Device health test failure: %s\n",
+				es_get_entropy_health_failure_name(
+					es_get_entropy_health_failure(bundle->health)));
+		}
+
+		goto exit;
+	}
+
+	/* Update the operation status. */
+	ret = ES_SUCCESS;
+
+exit:
+	/* Score the read and publish the weight change to the pool. */
+	clock_gettime(CLOCK_MONOTONIC, &read_end);
+	weight_change = es_record_entropy_score_read(
+		bundle->score,
+		ret,
+		*length,
+		(read_end.tv_sec - read_start.tv_sec) * 1000000000UL
+			+ read_end.tv_nsec - read_start.tv_nsec,
+		healthy);
+	__atomic_add_fetch(
+		&bundle->pool->device_weight,
+		weight_change,
+		__ATOMIC_RELAXED);
+
+	return ret;
+}
+
+/**
+ * Computes the size of the next device read of an entropy bundle, so that the
+ * read takes about ES_READ_TARGET_TIME microseconds at the measured device
+ * throughput.
+ *
+ * @param bundle The entropy bundle associated with the current device thread.
+ * @param size The maximum number of bytes needed by the caller.
+ * @return The number of bytes to read from the device.
+ */
+static const int es_get_entropy_bundle_read_size(
+	struct es_entropy_bundle *bundle,
+	const int size)
+{
+	long read_size;
+
+	read_size = bundle->score->throughput * ES_READ_TARGET_TIME / 1000000L;
+	read_size = es_max(read_size, ES_READ_BUFFER_SIZE);
+	read_size = es_min(read_size, ES_MAXIMUM_READ_SIZE);
+
+	return es_min(read_size, size);
+}
+
+/**
+ * Withdraws the scheduling weight of a device from its pool, once the device
+ * thread stopped.
+ *
+ * @param bundle The entropy bundle associated with the device thread.
+ */
+static void es_withdraw_entropy_bundle_weight(struct es_entropy_bundle *bundle)
+{
+	__atomic_add_fetch(
+		&bundle->pool->device_weight,
+		es_clear_entropy_score_weight(bundle->score),
+		__ATOMIC_RELAXED);
+}
+
+/**
+ * Computes the number of dirty entropy blocks a device thread claims at once,
+ * in proportion to the share of its device in the scheduling weight of the
+ * pool. Device threads feeding conditioning workers and mixing bundles always
+ * claim full batches.
+ *
+ * @param bundle The entropy bundle associated with the current device thread.
+ * @return The number of dirty entropy blocks to claim, between 0 and
+ * ES_CONDITIONING_BATCH_SIZE.
+ */
+static const int es_get_entropy_bundle_quota(struct es_entropy_bundle *bundle)
+{
+	int dirty_count;
+	long weight;
+	long total_weight;
+
+	if(bundle->ring || !bundle->descriptor)
+		return ES_CONDITIONING_BATCH_SIZE;
+
+	weight = es_get_entropy_score_weight(bundle->score);
+	total_weight = __atomic_load_n(
+		&bundle->pool->device_weight,
+		__ATOMIC_RELAXED);
+
+	/* Until some device is measured, claim a single block at a time. */
+	if(total_weight <= 0)
+		return 1;
+
+	/* A lone device claims full batches. */
+	if(weight >= total_weight)
+		return ES_CONDITIONING_BATCH_SIZE;
+
+	pthread_mutex_lock(&bundle->pool->mutex);
+	dirty_count = es_get_queue_length(bundle->pool->dirty_queue);
+	pthread_mutex_unlock(&bundle->pool->mutex);
+
+	return es_min(
+		(dirty_count * weight + total_weight / 2) / total_weight,
+		ES_CONDITIONING_BATCH_SIZE);
+}
+
+/**
+ * Checks whether the clean blocks of an entropy pool reached the device stream
+ * high watermark.
+ *
+ * @param pool The entropy pool to be checked.
+ * @return ES_SUCCESS if the pool is full, ES_FAILURE otherwise.
+ */
+static const int es_check_entropy_pool_full(struct es_entropy_pool *pool)
+{
+	int clean_count;
+
+	pthread_mutex_lock(&pool->mutex);
+	clean_count = es_get_queue_length(pool->clean_queue);
 	pthread_mutex_unlock(&pool->mutex);
 
-	return status;
+	if(clean_count * 100 < pool->size * ES_DEVICE_STREAM_HIGH_WATERMARK)
+		return ES_FAILURE;
+
+	return ES_SUCCESS;
+}
+
+/**
+ * Reads raw bytes for a mixing entropy bundle. Every source contributes a slice
+ * in proportion to the raw bytes its ring holds, so that a slow device does not
+ * throttle the read, and the space left by rounding is topped up from the
+ * sources still holding bytes. The read fails unless every source holds some
+ * bytes, so that each block draws input from all of them. The source rings are
+ * shared by every conditioning worker, so a ring may run dry after its length
+ * was sampled; the bytes already taken from the other rings are valid device
+ * output and are kept, and the read only fails if nothing was taken.
+ *
+ * @param bundle The mixing entropy bundle.
+ * @param buffer The buffer where to store the bytes read.
+ * @param size The maximum number of bytes to be read.
+ * @param length Output parameter representing the number of bytes read.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+static const int es_read_entropy_bundle_sources(
+	struct es_entropy_bundle *bundle,
+	char *buffer,
+	const int size,
+	int *length)
+{
+	int i;
+	int chunk;
+	long total_length = 0;
+	int lengths[ES_MAXIMUM_MIXING_SOURCE_COUNT];
+
+	*length = 0;
+
+	for(i = 0; i < bundle->source_count; ++i) {
+		lengths[i] = es_get_entropy_ring_length(bundle->sources[i]);
+		if(lengths[i] == 0)
+			return ES_FAILURE;
+
+		total_length += lengths[i];
+	}
+
+	/* Take a proportional slice, of at least one byte, from every source. */
+	for(i = 0; i < bundle->source_count && *length < size; ++i) {
+		if(es_drain_entropy_ring(
+				bundle->sources[i],
+				buffer + *length,
+				es_min(
+					es_max(size * lengths[i] / total_length, 1),
+					size - *length),
+				&chunk) != ES_SUCCESS)
+			continue;
+
+		*length += chunk;
+	}
+
+	/* Top up the remaining space from the sources still holding bytes. */
+	for(i = 0; i < bundle->source_count && *length < size; ++i) {
+		if(es_drain_entropy_ring(
+				bundle->sources[i],
+				buffer + *length,
+				size - *length,
+				&chunk) == ES_SUCCESS)
+			*length += chunk;
+	}
+
+	return (*length > 0) ? ES_SUCCESS : ES_FAILURE;
 }
 
 /**
- * Cleans the entropy block specified by the given index.
+ * Reads raw bytes for the specified entropy block of an entropy bundle. A
+ * mixing bundle takes a slice from each of its source rings. If the bundle has
+ * a ring buffer, the bytes are taken from the ring filled by the device reader
+ * thread. Otherwise the bytes staged while the pool was full are
+ * drained first, and the device is read once the staging ring is empty. Staged
+ * bytes are copied up to the free space of the block buffer at once.
+ *
+ * @param bundle The entropy bundle associated with the current thread.
+ * @param block The entropy block to be filled with the bytes.
+ * @param buffer The buffer where to store the bytes read, of
+ * ES_STAGING_READ_SIZE bytes.
+ * @param length Output parameter representing the number of bytes read.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+static const int es_read_entropy_bundle_bytes(
+	struct es_entropy_bundle *bundle,
+	struct es_entropy_block *block,
+	char *buffer,
+	int *length)
+{
+	int size = es_min(ES_STAGING_READ_SIZE, block->size - block->buffer_length);
+
+	if(bundle->source_count > 0)
+		return es_read_entropy_bundle_sources(bundle, buffer, size, length);
+
+	if(bundle->ring)
+		return es_read_entropy_ring(bundle->ring, buffer, size, length);
+
+	if(bundle->staging && es_get_entropy_ring_length(bundle->staging) > 0)
+		return es_read_entropy_ring(bundle->staging, buffer, size, length);
+
+	/*
+	 * A consumer may be waiting for the block, so never read more than the
+	 * block can take.
+	 */
+	return es_read_entropy_device_bytes(
+		bundle,
+		es_get_entropy_bundle_read_size(bundle, size),
+		buffer,
+		length);
+}
+
+/**
+ * Reads ahead device data into the staging ring of an entropy bundle. Used
+ * while every block in the pool is clean.
  *
  * @param bundle The entropy bundle associated with the current device thread.
- * @param index The index of the entropy block to be cleaned.
+ * @return ES_SUCCESS if some device data was staged, ES_FAILURE otherwise
+ * (including the case when the staging ring is full).
+ */
+static const int es_stage_entropy_bundle_bytes(
+	struct es_entropy_bundle *bundle)
+{
+	int ret = ES_FAILURE;
+	int length = 0;
+	int space;
+	char buffer[ES_MAXIMUM_READ_SIZE];
+
+	/* Perform sanity checks. */
+	if(!bundle->staging)
+		return ES_FAILURE;
+
+	/* The staging ring is bounded, so never wait for free space. */
+	space = es_get_entropy_ring_space(bundle->staging);
+	if(space < ES_READ_BUFFER_SIZE)
+		return ES_FAILURE;
+
+	if(es_read_entropy_device_bytes(
+			bundle,
+			es_get_entropy_bundle_read_size(bundle, space),
+			buffer,
+			&length) == ES_SUCCESS)
+		ret = es_write_entropy_ring(bundle->staging, buffer, length);
+
+	/* Wipe the reading buffer. */
+	es_wipe_memory(buffer, ES_MAXIMUM_READ_SIZE);
+
+	return ret;
+}
+
+/**
+ * Fills the specified entropy blocks with data read from the device and mixes
+ * them as a single batch once every block reached its threshold. This is the
+ * conditioning stage of a device thread.
+ *
+ * @param bundle The entropy bundle associated with the current device thread.
+ * @param blocks The entropy blocks to be filled.
+ * @param count The number of entropy blocks, at most
+ * ES_CONDITIONING_BATCH_SIZE.
+ * @param statuses Output parameter holding, for each block, ES_SUCCESS if the
+ * block was filled and published, ES_FAILURE otherwise.
+ * @return ES_SUCCESS if every block was filled, ES_FAILURE otherwise.
+ */
+static const int es_fill_entropy_blocks(
+	struct es_entropy_bundle *bundle,
+	struct es_entropy_block **blocks,
+	const int count,
+	int *statuses)
+{
+	int i;
+	int length = 0;
+	int expansion = 1;
+	int ready_count = 0;
+	int ret = ES_SUCCESS;
+	int digest_type;
+	int clean_depth;
+	struct timespec mix_start;
+	struct timespec mix_end;
+	struct es_entropy_policy *policy = NULL;
+	int claimed[ES_CONDITIONING_BATCH_SIZE];
+	unsigned long tickets[ES_CONDITIONING_BATCH_SIZE];
+	struct es_entropy_block *ready_blocks[ES_CONDITIONING_BATCH_SIZE];
+	char buffer[ES_STAGING_READ_SIZE];
+
+	/*
+	 * With the keyed extractor, a single extract over device input is expanded
+	 * into several blocks, so only the first block of each group is filled.
+	 */
+	if(blocks[0]->digest_type == ES_HKDF_SHA512_DIGEST)
+		expansion = bundle->pool->expansion_factor;
+	else
+		policy = bundle->pool->policy;
+
+	/* Select the digest of the load-adaptive policy once for the batch. */
+	if(policy)
+		digest_type = es_get_entropy_policy_digest(policy);
+
+	for(i = 0; i < count; ++i) {
+		statuses[i] = ES_FAILURE;
+		claimed[i] = FALSE;
+
+		/*
+		 * Claim the dirty entropy block for filling. The claim keeps any other
+		 * thread away from the block until it is published as clean.
+		 */
+		if(es_claim_entropy_block(
+				blocks[i],
+				ES_DIRTY_BLOCK_STATE,
+				ES_FILLING_BLOCK_STATE,
+				&tickets[i]) != ES_SUCCESS) {
+			ret = ES_FAILURE;
+			continue;
+		}
+
+		claimed[i] = TRUE;
+		statuses[i] = ES_SUCCESS;
+
+		/* Apply the digest selected by the load-adaptive policy. */
+		if(policy && blocks[i]->digest_type != digest_type)
+			es_set_entropy_block_digest(
+				blocks[i],
+				digest_type,
+				policy->digest_backend);
+
+		/* The following blocks of a group are expanded, not filled. */
+		if(ready_count % expansion != 0) {
+			ready_blocks[ready_count++] = blocks[i];
+			continue;
+		}
+
+		/* Append device data to the block buffer until it is ready. */
+		do {
+			/* Read raw data from the device or its ring buffers. */
+			if(es_read_entropy_bundle_bytes(
+					bundle,
+					blocks[i],
+					buffer,
+					&length) != ES_SUCCESS) {
+				statuses[i] = ES_FAILURE;
+				break;
+			}
+
+			/* Append the data to the entropy block buffer. */
+			if(es_append_entropy_block_content(
+					blocks[i],
+					buffer,
+					length) != ES_SUCCESS) {
+				statuses[i] = ES_FAILURE;
+				break;
+			}
+		} while(es_check_entropy_block_ready(blocks[i]) != ES_SUCCESS);
+
+		if(statuses[i] == ES_SUCCESS)
+			ready_blocks[ready_count++] = blocks[i];
+	}
+
+	/* Wipe the reading buffer. */
+	es_wipe_memory(buffer, ES_STAGING_READ_SIZE);
+
+	if(expansion > 1) {
+		/* Expand every group of ready blocks from a single extract. */
+		for(i = 0; i < ready_count; i += expansion)
+			es_expand_entropy_blocks(
+				ready_blocks + i,
+				es_min(expansion, ready_count - i));
+	} else if(ready_count > 0 && policy) {
+		/* Mix the batch, feeding its cost and the pool load to the policy. */
+		clock_gettime(CLOCK_THREAD_CPUTIME_ID, &mix_start);
+		es_mix_entropy_blocks(ready_blocks, ready_count);
+		clock_gettime(CLOCK_THREAD_CPUTIME_ID, &mix_end);
+
+		pthread_mutex_lock(&bundle->pool->mutex);
+		clean_depth = es_get_queue_length(bundle->pool->clean_queue);
+		pthread_mutex_unlock(&bundle->pool->mutex);
+
+		es_record_entropy_policy_mix(
+			policy,
+			clean_depth,
+			ready_count,
+			(mix_end.tv_sec - mix_start.tv_sec) * 1000000000UL
+				+ mix_end.tv_nsec - mix_start.tv_nsec);
+	} else if(ready_count > 0) {
+		/* Mix all the ready blocks as a single batch, publishing them. */
+		es_mix_entropy_blocks(ready_blocks, ready_count);
+	}
+
+	/*
+	 * Every claimed block still in the filling state could not be published,
+	 * so hand it back as dirty.
+	 */
+	for(i = 0; i < count; ++i) {
+		if(!claimed[i] || es_load_entropy_block_state(blocks[i]) != tickets[i])
+			continue;
+
+		statuses[i] = ES_FAILURE;
+		es_release_entropy_block(blocks[i], tickets[i], ES_DIRTY_BLOCK_STATE);
+	}
+
+	for(i = 0; i < count; ++i) {
+		if(statuses[i] != ES_SUCCESS)
+			ret = ES_FAILURE;
+	}
+
+	return ret;
+}
+
+/**
+ * Fills the specified entropy block with data read from the device until the
+ * block is published as clean.
+ *
+ * @param bundle The entropy bundle associated with the current device thread.
+ * @param block The entropy block to be filled.
  * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
  */
-const int es_clean_entropy_block(
+static const int es_fill_entropy_block(
 	struct es_entropy_bundle *bundle,
-	const int index)
+	struct es_entropy_block *block)
 {
+	int status;
+
+	return es_fill_entropy_blocks(bundle, &block, 1, &status);
+}
+
+/**
+ * Refills the specified entropy block with a record streamed back from the
+ * spill tier of the pool.
+ *
+ * @param pool The entropy pool owning the block.
+ * @param block The entropy block to be refilled.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise
+ * (including the case when the spill tier is empty).
+ */
+static const int es_refill_entropy_block_from_spill(
+	struct es_entropy_pool *pool,
+	struct es_entropy_block *block)
+{
+	int ret = ES_FAILURE;
+	char *record = NULL;
+
+	/* Perform sanity checks. */
+	if(!pool->spill)
+		return ES_FAILURE;
+
+	if(es_get_entropy_spill_record_count(pool->spill) <= 0)
+		return ES_FAILURE;
+
+	/* Allocate memory for the spill record. */
+	record = (char*)malloc(block->size * sizeof(char));
+	if(!record)
+		return ES_FAILURE;
+
+	/* Stream the oldest spill record back and publish it in the block. */
+	if(es_read_entropy_spill(pool->spill, record) == ES_SUCCESS)
+		ret = es_set_entropy_block_content(block, record);
+
+	/* Wipe & free the spill record. */
+	es_wipe_memory(record, block->size * sizeof(char));
+	free(record);
+
+	return ret;
+}
+
+/**
+ * Fills the specified scratch entropy block with device data and appends its
+ * conditioned content to the spill tier of the pool. Used while every block in
+ * the pool is clean, so that device output is not lost.
+ *
+ * @param bundle The entropy bundle associated with the current device thread.
+ * @param block The scratch entropy block, not part of the pool.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise
+ * (including the case when the spill tier is full).
+ */
+static const int es_spill_entropy_block(
+	struct es_entropy_bundle *bundle,
+	struct es_entropy_block *block)
+{
+	int ret = ES_FAILURE;
+	unsigned long ticket;
+	const char *content = NULL;
+
+	/* Condition a full block worth of device data. */
+	if(es_fill_entropy_block(bundle, block) != ES_SUCCESS)
+		return ES_FAILURE;
+
+	/* Read the conditioned content in place and append it to the spill. */
+	if(es_claim_entropy_block(
+			block,
+			ES_CLEAN_BLOCK_STATE,
+			ES_READING_BLOCK_STATE,
+			&ticket) != ES_SUCCESS)
+		return ES_FAILURE;
+
+	content = es_get_entropy_block_content(block);
+	if(content)
+		ret = es_write_entropy_spill(bundle->pool->spill, content);
+
+	/* The scratch block is dirty again, whatever the outcome. */
+	es_release_entropy_block(block, ticket, ES_DIRTY_BLOCK_STATE);
+
+	return ret;
+}
+
+/**
+ * Cleans the entropy blocks specified by the given indexes. If the pool has a
+ * spill tier holding surplus entropy, blocks are refilled from the spill at
+ * memory speed. The remaining blocks are filled with device data and mixed as a
+ * single batch.
+ *
+ * @param bundle The entropy bundle associated with the current device thread.
+ * @param indexes The indexes of the entropy blocks to be cleaned.
+ * @param count The number of indexes, at most ES_CONDITIONING_BATCH_SIZE.
+ * @param statuses Output parameter holding, for each index, ES_SUCCESS if the
+ * block was cleaned, ES_FAILURE otherwise.
+ * @return ES_SUCCESS if every block was cleaned, ES_FAILURE otherwise.
+ */
+const int es_clean_entropy_blocks(
+	struct es_entropy_bundle *bundle,
+	int **indexes,
+	const int count,
+	int *statuses)
+{
+	int i;
+	int fill_count = 0;
 	int ret = ES_SUCCESS;
-	char buffer[ES_READ_BUFFER_SIZE];
+	int fill_positions[ES_CONDITIONING_BATCH_SIZE];
+	int fill_statuses[ES_CONDITIONING_BATCH_SIZE];
 	struct es_entropy_block *block = NULL;
+	struct es_entropy_block *fill_blocks[ES_CONDITIONING_BATCH_SIZE];
 
 	/* Perform sanity checks. */
-	if(!bundle)
+	if(!bundle || !indexes || !statuses)
 		return ES_FAILURE;
-	
-	if(index < 0)
+
+	if(count <= 0 || count > ES_CONDITIONING_BATCH_SIZE)
 		return ES_FAILURE;
 
-	block = bundle->pool->blocks[index];
+	for(i = 0; i < count; ++i) {
+		statuses[i] = ES_FAILURE;
 
-	/* Atomic block cleaning operation. */
-	pthread_mutex_lock(&block->mutex);
-	while(block->state == ES_DIRTY_BLOCK_STATE) {
-		/* Clear the reading buffer. */
-		memset(buffer, 0, ES_READ_BUFFER_SIZE);
+		if(!indexes[i] || *indexes[i] < 0)
+			continue;
 
-		/* Read data from the device. */
-		if(es_read_device_data(
-				bundle->descriptor,
-				ES_READ_BUFFER_SIZE,
-				buffer) != ES_SUCCESS) {
-			ret = ES_FAILURE;
-			break;
+		block = bundle->pool->blocks[*indexes[i]];
+
+		/* Prefer the entropy stored in the spill tier, if any. */
+		if(es_refill_entropy_block_from_spill(
+				bundle->pool,
+				block) == ES_SUCCESS) {
+			statuses[i] = ES_SUCCESS;
+			continue;
 		}
 
-		/* Update the entropy block content. */
-		if(es_update_entropy_block_content(block, buffer) != ES_SUCCESS) {
+		/* Queue the block for the device conditioning batch. */
+		fill_positions[fill_count] = i;
+		fill_blocks[fill_count++] = block;
+	}
+
+	/* Fill the remaining blocks with device data. */
+	if(fill_count > 0) {
+		es_fill_entropy_blocks(bundle, fill_blocks, fill_count, fill_statuses);
+
+		for(i = 0; i < fill_count; ++i)
+			statuses[fill_positions[i]] = fill_statuses[i];
+	}
+
+	for(i = 0; i < count; ++i) {
+		if(statuses[i] != ES_SUCCESS)
 			ret = ES_FAILURE;
-			break;
-		}
 	}
-	pthread_mutex_unlock(&block->mutex);
 
 	return ret;
 }
 
+/**
+ * Cleans the entropy block specified by the given index. If the pool has a
+ * spill tier holding surplus entropy, the block is refilled from the spill at
+ * memory speed, otherwise it is filled with device data.
+ *
+ * @param bundle The entropy bundle associated with the current device thread.
+ * @param index The index of the entropy block to be cleaned.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_clean_entropy_block(
+	struct es_entropy_bundle *bundle,
+	const int index)
+{
+	int status;
+	int block_index = index;
+	int *indexes[1] = {&block_index};
+
+	return es_clean_entropy_blocks(bundle, indexes, 1, &status);
+}
+
+/**
+ * Creates the scratch entropy block used to condition device data into the
+ * spill tier of a pool while every block in the pool is clean.
+ *
+ * @param pool The entropy pool owning the spill tier.
+ * @return The address of a newly allocated scratch entropy block if the pool
+ * has a spill tier and the operation was successfull, NULL otherwise.
+ */
+struct es_entropy_block* es_create_entropy_spill_block(
+	struct es_entropy_pool *pool)
+{
+	struct es_entropy_block *spill_block = NULL;
+
+	/* Perform sanity checks. */
+	if(!pool || !pool->spill)
+		return NULL;
+
+	spill_block = es_create_entropy_block(pool->blocks[0]->size, ES_CLEAN_ALLOC);
+	if(!spill_block)
+		return NULL;
+
+	/* Mix the scratch block the same way as the pool blocks. */
+	es_set_entropy_block_digest(
+		spill_block,
+		pool->blocks[0]->digest_type,
+		pool->blocks[0]->digest_backend);
+
+	return spill_block;
+}
+
+/**
+ * Cleans a single batch of dirty entropy blocks and publishes them in the clean
+ * queue. If no dirty block exists, a block worth of device data is conditioned
+ * into the spill tier instead, when a scratch block is given.
+ *
+ * @param bundle The entropy bundle providing the device data.
+ * @param spill_block The scratch entropy block used to feed the spill tier, or
+ * NULL.
+ * @return ES_SUCCESS if some work was done, ES_FAILURE if there was nothing to
+ * do or no block of the batch could be cleaned.
+ */
+const int es_clean_entropy_pool_batch(
+	struct es_entropy_bundle *bundle,
+	struct es_entropy_block *spill_block)
+{
+	int i;
+	int count;
+	int quota;
+	int cleaned = 0;
+	int *indexes[ES_CONDITIONING_BATCH_SIZE];
+	int statuses[ES_CONDITIONING_BATCH_SIZE];
+
+	/* Perform sanity checks. */
+	if(!bundle)
+		return ES_FAILURE;
+
+	/*
+	 * A device whose share of the dirty blocks rounds down to none reads ahead
+	 * into its staging ring instead of holding a block for long. Once the
+	 * staging ring is full, it claims a single block and fills it at memory
+	 * speed.
+	 */
+	quota = es_get_entropy_bundle_quota(bundle);
+	if(quota == 0 && es_stage_entropy_bundle_bytes(bundle) == ES_SUCCESS)
+		return ES_SUCCESS;
+
+	/* Extract a batch of dirty entropy block indexes from the dirty queue. */
+	count = es_get_dirty_entropy_block_indexes(
+		bundle->pool,
+		indexes,
+		es_max(quota, 1));
+
+	if(count == 0) {
+		/* No blocks to be cleaned were found. */
+
+		/*
+		 * Keep reading ahead device output into the staging ring, if any, so
+		 * that it is drained at memory speed once blocks are consumed.
+		 */
+		if(es_stage_entropy_bundle_bytes(bundle) == ES_SUCCESS)
+			return ES_SUCCESS;
+
+		/*
+		 * Once the staging ring is full, keep harvesting device output into the
+		 * spill tier, if any, so that it can be streamed back once the pool
+		 * runs low.
+		 */
+		if(spill_block
+				&& es_spill_entropy_block(bundle, spill_block) == ES_SUCCESS)
+			return ES_SUCCESS;
+
+		return ES_FAILURE;
+	}
+
+	/* Clean the entropy blocks indentified by the extracted indexes. */
+	es_clean_entropy_blocks(bundle, indexes, count, statuses);
+
+	/*
+	 * Atomic queue push operation. The blocks which could not be filled, for
+	 * instance because a source ran dry or failed its health tests, were handed
+	 * back as dirty and are queued again.
+	 */
+	pthread_mutex_lock(&bundle->pool->mutex);
+	for(i = 0; i < count; ++i) {
+		if(statuses[i] != ES_SUCCESS) {
+			es_push_queue(bundle->pool->dirty_queue, indexes[i]);
+		} else {
+			es_push_queue(bundle->pool->clean_queue, indexes[i]);
+			++cleaned;
+		}
+	}
+	pthread_mutex_unlock(&bundle->pool->mutex);
+
+	if(ES_DEBUG) {
+		for(i = 0; i < count; ++i) {
+			if(statuses[i] != ES_SUCCESS)
+				continue;
+
+			printf(
+				"Entropy block %d size: %d bytes\n",
+				*indexes[i],
+				bundle->pool->blocks[*indexes[i]]->size);
+		}
+	}
+
+	/* Report no progress if every block was handed back. */
+	return (cleaned > 0) ? ES_SUCCESS : ES_FAILURE;
+}
+
 /**
  * Cleans the entire entropy pool specified in the entropy bundle parameter.
+ * While every block is clean, device readings are kept in a staging ring of
+ * the bundle and drained into the next dirty blocks. The device stream is only
+ * stopped while the pool and the staging ring are both full; when a batch does
+ * no work for any other reason, the thread backs off with the stream running.
  *
  * @param bundle The entropy bundle associated with the current device thread.
  * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
@@ -231,66 +1143,144 @@ const int es_clean_entropy_block(
 const int es_clean_entropy_pool(struct es_entropy_bundle *bundle)
 {
 	int ret = ES_FAILURE;
-	int *index = NULL;
-	struct es_entropy_block *block = NULL;
+	int backoff = ES_DEVICE_READER_SLEEP;
+	struct es_entropy_ring *staging = NULL;
+	struct es_entropy_block *spill_block = NULL;
 
 	/* Perform sanity checks. */
 	if(!bundle)
-		return ret;
+		return ES_FAILURE;
+
+	/* Create the staging ring of the device. */
+	staging = es_create_entropy_ring(ES_DEFAULT_ENTROPY_RING_SIZE);
+	if(!staging)
+		return ES_FAILURE;
+
+	bundle->staging = staging;
+
+	/*
+	 * If the pool has a spill tier, create a scratch block used to condition
+	 * device data while every block in the pool is clean.
+	 */
+	if(bundle->pool->spill) {
+		spill_block = es_create_entropy_spill_block(bundle->pool);
+		if(!spill_block)
+			goto exit;
+	}
 
 	while(TRUE) {
 		/* Checks if the current device thread should stop gracefully. */
 		if(!bundle->descriptor->runnable)
 			break;
 
-		/* Extract a dirty entropy block index from the dirty queue. */
-		index = es_get_dirty_entropy_block_index(bundle->pool);
+		if(es_clean_entropy_pool_batch(bundle, spill_block) == ES_SUCCESS) {
+			backoff = ES_DEVICE_READER_SLEEP;
+			continue;
+		}
 
-		if(index) {
-			/* Clean the entropy block indentified by the extracted index. */
-			ret = es_clean_entropy_block(bundle, *index);
+		/*
+		 * A failed read or a batch handed back leaves the device stream running,
+		 * so that readings keep flowing once the device recovers. The thread
+		 * backs off meanwhile instead of spinning on the device.
+		 */
+		if(es_check_entropy_pool_full(bundle->pool) != ES_SUCCESS
+				|| es_get_entropy_ring_space(staging) >= ES_READ_BUFFER_SIZE) {
+			usleep(backoff);
+			backoff = es_min(backoff * 2, ES_DEVICE_THREAD_MAXIMUM_BACKOFF);
+			continue;
+		}
 
-			/* Atomic queue push operation. */
-			pthread_mutex_lock(&bundle->pool->mutex);
-			if(ret != ES_SUCCESS) {
-				/* Something went very wrong ... */
-				block = bundle->pool->blocks[*index];
-				if(block)
-					es_destroy_entropy_block(&block);
+		/*
+		 * The pool and the staging ring are both full, so stop the device
+		 * stream until readings are needed again.
+		 */
+		es_stop_device_stream(bundle->descriptor);
 
-				free(index);
-			} else {
-				es_push_queue(bundle->pool->clean_queue, index);
-			}
-			pthread_mutex_unlock(&bundle->pool->mutex);
+		/* Sleep until some dirty blocks become available. */
+		if(ES_DEBUG) {
+			printf("All blocks are clean. Nothing to do ... Sleep\n");
+		}
 
-			if(ret != ES_SUCCESS)
-				continue;
+		sleep(ES_DEVICE_THREAD_SLEEP);
+		backoff = ES_DEVICE_READER_SLEEP;
+	}
 
-			if(ES_DEBUG) {
-				printf(
-					"Entropy block %d size: %d bytes\n",
-					*index,
-					strlen(bundle->pool->blocks[*index]->content));
-				printf(
-					"Entropy block %d content:\n%s\n",
-					*index,
-					bundle->pool->blocks[*index]->content);
-			}
-		} else {
-			/* No blocks to be cleaned were found. */
-			/* TODO: Cache some device readings in this case. */
+	/* Update the operation status. */
+	ret = ES_SUCCESS;
 
-			/* Sleep until some dirty blocks become available. */
-			if(ES_DEBUG) {
-				printf("All blocks are clean. Nothing to do ... Sleep\n");
-			}
+exit:
+	/* Destroy the scratch block. */
+	if(spill_block)
+		es_destroy_entropy_block(&spill_block);
+
+	/* Stop the device stream & withdraw its scheduling weight. */
+	es_stop_device_stream(bundle->descriptor);
+	es_withdraw_entropy_bundle_weight(bundle);
+
+	/* Detach & destroy the staging ring, wiping the staged readings. */
+	bundle->staging = NULL;
+	es_destroy_entropy_ring(&staging);
+
+	return ret;
+}
+
+/**
+ * Reads raw device data into the ring buffer of the specified entropy bundle
+ * until the device is stopped. This is the only work of a device reader thread,
+ * so serial I/O overlaps with the conditioning done by the workers. The ring is
+ * closed on exit.
+ *
+ * @param bundle The entropy bundle associated with the current device thread.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_read_entropy_device(struct es_entropy_bundle *bundle)
+{
+	int length = 0;
+	int space;
+	char buffer[ES_MAXIMUM_READ_SIZE];
 
+	/* Perform sanity checks. */
+	if(!bundle || !bundle->ring)
+		return ES_FAILURE;
+
+	while(bundle->descriptor->runnable) {
+		/*
+		 * While the ring is full, the device keeps streaming into the serial
+		 * buffers unless the pool is full as well, in which case the stream is
+		 * stopped until the workers drain the ring.
+		 */
+		space = es_get_entropy_ring_space(bundle->ring);
+		if(space < ES_READ_BUFFER_SIZE) {
+			if(es_check_entropy_pool_full(bundle->pool) == ES_SUCCESS)
+				es_stop_device_stream(bundle->descriptor);
+
+			usleep(ES_DEVICE_READER_SLEEP);
+			continue;
+		}
+
+		/* Read raw data from the device, as much as the ring can take. */
+		if(es_read_entropy_device_bytes(
+				bundle,
+				es_get_entropy_bundle_read_size(bundle, space),
+				buffer,
+				&length) != ES_SUCCESS) {
 			sleep(ES_DEVICE_THREAD_SLEEP);
+			continue;
 		}
+
+		/* Hand the data over to the conditioning workers. */
+		es_write_entropy_ring(bundle->ring, buffer, length);
 	}
 
-	ret = ES_SUCCESS;
-	return ret;
-}
+	/* Wipe the reading buffer. */
+	es_wipe_memory(buffer, ES_MAXIMUM_READ_SIZE);
 
+	/* Stop the device stream & withdraw its scheduling weight. */
+	es_stop_device_stream(bundle->descriptor);
+	es_withdraw_entropy_bundle_weight(bundle);
+
+	/* Let the conditioning workers drain the remaining readings. */
+	es_close_entropy_ring(bundle->ring);
+
+	return ES_SUCCESS;
+}
@@ -0,0 +1,290 @@
+/**
+ * Copyright (c) 2016, Codrin-Victor Poienaru <cvpoienaru@gmail.com>.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * This software is provided by the copyright holders and contributors "as is"
+ * and any express or implied warranties, including, but not limited to, the
+ * implied warranties of merchantability and fitness for a particular purpose
+ * are disclaimed. In no event shall the copyright holder or contributors be
+ * liable for any direct, indirect, incidental, special, exemplary, or
+ * consequential damages (including, but not limited to, procurement of
+ * substitute goods or services; loss of use, data, or profits; or business
+ * interruption) however caused and on any theory of liability, whether in
+ * contract, strict liability, or tort (including negligence or otherwise)
+ * arising in any way out of the use of this software, even if advised of the
+ * possibility of such damage.
+ */
+
+#include <generator/entropy_health.h>
+
+#include <stdlib.h>
+
+#include <global/defs.h>
+
+/**
+ * Repetition count test cutoffs, indexed by the assumed minimum entropy in
+ * bits per byte. Computed as 1 + ceil(20 / H).
+ */
+static const int es_health_rct_cutoffs[ES_MAXIMUM_HEALTH_MIN_ENTROPY + 1] = {
+	0, 21, 11, 8, 6, 5, 5, 4, 4
+};
+
+/**
+ * Adaptive proportion test cutoffs for a 512 byte window, indexed by the
+ * assumed minimum entropy in bits per byte. Computed as
+ * 1 + CRITBINOM(512, 2^-H, 1 - 2^-20).
+ */
+static const int es_health_apt_cutoffs[ES_MAXIMUM_HEALTH_MIN_ENTROPY + 1] = {
+	0, 311, 177, 103, 62, 39, 25, 18, 13
+};
+
+/**
+ * Allocates memory for an entropy health test state.
+ *
+ * @return The address of a newly allocated entropy health test state if the
+ * operation was successfull, NULL otherwise.
+ */
+struct es_entropy_health* es_alloc_entropy_health(void)
+{
+	struct es_entropy_health *health = NULL;
+
+	/* Allocate memory for the entropy health test state structure. */
+	health = (struct es_entropy_health*)malloc(
+		sizeof(struct es_entropy_health));
+
+	return health;
+}
+
+/**
+ * Frees the memory used by an entropy health test state.
+ *
+ * @param health The entropy health test state to be freed.
+ */
+void es_free_entropy_health(struct es_entropy_health **health)
+{
+	/* Perform sanity checks. */
+	if(!health || !(*health))
+		return;
+
+	/* Free the entropy health test state structure. */
+	free(*health);
+	*health = NULL;
+}
+
+/**
+ * Initializes an entropy health test state with the default values. The test
+ * cutoffs are looked up for the assumed minimum entropy, with a false positive
+ * probability of 2^-20 per test.
+ *
+ * @param health The entropy health test state to be initialized.
+ * @param min_entropy The assumed minimum entropy in bits per byte.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_init_entropy_health(
+	struct es_entropy_health *health,
+	const int min_entropy)
+{
+	/* Perform sanity checks. */
+	if(!health)
+		return ES_FAILURE;
+
+	if(min_entropy <= 0 || min_entropy > ES_MAXIMUM_HEALTH_MIN_ENTROPY)
+		return ES_FAILURE;
+
+	/* Initialize the structure fields with their default values. */
+	health->rct_value = 0;
+	health->rct_count = 0;
+	health->rct_cutoff = es_health_rct_cutoffs[min_entropy];
+	health->apt_value = 0;
+	health->apt_count = 0;
+	health->apt_length = 0;
+	health->apt_cutoff = es_health_apt_cutoffs[min_entropy];
+	health->byte_count = 0;
+	health->failure = ES_HEALTH_NO_FAILURE;
+
+	return ES_SUCCESS;
+}
+
+/**
+ * Creates an entropy health test state.
+ *
+ * @param min_entropy The assumed minimum entropy in bits per byte.
+ * @return The address of a newly allocated entropy health test state if the
+ * operation was successfull, NULL otherwise.
+ */
+struct es_entropy_health* es_create_entropy_health(const int min_entropy)
+{
+	int status = ES_FAILURE;
+	struct es_entropy_health *health = NULL;
+
+	/* Allocate memory for the new entropy health test state. */
+	health = es_alloc_entropy_health();
+	if(!health)
+		goto exit;
+
+	/* Initialize the entropy health test state fields. */
+	if(es_init_entropy_health(health, min_entropy) != ES_SUCCESS)
+		goto exit;
+
+	/* Update the operation status. */
+	status = ES_SUCCESS;
+
+exit:
+	/*
+	 * If the operation failed, destroy the partially created entropy health
+	 * test state.
+	 */
+	if(status == ES_FAILURE && health)
+		es_destroy_entropy_health(&health);
+
+	return health;
+}
+
+/**
+ * Destroys an entropy health test state.
+ *
+ * @param health The entropy health test state to be destroyed.
+ */
+void es_destroy_entropy_health(struct es_entropy_health **health)
+{
+	/* Free the given entropy health test state. */
+	es_free_entropy_health(health);
+}
+
+/**
+ * Validates an entropy health test state.
+ *
+ * @param health The entropy health test state to be validated.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_validate_entropy_health(struct es_entropy_health *health)
+{
+	/* Perform sanity checks. */
+	if(!health)
+		return ES_FAILURE;
+
+	/* Perform field validation. */
+	if(health->rct_cutoff <= 1)
+		return ES_FAILURE;
+
+	if(health->apt_cutoff <= 1
+			|| health->apt_cutoff > ES_HEALTH_APT_WINDOW_SIZE)
+		return ES_FAILURE;
+
+	return ES_SUCCESS;
+}
+
+/**
+ * Runs the health tests on the next raw bytes of a device stream.
+ *
+ * @param health The entropy health test state of the device stream.
+ * @param buffer The raw bytes read from the device.
+ * @param length The number of raw bytes read from the device.
+ * @return ES_SUCCESS if the bytes passed the health tests, ES_FAILURE otherwise
+ * (including the case when a previous test already failed).
+ */
+const int es_test_entropy_health(
+	struct es_entropy_health *health,
+	const char *buffer,
+	const int length)
+{
+	int i;
+	unsigned char value;
+
+	/* Perform sanity checks. */
+	if(es_validate_entropy_health(health) != ES_SUCCESS)
+		return ES_FAILURE;
+
+	if(!buffer || length < 0)
+		return ES_FAILURE;
+
+	if(es_get_entropy_health_failure(health) != ES_HEALTH_NO_FAILURE)
+		return ES_FAILURE;
+
+	for(i = 0; i < length; ++i) {
+		value = (unsigned char)buffer[i];
+
+		/* Repetition count test. */
+		if(health->rct_count && value == health->rct_value) {
+			if(++health->rct_count >= health->rct_cutoff) {
+				__atomic_store_n(
+					&health->failure,
+					ES_HEALTH_RCT_FAILURE,
+					__ATOMIC_RELAXED);
+				return ES_FAILURE;
+			}
+		} else {
+			health->rct_value = value;
+			health->rct_count = 1;
+		}
+
+		/* Adaptive proportion test. */
+		if(!health->apt_length) {
+			health->apt_value = value;
+			health->apt_count = 1;
+		} else if(value == health->apt_value
+				&& ++health->apt_count >= health->apt_cutoff) {
+			__atomic_store_n(
+				&health->failure,
+				ES_HEALTH_APT_FAILURE,
+				__ATOMIC_RELAXED);
+			return ES_FAILURE;
+		}
+
+		if(++health->apt_length == ES_HEALTH_APT_WINDOW_SIZE)
+			health->apt_length = 0;
+	}
+
+	health->byte_count += length;
+
+	return ES_SUCCESS;
+}
+
+/**
+ * Gets the failure status of an entropy health test state. Safe to call from
+ * a thread other than the one running the tests.
+ *
+ * @param health The entropy health test state to be checked.
+ * @return The failure status of the health tests.
+ */
+const int es_get_entropy_health_failure(struct es_entropy_health *health)
+{
+	/* Perform sanity checks. */
+	if(!health)
+		return ES_HEALTH_NO_FAILURE;
+
+	return __atomic_load_n(&health->failure, __ATOMIC_RELAXED);
+}
+
+/**
+ * Gets the name of a health test failure status.
+ *
+ * @param failure The failure status.
+ * @return The name of the failure status.
+ */
+const char* es_get_entropy_health_failure_name(const int failure)
+{
+	switch(failure) {
+		case ES_HEALTH_NO_FAILURE:
+			return "healthy";
+
+		case ES_HEALTH_RCT_FAILURE:
+			return "repetition count test failed";
+
+		case ES_HEALTH_APT_FAILURE:
+			return "adaptive proportion test failed";
+
+		default:
+			return "unknown";
+	}
+}
@@ -0,0 +1,450 @@
+/**
+ * Copyright (c) 2016, Codrin-Victor Poienaru <cvpoienaru@gmail.com>.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * This software is provided by the copyright holders and contributors "as is"
+ * and any express or implied warranties, including, but not limited to, the
+ * implied warranties of merchantability and fitness for a particular purpose
+ * are disclaimed. In no event shall the copyright holder or contributors be
+ * liable for any direct, indirect, incidental, special, exemplary, or
+ * consequential damages (including, but not limited to, procurement of
+ * substitute goods or services; loss of use, data, or profits; or business
+ * interruption) however caused and on any theory of liability, whether in
+ * contract, strict liability, or tort (including negligence or otherwise)
+ * arising in any way out of the use of this software, even if advised of the
+ * possibility of such damage.
+ */
+
+#include <generator/entropy_ring.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#include <global/defs.h>
+#include <global/math_defs.h>
+#include <global/memory.h>
+
+/**
+ * Computes the absolute deadline of a ring wait.
+ *
+ * @param deadline Output parameter holding the deadline.
+ */
+static void es_get_entropy_ring_deadline(struct timespec *deadline)
+{
+	clock_gettime(CLOCK_REALTIME, deadline);
+	deadline->tv_sec += ES_ENTROPY_RING_TIMEOUT;
+}
+
+/**
+ * Moves the bytes stored in a ring buffer, in at most two contiguous chunks, so
+ * that no copy of them is left behind in the ring. The ring mutex must be held
+ * by the caller.
+ *
+ * @param ring The ring buffer from where to move the bytes.
+ * @param buffer The buffer where to store the bytes moved.
+ * @param size The maximum number of bytes to be moved.
+ * @param length Output parameter representing the number of bytes moved.
+ * @return ES_SUCCESS if some bytes were moved, ES_FAILURE otherwise.
+ */
+static const int es_take_entropy_ring_bytes(
+	struct es_entropy_ring *ring,
+	char *buffer,
+	const int size,
+	int *length)
+{
+	int chunk;
+
+	while(*length < size && ring->length > 0) {
+		chunk = es_min(size - *length, ring->length);
+		chunk = es_min(chunk, ring->size - ring->head);
+		memcpy(buffer + *length, ring->buffer + ring->head, chunk);
+		es_wipe_memory(ring->buffer + ring->head, chunk);
+
+		ring->head = (ring->head + chunk) % ring->size;
+		ring->length -= chunk;
+		*length += chunk;
+	}
+
+	if(*length == 0)
+		return ES_FAILURE;
+
+	pthread_cond_signal(&ring->writable);
+
+	return ES_SUCCESS;
+}
+
+/**
+ * Allocates memory for a ring buffer.
+ *
+ * @param size The size in bytes of the ring storage.
+ * @return The address of a newly allocated ring buffer if the operation was
+ * successfull, NULL otherwise.
+ */
+struct es_entropy_ring* es_alloc_entropy_ring(const int size)
+{
+	int status = ES_FAILURE;
+	struct es_entropy_ring *ring = NULL;
+
+	/* Perform sanity checks. */
+	if(size <= 0)
+		goto exit;
+
+	/* Allocate memory for the ring buffer structure. */
+	ring = (struct es_entropy_ring*)calloc(1, sizeof(struct es_entropy_ring));
+	if(!ring)
+		goto exit;
+
+	/* Allocate memory for the ring storage. */
+	ring->buffer = (char*)calloc(size, sizeof(char));
+	if(!ring->buffer)
+		goto exit;
+
+	ring->size = size;
+
+	/* Initialize the underlying synchronization primitives. */
+	if(pthread_mutex_init(&ring->mutex, NULL))
+		goto exit;
+
+	if(pthread_cond_init(&ring->readable, NULL))
+		goto exit;
+
+	if(pthread_cond_init(&ring->writable, NULL))
+		goto exit;
+
+	/* Update the operation status. */
+	status = ES_SUCCESS;
+
+exit:
+	/* If the operation failed, free the partially allocated ring buffer. */
+	if(status == ES_FAILURE && ring)
+		es_free_entropy_ring(&ring);
+
+	return ring;
+}
+
+/**
+ * Frees the memory used by a ring buffer. The ring storage is cleared.
+ *
+ * @param ring The ring buffer to be freed.
+ */
+void es_free_entropy_ring(struct es_entropy_ring **ring)
+{
+	/* Perform sanity checks. */
+	if(!ring || !(*ring))
+		return;
+
+	/* Destroy the synchronization primitives of the current ring buffer. */
+	pthread_cond_destroy(&(*ring)->writable);
+	pthread_cond_destroy(&(*ring)->readable);
+	pthread_mutex_destroy(&(*ring)->mutex);
+
+	/* Wipe & free the ring storage. */
+	if((*ring)->buffer) {
+		es_wipe_memory((*ring)->buffer, (*ring)->size * sizeof(char));
+		free((*ring)->buffer);
+	}
+
+	/* Free the ring buffer structure. */
+	free(*ring);
+	*ring = NULL;
+}
+
+/**
+ * Initializes a ring buffer with the default values.
+ *
+ * @param ring The ring buffer to be initialized.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_init_entropy_ring(struct es_entropy_ring *ring)
+{
+	/* Perform sanity checks. */
+	if(!ring)
+		return ES_FAILURE;
+
+	/* Initialize the structure fields with their default values. */
+	ring->head = 0;
+	ring->length = 0;
+	ring->closed = FALSE;
+
+	return ES_SUCCESS;
+}
+
+/**
+ * Creates a ring buffer.
+ *
+ * @param size The size in bytes of the ring storage.
+ * @return The address of a newly allocated ring buffer if the operation was
+ * successfull, NULL otherwise.
+ */
+struct es_entropy_ring* es_create_entropy_ring(const int size)
+{
+	int status = ES_FAILURE;
+	struct es_entropy_ring *ring = NULL;
+
+	/* Allocate memory for the new ring buffer. */
+	ring = es_alloc_entropy_ring(size);
+	if(!ring)
+		goto exit;
+
+	/* Initialize the ring buffer fields with their default values. */
+	if(es_init_entropy_ring(ring) != ES_SUCCESS)
+		goto exit;
+
+	/* Update the operation status. */
+	status = ES_SUCCESS;
+
+exit:
+	/* If the operation failed, destroy the partially created ring buffer. */
+	if(status == ES_FAILURE && ring)
+		es_destroy_entropy_ring(&ring);
+
+	return ring;
+}
+
+/**
+ * Destroys a ring buffer.
+ *
+ * @param ring The ring buffer to be destroyed.
+ */
+void es_destroy_entropy_ring(struct es_entropy_ring **ring)
+{
+	/* Free the given ring buffer. */
+	es_free_entropy_ring(ring);
+}
+
+/**
+ * Validates a ring buffer.
+ *
+ * @param ring The ring buffer to be validated.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_validate_entropy_ring(struct es_entropy_ring *ring)
+{
+	/* Perform sanity checks. */
+	if(!ring)
+		return ES_FAILURE;
+
+	/* Perform field validation. */
+	if(!ring->buffer || ring->size <= 0)
+		return ES_FAILURE;
+
+	if(ring->head < 0 || ring->head >= ring->size)
+		return ES_FAILURE;
+
+	if(ring->length < 0 || ring->length > ring->size)
+		return ES_FAILURE;
+
+	return ES_SUCCESS;
+}
+
+/**
+ * Writes the specified bytes to a ring buffer, waiting while the ring is full.
+ *
+ * @param ring The ring buffer where to write the bytes.
+ * @param data The bytes to be written.
+ * @param length The number of bytes to be written.
+ * @return ES_SUCCESS if every byte was written, ES_FAILURE otherwise (including
+ * the case when the ring stayed full for ES_ENTROPY_RING_TIMEOUT seconds or was
+ * closed).
+ */
+const int es_write_entropy_ring(
+	struct es_entropy_ring *ring,
+	const char *data,
+	const int length)
+{
+	int ret = ES_FAILURE;
+	int written = 0;
+	int tail;
+	int chunk;
+	struct timespec deadline;
+
+	/* Perform sanity checks. */
+	if(!ring || !data || length < 0)
+		return ES_FAILURE;
+
+	es_get_entropy_ring_deadline(&deadline);
+
+	pthread_mutex_lock(&ring->mutex);
+	while(written < length) {
+		/* Wait for free space. */
+		while(ring->length == ring->size && !ring->closed) {
+			if(pthread_cond_timedwait(&ring->writable, &ring->mutex, &deadline))
+				goto exit;
+		}
+
+		if(ring->closed)
+			goto exit;
+
+		/* Copy the largest contiguous chunk after the stored bytes. */
+		tail = (ring->head + ring->length) % ring->size;
+		chunk = es_min(length - written, ring->size - ring->length);
+		chunk = es_min(chunk, ring->size - tail);
+		memcpy(ring->buffer + tail, data + written, chunk);
+
+		ring->length += chunk;
+		written += chunk;
+
+		pthread_cond_signal(&ring->readable);
+	}
+
+	/* Update the operation status. */
+	ret = ES_SUCCESS;
+
+exit:
+	pthread_mutex_unlock(&ring->mutex);
+	return ret;
+}
+
+/**
+ * Reads up to the specified number of bytes from a ring buffer, waiting while
+ * the ring is empty. The bytes read are wiped from the ring storage.
+ *
+ * @param ring The ring buffer from where to read the bytes.
+ * @param buffer The buffer where to store the bytes read.
+ * @param size The maximum number of bytes to be read.
+ * @param length Output parameter representing the number of bytes read.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise
+ * (including the case when the ring stayed empty for ES_ENTROPY_RING_TIMEOUT
+ * seconds or was closed and drained).
+ */
+const int es_read_entropy_ring(
+	struct es_entropy_ring *ring,
+	char *buffer,
+	const int size,
+	int *length)
+{
+	int ret = ES_FAILURE;
+	struct timespec deadline;
+
+	/* The default length value when exiting should be zero. */
+	*length = 0;
+
+	/* Perform sanity checks. */
+	if(!ring || !buffer || size <= 0)
+		return ES_FAILURE;
+
+	es_get_entropy_ring_deadline(&deadline);
+
+	pthread_mutex_lock(&ring->mutex);
+
+	/* Wait for stored bytes. */
+	while(ring->length == 0 && !ring->closed) {
+		if(pthread_cond_timedwait(&ring->readable, &ring->mutex, &deadline))
+			goto exit;
+	}
+
+	/* Move the stored bytes. */
+	ret = es_take_entropy_ring_bytes(ring, buffer, size, length);
+
+exit:
+	pthread_mutex_unlock(&ring->mutex);
+	return ret;
+}
+
+/**
+ * Reads up to the specified number of bytes from a ring buffer, without
+ * waiting for more bytes to be written. The bytes read are wiped from the ring
+ * storage.
+ *
+ * @param ring The ring buffer from where to read the bytes.
+ * @param buffer The buffer where to store the bytes read.
+ * @param size The maximum number of bytes to be read.
+ * @param length Output parameter representing the number of bytes read.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise
+ * (including the case when the ring is empty).
+ */
+const int es_drain_entropy_ring(
+	struct es_entropy_ring *ring,
+	char *buffer,
+	const int size,
+	int *length)
+{
+	int ret;
+
+	/* The default length value when exiting should be zero. */
+	*length = 0;
+
+	/* Perform sanity checks. */
+	if(!ring || !buffer || size <= 0)
+		return ES_FAILURE;
+
+	pthread_mutex_lock(&ring->mutex);
+	ret = es_take_entropy_ring_bytes(ring, buffer, size, length);
+	pthread_mutex_unlock(&ring->mutex);
+
+	return ret;
+}
+
+/**
+ * Closes a ring buffer. Waiting readers and writers are woken up, and the bytes
+ * still stored in the ring can be read until it is drained.
+ *
+ * @param ring The ring buffer to be closed.
+ */
+void es_close_entropy_ring(struct es_entropy_ring *ring)
+{
+	/* Perform sanity checks. */
+	if(!ring)
+		return;
+
+	pthread_mutex_lock(&ring->mutex);
+	ring->closed = TRUE;
+	pthread_cond_broadcast(&ring->readable);
+	pthread_cond_broadcast(&ring->writable);
+	pthread_mutex_unlock(&ring->mutex);
+}
+
+/**
+ * Gets the number of bytes stored in a ring buffer.
+ *
+ * @param ring The ring buffer to be checked.
+ * @return The number of bytes stored in the ring.
+ */
+const int es_get_entropy_ring_length(struct es_entropy_ring *ring)
+{
+	int length;
+
+	/* Perform sanity checks. */
+	if(!ring)
+		return 0;
+
+	pthread_mutex_lock(&ring->mutex);
+	length = ring->length;
+	pthread_mutex_unlock(&ring->mutex);
+
+	return length;
+}
+
+/**
+ * Gets the number of bytes that can be written to a ring buffer without
+ * waiting.
+ *
+ * @param ring The ring buffer to be checked.
+ * @return The number of free bytes in the ring.
+ */
+const int es_get_entropy_ring_space(struct es_entropy_ring *ring)
+{
+	int space;
+
+	/* Perform sanity checks. */
+	if(!ring)
+		return 0;
+
+	pthread_mutex_lock(&ring->mutex);
+	space = ring->closed ? 0 : ring->size - ring->length;
+	pthread_mutex_unlock(&ring->mutex);
+
+	return space;
+}
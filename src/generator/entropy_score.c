@@ -0,0 +1,251 @@
+/**
+ * Copyright (c) 2016, Codrin-Victor Poienaru <cvpoienaru@gmail.com>.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * This software is provided by the copyright holders and contributors "as is"
+ * and any express or implied warranties, including, but not limited to, the
+ * implied warranties of merchantability and fitness for a particular purpose
+ * are disclaimed. In no event shall the copyright holder or contributors be
+ * liable for any direct, indirect, incidental, special, exemplary, or
+ * consequential damages (including, but not limited to, procurement of
+ * substitute goods or services; loss of use, data, or profits; or business
+ * interruption) however caused and on any theory of liability, whether in
+ * contract, strict liability, or tort (including negligence or otherwise)
+ * arising in any way out of the use of this software, even if advised of the
+ * possibility of such damage.
+ */
+
+#include <generator/entropy_score.h>
+
+#include <stdlib.h>
+
+#include <global/defs.h>
+
+/**
+ * Moves a score average towards the specified sample.
+ *
+ * @param average The average to be updated.
+ * @param sample The new sample.
+ */
+static void es_update_entropy_score_average(long *average, const long sample)
+{
+	*average += (sample - *average) >> ES_SCORE_SMOOTHING_SHIFT;
+}
+
+/**
+ * Allocates memory for an entropy score.
+ *
+ * @return The address of a newly allocated entropy score if the operation was
+ * successfull, NULL otherwise.
+ */
+struct es_entropy_score* es_alloc_entropy_score(void)
+{
+	struct es_entropy_score *score = NULL;
+
+	/* Allocate memory for the entropy score structure. */
+	score = (struct es_entropy_score*)malloc(sizeof(struct es_entropy_score));
+
+	return score;
+}
+
+/**
+ * Frees the memory used by an entropy score.
+ *
+ * @param score The entropy score to be freed.
+ */
+void es_free_entropy_score(struct es_entropy_score **score)
+{
+	/* Perform sanity checks. */
+	if(!score || !(*score))
+		return;
+
+	/* Free the entropy score structure. */
+	free(*score);
+	*score = NULL;
+}
+
+/**
+ * Initializes an entropy score with the default values.
+ *
+ * @param score The entropy score to be initialized.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_init_entropy_score(struct es_entropy_score *score)
+{
+	/* Perform sanity checks. */
+	if(!score)
+		return ES_FAILURE;
+
+	/* Initialize the structure fields with their default values. */
+	score->throughput = 0;
+	score->error_rate = 0;
+	score->read_count = 0;
+	score->error_count = 0;
+	score->weight = 0;
+
+	return ES_SUCCESS;
+}
+
+/**
+ * Creates an entropy score.
+ *
+ * @return The address of a newly allocated entropy score if the operation was
+ * successfull, NULL otherwise.
+ */
+struct es_entropy_score* es_create_entropy_score(void)
+{
+	int status = ES_FAILURE;
+	struct es_entropy_score *score = NULL;
+
+	/* Allocate memory for the new entropy score. */
+	score = es_alloc_entropy_score();
+	if(!score)
+		goto exit;
+
+	/* Initialize the entropy score fields with their default values. */
+	if(es_init_entropy_score(score) != ES_SUCCESS)
+		goto exit;
+
+	/* Update the operation status. */
+	status = ES_SUCCESS;
+
+exit:
+	/* If the operation failed, destroy the partially created entropy score. */
+	if(status == ES_FAILURE && score)
+		es_destroy_entropy_score(&score);
+
+	return score;
+}
+
+/**
+ * Destroys an entropy score.
+ *
+ * @param score The entropy score to be destroyed.
+ */
+void es_destroy_entropy_score(struct es_entropy_score **score)
+{
+	/* Free the given entropy score. */
+	es_free_entropy_score(score);
+}
+
+/**
+ * Validates an entropy score.
+ *
+ * @param score The entropy score to be validated.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_validate_entropy_score(struct es_entropy_score *score)
+{
+	/* Perform sanity checks. */
+	if(!score)
+		return ES_FAILURE;
+
+	/* Perform field validation. */
+	if(score->throughput < 0 || score->weight < 0)
+		return ES_FAILURE;
+
+	if(score->error_rate < 0 || score->error_rate > ES_SCORE_ERROR_RATE_SCALE)
+		return ES_FAILURE;
+
+	return ES_SUCCESS;
+}
+
+/**
+ * Records the outcome of a device read and recomputes the scheduling weight.
+ *
+ * @param score The entropy score of the device stream.
+ * @param status ES_SUCCESS if the read succeeded, ES_FAILURE otherwise.
+ * @param length The number of bytes read.
+ * @param elapsed_time The duration of the read in nanoseconds.
+ * @param healthy TRUE if the device stream passed its health tests, FALSE
+ * otherwise.
+ * @return The change of the scheduling weight.
+ */
+const long es_record_entropy_score_read(
+	struct es_entropy_score *score,
+	const int status,
+	const int length,
+	const unsigned long elapsed_time,
+	const int healthy)
+{
+	long throughput;
+	long weight;
+	long previous_weight;
+
+	/* Perform sanity checks. */
+	if(es_validate_entropy_score(score) != ES_SUCCESS)
+		return 0;
+
+	if(status == ES_SUCCESS && length > 0) {
+		throughput = (long)(length * 1000000000UL / (elapsed_time + 1));
+
+		/* The first measured read seeds the throughput average. */
+		if(score->read_count++ == 0)
+			score->throughput = throughput;
+		else
+			es_update_entropy_score_average(&score->throughput, throughput);
+
+		es_update_entropy_score_average(&score->error_rate, 0);
+	} else {
+		++score->error_count;
+		es_update_entropy_score_average(
+			&score->error_rate,
+			ES_SCORE_ERROR_RATE_SCALE);
+	}
+
+	/* Weigh the throughput by the share of successfull reads. */
+	weight = healthy
+		? score->throughput
+			* (ES_SCORE_ERROR_RATE_SCALE - score->error_rate)
+			/ ES_SCORE_ERROR_RATE_SCALE
+		: 0;
+
+	previous_weight = __atomic_exchange_n(
+		&score->weight,
+		weight,
+		__ATOMIC_RELAXED);
+
+	return weight - previous_weight;
+}
+
+/**
+ * Gets the scheduling weight of an entropy score. Safe to call from a thread
+ * other than the one recording the reads.
+ *
+ * @param score The entropy score to be checked.
+ * @return The scheduling weight of the device stream.
+ */
+const long es_get_entropy_score_weight(struct es_entropy_score *score)
+{
+	/* Perform sanity checks. */
+	if(!score)
+		return 0;
+
+	return __atomic_load_n(&score->weight, __ATOMIC_RELAXED);
+}
+
+/**
+ * Clears the scheduling weight of an entropy score, once the device stream
+ * stopped.
+ *
+ * @param score The entropy score to be cleared.
+ * @return The change of the scheduling weight.
+ */
+const long es_clear_entropy_score_weight(struct es_entropy_score *score)
+{
+	/* Perform sanity checks. */
+	if(!score)
+		return 0;
+
+	return -__atomic_exchange_n(&score->weight, 0, __ATOMIC_RELAXED);
+}
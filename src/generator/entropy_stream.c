@@ -0,0 +1,167 @@
+/**
+ * Copyright (c) 2016, Codrin-Victor Poienaru <cvpoienaru@gmail.com>.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * This software is provided by the copyright holders and contributors "as is"
+ * and any express or implied warranties, including, but not limited to, the
+ * implied warranties of merchantability and fitness for a particular purpose
+ * are disclaimed. In no event shall the copyright holder or contributors be
+ * liable for any direct, indirect, incidental, special, exemplary, or
+ * consequential damages (including, but not limited to, procurement of
+ * substitute goods or services; loss of use, data, or profits; or business
+ * interruption) however caused and on any theory of liability, whether in
+ * contract, strict liability, or tort (including negligence or otherwise)
+ * arising in any way out of the use of this software, even if advised of the
+ * possibility of such damage.
+ */
+
+#include <generator/entropy_stream.h>
+
+#include <stdlib.h>
+#include <pthread.h>
+
+#include <global/defs.h>
+#include <global/memory.h>
+#include <crypto/chacha_generator.h>
+#include <generator/entropy_generator.h>
+#include <pool/entropy_pool.h>
+
+/** The key of the per-thread stream generator. */
+static pthread_key_t es_stream_generator_key;
+
+/** Guards the one-time creation of the per-thread stream generator key. */
+static pthread_once_t es_stream_generator_once = PTHREAD_ONCE_INIT;
+
+/**
+ * Destroys the stream generator of an exiting thread.
+ *
+ * @param generator The stream generator of the exiting thread.
+ */
+static void es_destroy_stream_generator(void *generator)
+{
+	struct es_chacha_generator *stream =
+		(struct es_chacha_generator*)generator;
+
+	es_destroy_chacha_generator(&stream);
+}
+
+/** Creates the key of the per-thread stream generator. */
+static void es_create_stream_generator_key(void)
+{
+	pthread_key_create(&es_stream_generator_key, es_destroy_stream_generator);
+}
+
+/**
+ * Gets the stream generator of the calling thread, creating it if needed.
+ *
+ * @return The address of the stream generator of the calling thread if the
+ * operation was successfull, NULL otherwise.
+ */
+static struct es_chacha_generator* es_acquire_stream_generator(void)
+{
+	struct es_chacha_generator *generator = NULL;
+
+	pthread_once(&es_stream_generator_once, es_create_stream_generator_key);
+
+	generator = (struct es_chacha_generator*)pthread_getspecific(
+		es_stream_generator_key);
+	if(generator)
+		return generator;
+
+	generator = es_create_chacha_generator();
+	if(!generator)
+		return NULL;
+
+	if(pthread_setspecific(es_stream_generator_key, generator) != 0) {
+		es_destroy_chacha_generator(&generator);
+		return NULL;
+	}
+
+	return generator;
+}
+
+/**
+ * Seeds a stream generator with fresh entropy pool blocks.
+ *
+ * @param pool The entropy pool from where to extract the seed material.
+ * @param generator The stream generator to be seeded.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+static const int es_seed_stream_generator(
+	struct es_entropy_pool *pool,
+	struct es_chacha_generator *generator)
+{
+	int ret = ES_FAILURE;
+	int offset = 0;
+	int length = 0;
+	char seed[ES_STREAM_SEED_SIZE];
+
+	/* Consume clean entropy blocks until enough seed material is gathered. */
+	while(offset < ES_STREAM_SEED_SIZE) {
+		if(es_consume_entropy_block_into(
+				pool,
+				seed + offset,
+				ES_STREAM_SEED_SIZE - offset,
+				&length) != ES_SUCCESS)
+			goto exit;
+
+		offset += length;
+	}
+
+	ret = es_seed_chacha_generator(generator, seed, ES_STREAM_SEED_SIZE);
+
+exit:
+	/* Wipe the seed material. */
+	es_wipe_memory(seed, ES_STREAM_SEED_SIZE);
+
+	return ret;
+}
+
+/**
+ * Generates bulk bytes from the ChaCha20 stream generator of the calling
+ * thread. Each thread owns its generator, so concurrent bulk requests never
+ * contend on a lock. The generator is seeded from a clean entropy block on
+ * first use and reseeded after ES_DEFAULT_STREAM_RESEED_BYTES bytes.
+ *
+ * @param pool The entropy pool used to seed the stream generator.
+ * @param buffer The buffer where to write the generated bytes.
+ * @param size The number of bytes to be generated.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_generate_entropy_stream(
+	struct es_entropy_pool *pool,
+	char *buffer,
+	const long size)
+{
+	struct es_chacha_generator *generator = NULL;
+
+	/* Perform sanity checks. */
+	if(!pool)
+		return ES_FAILURE;
+
+	if(!buffer || size < 0)
+		return ES_FAILURE;
+
+	generator = es_acquire_stream_generator();
+	if(!generator)
+		return ES_FAILURE;
+
+	/* Seed the generator on first use and once the reseed interval elapsed. */
+	if(!generator->seeded
+			|| generator->generated_bytes >= ES_DEFAULT_STREAM_RESEED_BYTES) {
+		if(es_seed_stream_generator(pool, generator) != ES_SUCCESS)
+			return ES_FAILURE;
+	}
+
+	return es_generate_chacha_generator(generator, buffer, size);
+}
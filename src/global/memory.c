@@ -0,0 +1,60 @@
+/**
+ * Copyright (c) 2016, Codrin-Victor Poienaru <cvpoienaru@gmail.com>.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * This software is provided by the copyright holders and contributors "as is"
+ * and any express or implied warranties, including, but not limited to, the
+ * implied warranties of merchantability and fitness for a particular purpose
+ * are disclaimed. In no event shall the copyright holder or contributors be
+ * liable for any direct, indirect, incidental, special, exemplary, or
+ * consequential damages (including, but not limited to, procurement of
+ * substitute goods or services; loss of use, data, or profits; or business
+ * interruption) however caused and on any theory of liability, whether in
+ * contract, strict liability, or tort (including negligence or otherwise)
+ * arising in any way out of the use of this software, even if advised of the
+ * possibility of such damage.
+ */
+
+#include <global/memory.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <global/defs.h>
+
+/**
+ * Represents a volatile pointer to memset. The compiler must load the pointer
+ * on every call, so it can never prove the call to be a dead store and drop it.
+ */
+static void* (*volatile es_memset_function)(void*, int, size_t) = memset;
+
+/**
+ * Clears the specified memory area in a way the compiler cannot elide, even
+ * when the area is never read again (e.g. a stack buffer about to go out of
+ * scope). Use it to wipe sensitive information (e.g. entropy bytes).
+ *
+ * @param data The memory area to be cleared.
+ * @param size The size in bytes of the memory area.
+ */
+void es_wipe_memory(void *data, const size_t size)
+{
+	/* Perform sanity checks. */
+	if(!data || !size)
+		return;
+
+	/* Clear the memory area through the volatile function pointer. */
+	es_memset_function(data, 0, size);
+
+	/* Keep the cleared memory observable to the compiler. */
+	__asm__ __volatile__("" : : "r"(data) : "memory");
+}
@@ -0,0 +1,455 @@
+/**
+ * Copyright (c) 2016, Codrin-Victor Poienaru <cvpoienaru@gmail.com>.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * This software is provided by the copyright holders and contributors "as is"
+ * and any express or implied warranties, including, but not limited to, the
+ * implied warranties of merchantability and fitness for a particular purpose
+ * are disclaimed. In no event shall the copyright holder or contributors be
+ * liable for any direct, indirect, incidental, special, exemplary, or
+ * consequential damages (including, but not limited to, procurement of
+ * substitute goods or services; loss of use, data, or profits; or business
+ * interruption) however caused and on any theory of liability, whether in
+ * contract, strict liability, or tort (including negligence or otherwise)
+ * arising in any way out of the use of this software, even if advised of the
+ * possibility of such damage.
+ */
+
+#define _GNU_SOURCE
+
+#include <global/thread_policy.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sched.h>
+#include <pthread.h>
+
+#include <global/defs.h>
+
+/**
+ * Allocates memory for a thread policy.
+ *
+ * @return The address of a newly allocated thread policy if the operation was
+ * successfull, NULL otherwise.
+ */
+struct es_thread_policy* es_alloc_thread_policy(void)
+{
+	struct es_thread_policy *policy = NULL;
+
+	/* Allocate memory for the thread policy structure. */
+	policy = (struct es_thread_policy*)malloc(sizeof(struct es_thread_policy));
+
+	return policy;
+}
+
+/**
+ * Frees the memory used by a thread policy.
+ *
+ * @param policy The thread policy to be freed.
+ */
+void es_free_thread_policy(struct es_thread_policy **policy)
+{
+	/* Perform sanity checks. */
+	if(!policy || !(*policy))
+		return;
+
+	/* Free the thread policy structure. */
+	free(*policy);
+	*policy = NULL;
+}
+
+/**
+ * Initializes a thread policy with the default values, i.e. no pinning and the
+ * default scheduling policy.
+ *
+ * @param policy The thread policy to be initialized.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_init_thread_policy(struct es_thread_policy *policy)
+{
+	/* Perform sanity checks. */
+	if(!policy)
+		return ES_FAILURE;
+
+	/* Initialize the structure fields with their default values. */
+	policy->cpu_count = 0;
+	policy->realtime = FALSE;
+	policy->priority = 0;
+
+	return ES_SUCCESS;
+}
+
+/**
+ * Creates a thread policy.
+ *
+ * @return The address of a newly allocated thread policy if the operation was
+ * successfull, NULL otherwise.
+ */
+struct es_thread_policy* es_create_thread_policy(void)
+{
+	int status = ES_FAILURE;
+	struct es_thread_policy *policy = NULL;
+
+	/* Allocate memory for the new thread policy. */
+	policy = es_alloc_thread_policy();
+	if(!policy)
+		goto exit;
+
+	/* Initialize the thread policy fields with their default values. */
+	if(es_init_thread_policy(policy) != ES_SUCCESS)
+		goto exit;
+
+	/* Update the operation status. */
+	status = ES_SUCCESS;
+
+exit:
+	/* If the operation failed, destroy the partially created thread policy. */
+	if(status == ES_FAILURE && policy)
+		es_destroy_thread_policy(&policy);
+
+	return policy;
+}
+
+/**
+ * Destroys a thread policy.
+ *
+ * @param policy The thread policy to be destroyed.
+ */
+void es_destroy_thread_policy(struct es_thread_policy **policy)
+{
+	/* Free the given thread policy. */
+	es_free_thread_policy(policy);
+}
+
+/**
+ * Validates a thread policy.
+ *
+ * @param policy The thread policy to be validated.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_validate_thread_policy(struct es_thread_policy *policy)
+{
+	int i;
+
+	/* Perform sanity checks. */
+	if(!policy)
+		return ES_FAILURE;
+
+	/* Perform field validation. */
+	if(policy->cpu_count < 0
+			|| policy->cpu_count > ES_MAXIMUM_THREAD_POLICY_CPU_COUNT)
+		return ES_FAILURE;
+
+	for(i = 0; i < policy->cpu_count; ++i) {
+		if(policy->cpus[i] < 0 || policy->cpus[i] >= CPU_SETSIZE)
+			return ES_FAILURE;
+	}
+
+	if(policy->realtime && (policy->priority < sched_get_priority_min(SCHED_FIFO)
+			|| policy->priority > sched_get_priority_max(SCHED_FIFO)))
+		return ES_FAILURE;
+
+	return ES_SUCCESS;
+}
+
+/**
+ * Sets the CPUs a thread policy pins threads to.
+ *
+ * @param policy The thread policy to be updated.
+ * @param cpu_list The comma separated list of CPUs or CPU ranges, e.g.
+ * "0,2-3".
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_set_thread_policy_cpus(
+	struct es_thread_policy *policy,
+	const char *cpu_list)
+{
+	int cpu;
+	int cpu_count = 0;
+	long first;
+	long last;
+	char *end = NULL;
+	const char *position = cpu_list;
+	int cpus[ES_MAXIMUM_THREAD_POLICY_CPU_COUNT];
+
+	/* Perform sanity checks. */
+	if(es_validate_thread_policy(policy) != ES_SUCCESS)
+		return ES_FAILURE;
+
+	if(!cpu_list || !(*cpu_list))
+		return ES_FAILURE;
+
+	/* Parse every CPU or CPU range of the list. */
+	while(*position) {
+		first = strtol(position, &end, 10);
+		if(end == position)
+			return ES_FAILURE;
+
+		last = first;
+		if(*end == '-') {
+			position = end + 1;
+			last = strtol(position, &end, 10);
+			if(end == position)
+				return ES_FAILURE;
+		}
+
+		if(first < 0 || last < first || last >= CPU_SETSIZE)
+			return ES_FAILURE;
+
+		for(cpu = first; cpu <= last; ++cpu) {
+			if(cpu_count == ES_MAXIMUM_THREAD_POLICY_CPU_COUNT)
+				return ES_FAILURE;
+
+			cpus[cpu_count++] = cpu;
+		}
+
+		if(*end == ',')
+			++end;
+		else if(*end)
+			return ES_FAILURE;
+
+		position = end;
+	}
+
+	/* Update the policy only once the whole list was parsed. */
+	memcpy(policy->cpus, cpus, cpu_count * sizeof(int));
+	policy->cpu_count = cpu_count;
+
+	return ES_SUCCESS;
+}
+
+/**
+ * Makes a thread policy schedule threads with SCHED_FIFO.
+ *
+ * @param policy The thread policy to be updated.
+ * @param priority The SCHED_FIFO priority of the threads.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_set_thread_policy_realtime(
+	struct es_thread_policy *policy,
+	const int priority)
+{
+	/* Perform sanity checks. */
+	if(es_validate_thread_policy(policy) != ES_SUCCESS)
+		return ES_FAILURE;
+
+	if(priority < sched_get_priority_min(SCHED_FIFO)
+			|| priority > sched_get_priority_max(SCHED_FIFO))
+		return ES_FAILURE;
+
+	policy->realtime = TRUE;
+	policy->priority = priority;
+
+	return ES_SUCCESS;
+}
+
+/**
+ * Applies a thread policy to a running thread. Scheduling threads with
+ * SCHED_FIFO requires the CAP_SYS_NICE capability.
+ *
+ * @param policy The thread policy to be applied, or NULL to leave the thread
+ * untouched.
+ * @param thread The thread to which the policy will be applied.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_apply_thread_policy(
+	struct es_thread_policy *policy,
+	pthread_t thread)
+{
+	int i;
+	int ret = ES_SUCCESS;
+	cpu_set_t cpus;
+	struct sched_param parameters;
+
+	/* Perform sanity checks. */
+	if(!policy)
+		return ES_SUCCESS;
+
+	if(es_validate_thread_policy(policy) != ES_SUCCESS)
+		return ES_FAILURE;
+
+	/* Pin the thread to the policy CPUs. */
+	if(policy->cpu_count > 0) {
+		CPU_ZERO(&cpus);
+		for(i = 0; i < policy->cpu_count; ++i)
+			CPU_SET(policy->cpus[i], &cpus);
+
+		if(pthread_setaffinity_np(thread, sizeof(cpu_set_t), &cpus))
+			ret = ES_FAILURE;
+	}
+
+	/* Raise the thread to the real-time scheduling policy. */
+	if(policy->realtime) {
+		memset(&parameters, 0, sizeof(struct sched_param));
+		parameters.sched_priority = policy->priority;
+
+		if(pthread_setschedparam(thread, SCHED_FIFO, &parameters))
+			ret = ES_FAILURE;
+	}
+
+	return ret;
+}
+
+/**
+ * Initializes thread attributes holding a thread policy, so that a thread is
+ * created pinned and with its scheduling policy in place. Scheduling threads
+ * with SCHED_FIFO requires the CAP_SYS_NICE capability when the thread is
+ * created. The attributes must be destroyed with pthread_attr_destroy.
+ *
+ * @param policy The thread policy to be held, or NULL for the default
+ * attributes.
+ * @param attributes The thread attributes to be initialized.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_init_thread_policy_attributes(
+	struct es_thread_policy *policy,
+	pthread_attr_t *attributes)
+{
+	int i;
+	int status = ES_FAILURE;
+	cpu_set_t cpus;
+	struct sched_param parameters;
+
+	/* Perform sanity checks. */
+	if(!attributes)
+		return ES_FAILURE;
+
+	if(policy && es_validate_thread_policy(policy) != ES_SUCCESS)
+		return ES_FAILURE;
+
+	if(pthread_attr_init(attributes))
+		return ES_FAILURE;
+
+	if(!policy)
+		return ES_SUCCESS;
+
+	/* Pin the thread to the policy CPUs. */
+	if(policy->cpu_count > 0) {
+		CPU_ZERO(&cpus);
+		for(i = 0; i < policy->cpu_count; ++i)
+			CPU_SET(policy->cpus[i], &cpus);
+
+		if(pthread_attr_setaffinity_np(attributes, sizeof(cpu_set_t), &cpus))
+			goto exit;
+	}
+
+	/* Start the thread with the real-time scheduling policy. */
+	if(policy->realtime) {
+		memset(&parameters, 0, sizeof(struct sched_param));
+		parameters.sched_priority = policy->priority;
+
+		if(pthread_attr_setinheritsched(attributes, PTHREAD_EXPLICIT_SCHED))
+			goto exit;
+
+		if(pthread_attr_setschedpolicy(attributes, SCHED_FIFO))
+			goto exit;
+
+		if(pthread_attr_setschedparam(attributes, &parameters))
+			goto exit;
+	}
+
+	/* Update the operation status. */
+	status = ES_SUCCESS;
+
+exit:
+	/* If the operation failed, destroy the partially set attributes. */
+	if(status == ES_FAILURE)
+		pthread_attr_destroy(attributes);
+
+	return status;
+}
+
+/**
+ * Creates a thread placed and scheduled according to a thread policy. The
+ * policy is set on the thread attributes before the thread starts. If the
+ * thread cannot be created with them, e.g. because SCHED_FIFO is not
+ * permitted, it is created with the default attributes and the policy is
+ * applied to the running thread instead.
+ *
+ * @param policy The thread policy to be applied, or NULL to leave the thread
+ * untouched.
+ * @param thread Output parameter holding the created thread.
+ * @param routine The routine run by the thread.
+ * @param argument The argument passed to the routine.
+ * @param applied Output parameter set to TRUE if the whole policy is in effect,
+ * FALSE otherwise.
+ * @return ES_SUCCESS if the thread was created, ES_FAILURE otherwise.
+ */
+const int es_create_policy_thread(
+	struct es_thread_policy *policy,
+	pthread_t *thread,
+	void *(*routine)(void*),
+	void *argument,
+	int *applied)
+{
+	int created = FALSE;
+	pthread_attr_t attributes;
+
+	/* Perform sanity checks. */
+	if(!thread || !routine || !applied)
+		return ES_FAILURE;
+
+	*applied = FALSE;
+
+	/* Create the thread with the policy already in place. */
+	if(es_init_thread_policy_attributes(policy, &attributes) == ES_SUCCESS) {
+		created = !pthread_create(thread, &attributes, routine, argument);
+		pthread_attr_destroy(&attributes);
+	}
+
+	if(created) {
+		*applied = TRUE;
+		return ES_SUCCESS;
+	}
+
+	/*
+	 * Fall back to the default attributes and apply as much of the policy as
+	 * possible to the running thread.
+	 */
+	if(pthread_create(thread, NULL, routine, argument))
+		return ES_FAILURE;
+
+	*applied = (es_apply_thread_policy(policy, *thread) == ES_SUCCESS);
+
+	return ES_SUCCESS;
+}
+
+/**
+ * Gets the CPU time consumed by a running thread.
+ *
+ * @param thread The thread to be checked.
+ * @param cpu_time Output parameter holding the CPU time in nanoseconds.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_get_thread_cpu_time(pthread_t thread, unsigned long *cpu_time)
+{
+	clockid_t clock;
+	struct timespec time;
+
+	/* Perform sanity checks. */
+	if(!cpu_time)
+		return ES_FAILURE;
+
+	*cpu_time = 0;
+
+	if(pthread_getcpuclockid(thread, &clock))
+		return ES_FAILURE;
+
+	if(clock_gettime(clock, &time))
+		return ES_FAILURE;
+
+	*cpu_time = time.tv_sec * 1000000000UL + time.tv_nsec;
+
+	return ES_SUCCESS;
+}
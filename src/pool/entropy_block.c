@@ -29,12 +29,15 @@
 
 #include <stdlib.h>
 #include <string.h>
-#include <pthread.h>
 
 #include <global/defs.h>
 #include <global/math_defs.h>
 #include <global/alloc_type.h>
+#include <global/memory.h>
 #include <crypto/digest.h>
+#include <crypto/hkdf.h>
+#include <crypto/tree_hash.h>
+#include <crypto/xor.h>
 #include <pool/entropy_block_digest.h>
 
 /**
@@ -80,14 +83,17 @@ static char* es_alloc_entropy_array(const int size, const int alloc_type)
 }
 
 /**
- * Clears the contents of a given entropy array.
+ * Clears the contents of a given entropy array. The whole array is cleared,
+ * not only the part preceding the first NULL character, since the array may
+ * hold stale entropy bytes past that point.
  *
  * @param array The array to be cleared.
+ * @param size The size of the specified array.
  */
-inline static void es_clear_entropy_array(char *array)
+inline static void es_clear_entropy_array(char *array, const int size)
 {
 	/* Clear the contents of the specified entropy array. */
-	memset(array, 0, sizeof(char) * strlen(array));
+	memset(array, 0, sizeof(char) * size);
 }
 
 /**
@@ -96,11 +102,12 @@ inline static void es_clear_entropy_array(char *array)
  * in danger of being leaked.
  *
  * @param array The array to be freed.
+ * @param size The size of the specified array.
  */
-static void es_free_entropy_array(char **array)
+static void es_free_entropy_array(char **array, const int size)
 {
 	/* Clear the contents of the specified entropy array. */
-	es_clear_entropy_array(*array);
+	es_clear_entropy_array(*array, size);
 
 	/* Free the entropy array. */
 	free(*array);
@@ -111,15 +118,106 @@ static void es_free_entropy_array(char **array)
  * Compute the entropy percentage of the specified array in relation to the
  * maximum block threshold.
  *
- * @param array The array for which the percentage will be computed.
+ * @param length The number of bytes stored in the array.
  * @param size The size of the specified array.
  * @return The entropy percentage of the specified array.
  */
 static inline const double es_compute_array_entropy_percentage(
-	const char *array,
+	const int length,
 	const int size)
 {
-	return ((double)(strlen(array) * ES_MAXIMUM_BLOCK_THRESHOLD)) / size;
+	return ((double)(length * ES_MAXIMUM_BLOCK_THRESHOLD)) / size;
+}
+
+/**
+ * Publishes the buffer of the specified entropy block by swapping it with the
+ * main entropy array. The swap is atomic so that readers holding the published
+ * pointer always see a complete array, never a partially written one. The
+ * previous main entropy array becomes the buffer and is cleared in order to
+ * avoid any leaks of sensitive information (in this case, entropy bytes) and
+ * to let the next refill start on it right away.
+ *
+ * @param block The entropy block for which the arrays will be swapped.
+ */
+static inline void es_swap_entropy_block_arrays(struct es_entropy_block *block)
+{
+	block->buffer = __atomic_exchange_n(
+		&block->content,
+		block->buffer,
+		__ATOMIC_ACQ_REL);
+
+	es_clear_entropy_array(block->buffer, block->size);
+	block->buffer_length = 0;
+}
+
+/**
+ * Moves the specified entropy block from the expected packed state word to the
+ * specified state with a single compare-and-swap operation, advancing the block
+ * generation.
+ *
+ * @param block The entropy block to be updated.
+ * @param expected The packed state word the block is expected to hold.
+ * @param to_state The state in which the block will be after the update.
+ * @param ticket Output parameter representing the packed state word written by
+ * the update. May be NULL.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+static inline const int es_swap_entropy_block_state(
+	struct es_entropy_block *block,
+	unsigned long expected,
+	const int to_state,
+	unsigned long *ticket)
+{
+	unsigned long desired = ES_PACK_BLOCK_STATE(
+		to_state,
+		ES_UNPACK_BLOCK_GENERATION(expected) + 1);
+
+	if(!__atomic_compare_exchange_n(
+			&block->state,
+			&expected,
+			desired,
+			FALSE,
+			__ATOMIC_ACQ_REL,
+			__ATOMIC_ACQUIRE))
+		return ES_FAILURE;
+
+	if(ticket)
+		*ticket = desired;
+
+	return ES_SUCCESS;
+}
+
+/**
+ * Publishes the freshly mixed content of the specified entropy block by moving
+ * the block to the clean state.
+ *
+ * @param block The entropy block to be published.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+static const int es_publish_entropy_block(struct es_entropy_block *block)
+{
+	unsigned long word;
+
+	while(TRUE) {
+		word = es_load_entropy_block_state(block);
+
+		/* Only blocks being filled or waiting to be filled can be published. */
+		switch(ES_UNPACK_BLOCK_STATE(word)) {
+			case ES_FILLING_BLOCK_STATE:
+			case ES_DIRTY_BLOCK_STATE:
+				break;
+
+			default:
+				return ES_FAILURE;
+		}
+
+		if(es_swap_entropy_block_state(
+				block,
+				word,
+				ES_CLEAN_BLOCK_STATE,
+				NULL) == ES_SUCCESS)
+			return ES_SUCCESS;
+	}
 }
 
 /**
@@ -149,6 +247,15 @@ struct es_entropy_block* es_alloc_entropy_block(
 	if(!block)
 		goto exit;
 
+	/*
+	 * The size is needed as early as this in order to be able to clear the
+	 * internal arrays if the allocation fails midway.
+	 */
+	block->size = size;
+	block->content = NULL;
+	block->buffer = NULL;
+	block->buffer_length = 0;
+
 	/* Allocate memory for the main entropy array. */
 	block->content = es_alloc_entropy_array(size, alloc_type);
 	if(!block->content)
@@ -162,10 +269,6 @@ struct es_entropy_block* es_alloc_entropy_block(
 	if(!block->buffer)
 		goto exit;
 
-	/* Initialize the underlying mutex. */
-	if(pthread_mutex_init(&block->mutex, NULL))
-		goto exit;
-
 	/* Update the operation status. */
 	status = ES_SUCCESS;
 
@@ -190,12 +293,9 @@ void es_free_entropy_block(struct es_entropy_block **block)
 
 	/* Free both the main entropy array and the internal buffer. */
 	if((*block)->content)
-		es_free_entropy_array(&(*block)->content);
+		es_free_entropy_array(&(*block)->content, (*block)->size);
 	if((*block)->buffer)
-		es_free_entropy_array(&(*block)->buffer);
-
-	/* Destroy the mutex associated with the current entropy block. */
-	pthread_mutex_destroy(&(*block)->mutex);
+		es_free_entropy_array(&(*block)->buffer, (*block)->size);
 
 	/* Free the entropy block structure. */
 	free(*block);
@@ -220,9 +320,15 @@ const int es_init_entropy_block(struct es_entropy_block *block, const int size)
 
 	/* Initialize the structure fields with their default values. */
 	block->size = size;
-	block->state = ES_DIRTY_BLOCK_STATE;
+	block->buffer_length = 0;
+	block->state = ES_PACK_BLOCK_STATE(ES_DIRTY_BLOCK_STATE, 0);
 	block->threshold = ES_MINIMUM_BLOCK_THRESHOLD;
 	block->digest_type = ES_SHA512_DIGEST;
+	block->digest_backend = ES_DEFAULT_DIGEST_BACKEND;
+	block->mixer = es_get_block_mixer(
+		block->digest_type,
+		block->digest_backend,
+		block->size);
 
 	return ES_SUCCESS;
 }
@@ -299,19 +405,54 @@ const int es_validate_entropy_block(struct es_entropy_block *block)
 	if(!block->buffer)
 		return ES_FAILURE;
 
-	if(es_validate_entropy_block_state(block->state) != ES_SUCCESS)
+	if(block->buffer_length < 0 || block->buffer_length > block->size)
+		return ES_FAILURE;
+
+	if(es_validate_entropy_block_state(
+			es_get_entropy_block_state(block)) != ES_SUCCESS)
 		return ES_FAILURE;
 
 	if(block->threshold < ES_MINIMUM_BLOCK_THRESHOLD
-			|| ES_MINIMUM_BLOCK_THRESHOLD > ES_MAXIMUM_BLOCK_THRESHOLD)
+			|| block->threshold > ES_MAXIMUM_BLOCK_THRESHOLD)
 		return ES_FAILURE;
 
-	if(!es_validate_digest_type(block->digest_type) != ES_SUCCESS)
+	if(es_validate_digest_pair(
+			block->digest_type,
+			block->digest_backend) != ES_SUCCESS)
 		return ES_FAILURE;
 
 	return ES_SUCCESS;
 }
 
+/**
+ * Sets the digest used to mix the specified entropy block and binds the block
+ * mixer specialized for the digest and the block size, if any.
+ *
+ * @param block The entropy block to be updated.
+ * @param digest_type The digest algorithm code.
+ * @param digest_backend The digest backend code.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_set_entropy_block_digest(
+	struct es_entropy_block *block,
+	const int digest_type,
+	const int digest_backend)
+{
+	/* Perform sanity checks. */
+	if(!block)
+		return ES_FAILURE;
+
+	if(es_validate_digest_pair(digest_type, digest_backend) != ES_SUCCESS)
+		return ES_FAILURE;
+
+	/* Update the digest and bind the matching specialized mixer. */
+	block->digest_type = digest_type;
+	block->digest_backend = digest_backend;
+	block->mixer = es_get_block_mixer(digest_type, digest_backend, block->size);
+
+	return ES_SUCCESS;
+}
+
 /**
  * Updates the contents of the specified entropy block with the new content
  * array. Depending on the value of the block threshold, the content may be
@@ -319,27 +460,58 @@ const int es_validate_entropy_block(struct es_entropy_block *block)
  *
  * @param block The entropy block to be updated.
  * @param content The contents to be written to the specified entropy block.
+ * @param length The number of bytes of content.
  * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
  */
 const int es_update_entropy_block_content(
 	struct es_entropy_block *block,
-	const char *content)
+	const char *content,
+	const int length)
+{
+	/* Append the given content to the entropy block buffer. */
+	if(es_append_entropy_block_content(block, content, length) != ES_SUCCESS)
+		return ES_FAILURE;
+
+	/*
+	 * Only if the buffer reached the threshold should the buffer content be
+	 * mixed with the main entropy array.
+	 */
+	if(es_check_entropy_block_ready(block) != ES_SUCCESS)
+		return ES_SUCCESS;
+
+	return es_mix_entropy_blocks(&block, 1);
+}
+
+/**
+ * Appends the new content array to the buffer of the specified entropy block,
+ * without mixing it into the main array. The content is binary and may include
+ * NUL characters.
+ *
+ * @param block The entropy block to be updated.
+ * @param content The contents to be appended to the entropy block buffer.
+ * @param length The number of bytes of content.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_append_entropy_block_content(
+	struct es_entropy_block *block,
+	const char *content,
+	const int length)
 {
-	int buffer_size = 0;
 	int copy_size = 0;
-	double block_percentage = 0.0;
-	char *digest = NULL;
 
 	/* Perform sanity checks. */
 	if(!block)
 		return ES_FAILURE;
 
-	if(!es_validate_entropy_block(block) != ES_SUCCESS)
+	if(es_validate_entropy_block(block) != ES_SUCCESS)
 		return ES_FAILURE;
 
 	if(!content)
 		return ES_FAILURE;
 
+	if(length < 0)
+		return ES_FAILURE;
+
 	/*
 	 * Append the given content to the entropy block buffer. In some cases there
 	 * might be only a partial copy of the given content into the buffer (when
@@ -348,56 +520,425 @@ const int es_update_entropy_block_content(
 	 * minimum value between the size of the given content and the remaining
 	 * space in the entropy block buffer.
 	 */
-	buffer_size = strlen(block->buffer);
-	copy_size = es_min(strlen(content), block->size - buffer_size - 1);
-	strncat(block->buffer, content, copy_size);
-	block->buffer[strlen(block->buffer) - 1] = '\0';
+	copy_size = es_min(length, block->size - block->buffer_length);
+	memcpy(block->buffer + block->buffer_length, content, copy_size);
+	block->buffer_length += copy_size;
+
+	return ES_SUCCESS;
+}
+
+/**
+ * Checks whether the buffer of the specified entropy block reached the block
+ * threshold, i.e. whether the block is ready to be mixed.
+ *
+ * @param block The entropy block to be checked.
+ * @return ES_SUCCESS if the block is ready to be mixed, ES_FAILURE otherwise.
+ */
+const int es_check_entropy_block_ready(struct es_entropy_block *block)
+{
+	double block_percentage = 0.0;
+
+	/* Perform sanity checks. */
+	if(!block)
+		return ES_FAILURE;
 
 	/*
 	 * Compute the entropy percentage for the entropy block buffer. If the
-	 * percentage is lower than the threshold, then the update ends here. Only
-	 * if the percentage is higher or at least equal with the threshold should
-	 * the buffer content be mixed with the main entropy array.
+	 * percentage is lower than the threshold, the block is not ready yet.
 	 */
 	block_percentage = es_compute_array_entropy_percentage(
-		block->buffer,
+		block->buffer_length,
 		block->size);
 	if(block->threshold > block_percentage)
-		return ES_SUCCESS;
+		return ES_FAILURE;
 
-	/*
-	 * Mix both the main entropy array and the entropy block buffer by computing
-	 * their digest.
-	 */
-	if(es_compute_digest_2(
-			block->digest_type,
-			block->content,
+	return ES_SUCCESS;
+}
+
+/**
+ * Stretches a digest shorter than its entropy block over the whole block
+ * buffer, so that no padding is ever served. The digest is extracted into a
+ * pseudorandom key and expanded with HKDF-SHA-512 over the block size.
+ *
+ * @param block The entropy block whose buffer holds the digest.
+ * @param digest_length The number of digest bytes at the start of the buffer.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+static const int es_stretch_entropy_block_digest(
+	struct es_entropy_block *block,
+	const int digest_length)
+{
+	int ret = ES_FAILURE;
+	unsigned char prk[ES_HKDF_PRK_SIZE];
+
+	/* Extract a pseudorandom key from the digest. */
+	if(es_hkdf_extract(
+			NULL,
+			0,
 			block->buffer,
-			&digest) != ES_SUCCESS)
+			digest_length,
+			prk) != ES_SUCCESS)
+		goto exit;
+
+	/* Expand the key over the whole buffer, replacing the digest. */
+	if(es_hkdf_expand(
+			prk,
+			ES_HKDF_STRETCH_INFO,
+			sizeof(ES_HKDF_STRETCH_INFO) - 1,
+			block->buffer,
+			block->size) != ES_SUCCESS)
+		goto exit;
+
+	/* Update the operation status. */
+	ret = ES_SUCCESS;
+
+exit:
+	/* Wipe the pseudorandom key, and the buffer if the stretch failed. */
+	es_wipe_memory(prk, ES_HKDF_PRK_SIZE);
+	if(ret != ES_SUCCESS)
+		es_wipe_memory(block->buffer, block->size);
+
+	return ret;
+}
+
+/**
+ * Swaps the freshly mixed buffers of the specified entropy blocks in as their
+ * main arrays and publishes the blocks. Digests shorter than their block are
+ * stretched over the whole block first.
+ *
+ * @param blocks The mixed entropy blocks.
+ * @param jobs The digest jobs of the blocks, holding the number of digest bytes
+ * written to each buffer, or zero if the mix failed.
+ * @param count The number of entropy blocks.
+ * @param status The status of the mix.
+ * @return ES_SUCCESS if the mix and the publication were successfull,
+ * ES_FAILURE otherwise.
+ */
+static const int es_publish_mixed_entropy_blocks(
+	struct es_entropy_block **blocks,
+	struct es_digest_job *jobs,
+	const int count,
+	const int status)
+{
+	int i;
+	int ret = status;
+
+	for(i = 0; i < count; ++i) {
+		/* Leave the blocks whose digest failed untouched. */
+		if(jobs[i].digest_length <= 0)
+			continue;
+
+		/* Stretch a digest shorter than the block over the whole buffer. */
+		if(jobs[i].digest_length < blocks[i]->size
+				&& es_stretch_entropy_block_digest(
+					blocks[i],
+					jobs[i].digest_length) != ES_SUCCESS) {
+			ret = ES_FAILURE;
+			continue;
+		}
+
+		/* Swap the freshly mixed array in as the main entropy array. */
+		es_swap_entropy_block_arrays(blocks[i]);
+
+		/*
+		 * Change the block state to clean now that the new content has been
+		 * written. The block is normally held in the filling state by the
+		 * device thread updating it, but an unclaimed dirty block is published
+		 * as well.
+		 */
+		if(es_publish_entropy_block(blocks[i]) != ES_SUCCESS)
+			ret = ES_FAILURE;
+	}
+
+	return ret;
+}
+
+/**
+ * Mixes the buffers of the specified entropy blocks with their main arrays in
+ * tree mode. Every buffer is zero padded, combined with its main array using
+ * XOR and replaced with the SHA-512 Merkle tree hash of the combination. The
+ * tree hashes of all the blocks are computed as a single batch.
+ *
+ * @param blocks The entropy blocks to be mixed.
+ * @param jobs The digest jobs of the blocks. On output, the digest length of
+ * each job holds the number of digest bytes written to the buffer, or zero if
+ * the operation failed.
+ * @param count The number of entropy blocks, at most
+ * ES_MAXIMUM_DIGEST_BATCH_SIZE.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+static const int es_tree_mix_entropy_blocks(
+	struct es_entropy_block **blocks,
+	struct es_digest_job *jobs,
+	const int count)
+{
+	int i;
+	int ret = ES_FAILURE;
+	const char *data[ES_MAXIMUM_DIGEST_BATCH_SIZE];
+	long lengths[ES_MAXIMUM_DIGEST_BATCH_SIZE];
+	char *digests[ES_MAXIMUM_DIGEST_BATCH_SIZE];
+	char digest_data[ES_MAXIMUM_DIGEST_BATCH_SIZE][ES_TREE_HASH_NODE_SIZE];
+
+	/* Perform sanity checks. */
+	for(i = 0; i < count; ++i) {
+		jobs[i].digest_length = 0;
+
+		if(es_validate_entropy_block(blocks[i]) != ES_SUCCESS)
+			return ES_FAILURE;
+	}
+
+	/* Combine the main arrays and the zero padded buffers in place. */
+	for(i = 0; i < count; ++i) {
+		memset(
+			blocks[i]->buffer + blocks[i]->buffer_length,
+			0,
+			blocks[i]->size - blocks[i]->buffer_length);
+		es_xor_bytes(
+			blocks[i]->buffer,
+			blocks[i]->buffer,
+			blocks[i]->content,
+			blocks[i]->size);
+
+		data[i] = blocks[i]->buffer;
+		lengths[i] = blocks[i]->size;
+		digests[i] = digest_data[i];
+	}
+
+	if(es_compute_tree_hashes(data, lengths, digests, count) == ES_SUCCESS)
+		ret = ES_SUCCESS;
+
+	/* Replace the combinations with the tree hashes. */
+	for(i = 0; i < count; ++i) {
+		es_wipe_memory(blocks[i]->buffer, blocks[i]->size);
+		if(ret == ES_FAILURE)
+			continue;
+
+		jobs[i].digest_length = es_min(ES_TREE_HASH_NODE_SIZE, blocks[i]->size);
+		memcpy(blocks[i]->buffer, digest_data[i], jobs[i].digest_length);
+	}
+
+	es_wipe_memory(digest_data, sizeof(digest_data));
+
+	return ret;
+}
+
+/**
+ * Mixes the buffers of the specified entropy blocks with their main arrays and
+ * publishes the blocks. The digests of all the blocks are computed as a single
+ * batch, so the blocks must share the same digest type and digest backend.
+ *
+ * @param blocks The entropy blocks to be mixed.
+ * @param count The number of entropy blocks, at most
+ * ES_MAXIMUM_DIGEST_BATCH_SIZE.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_mix_entropy_blocks(
+	struct es_entropy_block **blocks,
+	const int count)
+{
+	int i;
+	int ret = ES_SUCCESS;
+	struct es_digest_job jobs[ES_MAXIMUM_DIGEST_BATCH_SIZE];
+
+	/* Perform sanity checks. */
+	if(!blocks)
+		return ES_FAILURE;
+
+	if(count <= 0 || count > ES_MAXIMUM_DIGEST_BATCH_SIZE)
 		return ES_FAILURE;
 
+	/* Blocks using the keyed extractor are conditioned one at a time. */
+	if(blocks[0]->digest_type == ES_HKDF_SHA512_DIGEST) {
+		for(i = 0; i < count; ++i) {
+			if(es_expand_entropy_blocks(&blocks[i], 1) != ES_SUCCESS)
+				ret = ES_FAILURE;
+		}
+
+		return ret;
+	}
+
+	/* Blocks using the tree hash are mixed as a single tree hash batch. */
+	if(blocks[0]->digest_type == ES_TREE_SHA512_DIGEST) {
+		if(es_tree_mix_entropy_blocks(blocks, jobs, count) != ES_SUCCESS)
+			ret = ES_FAILURE;
+
+		return es_publish_mixed_entropy_blocks(blocks, jobs, count, ret);
+	}
+
 	/*
-	 * The entropy block buffer and the main entropy array must be cleared in
-	 * order to avoid any leaks of sensitive information (in this case, entropy
-	 * bytes).
+	 * Blocks with a specialized mixer, bound when their digest was set, are
+	 * mixed through direct calls over constant sizes, without re-validating
+	 * the digest on every mix, unless a multi-lane kernel digests the batch.
 	 */
-	es_clear_entropy_array(block->content);
-	es_clear_entropy_array(block->buffer);
+	if(blocks[0]->mixer && es_check_digest_batch_lanes(
+			blocks[0]->digest_type,
+			count) != ES_SUCCESS) {
+		for(i = 0; i < count; ++i) {
+			if(blocks[i]->mixer != blocks[0]->mixer)
+				return ES_FAILURE;
+		}
+
+		for(i = 0; i < count; ++i) {
+			if(blocks[i]->mixer(
+					blocks[i]->content,
+					blocks[i]->buffer,
+					blocks[i]->buffer_length,
+					blocks[i]->digest_backend,
+					&jobs[i].digest_length) != ES_SUCCESS)
+				ret = ES_FAILURE;
+		}
+
+		return es_publish_mixed_entropy_blocks(blocks, jobs, count, ret);
+	}
+
+	for(i = 0; i < count; ++i) {
+		if(es_validate_entropy_block(blocks[i]) != ES_SUCCESS)
+			return ES_FAILURE;
+
+		if(blocks[i]->digest_type != blocks[0]->digest_type
+				|| blocks[i]->digest_backend != blocks[0]->digest_backend)
+			return ES_FAILURE;
+
+		/*
+		 * Mix both the main entropy array and the entropy block buffer by
+		 * computing their raw digest. The main entropy array holds binary
+		 * digest bytes, so it is mixed over its whole size. The digest is
+		 * written straight into the buffer, which becomes the inactive array
+		 * of the double buffer, since it is only written once both arrays are
+		 * fully digested. The buffer doubles as the scratch buffer where the
+		 * two arrays are combined in place.
+		 */
+		jobs[i].data_1 = blocks[i]->content;
+		jobs[i].data_1_length = blocks[i]->size;
+		jobs[i].data_2 = blocks[i]->buffer;
+		jobs[i].data_2_length = blocks[i]->buffer_length;
+		jobs[i].scratch_data = blocks[i]->buffer;
+		jobs[i].digest_data = blocks[i]->buffer;
+		jobs[i].digest_length = blocks[i]->size;
+	}
 
-	/* Copy the contents of the computed digest into the main entropy array. */
-	strncpy(block->content, digest, block->size - 1);
-	block->content[block->size - 1] = '\0';
+	/* Compute the digests of all the blocks as a single batch. */
+	if(es_compute_digest_batch(
+			blocks[0]->digest_type,
+			blocks[0]->digest_backend,
+			jobs,
+			count) != ES_SUCCESS)
+		ret = ES_FAILURE;
 
-	/* Free the digest array. */
-	free(digest);
+	return es_publish_mixed_entropy_blocks(blocks, jobs, count, ret);
+}
+
+/**
+ * Conditions the specified entropy blocks with the HKDF-SHA-512 keyed
+ * extractor and publishes them. A single extract is performed over the buffer
+ * of the first block, keyed with its current content, and the resulting
+ * pseudorandom key is expanded into the content of every block. Only the first
+ * block needs to be filled; the other blocks are only claimed.
+ *
+ * @param blocks The entropy blocks to be conditioned.
+ * @param count The number of entropy blocks, at most
+ * ES_MAXIMUM_EXPANSION_FACTOR.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_expand_entropy_blocks(
+	struct es_entropy_block **blocks,
+	const int count)
+{
+	int i;
+	int ret = ES_SUCCESS;
+	char info[sizeof(ES_HKDF_BLOCK_INFO)];
+	unsigned char prk[ES_HKDF_PRK_SIZE];
+
+	/* Perform sanity checks. */
+	if(!blocks)
+		return ES_FAILURE;
+
+	if(count <= 0 || count > ES_MAXIMUM_EXPANSION_FACTOR)
+		return ES_FAILURE;
+
+	for(i = 0; i < count; ++i) {
+		if(es_validate_entropy_block(blocks[i]) != ES_SUCCESS)
+			return ES_FAILURE;
+
+		if(blocks[i]->digest_type != ES_HKDF_SHA512_DIGEST)
+			return ES_FAILURE;
+	}
 
 	/*
-	 * Change the block state to clean now that the new content has been
-	 * written.
+	 * Extract a pseudorandom key from the device input accumulated in the first
+	 * block buffer, using its previous content as the salt, so that the block
+	 * output stays chained.
 	 */
-	block->state = ES_CLEAN_BLOCK_STATE;
+	if(es_hkdf_extract(
+			blocks[0]->content,
+			blocks[0]->size,
+			blocks[0]->buffer,
+			blocks[0]->buffer_length,
+			prk) != ES_SUCCESS)
+		return ES_FAILURE;
 
-	return ES_SUCCESS;
+	/* The context information is a fixed label followed by the block slot. */
+	memcpy(info, ES_HKDF_BLOCK_INFO, sizeof(ES_HKDF_BLOCK_INFO) - 1);
+
+	for(i = 0; i < count; ++i) {
+		/* Expand the key into the inactive array of the block. */
+		info[sizeof(ES_HKDF_BLOCK_INFO) - 1] = (char)i;
+		es_clear_entropy_array(blocks[i]->buffer, blocks[i]->size);
+		if(es_hkdf_expand(
+				prk,
+				info,
+				sizeof(ES_HKDF_BLOCK_INFO),
+				blocks[i]->buffer,
+				blocks[i]->size) != ES_SUCCESS) {
+			ret = ES_FAILURE;
+			break;
+		}
+
+		/* Swap the expanded array in as the main entropy array. */
+		es_swap_entropy_block_arrays(blocks[i]);
+
+		/* Change the block state to clean. */
+		if(es_publish_entropy_block(blocks[i]) != ES_SUCCESS)
+			ret = ES_FAILURE;
+	}
+
+	/* Wipe the pseudorandom key. */
+	es_wipe_memory(prk, ES_HKDF_PRK_SIZE);
+
+	return ret;
+}
+
+/**
+ * Sets the content of the specified entropy block to already conditioned
+ * entropy bytes, bypassing the mixing step, and publishes the block. Used to
+ * refill blocks from conditioned entropy stored elsewhere (e.g. the spill
+ * tier).
+ *
+ * @param block The entropy block to be updated.
+ * @param content The conditioned content, of the block size.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_set_entropy_block_content(
+	struct es_entropy_block *block,
+	const char *content)
+{
+	/* Perform sanity checks. */
+	if(!block)
+		return ES_FAILURE;
+
+	if(es_validate_entropy_block(block) != ES_SUCCESS)
+		return ES_FAILURE;
+
+	if(!content)
+		return ES_FAILURE;
+
+	/* Write the conditioned content into the inactive array. */
+	memcpy(block->buffer, content, block->size);
+
+	/* Swap the inactive array in as the main entropy array and publish it. */
+	es_swap_entropy_block_arrays(block);
+
+	return es_publish_entropy_block(block);
 }
 
 /**
@@ -406,38 +947,174 @@ const int es_update_entropy_block_content(
  * function.
  *
  * @param block The entropy block for which we request the content.
- * @param content A copy of the contents of the specified entropy block.
+ * @param content A copy of the raw contents of the specified entropy block,
+ * of the block size.
  * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
  */
 const int es_request_entropy_block_content(
 	struct es_entropy_block *block,
 	char **content)
 {
+	unsigned long ticket;
+
 	/* Perform sanity checks. */
 	if(!block)
 		return ES_FAILURE;
 
-	if(!es_validate_entropy_block(block) != ES_SUCCESS)
+	if(es_validate_entropy_block(block) != ES_SUCCESS)
 		return ES_FAILURE;
 
-	if(block->state == ES_DIRTY_BLOCK_STATE)
+	/* Claim the clean entropy block for reading. */
+	if(es_claim_entropy_block(
+			block,
+			ES_CLEAN_BLOCK_STATE,
+			ES_READING_BLOCK_STATE,
+			&ticket) != ES_SUCCESS)
 		return ES_FAILURE;
 
 	/* Allocate memory for the entropy block content copy. */
 	*content = (char*)calloc(block->size, sizeof(char));
-	if(!*content)
+	if(!*content) {
+		/* Hand the untouched block back as clean. */
+		es_release_entropy_block(block, ticket, ES_CLEAN_BLOCK_STATE);
 		return ES_FAILURE;
+	}
 
-	/* Copy the contents of the current entropy block. */
-	strncpy(*content, block->content, block->size);
+	/* Copy the raw contents of the current entropy block. */
+	memcpy(
+		*content,
+		__atomic_load_n(&block->content, __ATOMIC_ACQUIRE),
+		block->size);
 
 	/*
 	 * Change the block state to dirty now that the block content has been
 	 * consumed.
 	 */
-	block->state = ES_DIRTY_BLOCK_STATE;
+	return es_release_entropy_block(block, ticket, ES_DIRTY_BLOCK_STATE);
+}
 
-	return ES_SUCCESS;
+/**
+ * Gets the published content of the specified entropy block without copying
+ * it. The returned array belongs to the block and stays valid until the block
+ * is consumed and mixed again, so the caller must hold the block while reading
+ * it.
+ *
+ * @param block The entropy block for which we request the content.
+ * @return The address of the published entropy array if the operation was
+ * successfull, NULL otherwise.
+ */
+const char* es_get_entropy_block_content(struct es_entropy_block *block)
+{
+	/* Perform sanity checks. */
+	if(!block)
+		return NULL;
+
+	if(es_validate_entropy_block(block) != ES_SUCCESS)
+		return NULL;
+
+	switch(es_get_entropy_block_state(block)) {
+		case ES_CLEAN_BLOCK_STATE:
+		case ES_READING_BLOCK_STATE:
+			/* The published array holds mixed entropy bytes. */
+			break;
+
+		default:
+			/* The published array is stale. */
+			return NULL;
+	}
+
+	/* Get the array published by the last mix operation. */
+	return __atomic_load_n(&block->content, __ATOMIC_ACQUIRE);
+}
+
+/**
+ * Atomically loads the packed state word of the specified entropy block.
+ *
+ * @param block The entropy block for which we request the state word.
+ * @return The packed state word of the specified entropy block.
+ */
+inline const unsigned long es_load_entropy_block_state(
+	struct es_entropy_block *block)
+{
+	return __atomic_load_n(&block->state, __ATOMIC_ACQUIRE);
+}
+
+/**
+ * Atomically loads the state of the specified entropy block.
+ *
+ * @param block The entropy block for which we request the state.
+ * @return The state of the specified entropy block.
+ */
+inline const int es_get_entropy_block_state(struct es_entropy_block *block)
+{
+	return ES_UNPACK_BLOCK_STATE(es_load_entropy_block_state(block));
+}
+
+/**
+ * Claims the specified entropy block by moving it from one state to another
+ * with a single compare-and-swap operation. The claim fails if the block is
+ * not found in the expected state.
+ *
+ * @param block The entropy block to be claimed.
+ * @param from_state The state in which the block is expected to be.
+ * @param to_state The state in which the block will be after the claim.
+ * @param ticket Output parameter representing the packed state word written by
+ * the claim. The ticket must be handed back when releasing the block.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_claim_entropy_block(
+	struct es_entropy_block *block,
+	const int from_state,
+	const int to_state,
+	unsigned long *ticket)
+{
+	unsigned long word;
+
+	/* Perform sanity checks. */
+	if(!block)
+		return ES_FAILURE;
+
+	if(!ticket)
+		return ES_FAILURE;
+
+	if(es_validate_entropy_block_state(to_state) != ES_SUCCESS)
+		return ES_FAILURE;
+
+	/* The claim fails right away if the block is not in the expected state. */
+	word = es_load_entropy_block_state(block);
+	if(ES_UNPACK_BLOCK_STATE(word) != from_state)
+		return ES_FAILURE;
+
+	/*
+	 * If another thread changed the block in the meantime, the generation no
+	 * longer matches and the claim fails.
+	 */
+	return es_swap_entropy_block_state(block, word, to_state, ticket);
+}
+
+/**
+ * Releases a previously claimed entropy block by moving it to the specified
+ * state. The release only succeeds if the block still holds the state word
+ * written by the matching claim.
+ *
+ * @param block The entropy block to be released.
+ * @param ticket The packed state word written by the matching claim.
+ * @param to_state The state in which the block will be after the release.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_release_entropy_block(
+	struct es_entropy_block *block,
+	const unsigned long ticket,
+	const int to_state)
+{
+	/* Perform sanity checks. */
+	if(!block)
+		return ES_FAILURE;
+
+	if(es_validate_entropy_block_state(to_state) != ES_SUCCESS)
+		return ES_FAILURE;
+
+	return es_swap_entropy_block_state(block, ticket, to_state, NULL);
 }
 
 /**
@@ -451,6 +1128,8 @@ inline const int es_validate_entropy_block_state(const int block_state)
 	switch(block_state) {
 		case ES_CLEAN_BLOCK_STATE:
 		case ES_DIRTY_BLOCK_STATE:
+		case ES_FILLING_BLOCK_STATE:
+		case ES_READING_BLOCK_STATE:
 			/* Block state is valid. */
 			return ES_SUCCESS;
 
@@ -32,138 +32,618 @@
 
 #include <global/defs.h>
 #include <global/math_defs.h>
+#include <global/memory.h>
 #include <crypto/digest.h>
+#include <crypto/xor.h>
+#include <crypto/sha_lanes.h>
 
 /**
- * Computes the digest for the given data set.
+ * Represents the size in bytes of the stack chunk used to stream the combination
+ * of two data sets into a digest.
+ */
+#define ES_DIGEST_CHUNK_SIZE 256
+
+/**
+ * Combines the two given data sets using XOR over their common length and
+ * streams the combined data set into the specified digest. The remainder of the
+ * longer data set is streamed as is. If a scratch buffer is given, the whole
+ * combination is written into it and digested at once, otherwise it is streamed
+ * through a small chunk on the stack. Either way, the combination is wiped once
+ * digested.
+ *
+ * @param digest The digest to be updated.
+ * @param data_1 The first data set.
+ * @param data_1_length The number of bytes in the first data set.
+ * @param data_2 The second data set.
+ * @param data_2_length The number of bytes in the second data set.
+ * @param scratch_data The scratch buffer, at least as long as the longer data
+ * set, or NULL. It may be one of the two data sets.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+static const int es_update_digest_combined(
+	struct es_digest *digest,
+	const char *data_1,
+	const int data_1_length,
+	const char *data_2,
+	const int data_2_length,
+	char *scratch_data)
+{
+	int i;
+	int chunk_size;
+	int minimum_size;
+	int maximum_size;
+	int ret = ES_SUCCESS;
+	const char *destination_data = NULL;
+	const char *source_data = NULL;
+	char chunk[ES_DIGEST_CHUNK_SIZE];
+
+	/* Decide which data set is the destination set and which is the source. */
+	destination_data = (data_1_length >= data_2_length) ? data_1 : data_2;
+	source_data = (data_1_length >= data_2_length) ? data_2 : data_1;
+	minimum_size = es_min(data_1_length, data_2_length);
+	maximum_size = es_max(data_1_length, data_2_length);
+
+	if(scratch_data) {
+		/*
+		 * Combine the two data sets in place, in the scratch buffer, using a
+		 * secure function like XOR, and digest the combination at once.
+		 */
+		es_xor_bytes(scratch_data, destination_data, source_data, minimum_size);
+		if(scratch_data != destination_data)
+			memcpy(
+				scratch_data + minimum_size,
+				destination_data + minimum_size,
+				maximum_size - minimum_size);
+
+		ret = es_update_digest_bytes(digest, scratch_data, maximum_size);
+
+		/* Wipe the combined data set. */
+		es_wipe_memory(scratch_data, maximum_size);
+
+		return ret;
+	}
+
+	/*
+	 * Combine the two data sets using a secure function like XOR and stream the
+	 * combined data set into the digest, one chunk at a time.
+	 */
+	for(i = 0; i < maximum_size; i += chunk_size) {
+		chunk_size = es_min(ES_DIGEST_CHUNK_SIZE, maximum_size - i);
+
+		memcpy(chunk, destination_data + i, chunk_size);
+		if(i < minimum_size)
+			es_xor_bytes(
+				chunk,
+				chunk,
+				source_data + i,
+				es_min(chunk_size, minimum_size - i));
+
+		if(es_update_digest_bytes(digest, chunk, chunk_size) != ES_SUCCESS) {
+			ret = ES_FAILURE;
+			break;
+		}
+	}
+
+	/* Wipe the combined data chunk. */
+	es_wipe_memory(chunk, ES_DIGEST_CHUNK_SIZE);
+
+	return ret;
+}
+
+/**
+ * Computes the raw digest for the given data set. No memory is allocated: the
+ * digest context is cached per thread and the output is written to the caller
+ * buffer.
  *
  * @param digest_type The digest type represents the digest algorithm code which
  * identifies a particular digest algorithm used to compute the digest.
+ * @param digest_backend The digest backend code representing the library
+ * implementing the digest algorithm.
  * @param data The data set for which the digest must be computed.
- * @param digest_data The output digest data.
+ * @param data_length The number of bytes in the data set.
+ * @param digest_data The buffer where to write the raw digest bytes.
+ * @param digest_length Input/output parameter representing the size of the
+ * digest buffer on input and the number of digest bytes written on output.
  * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
  */
 const int es_compute_digest_1(
 	const int digest_type,
+	const int digest_backend,
 	const char *data,
-	char **digest_data)
+	const int data_length,
+	char *digest_data,
+	int *digest_length)
 {
 	int ret = ES_FAILURE;
 	struct es_digest *digest = NULL;
 
 	/* Perform sanity checks. */
-	if(es_validate_digest_type(digest_type) != ES_SUCCESS)
+	if(es_validate_digest_pair(digest_type, digest_backend) != ES_SUCCESS)
+		goto exit;
+
+	if(!data || data_length < 0)
 		goto exit;
 
-	if(!data)
+	if(!digest_data || !digest_length)
 		goto exit;
 
-	/* Create a new digest. */
-	digest = es_create_digest(digest_type);
+	/*
+	 * Acquire the digest cached for the current thread, so that mixing does not
+	 * create and destroy a digest on every call.
+	 */
+	digest = es_acquire_digest(digest_type, digest_backend);
 	if(!digest)
 		goto exit;
 
 	/* Update the digest internal buffer using the specified data. */
-	if(es_update_digest(digest, data) != ES_SUCCESS)
+	if(es_update_digest_bytes(digest, data, data_length) != ES_SUCCESS)
 		goto exit;
 
-	/* Get the string representation of the digest internal buffer. */
-	*digest_data = es_get_digest_string(digest);
-	if(!digest_data)
+	/* Get the raw bytes of the digest internal buffer. */
+	if(es_get_digest_bytes(digest, digest_data, digest_length) != ES_SUCCESS)
 		goto exit;
 
 	/* Update the operation status. */
 	ret = ES_SUCCESS;
 
 exit:
-	/* If the operation failed, clear & free the digest data buffer. */
-	if(ret == ES_FAILURE && digest_data && *digest_data) {
-		memset(*digest_data, 0, es_get_digest_size(digest->type));
-		*digest_data[0] = '\0';
-	}
+	/* If the operation failed, report an empty digest. */
+	if(ret == ES_FAILURE && digest_length)
+		*digest_length = 0;
 
-	/* Destroy the digest. */
+	/* Reset the cached digest so that no mixed data lingers in it. */
 	if(digest)
-		es_destroy_digest(&digest);
+		es_reset_digest(digest);
 
 	return ret;
 }
 
 /**
- * Computes the digest for the two given data sets.
+ * Computes the raw digest for the two given data sets. The data sets are
+ * combined with XOR over their common length and the remainder of the longer
+ * one is kept as is. No memory is allocated: the combination is written into
+ * the caller scratch buffer, or streamed through a small chunk on the stack.
  *
  * @param digest_type The digest type represents the digest algorithm code which
  * identifies a particular digest algorithm used to compute the digest.
+ * @param digest_backend The digest backend code representing the library
+ * implementing the digest algorithm.
  * @param data_1 The first data set for which the digest must be computed.
+ * @param data_1_length The number of bytes in the first data set.
  * @param data_2 The second data set for which the digest must be computed.
- * @param digest_data The output digest data.
+ * @param data_2_length The number of bytes in the second data set.
+ * @param scratch_data The buffer where to combine the two data sets in place,
+ * at least as long as the longer data set, or NULL to stream the combination
+ * through a small chunk on the stack. It may be one of the two data sets. It is
+ * wiped once digested.
+ * @param digest_data The buffer where to write the raw digest bytes. It may
+ * overlap any of the data sets and the scratch buffer, since it is only written
+ * once both are fully digested.
+ * @param digest_length Input/output parameter representing the size of the
+ * digest buffer on input and the number of digest bytes written on output.
  * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
  */
 const int es_compute_digest_2(
 	const int digest_type,
+	const int digest_backend,
 	const char *data_1,
+	const int data_1_length,
 	const char *data_2,
-	char **digest_data)
+	const int data_2_length,
+	char *scratch_data,
+	char *digest_data,
+	int *digest_length)
 {
-	int i;
-	int data_1_size;
-	int data_2_size;
-	int minimum_digest_size;
 	int ret = ES_FAILURE;
-	char *destination_data = NULL;
-	char *source_data = NULL;
+	struct es_digest *digest = NULL;
 
 	/* Perform sanity checks. */
-	if(es_validate_digest_type(digest_type) != ES_SUCCESS)
+	if(es_validate_digest_pair(digest_type, digest_backend) != ES_SUCCESS)
 		goto exit;
 
-	if(!data_1)
+	if(!data_1 || data_1_length < 0)
 		goto exit;
 
-	if(!data_2)
+	if(!data_2 || data_2_length < 0)
 		goto exit;
 
-	/* Compute the minimum size of the two data sets. */
-	data_1_size = strlen(data_1);
-	data_2_size = strlen(data_2);
-	minimum_digest_size = es_min(data_1_size, data_2_size);
+	if(!digest_data || !digest_length)
+		goto exit;
 
-	/* Decide which data set is the destination set and which is the source. */
-	destination_data = (data_1_size > data_2_size)
-		? strdup(data_1)
-		: strdup(data_2);
-	source_data = (data_1_size < data_2_size)
-		? strdup(data_1)
-		: strdup(data_2);
-
-	/* Combine the two data sets using a secure function like XOR. */
-	for(i = 0; i < minimum_digest_size; ++i)
-		destination_data[i] ^= source_data[i];
-
-	/* Compute the digest for the combined data set. */
-	if(es_compute_digest_1(
-			digest_type,
-			destination_data,
-			digest_data) != ES_SUCCESS)
+	/* Acquire the digest cached for the current thread. */
+	digest = es_acquire_digest(digest_type, digest_backend);
+	if(!digest)
+		goto exit;
+
+	/* Stream the combination of the two data sets into the digest. */
+	if(es_update_digest_combined(
+			digest,
+			data_1,
+			data_1_length,
+			data_2,
+			data_2_length,
+			scratch_data) != ES_SUCCESS)
+		goto exit;
+
+	/* Get the raw bytes of the digest internal buffer. */
+	if(es_get_digest_bytes(digest, digest_data, digest_length) != ES_SUCCESS)
 		goto exit;
 
 	/* Update the operation status. */
 	ret = ES_SUCCESS;
 
 exit:
-	/* Clear & free the destination data set. */
-	if(destination_data) {
-		memset(destination_data, 0, strlen(destination_data));
-		free(destination_data);
-		destination_data = NULL;
+	/* If the operation failed, report an empty digest. */
+	if(ret == ES_FAILURE && digest_length)
+		*digest_length = 0;
+
+	/* Reset the cached digest so that no mixed data lingers in it. */
+	if(digest)
+		es_reset_digest(digest);
+
+	return ret;
+}
+
+/**
+ * Checks whether every job of a batch can be handed to a multi-lane kernel:
+ * the jobs must be valid, combined in their scratch buffers and equally long.
+ *
+ * @param jobs The digest jobs to be computed.
+ * @param count The number of digest jobs.
+ * @return ES_SUCCESS if the jobs fit a multi-lane kernel, ES_FAILURE otherwise.
+ */
+static const int es_check_digest_jobs_lanes(
+	struct es_digest_job *jobs,
+	const int count)
+{
+	int i;
+	int length = es_max(jobs[0].data_1_length, jobs[0].data_2_length);
+
+	for(i = 0; i < count; ++i) {
+		if(!jobs[i].data_1 || jobs[i].data_1_length < 0
+				|| !jobs[i].data_2 || jobs[i].data_2_length < 0
+				|| !jobs[i].scratch_data
+				|| !jobs[i].digest_data || jobs[i].digest_length < 0)
+			return ES_FAILURE;
+
+		if(es_max(jobs[i].data_1_length, jobs[i].data_2_length) != length)
+			return ES_FAILURE;
+	}
+
+	return ES_SUCCESS;
+}
+
+/**
+ * Computes the raw digests of a batch of jobs with a multi-lane kernel. The
+ * data sets of every job are combined in its scratch buffer, then the jobs are
+ * digested a group of lanes at a time. The lanes of a partial group left
+ * without a job repeat the first job of the group and their digests are
+ * dropped. Every scratch buffer is wiped once digested.
+ *
+ * @param kernel The multi-lane kernel.
+ * @param lanes The number of lanes of the kernel.
+ * @param digest_size The size in bytes of the raw digest.
+ * @param jobs The digest jobs to be computed, as checked by
+ * es_check_digest_jobs_lanes.
+ * @param count The number of digest jobs.
+ */
+static void es_compute_digest_batch_lanes(
+	es_sha_lanes_kernel kernel,
+	const int lanes,
+	const int digest_size,
+	struct es_digest_job *jobs,
+	const int count)
+{
+	int i;
+	int j;
+	int group;
+	int minimum_size;
+	int maximum_size;
+	const char *destination_data = NULL;
+	const char *source_data = NULL;
+	const unsigned char *data[ES_SHA_MAXIMUM_LANES];
+	unsigned char *digests[ES_SHA_MAXIMUM_LANES];
+	unsigned char digest_data[ES_SHA_MAXIMUM_LANES][ES_MAXIMUM_DIGEST_SIZE];
+
+	/* Combine the two data sets of every job in its scratch buffer. */
+	for(i = 0; i < count; ++i) {
+		destination_data = (jobs[i].data_1_length >= jobs[i].data_2_length)
+			? jobs[i].data_1
+			: jobs[i].data_2;
+		source_data = (jobs[i].data_1_length >= jobs[i].data_2_length)
+			? jobs[i].data_2
+			: jobs[i].data_1;
+		minimum_size = es_min(jobs[i].data_1_length, jobs[i].data_2_length);
+		maximum_size = es_max(jobs[i].data_1_length, jobs[i].data_2_length);
+
+		es_xor_bytes(
+			jobs[i].scratch_data,
+			destination_data,
+			source_data,
+			minimum_size);
+		if(jobs[i].scratch_data != destination_data)
+			memcpy(
+				jobs[i].scratch_data + minimum_size,
+				destination_data + minimum_size,
+				maximum_size - minimum_size);
+	}
+
+	for(i = 0; i < count; i += lanes) {
+		group = es_min(lanes, count - i);
+
+		/* Digest a group of equally long jobs side by side. */
+		for(j = 0; j < lanes; ++j) {
+			data[j] = (const unsigned char*)
+				jobs[i + ((j < group) ? j : 0)].scratch_data;
+			digests[j] = digest_data[j];
+		}
+
+		kernel(data, maximum_size, digests);
+
+		/* Wipe the combinations and write the digests of the group. */
+		for(j = 0; j < group; ++j) {
+			es_wipe_memory(jobs[i + j].scratch_data, maximum_size);
+
+			jobs[i + j].digest_length = es_min(
+				jobs[i + j].digest_length,
+				digest_size);
+			memcpy(
+				jobs[i + j].digest_data,
+				digest_data[j],
+				jobs[i + j].digest_length);
+		}
+	}
+
+	/* Clear the digest bytes. */
+	es_wipe_memory(digest_data, sizeof(digest_data));
+}
+
+/**
+ * Checks whether a digest batch is computed by a multi-lane kernel, which is
+ * the case when the CPU dispatch layer bound one for the digest type and the
+ * batch holds at least its minimum number of messages.
+ *
+ * @param digest_type The digest type represents the digest algorithm code.
+ * @param count The number of digest jobs in the batch.
+ * @return ES_SUCCESS if the batch is computed by a multi-lane kernel,
+ * ES_FAILURE otherwise.
+ */
+const int es_check_digest_batch_lanes(const int digest_type, const int count)
+{
+	int minimum_count = 0;
+
+	if(es_get_sha_lanes_kernel(digest_type, NULL, &minimum_count) == 0)
+		return ES_FAILURE;
+
+	if(count < minimum_count)
+		return ES_FAILURE;
+
+	return ES_SUCCESS;
+}
+
+/**
+ * Computes the raw digests of a batch of independent jobs in one call. Each job
+ * combines two data sets the same way es_compute_digest_2 does. If the CPU
+ * dispatch layer bound a multi-lane kernel for the digest type, equally long
+ * jobs combined in their scratch buffers are digested side by side, one per
+ * vector lane. Otherwise, the digest context is acquired once for the whole
+ * batch and reset between jobs.
+ *
+ * @param digest_type The digest type represents the digest algorithm code which
+ * identifies a particular digest algorithm used to compute the digests.
+ * @param digest_backend The digest backend code representing the library
+ * implementing the digest algorithm.
+ * @param jobs The digest jobs to be computed. On output, the digest length of
+ * each job holds the number of digest bytes written, or zero if the job failed.
+ * @param count The number of digest jobs, at most ES_MAXIMUM_DIGEST_BATCH_SIZE.
+ * @return ES_SUCCESS if every job was successfull, ES_FAILURE otherwise.
+ */
+const int es_compute_digest_batch(
+	const int digest_type,
+	const int digest_backend,
+	struct es_digest_job *jobs,
+	const int count)
+{
+	int i;
+	int lanes;
+	int ret = ES_FAILURE;
+	struct es_digest *digest = NULL;
+	es_sha_lanes_kernel kernel = NULL;
+
+	/* Perform sanity checks. */
+	if(es_validate_digest_pair(digest_type, digest_backend) != ES_SUCCESS)
+		return ES_FAILURE;
+
+	if(!jobs)
+		return ES_FAILURE;
+
+	if(count <= 0 || count > ES_MAXIMUM_DIGEST_BATCH_SIZE)
+		return ES_FAILURE;
+
+	/* Digest the jobs side by side if a multi-lane kernel fits the batch. */
+	lanes = es_get_sha_lanes_kernel(digest_type, &kernel, NULL);
+	if(es_check_digest_batch_lanes(digest_type, count) == ES_SUCCESS
+			&& es_check_digest_jobs_lanes(jobs, count) == ES_SUCCESS) {
+		es_compute_digest_batch_lanes(
+			kernel,
+			lanes,
+			es_get_digest_size(digest_type),
+			jobs,
+			count);
+
+		return ES_SUCCESS;
 	}
 
-	/* Clear & free the source data set. */
-	if(source_data) {
-		memset(source_data, 0, strlen(source_data));
-		free(source_data);
-		source_data = NULL;
+	/* Acquire the digest cached for the current thread, once for the batch. */
+	digest = es_acquire_digest(digest_type, digest_backend);
+	if(!digest)
+		return ES_FAILURE;
+
+	ret = ES_SUCCESS;
+	for(i = 0; i < count; ++i) {
+		/* Stream the job data sets and collect the raw digest bytes. */
+		if(!jobs[i].data_1 || jobs[i].data_1_length < 0
+				|| !jobs[i].data_2 || jobs[i].data_2_length < 0
+				|| !jobs[i].digest_data
+				|| es_update_digest_combined(
+					digest,
+					jobs[i].data_1,
+					jobs[i].data_1_length,
+					jobs[i].data_2,
+					jobs[i].data_2_length,
+					jobs[i].scratch_data) != ES_SUCCESS
+				|| es_get_digest_bytes(
+					digest,
+					jobs[i].digest_data,
+					&jobs[i].digest_length) != ES_SUCCESS) {
+			jobs[i].digest_length = 0;
+			ret = ES_FAILURE;
+		}
+
+		/* Reset the digest for the next job. */
+		if(es_reset_digest(digest) != ES_SUCCESS)
+			return ES_FAILURE;
 	}
 
 	return ret;
 }
+
+/** Gets the minimum of two compile-time constants. */
+#define ES_MIN_CONSTANT(X, Y) ((X) < (Y) ? (X) : (Y))
+
+/**
+ * Defines a block mixer specialized for the given digest algorithm and block
+ * size. The buffer is zero padded to the block size, which yields the same
+ * combination as es_update_digest_combined, so the XOR loop and the digest
+ * input run over a compile-time constant length.
+ *
+ * @param NAME The digest name used in the mixer function name.
+ * @param DIGEST_TYPE The digest algorithm code.
+ * @param DIGEST_SIZE The size in bytes of the raw digest.
+ * @param BLOCK_SIZE The block size in bytes.
+ */
+#define ES_DEFINE_BLOCK_MIXER(NAME, DIGEST_TYPE, DIGEST_SIZE, BLOCK_SIZE) \
+static const int es_mix_block_##NAME##_##BLOCK_SIZE( \
+	const char *content, \
+	char *buffer, \
+	const int buffer_length, \
+	const int digest_backend, \
+	int *digest_length) \
+{ \
+	int i; \
+	int length = 0; \
+	int ret = ES_FAILURE; \
+	struct es_digest *digest = NULL; \
+	unsigned char digest_data[ES_MAXIMUM_DIGEST_SIZE]; \
+	const char * restrict source = content; \
+	char * restrict destination = buffer; \
+\
+	*digest_length = 0; \
+\
+	/* Combine the content and the zero padded buffer in place. */ \
+	memset(destination + buffer_length, 0, (BLOCK_SIZE) - buffer_length); \
+	for(i = 0; i < (BLOCK_SIZE); ++i) \
+		destination[i] ^= source[i]; \
+\
+	digest = es_acquire_digest((DIGEST_TYPE), digest_backend); \
+	if(!digest) \
+		goto exit; \
+\
+	if(digest->operations->update( \
+			digest->algorithm, \
+			destination, \
+			(BLOCK_SIZE)) != ES_SUCCESS) \
+		goto exit; \
+\
+	if(digest->operations->finish( \
+			digest->algorithm, \
+			digest_data, \
+			&length) != ES_SUCCESS) \
+		goto exit; \
+\
+	/* Replace the combination with the digest. */ \
+	es_wipe_memory(destination, (BLOCK_SIZE)); \
+	memcpy(destination, digest_data, ES_MIN_CONSTANT(DIGEST_SIZE, BLOCK_SIZE)); \
+	*digest_length = ES_MIN_CONSTANT(DIGEST_SIZE, BLOCK_SIZE); \
+\
+	/* Update the operation status. */ \
+	ret = ES_SUCCESS; \
+\
+exit: \
+	if(ret == ES_FAILURE) \
+		es_wipe_memory(destination, (BLOCK_SIZE)); \
+\
+	/* Clear the digest bytes and the cached digest state. */ \
+	es_wipe_memory(digest_data, ES_MAXIMUM_DIGEST_SIZE); \
+	if(digest) \
+		es_reset_digest(digest); \
+\
+	return ret; \
+}
+
+/** Defines the specialized block mixers of every digest for a block size. */
+#define ES_DEFINE_BLOCK_MIXERS(BLOCK_SIZE) \
+	ES_DEFINE_BLOCK_MIXER(md5, ES_MD5_DIGEST, 16, BLOCK_SIZE) \
+	ES_DEFINE_BLOCK_MIXER(sha1, ES_SHA1_DIGEST, 20, BLOCK_SIZE) \
+	ES_DEFINE_BLOCK_MIXER(sha256, ES_SHA256_DIGEST, 32, BLOCK_SIZE) \
+	ES_DEFINE_BLOCK_MIXER(sha512, ES_SHA512_DIGEST, 64, BLOCK_SIZE) \
+	ES_DEFINE_BLOCK_MIXER(blake2b, ES_BLAKE2B_DIGEST, 64, BLOCK_SIZE)
+
+ES_BLOCK_MIXER_SIZE_CLASSES(ES_DEFINE_BLOCK_MIXERS)
+
+/** Defines the row of specialized block mixers for a block size. */
+#define ES_BLOCK_MIXER_ROW(BLOCK_SIZE) { \
+		[ES_MD5_DIGEST] = es_mix_block_md5_##BLOCK_SIZE, \
+		[ES_SHA1_DIGEST] = es_mix_block_sha1_##BLOCK_SIZE, \
+		[ES_SHA256_DIGEST] = es_mix_block_sha256_##BLOCK_SIZE, \
+		[ES_SHA512_DIGEST] = es_mix_block_sha512_##BLOCK_SIZE, \
+		[ES_BLAKE2B_DIGEST] = es_mix_block_blake2b_##BLOCK_SIZE, \
+		[ES_HKDF_SHA512_DIGEST] = NULL, \
+		[ES_TREE_SHA512_DIGEST] = NULL \
+	},
+
+/** Defines the entry of a block size class. */
+#define ES_BLOCK_MIXER_SIZE(BLOCK_SIZE) BLOCK_SIZE,
+
+/** The block size classes with specialized block mixers. */
+static const int es_block_mixer_sizes[] = {
+	ES_BLOCK_MIXER_SIZE_CLASSES(ES_BLOCK_MIXER_SIZE)
+};
+
+/** The specialized block mixers, indexed by size class and digest type. */
+static const es_block_mixer_func es_block_mixers[][ES_DIGEST_TYPE_COUNT] = {
+	ES_BLOCK_MIXER_SIZE_CLASSES(ES_BLOCK_MIXER_ROW)
+};
+
+/**
+ * Gets the block mixer specialized for the specified digest type and block
+ * size. Specialized mixers are generated at compile time for the digest
+ * algorithms and for the block size classes ES_BLOCK_MIXER_SIZE_CLASSES, so
+ * the combination and digest sizes are compile-time constants.
+ *
+ * @param digest_type The digest type represents the digest algorithm code.
+ * @param digest_backend The digest backend code representing the library
+ * implementing the digest algorithm.
+ * @param block_size The block size in bytes.
+ * @return The specialized block mixer, or NULL if the combination has no
+ * specialization and the generic mixing path must be used.
+ */
+es_block_mixer_func es_get_block_mixer(
+	const int digest_type,
+	const int digest_backend,
+	const int block_size)
+{
+	int i;
+
+	/* Perform sanity checks. */
+	if(es_validate_digest_pair(digest_type, digest_backend) != ES_SUCCESS)
+		return NULL;
+
+	/* Look up the size class matching the block size exactly. */
+	for(i = 0; i < sizeof(es_block_mixer_sizes) / sizeof(int); ++i) {
+		if(es_block_mixer_sizes[i] == block_size)
+			return es_block_mixers[i][digest_type];
+	}
+
+	return NULL;
+}
@@ -0,0 +1,427 @@
+/**
+ * Copyright (c) 2016, Codrin-Victor Poienaru <cvpoienaru@gmail.com>.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * This software is provided by the copyright holders and contributors "as is"
+ * and any express or implied warranties, including, but not limited to, the
+ * implied warranties of merchantability and fitness for a particular purpose
+ * are disclaimed. In no event shall the copyright holder or contributors be
+ * liable for any direct, indirect, incidental, special, exemplary, or
+ * consequential damages (including, but not limited to, procurement of
+ * substitute goods or services; loss of use, data, or profits; or business
+ * interruption) however caused and on any theory of liability, whether in
+ * contract, strict liability, or tort (including negligence or otherwise)
+ * arising in any way out of the use of this software, even if advised of the
+ * possibility of such damage.
+ */
+
+#include <pool/entropy_policy.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+
+#include <global/defs.h>
+#include <crypto/digest.h>
+
+/**
+ * Validates a digest type against the allowed digest types of a policy.
+ *
+ * @param allowed_digest_types The bit set of the allowed digest types.
+ * @param digest_type The digest type to be validated.
+ * @param digest_backend The digest backend used with the digest type.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+static const int es_validate_entropy_policy_digest(
+	const unsigned int allowed_digest_types,
+	const int digest_type,
+	const int digest_backend)
+{
+	if(es_validate_digest_pair(digest_type, digest_backend) != ES_SUCCESS)
+		return ES_FAILURE;
+
+	/* The keyed extractor conditions blocks in groups, so it is excluded. */
+	if(digest_type == ES_HKDF_SHA512_DIGEST)
+		return ES_FAILURE;
+
+	if(!(allowed_digest_types & ES_DIGEST_TYPE_BIT(digest_type)))
+		return ES_FAILURE;
+
+	return ES_SUCCESS;
+}
+
+/**
+ * Switches the digest used for new mixes. Must be called with the policy mutex
+ * held.
+ *
+ * @param policy The digest policy.
+ * @param digest_type The new digest type.
+ */
+static void es_switch_entropy_policy_digest(
+	struct es_entropy_policy *policy,
+	const int digest_type)
+{
+	if(policy->digest_type == digest_type)
+		return;
+
+	__atomic_store_n(&policy->digest_type, digest_type, __ATOMIC_RELAXED);
+
+	/* Record the switch. */
+	policy->metrics.digest_type = digest_type;
+	++policy->metrics.switch_count;
+	if(digest_type == policy->burst_digest_type)
+		++policy->metrics.burst_switch_count;
+	else
+		++policy->metrics.idle_switch_count;
+
+	if(ES_DEBUG) {
+		printf(
+			"Digest policy: switched to %s digest %d (clean depth %d, "
+			"average mix time %lu ns)\n",
+			digest_type == policy->burst_digest_type ? "burst" : "idle",
+			digest_type,
+			policy->metrics.clean_depth,
+			policy->metrics.average_mix_time);
+	}
+}
+
+/**
+ * Allocates memory for a digest policy.
+ *
+ * @return The address of a newly allocated digest policy if the operation was
+ * successfull, NULL otherwise.
+ */
+struct es_entropy_policy* es_alloc_entropy_policy(void)
+{
+	struct es_entropy_policy *policy = NULL;
+
+	/* Allocate memory for the digest policy structure. */
+	policy = (struct es_entropy_policy*)calloc(
+		1,
+		sizeof(struct es_entropy_policy));
+	if(!policy)
+		return NULL;
+
+	/* Initialize the underlying mutex. */
+	if(pthread_mutex_init(&policy->mutex, NULL)) {
+		free(policy);
+		return NULL;
+	}
+
+	return policy;
+}
+
+/**
+ * Frees the memory used by a digest policy.
+ *
+ * @param policy The digest policy to be freed.
+ */
+void es_free_entropy_policy(struct es_entropy_policy **policy)
+{
+	/* Perform sanity checks. */
+	if(!policy || !(*policy))
+		return;
+
+	/* Destroy the mutex associated with the current digest policy. */
+	pthread_mutex_destroy(&(*policy)->mutex);
+
+	/* Free the digest policy structure. */
+	free(*policy);
+	*policy = NULL;
+}
+
+/**
+ * Initializes a digest policy. The policy starts on the idle digest.
+ *
+ * @param policy The digest policy to be initialized.
+ * @param allowed_digest_types The bit set of the allowed digest types. The
+ * HKDF-SHA-512 keyed extractor cannot be switched to or from.
+ * @param idle_digest_type The digest type used while the pool keeps up.
+ * @param burst_digest_type The digest type used during bursts.
+ * @param digest_backend The digest backend used with both digest types.
+ * @param low_watermark The clean queue depth at or below which the policy
+ * switches to the burst digest.
+ * @param high_watermark The clean queue depth at or above which the policy
+ * switches back to the idle digest.
+ * @param low_time_budget The mixing CPU time per block in nanoseconds at or
+ * below which the policy may switch back to the idle digest, or zero.
+ * @param high_time_budget The mixing CPU time per block in nanoseconds above
+ * which the policy switches to the burst digest, or zero.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_init_entropy_policy(
+	struct es_entropy_policy *policy,
+	const unsigned int allowed_digest_types,
+	const int idle_digest_type,
+	const int burst_digest_type,
+	const int digest_backend,
+	const int low_watermark,
+	const int high_watermark,
+	const unsigned long low_time_budget,
+	const unsigned long high_time_budget)
+{
+	/* Perform sanity checks. */
+	if(!policy)
+		return ES_FAILURE;
+
+	if(es_validate_entropy_policy_digest(
+			allowed_digest_types,
+			idle_digest_type,
+			digest_backend) != ES_SUCCESS)
+		return ES_FAILURE;
+
+	if(es_validate_entropy_policy_digest(
+			allowed_digest_types,
+			burst_digest_type,
+			digest_backend) != ES_SUCCESS)
+		return ES_FAILURE;
+
+	/* The watermarks must leave room for hysteresis. */
+	if(low_watermark < 0 || high_watermark <= low_watermark)
+		return ES_FAILURE;
+
+	/* So must the time budgets, unless the CPU time criterion is disabled. */
+	if(high_time_budget == 0 && low_time_budget != 0)
+		return ES_FAILURE;
+
+	if(high_time_budget != 0
+			&& (low_time_budget == 0 || high_time_budget <= low_time_budget))
+		return ES_FAILURE;
+
+	/* Initialize the structure fields. */
+	policy->allowed_digest_types = allowed_digest_types;
+	policy->idle_digest_type = idle_digest_type;
+	policy->burst_digest_type = burst_digest_type;
+	policy->digest_backend = digest_backend;
+	policy->low_watermark = low_watermark;
+	policy->high_watermark = high_watermark;
+	policy->low_time_budget = low_time_budget;
+	policy->high_time_budget = high_time_budget;
+	policy->digest_type = idle_digest_type;
+
+	memset(&policy->metrics, 0, sizeof(struct es_entropy_policy_metrics));
+	policy->metrics.digest_type = idle_digest_type;
+
+	return ES_SUCCESS;
+}
+
+/**
+ * Creates a digest policy.
+ *
+ * @param allowed_digest_types The bit set of the allowed digest types.
+ * @param idle_digest_type The digest type used while the pool keeps up.
+ * @param burst_digest_type The digest type used during bursts.
+ * @param digest_backend The digest backend used with both digest types.
+ * @param low_watermark The clean queue depth at or below which the policy
+ * switches to the burst digest.
+ * @param high_watermark The clean queue depth at or above which the policy
+ * switches back to the idle digest.
+ * @param low_time_budget The mixing CPU time per block in nanoseconds at or
+ * below which the policy may switch back to the idle digest, or zero.
+ * @param high_time_budget The mixing CPU time per block in nanoseconds above
+ * which the policy switches to the burst digest, or zero.
+ * @return The address of a newly allocated digest policy if the operation was
+ * successfull, NULL otherwise.
+ */
+struct es_entropy_policy* es_create_entropy_policy(
+	const unsigned int allowed_digest_types,
+	const int idle_digest_type,
+	const int burst_digest_type,
+	const int digest_backend,
+	const int low_watermark,
+	const int high_watermark,
+	const unsigned long low_time_budget,
+	const unsigned long high_time_budget)
+{
+	int status = ES_FAILURE;
+	struct es_entropy_policy *policy = NULL;
+
+	/* Allocate memory for the digest policy. */
+	policy = es_alloc_entropy_policy();
+	if(!policy)
+		goto exit;
+
+	/* Initialize the digest policy. */
+	if(es_init_entropy_policy(
+			policy,
+			allowed_digest_types,
+			idle_digest_type,
+			burst_digest_type,
+			digest_backend,
+			low_watermark,
+			high_watermark,
+			low_time_budget,
+			high_time_budget) != ES_SUCCESS)
+		goto exit;
+
+	/* Update the operation status. */
+	status = ES_SUCCESS;
+
+exit:
+	/* If the operation failed, destroy the partially created digest policy. */
+	if(status == ES_FAILURE && policy)
+		es_destroy_entropy_policy(&policy);
+
+	return policy;
+}
+
+/**
+ * Destroys a digest policy.
+ *
+ * @param policy The digest policy to be destroyed.
+ */
+void es_destroy_entropy_policy(struct es_entropy_policy **policy)
+{
+	es_free_entropy_policy(policy);
+}
+
+/**
+ * Validates a digest policy.
+ *
+ * @param policy The digest policy to be validated.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_validate_entropy_policy(struct es_entropy_policy *policy)
+{
+	/* Perform sanity checks. */
+	if(!policy)
+		return ES_FAILURE;
+
+	if(es_validate_entropy_policy_digest(
+			policy->allowed_digest_types,
+			policy->idle_digest_type,
+			policy->digest_backend) != ES_SUCCESS)
+		return ES_FAILURE;
+
+	if(es_validate_entropy_policy_digest(
+			policy->allowed_digest_types,
+			policy->burst_digest_type,
+			policy->digest_backend) != ES_SUCCESS)
+		return ES_FAILURE;
+
+	if(policy->low_watermark < 0
+			|| policy->high_watermark <= policy->low_watermark)
+		return ES_FAILURE;
+
+	if(policy->high_time_budget == 0 && policy->low_time_budget != 0)
+		return ES_FAILURE;
+
+	if(policy->high_time_budget != 0
+			&& (policy->low_time_budget == 0
+				|| policy->high_time_budget <= policy->low_time_budget))
+		return ES_FAILURE;
+
+	return ES_SUCCESS;
+}
+
+/**
+ * Gets the digest type to be used for new mixes.
+ *
+ * @param policy The digest policy.
+ * @return The digest type to be used for new mixes.
+ */
+const int es_get_entropy_policy_digest(struct es_entropy_policy *policy)
+{
+	return __atomic_load_n(&policy->digest_type, __ATOMIC_RELAXED);
+}
+
+/**
+ * Records a mix and re-evaluates the policy. The policy switches to the burst
+ * digest when the clean queue depth drops to the low watermark or the mixing
+ * time exceeds its high budget, and back to the idle digest once the clean
+ * queue depth reaches the high watermark and the mixing time is back within
+ * its low budget.
+ *
+ * @param policy The digest policy.
+ * @param clean_depth The current clean queue depth of the pool.
+ * @param block_count The number of blocks mixed.
+ * @param mix_time The CPU time in nanoseconds spent mixing the blocks.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_record_entropy_policy_mix(
+	struct es_entropy_policy *policy,
+	const int clean_depth,
+	const int block_count,
+	const unsigned long mix_time)
+{
+	int over_budget;
+	int within_budget;
+	unsigned long block_mix_time;
+	struct es_entropy_policy_metrics *metrics = NULL;
+
+	/* Perform sanity checks. */
+	if(!policy)
+		return ES_FAILURE;
+
+	if(clean_depth < 0 || block_count <= 0)
+		return ES_FAILURE;
+
+	pthread_mutex_lock(&policy->mutex);
+	metrics = &policy->metrics;
+
+	/* Update the mixing time moving average. */
+	block_mix_time = mix_time / block_count;
+	if(metrics->mix_count == 0)
+		metrics->average_mix_time = block_mix_time;
+	else
+		metrics->average_mix_time = (
+			metrics->average_mix_time
+				* (ES_POLICY_AVERAGE_SCALE - ES_POLICY_AVERAGE_WEIGHT)
+			+ block_mix_time * ES_POLICY_AVERAGE_WEIGHT)
+			/ ES_POLICY_AVERAGE_SCALE;
+
+	metrics->mix_count += block_count;
+	metrics->mix_time += mix_time;
+	metrics->clean_depth = clean_depth;
+
+	over_budget = policy->high_time_budget
+		&& metrics->average_mix_time > policy->high_time_budget;
+	within_budget = !policy->high_time_budget
+		|| metrics->average_mix_time <= policy->low_time_budget;
+
+	/*
+	 * Switch with hysteresis between the two watermarks and the two time
+	 * budgets, keeping the current digest while either sits between them.
+	 */
+	if(clean_depth <= policy->low_watermark || over_budget)
+		es_switch_entropy_policy_digest(policy, policy->burst_digest_type);
+	else if(clean_depth >= policy->high_watermark && within_budget)
+		es_switch_entropy_policy_digest(policy, policy->idle_digest_type);
+
+	pthread_mutex_unlock(&policy->mutex);
+
+	return ES_SUCCESS;
+}
+
+/**
+ * Gets a snapshot of the metrics recorded by a digest policy.
+ *
+ * @param policy The digest policy.
+ * @param metrics The structure where to copy the metrics.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_get_entropy_policy_metrics(
+	struct es_entropy_policy *policy,
+	struct es_entropy_policy_metrics *metrics)
+{
+	/* Perform sanity checks. */
+	if(!policy || !metrics)
+		return ES_FAILURE;
+
+	pthread_mutex_lock(&policy->mutex);
+	memcpy(metrics, &policy->metrics, sizeof(struct es_entropy_policy_metrics));
+	pthread_mutex_unlock(&policy->mutex);
+
+	return ES_SUCCESS;
+}
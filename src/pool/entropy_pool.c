@@ -37,6 +37,8 @@
 #include <crypto/digest.h>
 #include <pool/entropy_block_digest.h>
 #include <pool/entropy_block.h>
+#include <pool/entropy_spill.h>
+#include <pool/entropy_policy.h>
 
 /**
  * Free the specified complex queue element.
@@ -197,6 +199,10 @@ const int es_init_entropy_pool(struct es_entropy_pool *pool, const int size)
 
 	/* Initialize the structure fields with their default values. */
 	pool->size = size;
+	pool->spill = NULL;
+	pool->policy = NULL;
+	pool->expansion_factor = 1;
+	pool->device_weight = 0;
 
 	return ES_SUCCESS;
 }
@@ -292,3 +298,153 @@ const int es_validate_entropy_pool(struct es_entropy_pool *pool)
 
 	return ES_SUCCESS;
 }
+
+/**
+ * Attaches a spill tier to an entropy pool. The spill record size must match
+ * the entropy block size. The spill is not owned by the pool and must be
+ * destroyed by the caller after the pool is no longer in use.
+ *
+ * @param pool The entropy pool to which the spill tier will be attached.
+ * @param spill The spill tier to be attached, or NULL to detach the current
+ * one.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_set_entropy_pool_spill(
+	struct es_entropy_pool *pool,
+	struct es_entropy_spill *spill)
+{
+	/* Perform sanity checks. */
+	if(!pool)
+		return ES_FAILURE;
+
+	if(es_validate_entropy_pool(pool) != ES_SUCCESS)
+		return ES_FAILURE;
+
+	if(spill) {
+		if(es_validate_entropy_spill(spill) != ES_SUCCESS)
+			return ES_FAILURE;
+
+		/* Spill records are whole entropy blocks. */
+		if(spill->record_size != pool->blocks[0]->size)
+			return ES_FAILURE;
+	}
+
+	/* Attach the spill tier. */
+	pool->spill = spill;
+
+	return ES_SUCCESS;
+}
+
+/**
+ * Attaches a load-adaptive digest policy to an entropy pool. Blocks refilled
+ * after the policy is attached are mixed with the digest selected by the
+ * policy. The policy is not owned by the pool and must be destroyed by the
+ * caller after the pool is no longer in use.
+ *
+ * @param pool The entropy pool to which the digest policy will be attached.
+ * @param policy The digest policy to be attached, or NULL to detach the current
+ * one. Both digests of the policy must be at least as long as the pool blocks,
+ * so that every block byte is digest output.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_set_entropy_pool_policy(
+	struct es_entropy_pool *pool,
+	struct es_entropy_policy *policy)
+{
+	/* Perform sanity checks. */
+	if(!pool)
+		return ES_FAILURE;
+
+	if(es_validate_entropy_pool(pool) != ES_SUCCESS)
+		return ES_FAILURE;
+
+	if(policy) {
+		if(es_validate_entropy_policy(policy) != ES_SUCCESS)
+			return ES_FAILURE;
+
+		/* The keyed extractor conditions blocks in groups. */
+		if(pool->blocks[0]->digest_type == ES_HKDF_SHA512_DIGEST)
+			return ES_FAILURE;
+
+		/* Digests shorter than a block would only be stretched over it. */
+		if(es_get_digest_size(policy->idle_digest_type) < pool->blocks[0]->size
+				|| es_get_digest_size(policy->burst_digest_type)
+					< pool->blocks[0]->size)
+			return ES_FAILURE;
+	}
+
+	/* Attach the digest policy. */
+	pool->policy = policy;
+
+	return ES_SUCCESS;
+}
+
+/**
+ * Selects the digest algorithm and the digest backend used to mix every entropy
+ * block of an entropy pool. Must be called before entropy is collected into the
+ * pool.
+ *
+ * @param pool The entropy pool to be updated.
+ * @param digest_type The digest algorithm code.
+ * @param digest_backend The digest backend code representing the library
+ * implementing the digest algorithm.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_set_entropy_pool_digest(
+	struct es_entropy_pool *pool,
+	const int digest_type,
+	const int digest_backend)
+{
+	int i;
+
+	/* Perform sanity checks. */
+	if(!pool)
+		return ES_FAILURE;
+
+	if(es_validate_entropy_pool(pool) != ES_SUCCESS)
+		return ES_FAILURE;
+
+	if(es_validate_digest_pair(digest_type, digest_backend) != ES_SUCCESS)
+		return ES_FAILURE;
+
+	/* Update the digest of every entropy block. */
+	for(i = 0; i < pool->size; ++i) {
+		if(es_set_entropy_block_digest(
+				pool->blocks[i],
+				digest_type,
+				digest_backend) != ES_SUCCESS)
+			return ES_FAILURE;
+	}
+
+	return ES_SUCCESS;
+}
+
+/**
+ * Sets the number of entropy blocks expanded from a single extract over device
+ * input, when the pool blocks are conditioned with the HKDF-SHA-512 keyed
+ * extractor. Must be called before entropy is collected into the pool.
+ *
+ * @param pool The entropy pool to be updated.
+ * @param expansion_factor The number of blocks per extract, between 1 and
+ * ES_MAXIMUM_EXPANSION_FACTOR.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_set_entropy_pool_expansion(
+	struct es_entropy_pool *pool,
+	const int expansion_factor)
+{
+	/* Perform sanity checks. */
+	if(!pool)
+		return ES_FAILURE;
+
+	if(es_validate_entropy_pool(pool) != ES_SUCCESS)
+		return ES_FAILURE;
+
+	if(expansion_factor < 1 || expansion_factor > ES_MAXIMUM_EXPANSION_FACTOR)
+		return ES_FAILURE;
+
+	/* Update the expansion factor. */
+	pool->expansion_factor = expansion_factor;
+
+	return ES_SUCCESS;
+}
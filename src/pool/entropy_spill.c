@@ -0,0 +1,620 @@
+/**
+ * Copyright (c) 2016, Codrin-Victor Poienaru <cvpoienaru@gmail.com>.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * This software is provided by the copyright holders and contributors "as is"
+ * and any express or implied warranties, including, but not limited to, the
+ * implied warranties of merchantability and fitness for a particular purpose
+ * are disclaimed. In no event shall the copyright holder or contributors be
+ * liable for any direct, indirect, incidental, special, exemplary, or
+ * consequential damages (including, but not limited to, procurement of
+ * substitute goods or services; loss of use, data, or profits; or business
+ * interruption) however caused and on any theory of liability, whether in
+ * contract, strict liability, or tort (including negligence or otherwise)
+ * arising in any way out of the use of this software, even if advised of the
+ * possibility of such damage.
+ */
+
+#include <pool/entropy_spill.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <openssl/evp.h>
+#include <openssl/rand.h>
+#include <openssl/crypto.h>
+
+#include <global/defs.h>
+#include <global/math_defs.h>
+
+/**
+ * Computes the capacity of the spill write buffer, which is the largest
+ * multiple of the record size that fits into the buffer.
+ *
+ * @param spill The entropy spill for which the capacity will be computed.
+ * @return The capacity in bytes of the spill write buffer.
+ */
+static inline const int es_get_spill_write_buffer_capacity(
+	struct es_entropy_spill *spill)
+{
+	return (ES_SPILL_WRITE_BUFFER_SIZE / spill->record_size)
+		* spill->record_size;
+}
+
+/**
+ * Encrypts or decrypts a spill record. The records are encrypted with
+ * AES-256-CTR and the record counter is placed in the high half of the
+ * initialization vector, so that the key streams of two different records
+ * never overlap.
+ *
+ * @param spill The entropy spill owning the record.
+ * @param counter The record counter.
+ * @param in The record to be transformed.
+ * @param out The buffer where to store the transformed record.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+static const int es_crypt_spill_record(
+	struct es_entropy_spill *spill,
+	const long counter,
+	const char *in,
+	char *out)
+{
+	int i;
+	int ret = ES_FAILURE;
+	int out_length = 0;
+	unsigned char iv[ES_SPILL_IV_SIZE];
+	EVP_CIPHER_CTX *context = NULL;
+
+	/* Build the record initialization vector from the record counter. */
+	memset(iv, 0, ES_SPILL_IV_SIZE);
+	for(i = 0; i < sizeof(long); ++i)
+		iv[sizeof(long) - 1 - i] = (unsigned char)(counter >> (i * 8));
+
+	context = EVP_CIPHER_CTX_new();
+	if(!context)
+		goto exit;
+
+	/* In counter mode encryption and decryption are the same operation. */
+	if(EVP_EncryptInit_ex(context, EVP_aes_256_ctr(), NULL, spill->key, iv)
+			!= 1)
+		goto exit;
+
+	if(EVP_EncryptUpdate(
+			context,
+			(unsigned char*)out,
+			&out_length,
+			(const unsigned char*)in,
+			spill->record_size) != 1)
+		goto exit;
+
+	if(out_length != spill->record_size)
+		goto exit;
+
+	/* Update the operation status. */
+	ret = ES_SUCCESS;
+
+exit:
+	if(context)
+		EVP_CIPHER_CTX_free(context);
+
+	return ret;
+}
+
+/**
+ * Flushes the spill write buffer to the spill file with a single sequential
+ * write.
+ *
+ * @param spill The entropy spill to be flushed.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+static const int es_flush_entropy_spill(struct es_entropy_spill *spill)
+{
+	int wbytes = 0;
+	int length = 0;
+
+	while(length < spill->write_buffer_length) {
+		wbytes = write(
+			spill->fd,
+			spill->write_buffer + length,
+			spill->write_buffer_length - length);
+		if(wbytes < 0)
+			return ES_FAILURE;
+
+		length += wbytes;
+	}
+
+	spill->write_offset += spill->write_buffer_length;
+	spill->write_buffer_length = 0;
+
+	return ES_SUCCESS;
+}
+
+/**
+ * Unmaps the current read window of the spill file.
+ *
+ * @param spill The entropy spill owning the read window.
+ */
+static void es_unmap_entropy_spill(struct es_entropy_spill *spill)
+{
+	if(spill->map)
+		munmap(spill->map, spill->map_length);
+
+	spill->map = NULL;
+	spill->map_offset = 0;
+	spill->map_length = 0;
+}
+
+/**
+ * Maps a read window of the spill file covering the next record to be read
+ * back.
+ *
+ * @param spill The entropy spill owning the read window.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+static const int es_map_entropy_spill(struct es_entropy_spill *spill)
+{
+	long page_size;
+	long map_offset;
+	long map_end;
+	void *map = NULL;
+
+	/* Nothing to do if the current window already covers the next record. */
+	if(spill->map
+			&& spill->read_offset >= spill->map_offset
+			&& spill->read_offset + spill->record_size
+				<= spill->map_offset + spill->map_length)
+		return ES_SUCCESS;
+
+	es_unmap_entropy_spill(spill);
+
+	/* The window must start on a page boundary. */
+	page_size = sysconf(_SC_PAGESIZE);
+	if(page_size <= 0)
+		return ES_FAILURE;
+
+	map_offset = spill->read_offset - (spill->read_offset % page_size);
+	map_end = es_min(
+		spill->write_offset,
+		spill->read_offset + ES_SPILL_WRITE_BUFFER_SIZE);
+	if(map_end < spill->read_offset + spill->record_size)
+		return ES_FAILURE;
+
+	map = mmap(
+		NULL,
+		map_end - map_offset,
+		PROT_READ,
+		MAP_SHARED,
+		spill->fd,
+		map_offset);
+	if(map == MAP_FAILED)
+		return ES_FAILURE;
+
+	spill->map = (char*)map;
+	spill->map_offset = map_offset;
+	spill->map_length = map_end - map_offset;
+
+	return ES_SUCCESS;
+}
+
+/**
+ * Starts a new spill file generation once every stored record has been read
+ * back, so that the spill file does not grow without bounds.
+ *
+ * @param spill The entropy spill to be reset.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+static const int es_reset_entropy_spill(struct es_entropy_spill *spill)
+{
+	es_unmap_entropy_spill(spill);
+
+	if(ftruncate(spill->fd, 0) != 0)
+		return ES_FAILURE;
+
+	/* Keep counting records so that no record counter is ever reused. */
+	spill->base_record += spill->read_offset / spill->record_size;
+	spill->read_offset = 0;
+	spill->write_offset = 0;
+	spill->write_buffer_length = 0;
+
+	return ES_SUCCESS;
+}
+
+/**
+ * Allocates memory for an entropy spill.
+ *
+ * @param path The path of the spill file.
+ * @return The address of a newly allocated entropy spill if the operation was
+ * successfull, NULL otherwise.
+ */
+struct es_entropy_spill* es_alloc_entropy_spill(const char *path)
+{
+	int status = ES_FAILURE;
+	struct es_entropy_spill *spill = NULL;
+
+	/* Perform sanity checks. */
+	if(!path)
+		goto exit;
+
+	/* Allocate memory for the entropy spill structure. */
+	spill = (struct es_entropy_spill*)calloc(
+		1,
+		sizeof(struct es_entropy_spill));
+	if(!spill)
+		goto exit;
+
+	spill->fd = ES_DEFAULT_DESCRIPTOR;
+
+	/* Copy the spill file path. */
+	spill->path = strdup(path);
+	if(!spill->path)
+		goto exit;
+
+	/* Allocate memory for the spill write buffer. */
+	spill->write_buffer = (char*)malloc(
+		ES_SPILL_WRITE_BUFFER_SIZE * sizeof(char));
+	if(!spill->write_buffer)
+		goto exit;
+
+	/* Initialize the underlying mutex. */
+	if(pthread_mutex_init(&spill->mutex, NULL))
+		goto exit;
+
+	/* Update the operation status. */
+	status = ES_SUCCESS;
+
+exit:
+	/* If the operation failed, free the partially allocated entropy spill. */
+	if(status == ES_FAILURE && spill)
+		es_free_entropy_spill(&spill);
+
+	return spill;
+}
+
+/**
+ * Frees the memory used by an entropy spill. The spill file is truncated and
+ * removed, and the ephemeral key is cleared.
+ *
+ * @param spill The entropy spill to be freed.
+ */
+void es_free_entropy_spill(struct es_entropy_spill **spill)
+{
+	/* Perform sanity checks. */
+	if(!spill || !(*spill))
+		return;
+
+	/* Unmap the read window. */
+	es_unmap_entropy_spill(*spill);
+
+	/* Truncate, close and remove the spill file. */
+	if((*spill)->fd >= 0) {
+		ftruncate((*spill)->fd, 0);
+		close((*spill)->fd);
+
+		if((*spill)->path)
+			unlink((*spill)->path);
+	}
+
+	if((*spill)->path)
+		free((*spill)->path);
+
+	/* Clear & free the spill write buffer. */
+	if((*spill)->write_buffer) {
+		OPENSSL_cleanse((*spill)->write_buffer, ES_SPILL_WRITE_BUFFER_SIZE);
+		free((*spill)->write_buffer);
+	}
+
+	/* Clear the ephemeral key. */
+	OPENSSL_cleanse((*spill)->key, ES_SPILL_KEY_SIZE);
+
+	/* Destroy the mutex associated with the current entropy spill. */
+	pthread_mutex_destroy(&(*spill)->mutex);
+
+	/* Free the entropy spill structure. */
+	free(*spill);
+	*spill = NULL;
+}
+
+/**
+ * Initializes an entropy spill with the default values. A fresh ephemeral key
+ * is generated and a new spill file is created, replacing any file found at
+ * the spill path.
+ *
+ * @param spill The entropy spill to be initialized.
+ * @param record_size The size in bytes of a single spill record.
+ * @param max_size The maximum size in bytes of the spill file.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_init_entropy_spill(
+	struct es_entropy_spill *spill,
+	const int record_size,
+	const long max_size)
+{
+	/* Perform sanity checks. */
+	if(!spill)
+		return ES_FAILURE;
+
+	if(record_size <= 0 || record_size > ES_SPILL_WRITE_BUFFER_SIZE)
+		return ES_FAILURE;
+
+	if(max_size < record_size)
+		return ES_FAILURE;
+
+	/* Generate the ephemeral key. */
+	if(RAND_bytes(spill->key, ES_SPILL_KEY_SIZE) != 1)
+		return ES_FAILURE;
+
+	/*
+	 * Create a new spill file, readable by the current user only. A stale file
+	 * (or a symbolic link planted at the path) is unlinked first, and the file
+	 * is created exclusively, so that pool secrets are never written through an
+	 * existing file.
+	 */
+	unlink(spill->path);
+	spill->fd = open(
+		spill->path,
+		O_RDWR | O_CREAT | O_EXCL | O_APPEND | O_NOFOLLOW | O_CLOEXEC,
+		S_IRUSR | S_IWUSR);
+	if(spill->fd < 0)
+		return ES_FAILURE;
+
+	/* Initialize the structure fields with their default values. */
+	spill->record_size = record_size;
+	spill->max_size = max_size;
+	spill->base_record = 0;
+	spill->read_offset = 0;
+	spill->write_offset = 0;
+	spill->write_buffer_length = 0;
+	spill->map = NULL;
+	spill->map_offset = 0;
+	spill->map_length = 0;
+
+	return ES_SUCCESS;
+}
+
+/**
+ * Creates an entropy spill.
+ *
+ * @param path The path of the spill file.
+ * @param record_size The size in bytes of a single spill record.
+ * @param max_size The maximum size in bytes of the spill file.
+ * @return The address of a newly allocated entropy spill if the operation was
+ * successfull, NULL otherwise.
+ */
+struct es_entropy_spill* es_create_entropy_spill(
+	const char *path,
+	const int record_size,
+	const long max_size)
+{
+	int status = ES_FAILURE;
+	struct es_entropy_spill *spill = NULL;
+
+	/* Perform sanity checks. */
+	if(!path)
+		goto exit;
+
+	/* Allocate memory for the new entropy spill. */
+	spill = es_alloc_entropy_spill(path);
+	if(!spill)
+		goto exit;
+
+	/* Initialize the entropy spill fields with their default values. */
+	if(es_init_entropy_spill(spill, record_size, max_size) != ES_SUCCESS)
+		goto exit;
+
+	/* Update the operation status. */
+	status = ES_SUCCESS;
+
+exit:
+	/* If the operation failed, destroy the partially created entropy spill. */
+	if(status == ES_FAILURE && spill)
+		es_destroy_entropy_spill(&spill);
+
+	return spill;
+}
+
+/**
+ * Destroys an entropy spill.
+ *
+ * @param spill The entropy spill to be destroyed.
+ */
+void es_destroy_entropy_spill(struct es_entropy_spill **spill)
+{
+	/* Free the given entropy spill. */
+	es_free_entropy_spill(spill);
+}
+
+/**
+ * Validates an entropy spill.
+ *
+ * @param spill The entropy spill to be validated.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise.
+ */
+const int es_validate_entropy_spill(struct es_entropy_spill *spill)
+{
+	/* Perform sanity checks. */
+	if(!spill)
+		return ES_FAILURE;
+
+	/* Perform field validation. */
+	if(!spill->path)
+		return ES_FAILURE;
+
+	if(spill->fd < 0)
+		return ES_FAILURE;
+
+	if(!spill->write_buffer)
+		return ES_FAILURE;
+
+	if(spill->record_size <= 0)
+		return ES_FAILURE;
+
+	return ES_SUCCESS;
+}
+
+/**
+ * Encrypts the specified record and appends it to the spill. Records are
+ * gathered in memory and flushed to the spill file in large sequential writes.
+ *
+ * @param spill The entropy spill where to append the record.
+ * @param record The record to be appended, of the spill record size.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise
+ * (including the case when the spill is full).
+ */
+const int es_write_entropy_spill(
+	struct es_entropy_spill *spill,
+	const char *record)
+{
+	int ret = ES_FAILURE;
+	long offset;
+
+	/* Perform sanity checks. */
+	if(!spill)
+		return ES_FAILURE;
+
+	if(es_validate_entropy_spill(spill) != ES_SUCCESS)
+		return ES_FAILURE;
+
+	if(!record)
+		return ES_FAILURE;
+
+	/* Atomic spill append operation. */
+	pthread_mutex_lock(&spill->mutex);
+
+	/* Refuse the record if the spill file is full. */
+	offset = spill->write_offset + spill->write_buffer_length;
+	if(offset + spill->record_size > spill->max_size)
+		goto exit;
+
+	/* Encrypt the record straight into the write buffer. */
+	if(es_crypt_spill_record(
+			spill,
+			spill->base_record + offset / spill->record_size,
+			record,
+			spill->write_buffer + spill->write_buffer_length) != ES_SUCCESS)
+		goto exit;
+
+	spill->write_buffer_length += spill->record_size;
+
+	/* Flush the write buffer once there is no room left for another record. */
+	if(spill->write_buffer_length + spill->record_size
+			> es_get_spill_write_buffer_capacity(spill)) {
+		if(es_flush_entropy_spill(spill) != ES_SUCCESS)
+			goto exit;
+	}
+
+	/* Update the operation status. */
+	ret = ES_SUCCESS;
+
+exit:
+	pthread_mutex_unlock(&spill->mutex);
+
+	return ret;
+}
+
+/**
+ * Reads back and decrypts the oldest record stored in the spill. Flushed
+ * records are read through a memory-mapped window of the spill file. Each
+ * record is handed out only once.
+ *
+ * @param spill The entropy spill from where to read the record.
+ * @param record The buffer where to store the record, of the spill record
+ * size.
+ * @return ES_SUCCESS if the operation was successfull, ES_FAILURE otherwise
+ * (including the case when the spill is empty).
+ */
+const int es_read_entropy_spill(struct es_entropy_spill *spill, char *record)
+{
+	int ret = ES_FAILURE;
+	const char *source = NULL;
+
+	/* Perform sanity checks. */
+	if(!spill)
+		return ES_FAILURE;
+
+	if(es_validate_entropy_spill(spill) != ES_SUCCESS)
+		return ES_FAILURE;
+
+	if(!record)
+		return ES_FAILURE;
+
+	/* Atomic spill read operation. */
+	pthread_mutex_lock(&spill->mutex);
+
+	if(spill->read_offset + spill->record_size <= spill->write_offset) {
+		/* The record was flushed, so read it through the mapped window. */
+		if(es_map_entropy_spill(spill) != ES_SUCCESS)
+			goto exit;
+
+		source = spill->map + (spill->read_offset - spill->map_offset);
+	} else if(spill->read_offset + spill->record_size
+			<= spill->write_offset + spill->write_buffer_length) {
+		/* The record is still waiting in the write buffer. */
+		source = spill->write_buffer
+			+ (spill->read_offset - spill->write_offset);
+	} else {
+		/* The spill is empty. */
+		goto exit;
+	}
+
+	/* Decrypt the record into the caller buffer. */
+	if(es_crypt_spill_record(
+			spill,
+			spill->base_record + spill->read_offset / spill->record_size,
+			source,
+			record) != ES_SUCCESS)
+		goto exit;
+
+	spill->read_offset += spill->record_size;
+
+	/* Start a new spill file generation once everything was read back. */
+	if(spill->read_offset == spill->write_offset + spill->write_buffer_length)
+		es_reset_entropy_spill(spill);
+
+	/* Update the operation status. */
+	ret = ES_SUCCESS;
+
+exit:
+	pthread_mutex_unlock(&spill->mutex);
+
+	return ret;
+}
+
+/**
+ * Gets the number of records stored in the spill which were not read back yet.
+ *
+ * @param spill The entropy spill to be checked.
+ * @return The number of records available in the spill.
+ */
+const long es_get_entropy_spill_record_count(struct es_entropy_spill *spill)
+{
+	long count = 0;
+
+	/* Perform sanity checks. */
+	if(!spill)
+		return count;
+
+	if(es_validate_entropy_spill(spill) != ES_SUCCESS)
+		return count;
+
+	pthread_mutex_lock(&spill->mutex);
+	count = (spill->write_offset + spill->write_buffer_length
+		- spill->read_offset) / spill->record_size;
+	pthread_mutex_unlock(&spill->mutex);
+
+	return count;
+}
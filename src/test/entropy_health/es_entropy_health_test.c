@@ -0,0 +1,296 @@
+/**
+ * Copyright (c) 2016, Codrin-Victor Poienaru <cvpoienaru@gmail.com>.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * This software is provided by the copyright holders and contributors "as is"
+ * and any express or implied warranties, including, but not limited to, the
+ * implied warranties of merchantability and fitness for a particular purpose
+ * are disclaimed. In no event shall the copyright holder or contributors be
+ * liable for any direct, indirect, incidental, special, exemplary, or
+ * consequential damages (including, but not limited to, procurement of
+ * substitute goods or services; loss of use, data, or profits; or business
+ * interruption) however caused and on any theory of liability, whether in
+ * contract, strict liability, or tort (including negligence or otherwise)
+ * arising in any way out of the use of this software, even if advised of the
+ * possibility of such damage.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <global/defs.h>
+#include <generator/entropy_health.h>
+
+/** Represents the size in bytes of the test input buffer. */
+#define ES_HEALTH_TEST_BUFFER_SIZE (2 * ES_HEALTH_APT_WINDOW_SIZE)
+
+/** Represents the byte repeated by the test inputs. */
+#define ES_HEALTH_TEST_VALUE 0x5a
+
+/** Represents the byte separating the runs of the repeated byte. */
+#define ES_HEALTH_TEST_SEPARATOR 0xa5
+
+/**
+ * Prints the result of a health test case.
+ *
+ * @param name The name of the test case.
+ * @param passed TRUE if the test case passed, FALSE otherwise.
+ * @return ES_SUCCESS if the test case passed, ES_FAILURE otherwise.
+ */
+static const int es_report_health_test_case(const char *name, const int passed)
+{
+	printf("%s: %s\n", name, passed ? "PASS" : "FAIL");
+
+	return passed ? ES_SUCCESS : ES_FAILURE;
+}
+
+/**
+ * Checks the repetition count test cutoffs against the SP 800-90B formula
+ * C = 1 + ceil(20 / H), for a false positive probability of 2^-20.
+ *
+ * @return ES_SUCCESS if the test case passed, ES_FAILURE otherwise.
+ */
+static const int es_test_rct_cutoffs(void)
+{
+	int min_entropy;
+	int passed = TRUE;
+	struct es_entropy_health *health = NULL;
+
+	for(min_entropy = 1;
+			min_entropy <= ES_MAXIMUM_HEALTH_MIN_ENTROPY;
+			++min_entropy) {
+		health = es_create_entropy_health(min_entropy);
+		if(!health
+				|| health->rct_cutoff
+					!= 1 + (20 + min_entropy - 1) / min_entropy)
+			passed = FALSE;
+
+		if(health)
+			es_destroy_entropy_health(&health);
+	}
+
+	return es_report_health_test_case("RCT cutoffs", passed);
+}
+
+/**
+ * Checks that a stuck device, repeating the same byte, fails the repetition
+ * count test, and that the failure is sticky.
+ *
+ * @return ES_SUCCESS if the test case passed, ES_FAILURE otherwise.
+ */
+static const int es_test_stuck_byte(void)
+{
+	int passed = FALSE;
+	char buffer[ES_HEALTH_TEST_BUFFER_SIZE];
+	struct es_entropy_health *health = NULL;
+
+	health = es_create_entropy_health(ES_DEFAULT_HEALTH_MIN_ENTROPY);
+	if(!health)
+		goto exit;
+
+	memset(buffer, ES_HEALTH_TEST_VALUE, ES_HEALTH_TEST_BUFFER_SIZE);
+
+	passed = es_test_entropy_health(
+			health,
+			buffer,
+			ES_HEALTH_TEST_BUFFER_SIZE) != ES_SUCCESS
+		&& es_get_entropy_health_failure(health) == ES_HEALTH_RCT_FAILURE
+		&& es_test_entropy_health(health, "\x01", 1) != ES_SUCCESS;
+
+exit:
+	if(health)
+		es_destroy_entropy_health(&health);
+
+	return es_report_health_test_case("RCT stuck byte", passed);
+}
+
+/**
+ * Checks that a run one byte shorter than the repetition count cutoff passes,
+ * and that the next repetition fails, even when split across calls.
+ *
+ * @return ES_SUCCESS if the test case passed, ES_FAILURE otherwise.
+ */
+static const int es_test_rct_boundary(void)
+{
+	int passed = FALSE;
+	char value = (char)ES_HEALTH_TEST_VALUE;
+	char buffer[ES_HEALTH_TEST_BUFFER_SIZE];
+	struct es_entropy_health *health = NULL;
+
+	health = es_create_entropy_health(ES_DEFAULT_HEALTH_MIN_ENTROPY);
+	if(!health)
+		goto exit;
+
+	memset(buffer, ES_HEALTH_TEST_VALUE, ES_HEALTH_TEST_BUFFER_SIZE);
+
+	passed = es_test_entropy_health(
+			health,
+			buffer,
+			health->rct_cutoff - 1) == ES_SUCCESS
+		&& es_test_entropy_health(health, &value, 1) != ES_SUCCESS
+		&& es_get_entropy_health_failure(health) == ES_HEALTH_RCT_FAILURE;
+
+exit:
+	if(health)
+		es_destroy_entropy_health(&health);
+
+	return es_report_health_test_case("RCT cutoff boundary", passed);
+}
+
+/**
+ * Fills a buffer with the repeated byte, broken into runs short enough to pass
+ * the repetition count test, until the repeated byte occurs the specified
+ * number of times.
+ *
+ * @param buffer The buffer to be filled.
+ * @param count The number of occurrences of the repeated byte.
+ * @param run_length The maximum length of a run of the repeated byte.
+ * @return The number of bytes written to the buffer.
+ */
+static const int es_fill_health_test_buffer(
+	char *buffer,
+	const int count,
+	const int run_length)
+{
+	int length = 0;
+	int occurrences = 0;
+	int run = 0;
+
+	while(occurrences < count) {
+		if(run == run_length) {
+			buffer[length++] = (char)ES_HEALTH_TEST_SEPARATOR;
+			run = 0;
+			continue;
+		}
+
+		buffer[length++] = (char)ES_HEALTH_TEST_VALUE;
+		++occurrences;
+		++run;
+	}
+
+	return length;
+}
+
+/**
+ * Checks that a window holding the repeated byte one time less than the
+ * adaptive proportion test cutoff passes, and that one more occurrence in the
+ * same window fails. The repeated byte never runs long enough to trip the
+ * repetition count test.
+ *
+ * @return ES_SUCCESS if the test case passed, ES_FAILURE otherwise.
+ */
+static const int es_test_apt_boundary(void)
+{
+	int length;
+	int passed = FALSE;
+	char buffer[ES_HEALTH_TEST_BUFFER_SIZE];
+	struct es_entropy_health *health = NULL;
+
+	health = es_create_entropy_health(ES_DEFAULT_HEALTH_MIN_ENTROPY);
+	if(!health)
+		goto exit;
+
+	/* Separate the last run, so that one more occurrence is a fresh run. */
+	length = es_fill_health_test_buffer(
+		buffer,
+		health->apt_cutoff - 1,
+		health->rct_cutoff - 1);
+	buffer[length++] = (char)ES_HEALTH_TEST_SEPARATOR;
+	if(length >= ES_HEALTH_APT_WINDOW_SIZE)
+		goto exit;
+
+	buffer[length] = (char)ES_HEALTH_TEST_VALUE;
+
+	passed = es_test_entropy_health(health, buffer, length) == ES_SUCCESS
+		&& es_test_entropy_health(health, buffer + length, 1) != ES_SUCCESS
+		&& es_get_entropy_health_failure(health) == ES_HEALTH_APT_FAILURE;
+
+exit:
+	if(health)
+		es_destroy_entropy_health(&health);
+
+	return es_report_health_test_case("APT cutoff boundary", passed);
+}
+
+/**
+ * Checks that the adaptive proportion test count restarts with every window,
+ * so that occurrences spread over two windows do not add up.
+ *
+ * @return ES_SUCCESS if the test case passed, ES_FAILURE otherwise.
+ */
+static const int es_test_apt_window(void)
+{
+	int length;
+	int passed = FALSE;
+	char buffer[ES_HEALTH_TEST_BUFFER_SIZE];
+	struct es_entropy_health *health = NULL;
+
+	health = es_create_entropy_health(ES_DEFAULT_HEALTH_MIN_ENTROPY);
+	if(!health)
+		goto exit;
+
+	/*
+	 * Fill the first window with the repeated byte just under the cutoff and
+	 * pad it with alternating bytes, then repeat the same pattern in the
+	 * second window.
+	 */
+	length = es_fill_health_test_buffer(
+		buffer,
+		health->apt_cutoff - 1,
+		health->rct_cutoff - 1);
+	if(length >= ES_HEALTH_APT_WINDOW_SIZE)
+		goto exit;
+
+	for(; length < ES_HEALTH_APT_WINDOW_SIZE; ++length)
+		buffer[length] = (char)((length % 2) ? 0x01 : 0x02);
+
+	memcpy(
+		buffer + ES_HEALTH_APT_WINDOW_SIZE,
+		buffer,
+		ES_HEALTH_APT_WINDOW_SIZE);
+
+	passed = es_test_entropy_health(
+			health,
+			buffer,
+			ES_HEALTH_TEST_BUFFER_SIZE) == ES_SUCCESS
+		&& health->byte_count == ES_HEALTH_TEST_BUFFER_SIZE;
+
+exit:
+	if(health)
+		es_destroy_entropy_health(&health);
+
+	return es_report_health_test_case("APT window restart", passed);
+}
+
+int main(int argc, char **argv)
+{
+	int ret = ES_SUCCESS;
+
+	if(es_test_rct_cutoffs() != ES_SUCCESS)
+		ret = ES_FAILURE;
+
+	if(es_test_stuck_byte() != ES_SUCCESS)
+		ret = ES_FAILURE;
+
+	if(es_test_rct_boundary() != ES_SUCCESS)
+		ret = ES_FAILURE;
+
+	if(es_test_apt_boundary() != ES_SUCCESS)
+		ret = ES_FAILURE;
+
+	if(es_test_apt_window() != ES_SUCCESS)
+		ret = ES_FAILURE;
+
+	return ret;
+}
@@ -0,0 +1,182 @@
+/**
+ * Copyright (c) 2016, Codrin-Victor Poienaru <cvpoienaru@gmail.com>.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * This software is provided by the copyright holders and contributors "as is"
+ * and any express or implied warranties, including, but not limited to, the
+ * implied warranties of merchantability and fitness for a particular purpose
+ * are disclaimed. In no event shall the copyright holder or contributors be
+ * liable for any direct, indirect, incidental, special, exemplary, or
+ * consequential damages (including, but not limited to, procurement of
+ * substitute goods or services; loss of use, data, or profits; or business
+ * interruption) however caused and on any theory of liability, whether in
+ * contract, strict liability, or tort (including negligence or otherwise)
+ * arising in any way out of the use of this software, even if advised of the
+ * possibility of such damage.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <global/defs.h>
+#include <crypto/hkdf.h>
+
+/*
+ * The known answers below use the inputs of RFC 5869 test cases 1 and 3. The
+ * RFC only lists SHA-256 and SHA-1 outputs, so the expected values are the
+ * HKDF-SHA-512 outputs for the same inputs, as produced by independent
+ * implementations (OpenSSL and Python hmac). Test case 2 is left out, since
+ * its 80-byte context information exceeds ES_HKDF_MAXIMUM_INFO_SIZE.
+ */
+
+/** Represents the number of output bytes of the test cases (L in RFC 5869). */
+#define ES_HKDF_TEST_OUTPUT_SIZE 42
+
+/** The input keying material of RFC 5869 test cases 1 and 3. */
+static const unsigned char es_hkdf_ikm[] = {
+	0x0b, 0x0b, 0x0b, 0x0b, 0x0b, 0x0b, 0x0b, 0x0b, 0x0b, 0x0b, 0x0b, 0x0b,
+	0x0b, 0x0b, 0x0b, 0x0b, 0x0b, 0x0b, 0x0b, 0x0b, 0x0b, 0x0b
+};
+
+/** The salt of RFC 5869 test case 1. */
+static const unsigned char es_hkdf_salt[] = {
+	0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b,
+	0x0c
+};
+
+/** The context information of RFC 5869 test case 1. */
+static const unsigned char es_hkdf_info[] = {
+	0xf0, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8, 0xf9
+};
+
+/** The HKDF-SHA-512 pseudorandom key for the inputs of test case 1. */
+static const unsigned char es_hkdf_prk_1[] = {
+	0x66, 0x57, 0x99, 0x82, 0x37, 0x37, 0xde, 0xd0, 0x4a, 0x88, 0xe4, 0x7e,
+	0x54, 0xa5, 0x89, 0x0b, 0xb2, 0xc3, 0xd2, 0x47, 0xc7, 0xa4, 0x25, 0x4a,
+	0x8e, 0x61, 0x35, 0x07, 0x23, 0x59, 0x0a, 0x26, 0xc3, 0x62, 0x38, 0x12,
+	0x7d, 0x86, 0x61, 0xb8, 0x8c, 0xf8, 0x0e, 0xf8, 0x02, 0xd5, 0x7e, 0x2f,
+	0x7c, 0xeb, 0xcf, 0x1e, 0x00, 0xe0, 0x83, 0x84, 0x8b, 0xe1, 0x99, 0x29,
+	0xc6, 0x1b, 0x42, 0x37
+};
+
+/** The HKDF-SHA-512 output for the inputs of test case 1. */
+static const unsigned char es_hkdf_okm_1[] = {
+	0x83, 0x23, 0x90, 0x08, 0x6c, 0xda, 0x71, 0xfb, 0x47, 0x62, 0x5b, 0xb5,
+	0xce, 0xb1, 0x68, 0xe4, 0xc8, 0xe2, 0x6a, 0x1a, 0x16, 0xed, 0x34, 0xd9,
+	0xfc, 0x7f, 0xe9, 0x2c, 0x14, 0x81, 0x57, 0x93, 0x38, 0xda, 0x36, 0x2c,
+	0xb8, 0xd9, 0xf9, 0x25, 0xd7, 0xcb
+};
+
+/** The HKDF-SHA-512 pseudorandom key for the inputs of test case 3. */
+static const unsigned char es_hkdf_prk_3[] = {
+	0xfd, 0x20, 0x0c, 0x49, 0x87, 0xac, 0x49, 0x13, 0x13, 0xbd, 0x4a, 0x2a,
+	0x13, 0x28, 0x71, 0x21, 0x24, 0x72, 0x39, 0xe1, 0x1c, 0x9e, 0xf8, 0x28,
+	0x02, 0x04, 0x4b, 0x66, 0xef, 0x35, 0x7e, 0x5b, 0x19, 0x44, 0x98, 0xd0,
+	0x68, 0x26, 0x11, 0x38, 0x23, 0x48, 0x57, 0x2a, 0x7b, 0x16, 0x11, 0xde,
+	0x54, 0x76, 0x40, 0x94, 0x28, 0x63, 0x20, 0x57, 0x8a, 0x86, 0x3f, 0x36,
+	0x56, 0x2b, 0x0d, 0xf6
+};
+
+/** The HKDF-SHA-512 output for the inputs of test case 3. */
+static const unsigned char es_hkdf_okm_3[] = {
+	0xf5, 0xfa, 0x02, 0xb1, 0x82, 0x98, 0xa7, 0x2a, 0x8c, 0x23, 0x89, 0x8a,
+	0x87, 0x03, 0x47, 0x2c, 0x6e, 0xb1, 0x79, 0xdc, 0x20, 0x4c, 0x03, 0x42,
+	0x5c, 0x97, 0x0e, 0x3b, 0x16, 0x4b, 0xf9, 0x0f, 0xff, 0x22, 0xd0, 0x48,
+	0x36, 0xd0, 0xe2, 0x34, 0x3b, 0xac
+};
+
+/**
+ * Runs a single HKDF known-answer test case and prints its result.
+ *
+ * @param name The name of the test case.
+ * @param salt The salt of the test case.
+ * @param salt_length The number of bytes of salt.
+ * @param info The context information of the test case.
+ * @param info_length The number of bytes of context information.
+ * @param expected_prk The expected pseudorandom key.
+ * @param expected_okm The expected output keying material.
+ * @return ES_SUCCESS if the test case passed, ES_FAILURE otherwise.
+ */
+static const int es_run_hkdf_test_case(
+	const char *name,
+	const unsigned char *salt,
+	const int salt_length,
+	const unsigned char *info,
+	const int info_length,
+	const unsigned char *expected_prk,
+	const unsigned char *expected_okm)
+{
+	int ret = ES_FAILURE;
+	unsigned char prk[ES_HKDF_PRK_SIZE];
+	char okm[ES_HKDF_TEST_OUTPUT_SIZE];
+
+	/* Extract the pseudorandom key and check it. */
+	if(es_hkdf_extract(
+			(const char*)salt,
+			salt_length,
+			(const char*)es_hkdf_ikm,
+			sizeof(es_hkdf_ikm),
+			prk) != ES_SUCCESS)
+		goto exit;
+
+	if(memcmp(prk, expected_prk, ES_HKDF_PRK_SIZE))
+		goto exit;
+
+	/* Expand the pseudorandom key and check the output. */
+	if(es_hkdf_expand(
+			prk,
+			(const char*)info,
+			info_length,
+			okm,
+			ES_HKDF_TEST_OUTPUT_SIZE) != ES_SUCCESS)
+		goto exit;
+
+	if(memcmp(okm, expected_okm, ES_HKDF_TEST_OUTPUT_SIZE))
+		goto exit;
+
+	/* Update the operation status. */
+	ret = ES_SUCCESS;
+
+exit:
+	printf("%s: %s\n", name, (ret == ES_SUCCESS) ? "PASS" : "FAIL");
+
+	return ret;
+}
+
+int main(int argc, char **argv)
+{
+	int ret = ES_SUCCESS;
+
+	if(es_run_hkdf_test_case(
+			"HKDF-SHA-512 RFC 5869 test case 1",
+			es_hkdf_salt,
+			sizeof(es_hkdf_salt),
+			es_hkdf_info,
+			sizeof(es_hkdf_info),
+			es_hkdf_prk_1,
+			es_hkdf_okm_1) != ES_SUCCESS)
+		ret = ES_FAILURE;
+
+	if(es_run_hkdf_test_case(
+			"HKDF-SHA-512 RFC 5869 test case 3",
+			NULL,
+			0,
+			NULL,
+			0,
+			es_hkdf_prk_3,
+			es_hkdf_okm_3) != ES_SUCCESS)
+		ret = ES_FAILURE;
+
+	return ret;
+}
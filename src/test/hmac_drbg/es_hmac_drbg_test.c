@@ -0,0 +1,138 @@
+/**
+ * Copyright (c) 2016, Codrin-Victor Poienaru <cvpoienaru@gmail.com>.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * This software is provided by the copyright holders and contributors "as is"
+ * and any express or implied warranties, including, but not limited to, the
+ * implied warranties of merchantability and fitness for a particular purpose
+ * are disclaimed. In no event shall the copyright holder or contributors be
+ * liable for any direct, indirect, incidental, special, exemplary, or
+ * consequential damages (including, but not limited to, procurement of
+ * substitute goods or services; loss of use, data, or profits; or business
+ * interruption) however caused and on any theory of liability, whether in
+ * contract, strict liability, or tort (including negligence or otherwise)
+ * arising in any way out of the use of this software, even if advised of the
+ * possibility of such damage.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <global/defs.h>
+#include <crypto/hmac_drbg.h>
+
+/*
+ * The known answer below is COUNT 0 of the NIST CAVP HMAC_DRBG test vectors
+ * (SP 800-90A) for SHA-512, without prediction resistance, reseed,
+ * personalization string or additional input. The DRBG is instantiated from
+ * the entropy input followed by the nonce, generates the requested bits twice
+ * and the second output is compared with the returned bits.
+ */
+
+/** Represents the number of bytes returned by each generate call. */
+#define ES_HMAC_DRBG_TEST_OUTPUT_SIZE 256
+
+/** The entropy input of the test vector. */
+static const unsigned char es_hmac_drbg_entropy[] = {
+	0x35, 0x04, 0x9f, 0x38, 0x9a, 0x33, 0xc0, 0xec, 0xb1, 0x29, 0x32, 0x38,
+	0xfd, 0x95, 0x1f, 0x8f, 0xfd, 0x51, 0x7d, 0xfd, 0xe0, 0x60, 0x41, 0xd3,
+	0x29, 0x45, 0xb3, 0xe2, 0x69, 0x14, 0xba, 0x15
+};
+
+/** The nonce of the test vector. */
+static const unsigned char es_hmac_drbg_nonce[] = {
+	0xf7, 0x32, 0x87, 0x60, 0xbe, 0x61, 0x68, 0xe6, 0xaa, 0x9f, 0xb5, 0x47,
+	0x84, 0x98, 0x9a, 0x11
+};
+
+/** The returned bits of the test vector. */
+static const unsigned char es_hmac_drbg_output[] = {
+	0xe7, 0x64, 0x91, 0xb0, 0x26, 0x0a, 0xac, 0xfd, 0xed, 0x01, 0xad, 0x39,
+	0xfb, 0xf1, 0xa6, 0x6a, 0x88, 0x28, 0x4c, 0xaa, 0x51, 0x23, 0x36, 0x8a,
+	0x2a, 0xd9, 0x33, 0x0e, 0xe4, 0x83, 0x35, 0xe3, 0xc9, 0xc9, 0xba, 0x90,
+	0xe6, 0xcb, 0xc9, 0x42, 0x99, 0x62, 0xd6, 0x0c, 0x1a, 0x66, 0x61, 0xed,
+	0xcf, 0xaa, 0x31, 0xd9, 0x72, 0xb8, 0x26, 0x4b, 0x9d, 0x45, 0x62, 0xcf,
+	0x18, 0x49, 0x41, 0x28, 0xa0, 0x92, 0xc1, 0x7a, 0x8d, 0xa6, 0xf3, 0x11,
+	0x3e, 0x8a, 0x7e, 0xdf, 0xcd, 0x44, 0x27, 0x08, 0x2b, 0xd3, 0x90, 0x67,
+	0x5e, 0x96, 0x62, 0x40, 0x81, 0x44, 0x97, 0x17, 0x17, 0x30, 0x3d, 0x8d,
+	0xc3, 0x52, 0xc9, 0xe8, 0xb9, 0x5e, 0x7f, 0x35, 0xfa, 0x2a, 0xc9, 0xf5,
+	0x49, 0xb2, 0x92, 0xbc, 0x7c, 0x4b, 0xc7, 0xf0, 0x1e, 0xe0, 0xa5, 0x77,
+	0x85, 0x9e, 0xf6, 0xe8, 0x2d, 0x79, 0xef, 0x23, 0x89, 0x2d, 0x16, 0x7c,
+	0x14, 0x0d, 0x22, 0xaa, 0xc3, 0x2b, 0x64, 0xcc, 0xdf, 0xee, 0xe2, 0x73,
+	0x05, 0x28, 0xa3, 0x87, 0x63, 0xb2, 0x42, 0x27, 0xf9, 0x1a, 0xc3, 0xff,
+	0xe4, 0x7f, 0xb1, 0x15, 0x38, 0xe4, 0x35, 0x30, 0x7e, 0x77, 0x48, 0x18,
+	0x02, 0xb0, 0xf6, 0x13, 0xf3, 0x70, 0xff, 0xb0, 0xdb, 0xea, 0xb7, 0x74,
+	0xfe, 0x1e, 0xfb, 0xb1, 0xa8, 0x0d, 0x01, 0x15, 0x4a, 0x94, 0x59, 0xe7,
+	0x3a, 0xd3, 0x61, 0x10, 0x8b, 0xbc, 0x86, 0xb0, 0x91, 0x4f, 0x09, 0x51,
+	0x36, 0xcb, 0xe6, 0x34, 0x55, 0x5c, 0xe0, 0xbb, 0x26, 0x36, 0x18, 0xdc,
+	0x5c, 0x36, 0x72, 0x91, 0xce, 0x08, 0x25, 0x51, 0x89, 0x87, 0x15, 0x4f,
+	0xe9, 0xec, 0xb0, 0x52, 0xb3, 0xf0, 0xa2, 0x56, 0xfc, 0xc3, 0x0c, 0xc1,
+	0x45, 0x72, 0x53, 0x1c, 0x96, 0x28, 0x97, 0x36, 0x39, 0xbe, 0xda, 0x45,
+	0x6f, 0x2b, 0xdd, 0xf6
+};
+
+int main(int argc, char **argv)
+{
+	int ret = ES_FAILURE;
+	char seed[sizeof(es_hmac_drbg_entropy) + sizeof(es_hmac_drbg_nonce)];
+	char output[ES_HMAC_DRBG_TEST_OUTPUT_SIZE];
+	struct es_hmac_drbg *drbg = NULL;
+
+	/* Create a new HMAC_DRBG. */
+	drbg = es_create_hmac_drbg();
+	if(!drbg) {
+		perror("Cannot create the HMAC_DRBG.");
+		goto exit;
+	}
+
+	/* Instantiate the HMAC_DRBG from the entropy input and the nonce. */
+	memcpy(seed, es_hmac_drbg_entropy, sizeof(es_hmac_drbg_entropy));
+	memcpy(
+		seed + sizeof(es_hmac_drbg_entropy),
+		es_hmac_drbg_nonce,
+		sizeof(es_hmac_drbg_nonce));
+
+	if(es_instantiate_hmac_drbg(drbg, seed, sizeof(seed)) != ES_SUCCESS)
+		goto exit;
+
+	/* Generate twice and keep the second output only. */
+	if(es_generate_hmac_drbg(
+			drbg,
+			output,
+			ES_HMAC_DRBG_TEST_OUTPUT_SIZE) != ES_SUCCESS)
+		goto exit;
+
+	if(es_generate_hmac_drbg(
+			drbg,
+			output,
+			ES_HMAC_DRBG_TEST_OUTPUT_SIZE) != ES_SUCCESS)
+		goto exit;
+
+	if(memcmp(output, es_hmac_drbg_output, ES_HMAC_DRBG_TEST_OUTPUT_SIZE))
+		goto exit;
+
+	/* Update the operation status. */
+	ret = ES_SUCCESS;
+
+exit:
+	printf(
+		"HMAC_DRBG SHA-512 CAVP COUNT 0: %s\n",
+		(ret == ES_SUCCESS) ? "PASS" : "FAIL");
+
+	/* Destroy the HMAC_DRBG. */
+	if(drbg)
+		es_destroy_hmac_drbg(&drbg);
+
+	return ret;
+}
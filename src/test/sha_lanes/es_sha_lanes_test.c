@@ -0,0 +1,145 @@
+/**
+ * Copyright (c) 2016, Codrin-Victor Poienaru <cvpoienaru@gmail.com>.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * This software is provided by the copyright holders and contributors "as is"
+ * and any express or implied warranties, including, but not limited to, the
+ * implied warranties of merchantability and fitness for a particular purpose
+ * are disclaimed. In no event shall the copyright holder or contributors be
+ * liable for any direct, indirect, incidental, special, exemplary, or
+ * consequential damages (including, but not limited to, procurement of
+ * substitute goods or services; loss of use, data, or profits; or business
+ * interruption) however caused and on any theory of liability, whether in
+ * contract, strict liability, or tort (including negligence or otherwise)
+ * arising in any way out of the use of this software, even if advised of the
+ * possibility of such damage.
+ */
+
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <global/defs.h>
+#include <crypto/digest.h>
+#include <crypto/digest_backend.h>
+#include <crypto/sha_lanes.h>
+
+/*
+ * The multi-lane kernels are checked against the single-stream digests of the
+ * OpenSSL backend, over message lengths straddling the padding boundaries of
+ * both block sizes. Every lane carries a different message.
+ */
+
+/** Represents the maximum message length of the test cases. */
+#define ES_SHA_LANES_TEST_MAXIMUM_LENGTH 4096
+
+/** The message lengths of the test cases. */
+static const int es_sha_lanes_test_lengths[] = {
+	0, 1, 55, 56, 63, 64, 111, 112, 127, 128, 1000, 4096
+};
+
+/**
+ * Runs the test cases of the kernel bound for a digest type and prints their
+ * result. A digest type without a kernel on the running CPU is skipped.
+ *
+ * @param name The name of the digest type.
+ * @param digest_type The digest type.
+ * @return ES_SUCCESS if every test case passed, ES_FAILURE otherwise.
+ */
+static const int es_run_sha_lanes_test_cases(
+	const char *name,
+	const int digest_type)
+{
+	int i;
+	int j;
+	int k;
+	int lanes;
+	int length;
+	int digest_length;
+	int ret = ES_FAILURE;
+	struct es_digest *digest = NULL;
+	es_sha_lanes_kernel kernel = NULL;
+	const unsigned char *data[ES_SHA_MAXIMUM_LANES];
+	unsigned char *digests[ES_SHA_MAXIMUM_LANES];
+	static unsigned char messages[ES_SHA_MAXIMUM_LANES]
+		[ES_SHA_LANES_TEST_MAXIMUM_LENGTH];
+	unsigned char lane_digests[ES_SHA_MAXIMUM_LANES][ES_MAXIMUM_DIGEST_SIZE];
+	char expected_digest[ES_MAXIMUM_DIGEST_SIZE];
+
+	lanes = es_get_sha_lanes_kernel(digest_type, &kernel, NULL);
+	if(lanes == 0) {
+		printf("%s lanes: SKIP\n", name);
+		return ES_SUCCESS;
+	}
+
+	digest = es_acquire_digest(digest_type, ES_OPENSSL_DIGEST_BACKEND);
+	if(!digest)
+		goto exit;
+
+	for(i = 0; i < lanes; ++i) {
+		for(k = 0; k < ES_SHA_LANES_TEST_MAXIMUM_LENGTH; ++k)
+			messages[i][k] = (unsigned char)(k * 31 + i * 17 + (k >> 8));
+
+		data[i] = messages[i];
+		digests[i] = lane_digests[i];
+	}
+
+	for(j = 0; j < sizeof(es_sha_lanes_test_lengths) / sizeof(int); ++j) {
+		length = es_sha_lanes_test_lengths[j];
+		kernel(data, length, digests);
+
+		/* Check the digest of every lane against the single stream. */
+		for(i = 0; i < lanes; ++i) {
+			digest_length = ES_MAXIMUM_DIGEST_SIZE;
+			if(es_update_digest_bytes(
+					digest,
+					(const char*)messages[i],
+					length) != ES_SUCCESS
+					|| es_get_digest_bytes(
+						digest,
+						expected_digest,
+						&digest_length) != ES_SUCCESS
+					|| es_reset_digest(digest) != ES_SUCCESS)
+				goto exit;
+
+			if(memcmp(lane_digests[i], expected_digest, digest_length))
+				goto exit;
+		}
+	}
+
+	/* Update the operation status. */
+	ret = ES_SUCCESS;
+
+exit:
+	printf(
+		"%s lanes (%d): %s\n",
+		name,
+		lanes,
+		(ret == ES_SUCCESS) ? "PASS" : "FAIL");
+
+	return ret;
+}
+
+int main(int argc, char **argv)
+{
+	int ret = ES_SUCCESS;
+
+	if(es_run_sha_lanes_test_cases("SHA-256", ES_SHA256_DIGEST) != ES_SUCCESS)
+		ret = ES_FAILURE;
+
+	if(es_run_sha_lanes_test_cases("SHA-512", ES_SHA512_DIGEST) != ES_SUCCESS)
+		ret = ES_FAILURE;
+
+	return ret;
+}